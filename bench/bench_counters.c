@@ -0,0 +1,143 @@
+// Benchmark: costo por request de actualizar estadísticas globales
+//
+// Compara la contabilidad que hacía cada request antes (tres mutex globales:
+// stats del servidor, contador de conexiones y métricas) contra los
+// counter_set_t repartidos por thread.
+//
+// Uso: ./build/bench_counters [threads] [requests_por_thread]
+#include "../src/core/counters.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// ============================================================================
+// VARIANTE CON MUTEX (como server_update_stats + metrics_increment_requests)
+// ============================================================================
+
+typedef struct {
+    unsigned long connections_served;
+    unsigned long requests_ok;
+    unsigned long bytes_received;
+    unsigned long bytes_sent;
+    pthread_mutex_t mutex;
+} mutex_stats_t;
+
+static mutex_stats_t g_server_stats = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+static pthread_mutex_t g_conn_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long g_metrics_requests = 0;
+
+static void request_with_mutex(void) {
+    pthread_mutex_lock(&g_conn_mutex);
+    g_server_stats.connections_served++;
+    pthread_mutex_unlock(&g_conn_mutex);
+
+    pthread_mutex_lock(&g_server_stats.mutex);
+    g_server_stats.requests_ok++;
+    g_server_stats.bytes_received += 120;
+    g_server_stats.bytes_sent += 250;
+    pthread_mutex_unlock(&g_server_stats.mutex);
+
+    pthread_mutex_lock(&g_metrics_mutex);
+    g_metrics_requests++;
+    pthread_mutex_unlock(&g_metrics_mutex);
+}
+
+// ============================================================================
+// VARIANTE CON CONTADORES POR THREAD
+// ============================================================================
+
+enum { CTR_CONNECTIONS, CTR_OK, CTR_RX, CTR_TX, CTR_COUNT };
+
+static counter_set_t *g_server_counters;
+static counter_set_t *g_metrics_counters;
+
+static void request_with_counters(void) {
+    counter_set_add(g_server_counters, CTR_CONNECTIONS, 1);
+    counter_set_add(g_server_counters, CTR_OK, 1);
+    counter_set_add(g_server_counters, CTR_RX, 120);
+    counter_set_add(g_server_counters, CTR_TX, 250);
+    counter_set_add(g_metrics_counters, 0, 1);
+}
+
+// ============================================================================
+// HARNESS
+// ============================================================================
+
+typedef struct {
+    void (*fn)(void);
+    long iterations;
+    pthread_barrier_t *barrier;
+} bench_arg_t;
+
+static void* bench_thread(void *arg) {
+    bench_arg_t *a = (bench_arg_t*)arg;
+    pthread_barrier_wait(a->barrier);
+    for (long i = 0; i < a->iterations; i++) {
+        a->fn();
+    }
+    return NULL;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run(const char *name, void (*fn)(void), int threads, long iterations) {
+    pthread_t *tids = malloc(sizeof(pthread_t) * threads);
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, threads + 1);
+
+    bench_arg_t arg = { fn, iterations, &barrier };
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tids[i], NULL, bench_thread, &arg);
+    }
+
+    pthread_barrier_wait(&barrier);
+    double start = now_sec();
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    double elapsed = now_sec() - start;
+
+    pthread_barrier_destroy(&barrier);
+    free(tids);
+
+    double total = (double)threads * (double)iterations;
+    double ns_per_req = elapsed * 1e9 / total;
+    printf("  %-10s %8.1f ns/request (wall)  %10.0f requests/s\n",
+           name, ns_per_req, total / elapsed);
+    return ns_per_req;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : 32;
+    long iterations = argc > 2 ? atol(argv[2]) : 200000;
+    if (threads <= 0 || iterations <= 0) {
+        fprintf(stderr, "Uso: %s [threads] [requests_por_thread]\n", argv[0]);
+        return 1;
+    }
+
+    g_server_counters = counter_set_create(CTR_COUNT);
+    g_metrics_counters = counter_set_create(1);
+
+    printf("Contabilidad por request: %d threads x %ld requests\n", threads, iterations);
+    double m = run("mutex", request_with_mutex, threads, iterations);
+    double c = run("sharded", request_with_counters, threads, iterations);
+    printf("  speedup    %8.1fx\n", m / c);
+
+    // Verificar que no se perdió ningún incremento
+    unsigned long expected = (unsigned long)threads * (unsigned long)iterations;
+    if (counter_set_read(g_server_counters, CTR_OK) != expected ||
+        g_server_stats.requests_ok != expected) {
+        fprintf(stderr, "ERROR: totales inconsistentes\n");
+        return 1;
+    }
+
+    counter_set_destroy(g_server_counters);
+    counter_set_destroy(g_metrics_counters);
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Benchmark: costo de una llamada a LOG_INFO en el hot path
+//
+// Compara el logger anterior (mutex global + localtime/strftime + fprintf +
+// fflush por línea) contra el logger asíncrono con rings por thread. Ambos
+// escriben a /dev/null para medir el costo del caller, no el del disco.
+//
+// Uso: ./build/bench_logger [threads] [mensajes_por_thread]
+#include "../src/utils/utils.h"
+#include <stdarg.h>
+
+// ============================================================================
+// VARIANTE SINCRÓNICA (como el log_message original)
+// ============================================================================
+
+static FILE *g_sync_file;
+static pthread_mutex_t g_sync_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void sync_log(const char *file, int line, const char *fmt, ...) {
+    pthread_mutex_lock(&g_sync_mutex);
+
+    time_t now = time(NULL);
+    struct tm *tm_info = localtime(&now);
+    char timestamp[32];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
+
+    const char *filename = strrchr(file, '/');
+    filename = filename ? filename + 1 : file;
+    fprintf(g_sync_file, "[%s] [INFO ] [%s:%d] ", timestamp, filename, line);
+
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(g_sync_file, fmt, args);
+    va_end(args);
+
+    fprintf(g_sync_file, "\n");
+    fflush(g_sync_file);
+
+    pthread_mutex_unlock(&g_sync_mutex);
+}
+
+static void request_sync(long i) {
+    sync_log(__FILE__, __LINE__, "Processing: GET /isprime?n=%ld [%s]", i, "req-0001");
+}
+
+static void request_async(long i) {
+    LOG_INFO("Processing: GET /isprime?n=%ld [%s]", i, "req-0001");
+}
+
+// ============================================================================
+// HARNESS
+// ============================================================================
+
+typedef struct {
+    void (*fn)(long);
+    long iterations;
+    pthread_barrier_t *barrier;
+} bench_arg_t;
+
+static void* bench_thread(void *arg) {
+    bench_arg_t *a = (bench_arg_t*)arg;
+    pthread_barrier_wait(a->barrier);
+    for (long i = 0; i < a->iterations; i++) {
+        a->fn(i);
+    }
+    return NULL;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run(const char *name, void (*fn)(long), int threads, long iterations) {
+    pthread_t *tids = malloc(sizeof(pthread_t) * threads);
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, threads + 1);
+
+    bench_arg_t arg = { fn, iterations, &barrier };
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tids[i], NULL, bench_thread, &arg);
+    }
+
+    pthread_barrier_wait(&barrier);
+    double start = now_sec();
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    double elapsed = now_sec() - start;
+
+    pthread_barrier_destroy(&barrier);
+    free(tids);
+
+    double total = (double)threads * (double)iterations;
+    double ns_per_call = elapsed * 1e9 / total;
+    printf("  %-12s %8.1f ns/llamada (wall)  %10.0f líneas/s\n",
+           name, ns_per_call, total / elapsed);
+    return ns_per_call;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : 8;
+    long iterations = argc > 2 ? atol(argv[2]) : 100000;
+    if (threads <= 0 || iterations <= 0) {
+        fprintf(stderr, "Uso: %s [threads] [mensajes_por_thread]\n", argv[0]);
+        return 1;
+    }
+
+    g_sync_file = fopen("/dev/null", "w");
+    logger_init(LOG_INFO, "/dev/null");
+
+    printf("Logging en el hot path: %d threads x %ld mensajes\n", threads, iterations);
+    double s = run("sync+mutex", request_sync, threads, iterations);
+
+    // BLOCK: cada llamada cuenta, ninguna sale barata por descartarse
+    logger_set_overflow(LOG_OVERFLOW_BLOCK);
+    double a = run("async ring", request_async, threads, iterations);
+    logger_flush();
+    printf("  speedup      %8.1fx  (descartados: %lu)\n", s / a, logger_dropped());
+
+    logger_set_overflow(LOG_OVERFLOW_DROP);
+    run("async (drop)", request_async, threads, iterations);
+    logger_flush();
+    printf("  descartados con DROP: %lu\n", logger_dropped());
+
+    logger_shutdown();
+    fclose(g_sync_file);
+    return 0;
+}
@@ -0,0 +1,834 @@
+// Generador de carga open-loop
+//
+// ab y el fallback con curl de scripts/benchmark_metrics.sh son closed-loop:
+// cada cliente espera su respuesta antes de mandar la siguiente, así que si el
+// servidor se frena, también se frena la carga y las requests que "debieron"
+// salir durante la pausa nunca se miden (coordinated omission).
+//
+// Acá las llegadas siguen un calendario fijo: la request i de cada thread
+// debe salir en start + offset + i * intervalo, responda o no el servidor.
+// Si no hay conexión libre, la request espera en una cola y su latencia se
+// mide desde el momento programado. Se reportan las dos cosas:
+//   latencia          - desde el envío programado (lo que vería un usuario)
+//   tiempo de servicio - desde el envío real (lo que mide ab)
+//
+// Cada thread maneja sus conexiones no bloqueantes con epoll. Los
+// percentiles usan el histograma HDR del servidor (src/core/histogram.c).
+//
+// Uso: ./build/loadgen [opciones]   (--help para la lista)
+#include "../src/core/histogram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define MAX_ENDPOINTS   16
+#define MAX_THREADS     64
+#define PENDING_CAP     65536       // Requests atrasadas por thread (potencia de 2)
+#define RESP_HEADER_MAX 4096
+#define REQ_MAX         512
+
+// ============================================================================
+// CONFIGURACIÓN
+// ============================================================================
+
+typedef struct {
+    char path[256];
+    int weight;
+} endpoint_t;
+
+// Los mismos tres perfiles de scripts/benchmark_metrics.sh (a /random le
+// faltaba count y respondía 400), más una mezcla
+static const struct {
+    const char *name;
+    const char *spec;
+    double rate;
+    int connections;
+} PROFILES[] = {
+    { "ligera", "/random?count=10&min=1&max=100",  100.0,  10 },
+    { "media",  "/isprime?n=97",                    500.0,  50 },
+    { "alta",   "/factor?n=123456",                1000.0, 100 },
+    { "mixta",  "70:/random?count=10&min=1&max=100,20:/isprime?n=97,10:/factor?n=123456", 500.0, 50 },
+};
+#define NUM_PROFILES (int)(sizeof(PROFILES) / sizeof(PROFILES[0]))
+
+static struct {
+    const char *host;
+    const char *port;
+    double rate;                // req/s en total
+    double duration;            // segundos
+    int threads;
+    int connections;            // en total
+    bool keepalive;
+    int timeout_ms;
+    const char *profile;
+    const char *csv_path;
+    const char *json_path;
+
+    endpoint_t endpoints[MAX_ENDPOINTS];
+    int num_endpoints;
+    int total_weight;
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+} g_cfg = {
+    .host = "127.0.0.1",
+    .port = "8080",
+    .duration = 10.0,
+    .threads = 2,
+    .timeout_ms = 5000,
+};
+
+// ============================================================================
+// ESTADÍSTICAS
+// ============================================================================
+
+typedef struct {
+    uint64_t completed;
+    uint64_t status[6];         // Por clase: [2] = 2xx ... [5] = 5xx
+    uint64_t errors;            // connect/IO/respuesta inválida
+    uint64_t timeouts;
+    uint64_t unsent;            // Programadas que nunca salieron
+    uint64_t reconnects;
+    uint64_t bytes_in;
+} stats_t;
+
+static histogram_t *g_latency;                  // Desde el envío programado
+static histogram_t *g_service;                  // Desde el envío real
+static histogram_t *g_ep_latency[MAX_ENDPOINTS];
+
+// ============================================================================
+// CONEXIONES
+// ============================================================================
+
+typedef enum {
+    CONN_IDLE,
+    CONN_CONNECTING,
+    CONN_WRITING,
+    CONN_READING
+} conn_state_t;
+
+typedef struct {
+    int fd;                     // -1 = sin conexión abierta
+    conn_state_t state;
+    bool reused;                // La request va por una conexión keep-alive
+
+    int endpoint;
+    uint64_t intended_ns;
+    uint64_t sent_ns;
+
+    char req[REQ_MAX];
+    size_t req_len;
+    size_t req_off;
+
+    char head[RESP_HEADER_MAX];
+    size_t head_len;
+    bool head_done;
+    int status;
+    long content_length;        // -1 = hasta EOF
+    long body_read;
+    bool server_keeps;
+} conn_t;
+
+typedef struct {
+    uint64_t intended_ns;
+    int endpoint;
+} pending_t;
+
+typedef struct {
+    int index;
+    pthread_t thread;
+    int epfd;
+    conn_t *conns;
+    int num_conns;
+    pending_t *pending;         // Ring de requests esperando conexión
+    uint64_t pending_head;
+    uint64_t pending_tail;
+    uint64_t rng;
+    stats_t stats;
+} worker_t;
+
+static uint64_t g_start_ns;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static int pick_endpoint(worker_t *w) {
+    if (g_cfg.num_endpoints == 1) return 0;
+    int r = (int)(splitmix64(&w->rng) % (uint64_t)g_cfg.total_weight);
+    for (int i = 0; i < g_cfg.num_endpoints; i++) {
+        r -= g_cfg.endpoints[i].weight;
+        if (r < 0) return i;
+    }
+    return g_cfg.num_endpoints - 1;
+}
+
+static void conn_close(conn_t *c) {
+    if (c->fd >= 0) {
+        close(c->fd);
+        c->fd = -1;
+    }
+    c->state = CONN_IDLE;
+}
+
+static int conn_open(worker_t *w, conn_t *c) {
+    int fd = socket(g_cfg.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(fd, (struct sockaddr *)&g_cfg.addr, g_cfg.addr_len) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return -1;
+    }
+
+    struct epoll_event ev = { .events = EPOLLOUT, .data.ptr = c };
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        close(fd);
+        return -1;
+    }
+    c->fd = fd;
+    c->state = CONN_CONNECTING;
+    return 0;
+}
+
+static void conn_watch(worker_t *w, conn_t *c, uint32_t events) {
+    struct epoll_event ev = { .events = events, .data.ptr = c };
+    epoll_ctl(w->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+// Armar la request y mandarla por la conexión (abriéndola si hace falta)
+static int conn_start(worker_t *w, conn_t *c, const pending_t *p) {
+    c->endpoint = p->endpoint;
+    c->intended_ns = p->intended_ns;
+    c->req_len = (size_t)snprintf(c->req, sizeof(c->req),
+                                  "GET %s HTTP/1.0\r\nHost: %s\r\nConnection: %s\r\n\r\n",
+                                  g_cfg.endpoints[p->endpoint].path, g_cfg.host,
+                                  g_cfg.keepalive ? "keep-alive" : "close");
+    c->req_off = 0;
+    c->head_len = 0;
+    c->head_done = false;
+    c->status = 0;
+    c->content_length = -1;
+    c->body_read = 0;
+    c->server_keeps = false;
+
+    if (c->fd >= 0) {
+        c->reused = true;
+        c->state = CONN_WRITING;
+        conn_watch(w, c, EPOLLOUT);
+    } else {
+        c->reused = false;
+        if (conn_open(w, c) < 0) return -1;
+    }
+    c->sent_ns = now_ns();
+    return 0;
+}
+
+static void record_done(worker_t *w, conn_t *c) {
+    uint64_t done = now_ns();
+    uint64_t latency_us = (done - c->intended_ns) / 1000;
+    uint64_t service_us = (done - c->sent_ns) / 1000;
+
+    histogram_record(g_latency, latency_us);
+    histogram_record(g_service, service_us);
+    histogram_record(g_ep_latency[c->endpoint], latency_us);
+
+    w->stats.completed++;
+    int cls = c->status / 100;
+    if (cls >= 1 && cls <= 5) w->stats.status[cls]++;
+
+    if (g_cfg.keepalive && c->server_keeps) {
+        c->state = CONN_IDLE;
+    } else {
+        conn_close(c);
+    }
+}
+
+// Falla de la conexión. Una conexión keep-alive que el servidor cerró antes
+// de responder se reintenta una vez con una conexión nueva.
+static void conn_fail(worker_t *w, conn_t *c) {
+    bool retry = c->reused && c->head_len == 0;
+    conn_close(c);
+    if (retry) {
+        pending_t p = { c->intended_ns, c->endpoint };
+        w->stats.reconnects++;
+        if (conn_start(w, c, &p) == 0) return;
+    }
+    w->stats.errors++;
+    conn_close(c);
+}
+
+// Parsear status, Content-Length y Connection de los headers completos
+static void parse_head(conn_t *c, size_t head_end) {
+    c->head[head_end] = '\0';
+    if (sscanf(c->head, "HTTP/%*d.%*d %d", &c->status) != 1) {
+        c->status = 0;
+    }
+    bool http11 = strncmp(c->head, "HTTP/1.1", 8) == 0;
+    c->server_keeps = http11;
+
+    char *line = strstr(c->head, "\r\n");
+    while (line && line[2] != '\0') {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            c->content_length = strtol(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char *v = line + 11;
+            while (*v == ' ') v++;
+            c->server_keeps = strncasecmp(v, "keep-alive", 10) == 0;
+        }
+        line = strstr(line, "\r\n");
+    }
+    // Sin Content-Length la respuesta termina con el cierre
+    if (c->content_length < 0) c->server_keeps = false;
+}
+
+static void conn_read(worker_t *w, conn_t *c) {
+    char buf[16384];
+    for (;;) {
+        ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR) continue;
+            conn_fail(w, c);
+            return;
+        }
+        if (n == 0) {
+            // EOF: respuesta completa si los headers llegaron y no falta body
+            if (c->head_done && (c->content_length < 0 || c->body_read >= c->content_length)) {
+                c->server_keeps = false;
+                record_done(w, c);
+            } else {
+                conn_fail(w, c);
+            }
+            return;
+        }
+        w->stats.bytes_in += (uint64_t)n;
+
+        size_t off = 0;
+        if (!c->head_done) {
+            size_t room = sizeof(c->head) - 1 - c->head_len;
+            size_t take = (size_t)n < room ? (size_t)n : room;
+            memcpy(c->head + c->head_len, buf, take);
+            size_t before = c->head_len;
+            c->head_len += take;
+            c->head[c->head_len] = '\0';
+
+            char *end = strstr(c->head, "\r\n\r\n");
+            if (!end) {
+                if (c->head_len >= sizeof(c->head) - 1) conn_fail(w, c);
+                continue;
+            }
+            size_t head_end = (size_t)(end - c->head) + 4;
+            parse_head(c, head_end);
+            c->head_done = true;
+            off = head_end - before;
+        }
+        c->body_read += (long)((size_t)n - off);
+
+        if (c->content_length >= 0 && c->body_read >= c->content_length) {
+            record_done(w, c);
+            return;
+        }
+    }
+}
+
+static void conn_write(worker_t *w, conn_t *c) {
+    while (c->req_off < c->req_len) {
+        ssize_t n = send(c->fd, c->req + c->req_off, c->req_len - c->req_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR) continue;
+            conn_fail(w, c);
+            return;
+        }
+        c->req_off += (size_t)n;
+    }
+    c->state = CONN_READING;
+    conn_watch(w, c, EPOLLIN);
+}
+
+static void conn_event(worker_t *w, conn_t *c, uint32_t events) {
+    if (c->state == CONN_CONNECTING) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            conn_fail(w, c);
+            return;
+        }
+        c->state = CONN_WRITING;
+    }
+    if (c->state == CONN_WRITING && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        conn_write(w, c);
+    } else if (c->state == CONN_READING && (events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+        conn_read(w, c);
+    }
+}
+
+// ============================================================================
+// LOOP POR THREAD
+// ============================================================================
+
+static bool pending_push(worker_t *w, uint64_t intended_ns, int endpoint) {
+    if (w->pending_tail - w->pending_head >= PENDING_CAP) return false;
+    pending_t *p = &w->pending[w->pending_tail++ & (PENDING_CAP - 1)];
+    p->intended_ns = intended_ns;
+    p->endpoint = endpoint;
+    return true;
+}
+
+// Asignar requests atrasadas a conexiones libres
+static void dispatch(worker_t *w) {
+    for (int i = 0; i < w->num_conns && w->pending_head != w->pending_tail; i++) {
+        conn_t *c = &w->conns[i];
+        if (c->state != CONN_IDLE) continue;
+        pending_t p = w->pending[w->pending_head++ & (PENDING_CAP - 1)];
+        if (conn_start(w, c, &p) < 0) {
+            w->stats.errors++;
+            conn_close(c);
+        }
+    }
+}
+
+static int busy_conns(const worker_t *w) {
+    int busy = 0;
+    for (int i = 0; i < w->num_conns; i++) {
+        if (w->conns[i].state != CONN_IDLE) busy++;
+    }
+    return busy;
+}
+
+static void expire_timeouts(worker_t *w, uint64_t now) {
+    uint64_t limit = (uint64_t)g_cfg.timeout_ms * 1000000ULL;
+    for (int i = 0; i < w->num_conns; i++) {
+        conn_t *c = &w->conns[i];
+        if (c->state != CONN_IDLE && now > c->sent_ns && now - c->sent_ns > limit) {
+            w->stats.timeouts++;
+            conn_close(c);
+        }
+    }
+}
+
+static void *worker_main(void *arg) {
+    worker_t *w = arg;
+    struct epoll_event events[64];
+
+    // Cada thread genera rate/threads req/s; los offsets intercalan las llegadas
+    double interval = 1e9 * g_cfg.threads / g_cfg.rate;
+    uint64_t offset = (uint64_t)(1e9 * w->index / g_cfg.rate);
+    uint64_t end_ns = g_start_ns + (uint64_t)(g_cfg.duration * 1e9);
+    uint64_t drain_ns = end_ns + (uint64_t)g_cfg.timeout_ms * 1000000ULL;
+    uint64_t seq = 0;
+
+    for (;;) {
+        uint64_t now = now_ns();
+        uint64_t next = g_start_ns + offset + (uint64_t)(seq * interval);
+
+        // Encolar todas las llegadas cuyo momento ya pasó
+        while (next <= now && next < end_ns) {
+            if (!pending_push(w, next, pick_endpoint(w))) {
+                w->stats.unsent++;
+            }
+            seq++;
+            next = g_start_ns + offset + (uint64_t)(seq * interval);
+        }
+        dispatch(w);
+        expire_timeouts(w, now);
+
+        bool generating = next < end_ns;
+        bool outstanding = w->pending_head != w->pending_tail || busy_conns(w) > 0;
+        if (!generating && (!outstanding || now >= drain_ns)) break;
+
+        // Dormir hasta la próxima llegada (epoll tiene resolución de ms: por
+        // debajo de 1 ms se hace polling)
+        int timeout_ms = 10;
+        if (generating) {
+            uint64_t wait = next > now ? next - now : 0;
+            timeout_ms = (int)(wait / 1000000ULL);
+            if (timeout_ms > 10) timeout_ms = 10;
+        }
+        int n = epoll_wait(w->epfd, events, 64, timeout_ms);
+        for (int i = 0; i < n; i++) {
+            conn_event(w, events[i].data.ptr, events[i].events);
+        }
+    }
+
+    // Lo que quedó sin respuesta o sin enviar al cerrar la ventana de drenaje
+    w->stats.unsent += w->pending_tail - w->pending_head;
+    for (int i = 0; i < w->num_conns; i++) {
+        if (w->conns[i].state != CONN_IDLE) w->stats.timeouts++;
+        conn_close(&w->conns[i]);
+    }
+    return NULL;
+}
+
+// ============================================================================
+// REPORTE
+// ============================================================================
+
+static const double REPORT_PERCENTILES[] = { 50.0, 75.0, 90.0, 99.0, 99.9, 99.99, 100.0 };
+#define NUM_REPORT_PERCENTILES (int)(sizeof(REPORT_PERCENTILES) / sizeof(REPORT_PERCENTILES[0]))
+
+static uint64_t percentile_of(const histogram_t *h, double pct) {
+    static uint64_t counts[HIST_BUCKETS];
+    uint64_t total = histogram_merge(h, counts);
+    if (total == 0) return 0;
+    if (pct >= 100.0) {
+        histogram_summary_t s;
+        histogram_summarize(h, &s);
+        return s.max;
+    }
+    return histogram_percentile(counts, total, pct);
+}
+
+static void print_us(uint64_t us) {
+    if (us >= 1000000) printf("%9.2fs ", us / 1e6);
+    else if (us >= 1000) printf("%9.2fms", us / 1e3);
+    else printf("%9luus", (unsigned long)us);
+}
+
+static void print_distribution(const char *title, const histogram_t *h) {
+    histogram_summary_t s;
+    histogram_summarize(h, &s);
+    printf("\n  %s  (media %.2fms, desvío %.2fms)\n", title, s.mean / 1e3, s.stddev / 1e3);
+    for (int i = 0; i < NUM_REPORT_PERCENTILES; i++) {
+        printf("    p%-7g", REPORT_PERCENTILES[i]);
+        print_us(percentile_of(h, REPORT_PERCENTILES[i]));
+        printf("\n");
+    }
+}
+
+// Distribución completa en formato HdrHistogram (un renglón por bucket no vacío)
+static void write_csv_series(FILE *f, const char *series, const histogram_t *h) {
+    static uint64_t counts[HIST_BUCKETS];
+    uint64_t total = histogram_merge(h, counts);
+    uint64_t cumulative = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        if (counts[i] == 0) continue;
+        cumulative += counts[i];
+        double fraction = (double)cumulative / (double)total;
+        fprintf(f, "%s,%lu,%.6f,%lu,", series, (unsigned long)histogram_bucket_upper(i),
+                fraction, (unsigned long)cumulative);
+        if (fraction < 1.0) fprintf(f, "%.2f\n", 1.0 / (1.0 - fraction));
+        else fprintf(f, "inf\n");
+    }
+}
+
+static int write_csv(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "series,value_us,percentile,total_count,inverse_percentile\n");
+    write_csv_series(f, "latency", g_latency);
+    write_csv_series(f, "service", g_service);
+    for (int e = 0; e < g_cfg.num_endpoints; e++) {
+        write_csv_series(f, g_cfg.endpoints[e].path, g_ep_latency[e]);
+    }
+    fclose(f);
+    return 0;
+}
+
+static void write_json_percentiles(FILE *f, const histogram_t *h) {
+    histogram_summary_t s;
+    histogram_summarize(h, &s);
+    fprintf(f, "{\"count\":%lu,\"mean_us\":%.1f,\"stddev_us\":%.1f",
+            (unsigned long)s.count, s.mean, s.stddev);
+    for (int i = 0; i < NUM_REPORT_PERCENTILES; i++) {
+        fprintf(f, ",\"p%g\":%lu", REPORT_PERCENTILES[i],
+                (unsigned long)percentile_of(h, REPORT_PERCENTILES[i]));
+    }
+    fprintf(f, "}");
+}
+
+static int write_json(const char *path, const stats_t *t, double elapsed) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "{\"profile\":\"%s\",\"target_rate\":%.1f,\"achieved_rate\":%.1f,"
+               "\"duration_s\":%.1f,\"threads\":%d,\"connections\":%d,\"keepalive\":%s,\n",
+            g_cfg.profile ? g_cfg.profile : "custom", g_cfg.rate,
+            elapsed > 0 ? t->completed / elapsed : 0.0, g_cfg.duration,
+            g_cfg.threads, g_cfg.connections, g_cfg.keepalive ? "true" : "false");
+    fprintf(f, " \"requests\":{\"completed\":%lu,\"2xx\":%lu,\"3xx\":%lu,\"4xx\":%lu,\"5xx\":%lu,"
+               "\"errors\":%lu,\"timeouts\":%lu,\"unsent\":%lu,\"reconnects\":%lu,\"bytes_in\":%lu},\n",
+            (unsigned long)t->completed, (unsigned long)t->status[2], (unsigned long)t->status[3],
+            (unsigned long)t->status[4], (unsigned long)t->status[5], (unsigned long)t->errors,
+            (unsigned long)t->timeouts, (unsigned long)t->unsent, (unsigned long)t->reconnects,
+            (unsigned long)t->bytes_in);
+    fprintf(f, " \"latency_us\":");
+    write_json_percentiles(f, g_latency);
+    fprintf(f, ",\n \"service_us\":");
+    write_json_percentiles(f, g_service);
+    fprintf(f, ",\n \"endpoints\":[");
+    for (int e = 0; e < g_cfg.num_endpoints; e++) {
+        fprintf(f, "%s\n  {\"path\":\"%s\",\"weight\":%d,\"latency_us\":", e ? "," : "",
+                g_cfg.endpoints[e].path, g_cfg.endpoints[e].weight);
+        write_json_percentiles(f, g_ep_latency[e]);
+        fprintf(f, "}");
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return 0;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+static void print_usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [opciones]\n"
+            "  -P, --profile NAME     ligera | media | alta | mixta (tasa y conexiones por defecto)\n"
+            "  -e, --endpoint [W:]PATH Endpoint con peso W (repetible; reemplaza al perfil)\n"
+            "  -r, --rate N           Requests por segundo en total (llegadas a tasa constante)\n"
+            "  -d, --duration S       Segundos de carga (default 10)\n"
+            "  -t, --threads N        Threads generadores (default 2)\n"
+            "  -c, --connections N    Conexiones en total (default según perfil)\n"
+            "  -k, --keepalive        Pedir keep-alive y reusar conexiones si el servidor lo permite\n"
+            "  -H, --host HOST        Host (default 127.0.0.1)\n"
+            "  -p, --port PORT        Puerto (default 8080)\n"
+            "      --timeout MS       Timeout por request (default 5000)\n"
+            "      --csv FILE         Distribución completa (formato HdrHistogram) en CSV\n"
+            "      --json FILE        Resumen en JSON\n",
+            prog);
+}
+
+static int add_endpoints(const char *spec) {
+    char copy[1024];
+    snprintf(copy, sizeof(copy), "%s", spec);
+    char *save = NULL;
+    for (char *item = strtok_r(copy, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        if (g_cfg.num_endpoints >= MAX_ENDPOINTS) return -1;
+        int weight = 1;
+        char *path = item;
+        if (*item != '/') {
+            char *colon = strchr(item, ':');
+            if (!colon) return -1;
+            weight = atoi(item);
+            path = colon + 1;
+        }
+        if (*path != '/' || weight <= 0 || strlen(path) >= sizeof(g_cfg.endpoints[0].path)) {
+            return -1;
+        }
+        endpoint_t *e = &g_cfg.endpoints[g_cfg.num_endpoints++];
+        snprintf(e->path, sizeof(e->path), "%s", path);
+        e->weight = weight;
+        g_cfg.total_weight += weight;
+    }
+    return 0;
+}
+
+static int resolve_target(void) {
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    int rc = getaddrinfo(g_cfg.host, g_cfg.port, &hints, &res);
+    if (rc != 0 || !res) {
+        fprintf(stderr, "No se pudo resolver %s: %s\n", g_cfg.host, gai_strerror(rc));
+        return -1;
+    }
+    memcpy(&g_cfg.addr, res->ai_addr, res->ai_addrlen);
+    g_cfg.addr_len = res->ai_addrlen;
+    freeaddrinfo(res);
+
+    // Verificar que el servidor escucha antes de empezar a medir
+    int fd = socket(g_cfg.addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&g_cfg.addr, g_cfg.addr_len) < 0) {
+        fprintf(stderr, "❌ ERROR: Servidor no disponible en %s:%s\n", g_cfg.host, g_cfg.port);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "profile",     required_argument, NULL, 'P' },
+        { "endpoint",    required_argument, NULL, 'e' },
+        { "rate",        required_argument, NULL, 'r' },
+        { "duration",    required_argument, NULL, 'd' },
+        { "threads",     required_argument, NULL, 't' },
+        { "connections", required_argument, NULL, 'c' },
+        { "keepalive",   no_argument,       NULL, 'k' },
+        { "host",        required_argument, NULL, 'H' },
+        { "port",        required_argument, NULL, 'p' },
+        { "timeout",     required_argument, NULL, 'T' },
+        { "csv",         required_argument, NULL, 'C' },
+        { "json",        required_argument, NULL, 'J' },
+        { "help",        no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "P:e:r:d:t:c:kH:p:h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'P': g_cfg.profile = optarg; break;
+            case 'e':
+                if (add_endpoints(optarg) < 0) {
+                    fprintf(stderr, "Endpoint inválido: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r': g_cfg.rate = atof(optarg); break;
+            case 'd': g_cfg.duration = atof(optarg); break;
+            case 't': g_cfg.threads = atoi(optarg); break;
+            case 'c': g_cfg.connections = atoi(optarg); break;
+            case 'k': g_cfg.keepalive = true; break;
+            case 'H': g_cfg.host = optarg; break;
+            case 'p': g_cfg.port = optarg; break;
+            case 'T': g_cfg.timeout_ms = atoi(optarg); break;
+            case 'C': g_cfg.csv_path = optarg; break;
+            case 'J': g_cfg.json_path = optarg; break;
+            case 'h': print_usage(argv[0]); return 0;
+            default:  print_usage(argv[0]); return 1;
+        }
+    }
+
+    // El perfil aporta endpoints, tasa y conexiones que no se dieron a mano
+    if (g_cfg.num_endpoints == 0 && !g_cfg.profile) g_cfg.profile = "ligera";
+    if (g_cfg.profile) {
+        int p = 0;
+        while (p < NUM_PROFILES && strcmp(PROFILES[p].name, g_cfg.profile) != 0) p++;
+        if (p == NUM_PROFILES) {
+            fprintf(stderr, "Perfil desconocido: %s\n", g_cfg.profile);
+            return 1;
+        }
+        if (g_cfg.num_endpoints == 0) add_endpoints(PROFILES[p].spec);
+        if (g_cfg.rate <= 0) g_cfg.rate = PROFILES[p].rate;
+        if (g_cfg.connections <= 0) g_cfg.connections = PROFILES[p].connections;
+    }
+    if (g_cfg.rate <= 0) g_cfg.rate = 100.0;
+    if (g_cfg.connections <= 0) g_cfg.connections = 10;
+    if (g_cfg.threads < 1) g_cfg.threads = 1;
+    if (g_cfg.threads > MAX_THREADS) g_cfg.threads = MAX_THREADS;
+    if (g_cfg.threads > g_cfg.connections) g_cfg.threads = g_cfg.connections;
+    if (g_cfg.duration <= 0 || g_cfg.timeout_ms <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (resolve_target() < 0) return 1;
+
+    g_latency = histogram_create();
+    g_service = histogram_create();
+    for (int e = 0; e < g_cfg.num_endpoints; e++) {
+        g_ep_latency[e] = histogram_create();
+    }
+
+    printf("\n  Perfil:       %s (%d endpoint%s)\n", g_cfg.profile ? g_cfg.profile : "custom",
+           g_cfg.num_endpoints, g_cfg.num_endpoints == 1 ? "" : "s");
+    printf("  Carga:        %.0f req/s durante %.0f s (open-loop), %d threads, %d conexiones%s\n",
+           g_cfg.rate, g_cfg.duration, g_cfg.threads, g_cfg.connections,
+           g_cfg.keepalive ? ", keep-alive" : "");
+
+    worker_t workers[MAX_THREADS];
+    memset(workers, 0, sizeof(workers));
+    g_start_ns = now_ns();
+
+    for (int i = 0; i < g_cfg.threads; i++) {
+        worker_t *w = &workers[i];
+        w->index = i;
+        w->num_conns = g_cfg.connections / g_cfg.threads +
+                       (i < g_cfg.connections % g_cfg.threads ? 1 : 0);
+        w->conns = calloc((size_t)w->num_conns, sizeof(conn_t));
+        w->pending = malloc(sizeof(pending_t) * PENDING_CAP);
+        w->epfd = epoll_create1(EPOLL_CLOEXEC);
+        w->rng = g_start_ns ^ ((uint64_t)(i + 1) * 0xd1b54a32d192ed03ULL);
+        if (!w->conns || !w->pending || w->epfd < 0) {
+            fprintf(stderr, "Sin memoria para el thread %d\n", i);
+            return 1;
+        }
+        for (int j = 0; j < w->num_conns; j++) {
+            w->conns[j].fd = -1;
+        }
+        pthread_create(&w->thread, NULL, worker_main, w);
+    }
+
+    stats_t total;
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < g_cfg.threads; i++) {
+        worker_t *w = &workers[i];
+        pthread_join(w->thread, NULL);
+        total.completed += w->stats.completed;
+        for (int s = 0; s < 6; s++) total.status[s] += w->stats.status[s];
+        total.errors += w->stats.errors;
+        total.timeouts += w->stats.timeouts;
+        total.unsent += w->stats.unsent;
+        total.reconnects += w->stats.reconnects;
+        total.bytes_in += w->stats.bytes_in;
+        close(w->epfd);
+        free(w->conns);
+        free(w->pending);
+    }
+    double elapsed = (now_ns() - g_start_ns) / 1e9;
+    if (elapsed < g_cfg.duration) elapsed = g_cfg.duration;
+
+    printf("  Lograda:      %.1f req/s (%lu respuestas en %.2f s)\n",
+           total.completed / elapsed, (unsigned long)total.completed, elapsed);
+    printf("  Respuestas:   2xx %lu, 3xx %lu, 4xx %lu, 5xx %lu\n",
+           (unsigned long)total.status[2], (unsigned long)total.status[3],
+           (unsigned long)total.status[4], (unsigned long)total.status[5]);
+    printf("  Fallas:       errores %lu, timeouts %lu, no enviadas %lu, reconexiones %lu\n",
+           (unsigned long)total.errors, (unsigned long)total.timeouts,
+           (unsigned long)total.unsent, (unsigned long)total.reconnects);
+
+    print_distribution("Latencia (desde el envío programado)", g_latency);
+    print_distribution("Tiempo de servicio (desde el envío real)", g_service);
+
+    if (g_cfg.num_endpoints > 1) {
+        printf("\n  Por endpoint (latencia):\n");
+        for (int e = 0; e < g_cfg.num_endpoints; e++) {
+            histogram_summary_t s;
+            histogram_summarize(g_ep_latency[e], &s);
+            printf("    %-28s n=%-8lu p50", g_cfg.endpoints[e].path, (unsigned long)s.count);
+            print_us(percentile_of(g_ep_latency[e], 50.0));
+            printf("  p99");
+            print_us(percentile_of(g_ep_latency[e], 99.0));
+            printf("\n");
+        }
+    }
+    if (total.unsent > 0 || total.timeouts > 0) {
+        printf("\n  ⚠️  El servidor no sostuvo la tasa pedida\n");
+    }
+    printf("\n");
+
+    int rc = 0;
+    if (g_cfg.csv_path && write_csv(g_cfg.csv_path) < 0) {
+        perror(g_cfg.csv_path);
+        rc = 1;
+    }
+    if (g_cfg.json_path && write_json(g_cfg.json_path, &total, elapsed) < 0) {
+        perror(g_cfg.json_path);
+        rc = 1;
+    }
+
+    histogram_destroy(g_latency);
+    histogram_destroy(g_service);
+    for (int e = 0; e < g_cfg.num_endpoints; e++) {
+        histogram_destroy(g_ep_latency[e]);
+    }
+    return rc;
+}
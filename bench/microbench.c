@@ -0,0 +1,551 @@
+// Microbenchmarks de los módulos del núcleo
+//
+// Cada benchmark es una función que ejecuta `iters` operaciones. El harness
+// calibra iters para que una repetición dure al menos --min-ms, descarta
+// --warmup repeticiones y reporta mediana, MAD (desvío absoluto mediano) y
+// mínimo en ns por operación sobre --reps repeticiones.
+//
+// Con --csv los resultados quedan en un formato estable para comparar
+// versiones; --compare lee un CSV anterior y marca las diferencias que
+// superan el ruido:
+//
+//   ./build/microbench --csv before.csv
+//   ... cambios ...
+//   ./build/microbench --compare before.csv
+//
+// Uso: ./build/microbench [--filter TEXTO] [--reps N] [--warmup N]
+//                         [--min-ms MS] [--csv FILE] [--compare FILE]
+#include "../src/core/queue.h"
+#include "../src/core/metrics.h"
+#include "../src/server/http.h"
+#include "../src/router/router.h"
+#include "../src/utils/utils.h"
+#include "../src/commands/basic/basic_commands.h"
+#include "../src/commands/cpu_bound/cpu_bound_commands.h"
+#include "../src/utils/primes.h"
+#include <math.h>
+#include <fcntl.h>
+#include <getopt.h>
+
+#define MAX_REPS        101
+#define MAX_BASELINE    256
+
+// Resultado de una función que el compilador no puede descartar
+static volatile uintptr_t g_sink;
+
+typedef struct bench_case bench_case_t;
+typedef void (*bench_fn_t)(const bench_case_t *bc, long iters);
+
+struct bench_case {
+    const char *name;           // "modulo.operacion"
+    const char *param;          // Tamaño o variante ("-" si no aplica)
+    bench_fn_t fn;
+    long arg;                   // Parámetro numérico (threads, n, ...)
+    const char *sarg;           // Parámetro string (query, path, ...)
+};
+
+static struct {
+    const char *filter;
+    int reps;
+    int warmup;
+    double min_ms;
+    const char *csv_path;
+    const char *compare_path;
+    int devnull;
+} g_opts = {
+    .reps = 15,
+    .warmup = 3,
+    .min_ms = 20.0,
+    .devnull = -1,
+};
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// ============================================================================
+// QUEUE
+// ============================================================================
+
+typedef struct {
+    queue_t *queue;
+    task_t *task;
+    long ops;
+} queue_ctx_t;
+
+static void *queue_producer(void *arg) {
+    queue_ctx_t *ctx = arg;
+    for (long i = 0; i < ctx->ops; i++) {
+        queue_enqueue(ctx->queue, ctx->task, -1);
+    }
+    return NULL;
+}
+
+static void *queue_consumer(void *arg) {
+    queue_ctx_t *ctx = arg;
+    for (long i = 0; i < ctx->ops; i++) {
+        g_sink += (uintptr_t)queue_dequeue(ctx->queue);
+    }
+    return NULL;
+}
+
+// Un thread: enqueue + dequeue sin esperar a nadie (costo del lock sin contención)
+static void bench_queue_single(const bench_case_t *bc, long iters) {
+    (void)bc;
+    static task_t task;
+    queue_t *q = queue_create(0);
+    for (long i = 0; i < iters; i++) {
+        queue_enqueue(q, &task, 0);
+        g_sink += (uintptr_t)queue_dequeue(q);
+    }
+    queue_destroy(q);
+}
+
+// arg productores y arg consumidores sobre una cola acotada; ns por tarea
+static void bench_queue_contended(const bench_case_t *bc, long iters) {
+    static task_t task;
+    int threads = (int)bc->arg;
+    queue_t *q = queue_create(128);
+    pthread_t prod[16], cons[16];
+    queue_ctx_t ctx = { q, &task, iters / threads > 0 ? iters / threads : 1 };
+
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&cons[i], NULL, queue_consumer, &ctx);
+        pthread_create(&prod[i], NULL, queue_producer, &ctx);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(prod[i], NULL);
+        pthread_join(cons[i], NULL);
+    }
+    queue_destroy(q);
+}
+
+// ============================================================================
+// HTTP / UTILS
+// ============================================================================
+
+static void bench_http_parse(const bench_case_t *bc, long iters) {
+    http_request_t req;
+    for (long i = 0; i < iters; i++) {
+        g_sink += (uintptr_t)http_parse_request(bc->sarg, &req);
+    }
+}
+
+static void bench_query_string(const bench_case_t *bc, long iters) {
+    for (long i = 0; i < iters; i++) {
+        query_params_t *qp = parse_query_string(bc->sarg);
+        g_sink += (uintptr_t)qp;
+        free_query_params(qp);
+    }
+}
+
+static void bench_url_decode(const bench_case_t *bc, long iters) {
+    for (long i = 0; i < iters; i++) {
+        char *s = url_decode(bc->sarg);
+        g_sink += (uintptr_t)s;
+        free(s);
+    }
+}
+
+static void bench_request_id(const bench_case_t *bc, long iters) {
+    char id[64];
+    request_id_set_format((request_id_format_t)bc->arg);
+    for (long i = 0; i < iters; i++) {
+        generate_request_id(id, sizeof(id));
+        g_sink += (uintptr_t)id[REQUEST_ID_COMPACT_LEN - 1];
+    }
+    request_id_set_format(REQUEST_ID_COMPACT);
+}
+
+// Request completa por el router (parse de query, handler, métricas y la
+// respuesta escrita a /dev/null)
+static void bench_router(const bench_case_t *bc, long iters) {
+    http_request_t req;
+    char raw[512];
+    snprintf(raw, sizeof(raw), "GET %s HTTP/1.0\r\nHost: localhost\r\n\r\n", bc->sarg);
+    http_parse_request(raw, &req);
+    for (long i = 0; i < iters; i++) {
+        g_sink += (uintptr_t)router_handle_request(&req, g_opts.devnull, "bench", NULL, 0, NULL);
+    }
+}
+
+// ============================================================================
+// METRICS
+// ============================================================================
+
+static void bench_metrics_request(const bench_case_t *bc, long iters) {
+    (void)bc;
+    for (long i = 0; i < iters; i++) {
+        metrics_record_request("isprime", (unsigned long)(i & 1023), (i & 63) == 0);
+    }
+}
+
+static void bench_metrics_phase(const bench_case_t *bc, long iters) {
+    (void)bc;
+    for (long i = 0; i < iters; i++) {
+        metrics_record_phase("isprime", METRICS_PHASE_EXEC, (unsigned long)(i & 1023));
+    }
+}
+
+static void bench_metrics_wait_exec(const bench_case_t *bc, long iters) {
+    (void)bc;
+    for (long i = 0; i < iters; i++) {
+        metrics_record_wait_time("isprime", (unsigned long)(i & 1023));
+        metrics_record_exec_time("isprime", (unsigned long)(i & 1023));
+    }
+}
+
+// ============================================================================
+// COMANDOS
+// ============================================================================
+
+enum { CMD_FIB, CMD_ISPRIME, CMD_FACTOR, CMD_PRIMES, CMD_PI, CMD_MANDELBROT, CMD_MATRIXMUL, CMD_HASH, CMD_REVERSE };
+
+// sarg lleva los argumentos separados por ',' en el orden del handler
+static void bench_command(const bench_case_t *bc, long iters) {
+    char args[128];
+    snprintf(args, sizeof(args), "%s", bc->sarg);
+    char *a[3] = { args, NULL, NULL };
+    for (int k = 1; k < 3; k++) {
+        char *comma = a[k - 1] ? strchr(a[k - 1], ',') : NULL;
+        if (comma) {
+            *comma = '\0';
+            a[k] = comma + 1;
+        }
+    }
+
+    for (long i = 0; i < iters; i++) {
+        char *json = NULL;
+        switch (bc->arg) {
+            case CMD_FIB: json = handle_fibonacci(a[0]); break;
+            case CMD_ISPRIME: json = handle_isprime(a[0]); break;
+            case CMD_FACTOR: json = handle_factor(a[0]); break;
+            case CMD_PRIMES: json = handle_primes(a[0], a[1], NULL); break;
+            case CMD_PI: json = handle_pi(a[0]); break;
+            case CMD_MANDELBROT: json = handle_mandelbrot(a[0], a[1], a[2], NULL, NULL, NULL); break;
+            case CMD_MATRIXMUL: json = handle_matrixmul(a[0], a[1]); break;
+            case CMD_HASH: json = handle_hash(a[0]); break;
+            case CMD_REVERSE: json = handle_reverse(a[0]); break;
+        }
+        g_sink += (uintptr_t)json;
+        free(json);
+    }
+}
+
+// Fast doubling sin caché (cmd.fibonacci guarda los N grandes)
+static void bench_fib_compute(const bench_case_t *bc, long iters) {
+    for (long i = 0; i < iters; i++) {
+        bigint_t f;
+        bigint_init(&f);
+        fibonacci_compute(bc->arg, 1, &f);
+        g_sink += f.len;
+        bigint_free(&f);
+    }
+}
+
+// 1024 impares de ~62 bits (1 de cada 22 primo) de a uno o por lotes
+static void bench_isprime_many(const bench_case_t *bc, long iters) {
+    enum { COUNT = 1024 };
+    uint64_t nums[COUNT];
+    bool out[COUNT];
+    uint64_t x = 88172645463325252ULL;
+    for (int k = 0; k < COUNT; k++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        nums[k] = (x >> 2) | 1;
+    }
+    for (long i = 0; i < iters; i++) {
+        if (bc->arg) {
+            prime_is_prime_u64_batch(nums, COUNT, out);
+        } else {
+            for (int k = 0; k < COUNT; k++) out[k] = prime_is_prime_u64(nums[k]);
+        }
+        g_sink += out[i & (COUNT - 1)];
+    }
+}
+
+// Chudnovsky sin caché (cmd.pi se sirve del caché después de la primera vuelta)
+static void bench_pi_compute(const bench_case_t *bc, long iters) {
+    for (long i = 0; i < iters; i++) {
+        char *digits = pi_compute_digits((int)bc->arg, 1);
+        g_sink += (uintptr_t)digits;
+        free(digits);
+    }
+}
+
+// ============================================================================
+// CATÁLOGO
+// ============================================================================
+
+#define HTTP_SIMPLE "GET /isprime?n=97 HTTP/1.0\r\nHost: localhost\r\n\r\n"
+#define HTTP_HEADERS "GET /mandelbrot?width=200&height=100&max_iter=500 HTTP/1.1\r\n" \
+    "Host: localhost:8080\r\nUser-Agent: microbench/1.0\r\nAccept: */*\r\n"      \
+    "Accept-Encoding: gzip, deflate\r\nConnection: keep-alive\r\n"                \
+    "X-Request-Timeout-Ms: 5000\r\nCache-Control: no-cache\r\n\r\n"
+
+static const bench_case_t CASES[] = {
+    { "queue.enqueue_dequeue", "threads=1", bench_queue_single, 1, NULL },
+    { "queue.contended", "threads=2", bench_queue_contended, 1, NULL },
+    { "queue.contended", "threads=4", bench_queue_contended, 2, NULL },
+    { "queue.contended", "threads=8", bench_queue_contended, 4, NULL },
+
+    { "http.parse_request", "simple", bench_http_parse, 0, HTTP_SIMPLE },
+    { "http.parse_request", "8_headers", bench_http_parse, 0, HTTP_HEADERS },
+    { "utils.parse_query_string", "1_param", bench_query_string, 0, "n=97" },
+    { "utils.parse_query_string", "3_params", bench_query_string, 0,
+      "width=200&height=100&max_iter=500" },
+    { "utils.url_decode", "plain", bench_url_decode, 0, "hello_world_this_is_plain" },
+    { "utils.url_decode", "escaped", bench_url_decode, 0, "hola%20mundo%21+caf%C3%A9%3F%3D%26" },
+    { "utils.request_id", "compact", bench_request_id, REQUEST_ID_COMPACT, NULL },
+    { "utils.request_id", "uuid7", bench_request_id, REQUEST_ID_UUID7, NULL },
+
+    { "router.dispatch", "/reverse", bench_router, 0, "/reverse?text=hello" },
+    { "router.dispatch", "/isprime", bench_router, 0, "/isprime?n=97" },
+    { "router.dispatch", "404", bench_router, 0, "/no/such/endpoint" },
+
+    { "metrics.record_request", "-", bench_metrics_request, 0, NULL },
+    { "metrics.record_phase", "-", bench_metrics_phase, 0, NULL },
+    { "metrics.record_wait_exec", "-", bench_metrics_wait_exec, 0, NULL },
+
+    { "cmd.fibonacci", "n=20", bench_command, CMD_FIB, "20" },
+    { "cmd.fibonacci", "n=90", bench_command, CMD_FIB, "90" },
+    { "fib.compute", "n=10000", bench_fib_compute, 10000, NULL },
+    { "fib.compute", "n=1000000", bench_fib_compute, 1000000, NULL },
+    { "cmd.isprime", "n=97", bench_command, CMD_ISPRIME, "97" },
+    { "cmd.isprime", "n=1e9+7", bench_command, CMD_ISPRIME, "1000000007" },
+    { "cmd.isprime", "n=2^61-1", bench_command, CMD_ISPRIME, "2305843009213693951" },
+    { "cmd.factor", "n=123456", bench_command, CMD_FACTOR, "123456" },
+    { "cmd.factor", "n=1e9+7", bench_command, CMD_FACTOR, "1000000007" },
+    { "cmd.factor", "n=p*q(1e12)", bench_command, CMD_FACTOR, "999999000001" },
+    { "cmd.factor", "n=p*q(2^64)", bench_command, CMD_FACTOR, "18446743979220271189" },
+    { "cmd.factor", "n=2^128-1", bench_command, CMD_FACTOR, "340282366920938463463374607431768211455" },
+    { "cmd.primes", "to=1e6", bench_command, CMD_PRIMES, "0,1000000" },
+    { "cmd.primes", "to=1e8", bench_command, CMD_PRIMES, "0,100000000" },
+    { "cmd.primes", "1e12+[0,1e7]", bench_command, CMD_PRIMES, "1000000000000,1000010000000" },
+    { "primes.isprime", "single/1024", bench_isprime_many, 0, NULL },
+    { "primes.isprime", "batch/1024", bench_isprime_many, 1, NULL },
+    { "cmd.pi", "digits=5", bench_command, CMD_PI, "5" },
+    { "cmd.pi", "digits=15", bench_command, CMD_PI, "15" },
+    { "pi.compute", "digits=1000", bench_pi_compute, 1000, NULL },
+    { "pi.compute", "digits=10000", bench_pi_compute, 10000, NULL },
+    { "pi.compute", "digits=100000", bench_pi_compute, 100000, NULL },
+    { "cmd.mandelbrot", "64x32/100", bench_command, CMD_MANDELBROT, "64,32,100" },
+    { "cmd.mandelbrot", "200x100/500", bench_command, CMD_MANDELBROT, "200,100,500" },
+    { "cmd.mandelbrot", "640x480/1000", bench_command, CMD_MANDELBROT, "640,480,1000" },
+    { "cmd.matrixmul", "n=32", bench_command, CMD_MATRIXMUL, "32,1" },
+    { "cmd.matrixmul", "n=128", bench_command, CMD_MATRIXMUL, "128,1" },
+    { "cmd.matrixmul", "n=256", bench_command, CMD_MATRIXMUL, "256,1" },
+    { "cmd.matrixmul", "n=512", bench_command, CMD_MATRIXMUL, "512,1" },
+    { "cmd.matrixmul", "n=1024", bench_command, CMD_MATRIXMUL, "1024,1" },
+    { "cmd.hash", "16B", bench_command, CMD_HASH, "hello-world-1234" },
+    { "cmd.hash", "100B", bench_command, CMD_HASH,
+      "0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqr" },
+    { "cmd.reverse", "16B", bench_command, CMD_REVERSE, "hello-world-1234" },
+};
+#define NUM_CASES (int)(sizeof(CASES) / sizeof(CASES[0]))
+
+// ============================================================================
+// HARNESS
+// ============================================================================
+
+typedef struct {
+    long iters;
+    double median;
+    double mad;
+    double min;
+} bench_result_t;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median_of(double *values, int n) {
+    qsort(values, (size_t)n, sizeof(double), cmp_double);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+static double time_once(const bench_case_t *bc, long iters) {
+    double t0 = now_ns();
+    bc->fn(bc, iters);
+    return now_ns() - t0;
+}
+
+static void run_case(const bench_case_t *bc, bench_result_t *out) {
+    // Calibrar: duplicar iters hasta que una repetición dure >= min_ms
+    long iters = 1;
+    double elapsed = time_once(bc, iters);
+    while (elapsed < g_opts.min_ms * 1e6 && iters < (1L << 40)) {
+        long next = elapsed > 0 ? (long)(iters * (g_opts.min_ms * 1e6 / elapsed) * 1.2) : iters * 2;
+        iters = next > iters * 2 ? iters * 2 : (next > iters ? next : iters + 1);
+        elapsed = time_once(bc, iters);
+    }
+
+    for (int i = 0; i < g_opts.warmup; i++) {
+        time_once(bc, iters);
+    }
+
+    double samples[MAX_REPS], dev[MAX_REPS];
+    for (int i = 0; i < g_opts.reps; i++) {
+        samples[i] = time_once(bc, iters) / (double)iters;
+    }
+
+    out->iters = iters;
+    out->median = median_of(samples, g_opts.reps);
+    out->min = samples[0];
+    for (int i = 0; i < g_opts.reps; i++) {
+        dev[i] = fabs(samples[i] - out->median);
+    }
+    out->mad = median_of(dev, g_opts.reps);
+}
+
+// ============================================================================
+// COMPARACIÓN
+// ============================================================================
+
+typedef struct {
+    char name[64];
+    char param[32];
+    double median;
+    double mad;
+} baseline_t;
+
+static baseline_t g_baseline[MAX_BASELINE];
+static int g_baseline_count;
+
+static int load_baseline(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char line[256];
+    while (fgets(line, sizeof(line), f) && g_baseline_count < MAX_BASELINE) {
+        baseline_t *b = &g_baseline[g_baseline_count];
+        long iters;
+        if (sscanf(line, "%63[^,],%31[^,],%ld,%lf,%lf", b->name, b->param, &iters,
+                   &b->median, &b->mad) == 5) {
+            g_baseline_count++;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static const baseline_t *find_baseline(const bench_case_t *bc) {
+    for (int i = 0; i < g_baseline_count; i++) {
+        if (strcmp(g_baseline[i].name, bc->name) == 0 && strcmp(g_baseline[i].param, bc->param) == 0) {
+            return &g_baseline[i];
+        }
+    }
+    return NULL;
+}
+
+// Cambio relevante: > 5% y fuera de 3 MAD de cualquiera de las dos corridas
+static const char *compare_mark(const bench_result_t *r, const baseline_t *b, double *delta_pct) {
+    *delta_pct = b->median > 0 ? (r->median - b->median) / b->median * 100.0 : 0.0;
+    double noise = 3.0 * (r->mad > b->mad ? r->mad : b->mad);
+    if (fabs(r->median - b->median) <= noise || fabs(*delta_pct) < 5.0) return "";
+    return *delta_pct > 0 ? "  ⚠️ más lento" : "  ✓ más rápido";
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+static void print_usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [opciones]\n"
+            "  -f, --filter TEXTO   Solo benchmarks cuyo nombre contiene TEXTO\n"
+            "  -r, --reps N         Repeticiones medidas (default 15)\n"
+            "  -w, --warmup N       Repeticiones descartadas (default 3)\n"
+            "  -m, --min-ms MS      Duración mínima de una repetición (default 20)\n"
+            "  -o, --csv FILE       Escribir resultados en CSV\n"
+            "  -c, --compare FILE   Comparar contra un CSV anterior\n"
+            "  -l, --list           Listar benchmarks\n",
+            prog);
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "filter",  required_argument, NULL, 'f' },
+        { "reps",    required_argument, NULL, 'r' },
+        { "warmup",  required_argument, NULL, 'w' },
+        { "min-ms",  required_argument, NULL, 'm' },
+        { "csv",     required_argument, NULL, 'o' },
+        { "compare", required_argument, NULL, 'c' },
+        { "list",    no_argument,       NULL, 'l' },
+        { "help",    no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "f:r:w:m:o:c:lh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'f': g_opts.filter = optarg; break;
+            case 'r': g_opts.reps = atoi(optarg); break;
+            case 'w': g_opts.warmup = atoi(optarg); break;
+            case 'm': g_opts.min_ms = atof(optarg); break;
+            case 'o': g_opts.csv_path = optarg; break;
+            case 'c': g_opts.compare_path = optarg; break;
+            case 'l':
+                for (int i = 0; i < NUM_CASES; i++) printf("%s %s\n", CASES[i].name, CASES[i].param);
+                return 0;
+            case 'h': print_usage(argv[0]); return 0;
+            default:  print_usage(argv[0]); return 1;
+        }
+    }
+    if (g_opts.reps < 1) g_opts.reps = 1;
+    if (g_opts.reps > MAX_REPS) g_opts.reps = MAX_REPS;
+    if (g_opts.warmup < 0) g_opts.warmup = 0;
+    if (g_opts.min_ms <= 0) g_opts.min_ms = 1.0;
+
+    if (g_opts.compare_path && load_baseline(g_opts.compare_path) < 0) {
+        perror(g_opts.compare_path);
+        return 1;
+    }
+    FILE *csv = NULL;
+    if (g_opts.csv_path) {
+        csv = fopen(g_opts.csv_path, "w");
+        if (!csv) {
+            perror(g_opts.csv_path);
+            return 1;
+        }
+        fprintf(csv, "benchmark,param,iterations,median_ns,mad_ns,min_ns\n");
+    }
+
+    // Los handlers loguean y registran métricas: dejar solo errores
+    logger_init(LOG_ERROR, NULL);
+    metrics_init();
+    metrics_register_command("isprime", 4, 100, 100);
+    g_opts.devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+    printf("%-28s %-14s %12s %12s %10s %12s\n", "benchmark", "param", "iters", "median", "MAD", "min");
+    for (int i = 0; i < NUM_CASES; i++) {
+        const bench_case_t *bc = &CASES[i];
+        if (g_opts.filter && !strstr(bc->name, g_opts.filter)) continue;
+
+        bench_result_t r;
+        run_case(bc, &r);
+        printf("%-28s %-14s %12ld %10.1fns %8.1fns %10.1fns", bc->name, bc->param,
+               r.iters, r.median, r.mad, r.min);
+
+        const baseline_t *b = g_opts.compare_path ? find_baseline(bc) : NULL;
+        if (b) {
+            double delta;
+            const char *mark = compare_mark(&r, b, &delta);
+            printf("  %+6.1f%%%s", delta, mark);
+        }
+        printf("\n");
+        fflush(stdout);
+
+        if (csv) {
+            fprintf(csv, "%s,%s,%ld,%.2f,%.2f,%.2f\n", bc->name, bc->param,
+                    r.iters, r.median, r.mad, r.min);
+        }
+    }
+
+    if (csv) fclose(csv);
+    close(g_opts.devnull);
+    metrics_destroy();
+    logger_shutdown();
+    return 0;
+}
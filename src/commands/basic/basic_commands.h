@@ -1,9 +1,37 @@
 #ifndef BASIC_COMMANDS_H
 #define BASIC_COMMANDS_H
 
+#include <stddef.h>
+#include "../../utils/bigint.h"
+
 // Function declaration for fibonacci command
 char* handle_fibonacci(const char* n_str);
 
+#define FIBONACCI_MAX_N 10000000
+
+// Destino de la respuesta de /fibonacci
+typedef struct {
+    // Antes del primer byte (el valor ya está calculado); != 0 aborta
+    int (*begin)(void *ctx);
+    void (*write)(void *ctx, const char *data, size_t len);
+    void *ctx;
+} fibonacci_sink_t;
+
+#define FIBONACCI_STREAM_OK        0
+#define FIBONACCI_STREAM_ERROR    -1   // Nada enviado: *error_json (NULL = deadline)
+#define FIBONACCI_STREAM_ABORTED  -2   // begin falló
+
+// Mismo JSON que handle_fibonacci, escrito por partes. Hasta n = 93 no usa
+// memoria dinámica; más arriba los valores grandes recientes salen del caché
+int handle_fibonacci_stream(const char* n_str, const fibonacci_sink_t *sink, char **error_json);
+
+// F(n) exacto por fast doubling en out (inicializado). 0 si éxito, -1 si
+// venció el deadline o faltó memoria
+int fibonacci_compute(long n, int threads, bigint_t *out);
+
+// Vaciar el caché de valores grandes
+void fibonacci_cache_clear(void);
+
 // Function declaration for hash command
 char* handle_hash(const char* text);
 
@@ -1,74 +1,327 @@
+// fibonacci.c - F(n) exacto: uint64 hasta n = 93, enteros grandes más arriba
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <limits.h>
+#include <pthread.h>
+#include "basic_commands.h"
+#include "../../utils/bigint.h"
 #include "../../utils/utils.h"
 
-// Function declaration that will be used by other modules
-char* handle_fibonacci(const char* n_str);
+#define FIB_MAX_U64         93          // F(93) es el último que entra en 64 bits
+#define FIB_CACHE_SLOTS     8
+#define FIB_CACHE_MIN_N     10000       // Más chicos se recalculan en microsegundos
+#define FIB_PARALLEL_LIMBS  (4 * BIGINT_NTT_LIMBS)
+#define FIB_CHUNK_BYTES     65536
 
-// Calculates the nth Fibonacci number and returns the result in JSON format
-// The caller is responsible for freeing the returned string
-char* handle_fibonacci(const char* n_str) {
-    if (!n_str) return NULL;
-    
-    // Start timing
-    http_timer_t timer;
-    timer_start(&timer);
+// Valida "n": solo dígitos, 0..FIBONACCI_MAX_N. Retorna -1 si no es válido
+static long parse_n(const char *n_str) {
+    if (!n_str || !*n_str) return -1;
+    long n = 0;
+    for (const char *p = n_str; *p; p++) {
+        if (*p < '0' || *p > '9') return -1;
+        n = n * 10 + (*p - '0');
+        if (n > FIBONACCI_MAX_N) return -1;
+    }
+    return n;
+}
 
-    // First decode the URL-encoded parameter
-    char* decoded = url_decode(n_str);
-    if (!decoded) return NULL;
-
-    // Convert string to integer
-    char* endptr;
-    long n = strtol(decoded, &endptr, 10);
-    
-    // Validate the input
-    if (*endptr != '\0' || n < 0 || n > 93) {
-        free(decoded);
-        return NULL;
+static unsigned long long fib_u64(long n) {
+    unsigned long long a = 0, b = 1;
+    for (long i = 0; i < n; i++) {
+        unsigned long long t = a + b;
+        a = b;
+        b = t;
     }
+    return a;
+}
+
+// ============================================================================
+// FAST DOUBLING
+// ============================================================================
+//
+// Con (a, b) = (F(k), F(k+1)):
+//   F(2k)   = a * (2b - a)
+//   F(2k+1) = a^2 + b^2
+// Se recorren los bits de n de arriba hacia abajo: O(log n) pasos, y el
+// costo lo dominan las multiplicaciones de los últimos (NTT en bigint).
+
+static void swap_bigint(bigint_t *x, bigint_t *y) {
+    bigint_t t = *x;
+    *x = *y;
+    *y = t;
+}
+
+typedef struct {
+    bigint_t *a;
+    bigint_t *b;
+    bigint_t *out;              // [0] = a*(2b-a), [1] = a^2, [2] = b^2
+    bigint_t *twice_b_minus_a;
+    int failed;                 // Atómico
+} fib_step_t;
+
+static void fib_product(int index, void *ctx) {
+    fib_step_t *s = ctx;
+    int rc = 0;
+    switch (index) {
+        case 0: rc = bigint_mul(&s->out[0], s->a, s->twice_b_minus_a); break;
+        case 1: rc = bigint_mul(&s->out[1], s->a, s->a); break;
+        case 2: rc = bigint_mul(&s->out[2], s->b, s->b); break;
+    }
+    if (rc != 0) __atomic_store_n(&s->failed, 1, __ATOMIC_RELAXED);
+}
 
-    // Calculate Fibonacci number iteratively
-    unsigned long long fib_result;
-    
-    if (n == 0) {
-        fib_result = 0;
-    } else if (n == 1) {
-        fib_result = 1;
-    } else {
-        unsigned long long a = 0, b = 1, temp;
-        for (long i = 2; i <= n; i++) {
-            temp = a + b;
-            a = b;
-            b = temp;
+/**
+ * F(n) con fast doubling
+ *
+ * @param n Índice (0..FIBONACCI_MAX_N)
+ * @param threads Threads para los tres productos de cada paso (los grandes)
+ * @param out Resultado (inicializado por quien llama)
+ * @return 0 si éxito, -1 si venció el deadline o faltó memoria
+ */
+int fibonacci_compute(long n, int threads, bigint_t *out) {
+    // El prefijo de bits que entra en 64 bits arranca ya calculado
+    int shift = 0;
+    while ((n >> shift) > FIB_MAX_U64 - 1) shift++;
+    long k = n >> shift;
+
+    bigint_t a, b, t, prod[3];
+    bigint_init(&a);
+    bigint_init(&b);
+    bigint_init(&t);
+    for (int i = 0; i < 3; i++) bigint_init(&prod[i]);
+    int rc = bigint_set_u64(&a, fib_u64(k));
+    rc |= bigint_set_u64(&b, fib_u64(k + 1));
+
+    for (int bit = shift - 1; bit >= 0 && rc == 0; bit--) {
+        if (deadline_expired()) {
+            rc = -1;
+            break;
+        }
+        rc |= bigint_add(&t, &b, &b);
+        rc |= bigint_sub(&t, &t, &a);
+        if (rc != 0) break;
+
+        fib_step_t step = { .a = &a, .b = &b, .out = prod, .twice_b_minus_a = &t };
+        parallel_for(3, a.len >= FIB_PARALLEL_LIMBS ? threads : 1, fib_product, &step);
+        if (step.failed) {
+            rc = -1;
+            break;
+        }
+
+        // prod[0] = F(2k), prod[1] + prod[2] = F(2k+1)
+        rc |= bigint_add(&prod[1], &prod[1], &prod[2]);
+        if ((n >> bit) & 1) {
+            rc |= bigint_add(&b, &prod[0], &prod[1]);
+            swap_bigint(&a, &prod[1]);
+        } else {
+            swap_bigint(&a, &prod[0]);
+            swap_bigint(&b, &prod[1]);
         }
-        fib_result = b;
     }
 
-    // Convert result to string
-    char result_str[32];
-    snprintf(result_str, sizeof(result_str), "%llu", fib_result);
+    if (rc == 0) {
+        bigint_free(out);
+        *out = a;
+        bigint_init(&a);
+    }
+    bigint_free(&a);
+    bigint_free(&b);
+    bigint_free(&t);
+    for (int i = 0; i < 3; i++) bigint_free(&prod[i]);
+    return rc ? -1 : 0;
+}
 
-    // Stop timing
-    timer_stop(&timer);
-    long elapsed = timer_elapsed_ms(&timer);
-
-    // Allocate memory for the JSON response
-    // Format: {"input":"n","output":"fibonacci_result"}
-    size_t json_len = strlen(decoded) + strlen(result_str) + 64;
-    char* json = malloc(json_len);
-    if (!json) {
-        free(decoded);
+// ============================================================================
+// CACHÉ
+// ============================================================================
+//
+// Los últimos FIB_CACHE_SLOTS valores grandes ya pasados a decimal (LRU).
+// Cada entrada es inmutable y con refcount: un request la sigue leyendo
+// aunque otro la desaloje mientras tanto.
+
+typedef struct {
+    int refs;                   // Protegido por fib_cache_lock
+    long n;
+    size_t len;
+    char digits[];
+} fib_value_t;
+
+static pthread_mutex_t fib_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static fib_value_t *fib_cache[FIB_CACHE_SLOTS];     // [0] = el más reciente
+
+static void fib_value_release(fib_value_t *v) {
+    if (!v) return;
+    pthread_mutex_lock(&fib_cache_lock);
+    bool last = --v->refs == 0;
+    pthread_mutex_unlock(&fib_cache_lock);
+    if (last) free(v);
+}
+
+// Buscar y mover al frente; NULL si no está
+static fib_value_t* fib_cache_lookup(long n) {
+    fib_value_t *hit = NULL;
+    pthread_mutex_lock(&fib_cache_lock);
+    for (int i = 0; i < FIB_CACHE_SLOTS && fib_cache[i]; i++) {
+        if (fib_cache[i]->n == n) {
+            hit = fib_cache[i];
+            memmove(&fib_cache[1], &fib_cache[0], (size_t)i * sizeof(fib_value_t*));
+            fib_cache[0] = hit;
+            hit->refs++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fib_cache_lock);
+    return hit;
+}
+
+static void fib_cache_insert(fib_value_t *v) {
+    fib_value_t *evicted = NULL;
+    pthread_mutex_lock(&fib_cache_lock);
+    for (int i = 0; i < FIB_CACHE_SLOTS && fib_cache[i]; i++) {
+        if (fib_cache[i]->n == v->n) {
+            // Otro request lo calculó en paralelo: queda el que ya estaba
+            pthread_mutex_unlock(&fib_cache_lock);
+            return;
+        }
+    }
+    evicted = fib_cache[FIB_CACHE_SLOTS - 1];
+    memmove(&fib_cache[1], &fib_cache[0], (FIB_CACHE_SLOTS - 1) * sizeof(fib_value_t*));
+    fib_cache[0] = v;
+    v->refs++;
+    pthread_mutex_unlock(&fib_cache_lock);
+    fib_value_release(evicted);
+}
+
+void fibonacci_cache_clear(void) {
+    fib_value_t *old[FIB_CACHE_SLOTS];
+    pthread_mutex_lock(&fib_cache_lock);
+    memcpy(old, fib_cache, sizeof(old));
+    memset(fib_cache, 0, sizeof(fib_cache));
+    pthread_mutex_unlock(&fib_cache_lock);
+    for (int i = 0; i < FIB_CACHE_SLOTS; i++) fib_value_release(old[i]);
+}
+
+// F(n) en decimal, del caché o recién calculado; NULL si venció el deadline o
+// faltó memoria
+static fib_value_t* fib_value_get(long n, bool *cached) {
+    fib_value_t *v = n >= FIB_CACHE_MIN_N ? fib_cache_lookup(n) : NULL;
+    *cached = v != NULL;
+    if (v) return v;
+
+    bigint_t f;
+    bigint_init(&f);
+    if (fibonacci_compute(n, parallel_default_threads(), &f) != 0) {
+        bigint_free(&f);
         return NULL;
     }
+    size_t len = bigint_digits(&f);
+    v = malloc(sizeof(fib_value_t) + len + 1);
+    if (v) {
+        v->refs = 1;
+        v->n = n;
+        v->len = bigint_write_decimal(&f, v->digits);
+        v->digits[v->len] = '\0';
+        if (n >= FIB_CACHE_MIN_N) fib_cache_insert(v);
+    }
+    bigint_free(&f);
+    return v;
+}
+
+// ============================================================================
+// HANDLERS
+// ============================================================================
+
+int handle_fibonacci_stream(const char* n_str, const fibonacci_sink_t *sink, char **error_json) {
+    *error_json = NULL;
+    long n = parse_n(n_str);
+    if (n < 0) {
+        char buf[96];
+        snprintf(buf, sizeof(buf), "{\"error\":\"Invalid num parameter (0..%d)\"}", FIBONACCI_MAX_N);
+        *error_json = strdup(buf);
+        return FIBONACCI_STREAM_ERROR;
+    }
+
+    http_timer_t timer;
+    timer_start(&timer);
+
+    // Camino chico: sin memoria dinámica, la respuesta se arma en el stack
+    if (n <= FIB_MAX_U64) {
+        unsigned long long value = fib_u64(n);
+        timer_stop(&timer);
+        if (sink->begin && sink->begin(sink->ctx) != 0) return FIBONACCI_STREAM_ABORTED;
+        char json[96];
+        int len = snprintf(json, sizeof(json), "{\"input\":\"%ld\",\"output\":\"%llu\",\"elapsed_ms\":%ld}",
+                           n, value, timer_elapsed_ms(&timer));
+        sink->write(sink->ctx, json, (size_t)len);
+        return FIBONACCI_STREAM_OK;
+    }
 
-    // Format the JSON response
-    snprintf(json, json_len, "{\"input\":\"%s\",\"output\":\"%s\",\"elapsed_ms\":%ld}", decoded, result_str, elapsed);
+    bool cached = false;
+    fib_value_t *v = fib_value_get(n, &cached);
+    timer_stop(&timer);
+    if (!v) {
+        if (!deadline_expired()) *error_json = strdup("{\"error\":\"Memory allocation failed\"}");
+        return FIBONACCI_STREAM_ERROR;
+    }
+    if (sink->begin && sink->begin(sink->ctx) != 0) {
+        fib_value_release(v);
+        return FIBONACCI_STREAM_ABORTED;
+    }
 
-    // Clean up
-    free(decoded);
+    // "output" va al final: es lo único largo
+    char head[160];
+    int len = snprintf(head, sizeof(head),
+                       "{\"input\":\"%ld\",\"digits\":%zu,\"elapsed_ms\":%ld,\"cached\":%s,\"output\":\"",
+                       n, v->len, timer_elapsed_ms(&timer), cached ? "true" : "false");
+    sink->write(sink->ctx, head, (size_t)len);
+    for (size_t off = 0; off < v->len; off += FIB_CHUNK_BYTES) {
+        size_t chunk = v->len - off < FIB_CHUNK_BYTES ? v->len - off : FIB_CHUNK_BYTES;
+        sink->write(sink->ctx, v->digits + off, chunk);
+    }
+    sink->write(sink->ctx, "\"}", 2);
+    fib_value_release(v);
+    return FIBONACCI_STREAM_OK;
+}
+
+// Sink que arma el JSON en memoria (jobs y llamadas directas)
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} fib_buffer_t;
 
-    return json;
+static void buffer_write(void *ctx, const char *data, size_t len) {
+    fib_buffer_t *b = ctx;
+    if (!b->buf) return;
+    if (b->len + len + 1 > b->cap) {
+        size_t cap = (b->len + len + 1) * 2;
+        char *p = realloc(b->buf, cap);
+        if (!p) {
+            free(b->buf);
+            b->buf = NULL;
+            return;
+        }
+        b->buf = p;
+        b->cap = cap;
+    }
+    memcpy(b->buf + b->len, data, len);
+    b->len += len;
+    b->buf[b->len] = '\0';
+}
+
+// Calculates the nth Fibonacci number and returns the result in JSON format
+// The caller is responsible for freeing the returned string
+char* handle_fibonacci(const char* n_str) {
+    if (!n_str) return NULL;
+    fib_buffer_t b = { .buf = malloc(128), .len = 0, .cap = 128 };
+    if (!b.buf) return NULL;
+    b.buf[0] = '\0';
+    fibonacci_sink_t sink = { .begin = NULL, .write = buffer_write, .ctx = &b };
+
+    char *error = NULL;
+    if (handle_fibonacci_stream(n_str, &sink, &error) != FIBONACCI_STREAM_OK) {
+        free(b.buf);
+        return error;
+    }
+    return b.buf;
 }
@@ -12,7 +12,10 @@ char* handle_help(void) {
             "\"basic\":["
                 "{\"path\":\"/status\",\"description\":\"Server status and metrics\"},"
                 "{\"path\":\"/help\",\"description\":\"This help message\"},"
-                "{\"path\":\"/fibonacci?num=N\",\"description\":\"Calculate Fibonacci number\"},"
+                "{\"path\":\"/metrics\",\"description\":\"Per-command latency metrics (JSON), ?window=10s for rates over the last 1-60s\"},"
+                "{\"path\":\"/metrics/prometheus\",\"description\":\"Metrics in Prometheus text format\"},"
+                "{\"path\":\"/debug/trace?seconds=5\",\"description\":\"Sampled request spans (Chrome trace_event JSON)\"},"
+                "{\"path\":\"/fibonacci?num=N\",\"description\":\"Exact Fibonacci number (fast doubling, N up to 10000000, cached)\"},"
                 "{\"path\":\"/reverse?text=TEXT\",\"description\":\"Reverse input text\"},"
                 "{\"path\":\"/toupper?text=TEXT\",\"description\":\"Convert text to uppercase\"},"
                 "{\"path\":\"/random?count=N&min=A&max=B\",\"description\":\"Generate random numbers\"},"
@@ -24,16 +27,19 @@ char* handle_help(void) {
             "],"
             "\"cpu_bound\":["
                 "{\"path\":\"/isprime?n=NUM\",\"description\":\"Check if number is prime\"},"
-                "{\"path\":\"/factor?n=NUM\",\"description\":\"Prime factorization\"},"
-                "{\"path\":\"/pi?digits=D\",\"description\":\"Calculate PI digits\"},"
-                "{\"path\":\"/mandelbrot?width=W&height=H&max_iter=I\",\"description\":\"Generate Mandelbrot set\"},"
+                "{\"path\":\"/factor?n=NUM\",\"description\":\"Prime factorization (NUM < 2^128, Pollard rho)\"},"
+                "{\"path\":\"/primes?from=A&to=B[&list=true]\",\"description\":\"Count (or list) primes in [A, B], segmented sieve\"},"
+                "{\"path\":\"/isprime_batch?nums=N1,N2,...\",\"description\":\"Primality of up to 4096 numbers per request\"},"
+                "{\"path\":\"/pi?digits=D\",\"description\":\"PI digits (Chudnovsky, up to 5000000, cached)\"},"
+                "{\"path\":\"/mandelbrot?width=W&height=H&max_iter=I[&cx=X&cy=Y&zoom=Z][&format=json|u16|u8|pgm|png]\",\"description\":\"Generate Mandelbrot set\"},"
                 "{\"path\":\"/matrixmul?size=N&seed=S\",\"description\":\"Matrix multiplication\"}"
             "],"
             "\"io_bound\":["
                 "{\"path\":\"/sortfile?name=FILE&algo=ALGO\",\"description\":\"Sort file contents\"},"
-                "{\"path\":\"/wordcount?name=FILE\",\"description\":\"Count words in file\"},"
+                "{\"path\":\"/wordcount?name=FILE[&threads=N]\",\"description\":\"Count lines, words, bytes and UTF-8 chars (SIMD)\"},"
                 "{\"path\":\"/grep?name=FILE&pattern=REGEX\",\"description\":\"Search file content\"},"
-                "{\"path\":\"/compress?name=FILE&codec=TYPE\",\"description\":\"Compress file\"},"
+                "{\"path\":\"/compress?name=FILE&codec=gzip|xz[&threads=N]\",\"description\":\"Compress file in-process, parallel blocks (files/FILE.gz|.xz)\"},"
+                "{\"path\":\"/decompress?name=FILE.gz|FILE.xz&overwrite=true|false\",\"description\":\"Decompress file (codec from extension; refuses to replace an existing file unless overwrite=true)\"},"
                 "{\"path\":\"/hashfile?name=FILE&algo=TYPE\",\"description\":\"Calculate file hash\"}"
             "],"
             "\"files\":["
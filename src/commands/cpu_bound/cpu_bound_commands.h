@@ -1,20 +1,109 @@
 #ifndef CPU_BOUND_COMMANDS_H
 #define CPU_BOUND_COMMANDS_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
+// Handlers may run under a per-request deadline (X-Request-Timeout-Ms header or
+// per-route default). Long loops should poll deadline_expired() from
+// utils/utils.h and return early; the caller answers 504 in that case.
+
 // Function declaration for isprime command
 char* handle_isprime(const char* n_str);
 
 // Function declaration for factor command
 char* handle_factor(const char* n_str);
 
+// Primos en [from, to] (from NULL = 0); list "true"/"1" agrega la lista
+char* handle_primes(const char* from_str, const char* to_str, const char* list_str);
+
+#define PRIMES_MAX_LIST_RANGE 10000000ULL
+
+// Primalidad de varios números separados por coma en un solo request
+char* handle_isprime_batch(const char* nums_str);
+
+#define ISPRIME_BATCH_MAX 4096
+
 // Function declaration for pi command
 char* handle_pi(const char* digits_str);
 
-// Function declaration for mandelbrot command
-char* handle_mandelbrot(const char* width_str, const char* height_str, const char* max_iter_str);
+#define PI_MAX_DIGITS 5000000
+
+// Destino de la respuesta de /pi
+typedef struct {
+    // Antes del primer byte (los dígitos ya están calculados); != 0 aborta
+    int (*begin)(void *ctx);
+    void (*write)(void *ctx, const char *data, size_t len);
+    void *ctx;
+} pi_sink_t;
+
+#define PI_STREAM_OK        0
+#define PI_STREAM_ERROR    -1   // Nada enviado: *error_json (NULL = deadline)
+#define PI_STREAM_ABORTED  -2   // begin falló
+
+// Mismo JSON que handle_pi, escrito por partes; los dígitos salen del caché
+// cuando ya se calcularon al menos tantos
+int handle_pi_stream(const char* digits_str, const pi_sink_t *sink, char **error_json);
+
+// "31415..." con 1 + decimals dígitos (truncados, sin punto), sin pasar por
+// el caché. NULL si venció el deadline o faltó memoria
+char* pi_compute_digits(int decimals, int threads);
+
+// Vaciar el caché de dígitos
+void pi_cache_clear(void);
+
+// Function declaration for mandelbrot command (center/zoom NULL = encuadre por defecto)
+char* handle_mandelbrot(const char* width_str, const char* height_str, const char* max_iter_str,
+                        const char* center_x_str, const char* center_y_str, const char* zoom_str);
+
+#define MANDELBROT_MAX_PIXELS (3840 * 2160)
+
+// Área a renderizar: el pixel (x, y) es el punto (x_min + x*dx, y_min + y*dy)
+typedef struct {
+    int width;
+    int height;
+    int max_iter;
+    double x_min;
+    double y_min;
+    double dx;
+    double dy;
+} mandelbrot_view_t;
+
+// Iteraciones por pixel (width*height, por filas) con hasta threads threads.
+// lanes: 8 (AVX-512), 4 (AVX2), 1 (escalar) o 0 = el mejor soportado; todos
+// dan el mismo resultado. Retorna los lanes usados, o -1 si venció el deadline
+int mandelbrot_render(const mandelbrot_view_t *view, int *iters, int threads, int lanes);
+
+// Destino de la salida binaria de /mandelbrot
+typedef struct {
+    // Antes del primer byte del body (ya se calculó la primera banda); != 0 aborta
+    int (*begin)(void *ctx, const char *content_type, const mandelbrot_view_t *view);
+    void (*write)(void *ctx, const void *data, size_t len);
+    // Fin de una banda: mandar lo acumulado; != 0 si el cliente se fue
+    int (*flush)(void *ctx);
+    void *ctx;
+} mandelbrot_sink_t;
+
+#define MANDELBROT_STREAM_OK        0
+#define MANDELBROT_STREAM_ERROR    -1   // Nada enviado: *error_json (NULL = deadline)
+#define MANDELBROT_STREAM_ABORTED  -2   // Cortado después de begin (deadline o cliente)
+
+// Mandelbrot en format u16 (iteraciones little-endian), u8 (gris), pgm o png,
+// escrito por bandas de filas a medida que se calculan
+int handle_mandelbrot_stream(const char* width_str, const char* height_str, const char* max_iter_str,
+                             const char* center_x_str, const char* center_y_str, const char* zoom_str,
+                             const char* format_str, const mandelbrot_sink_t *sink, char **error_json);
 
 // Function declaration for matrix multiplication command
 char* handle_matrixmul(const char* size_str, const char* seed_str);
 
+#define MATRIXMUL_MAX_SIZE 4096
+
+// C = A * B (N x N, row-major) con el kernel bloqueado; simd=false fuerza el
+// kernel escalar. Mismo resultado bit a bit con cualquier threads/simd.
+// Retorna 0 si éxito, -1 si venció el deadline o faltó memoria
+int matrixmul_multiply(int n, const double *A, const double *B, double *C,
+                       int threads, bool simd);
+
 #endif // CPU_BOUND_COMMANDS_H
 
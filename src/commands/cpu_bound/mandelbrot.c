@@ -3,11 +3,257 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <complex.h>
+#include <stdint.h>
+#include <math.h>
+#include <zlib.h>
+#include "cpu_bound_commands.h"
 #include "../../utils/utils.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
-char* handle_mandelbrot(const char* width_str, const char* height_str, const char* max_iter_str) {
-	if (!width_str || !height_str || !max_iter_str) return NULL;
+// ============================================================================
+// RENDER POR TILES
+// ============================================================================
+//
+// La imagen se corta en tiles de TILE_W x TILE_H que los threads toman de un
+// contador compartido (parallel_for): el costo por tile varía órdenes de
+// magnitud entre el interior del conjunto y el exterior, así que un reparto
+// fijo dejaría threads ociosos.
+//
+// Dentro de cada fila, los puntos del cardioide principal y del bulbo de
+// período 2 salen directo con max_iter; el resto se itera de a 4 (AVX2) u
+// 8 (AVX-512) puntos por grupo, y cada lane deja de contar al escapar.
+// Los kernels usan las mismas operaciones (sin FMA) que el escalar: el
+// resultado es idéntico con cualquier kernel y cantidad de threads.
+
+#define MB_TILE_W 64
+#define MB_TILE_H 8
+#define MB_MAX_LANES 8
+
+#define MB_PARALLEL_MIN_PIXELS 16384    // Debajo de esto un solo thread
+
+// Itera lanes puntos (cx[i], cy) y escribe las iteraciones en out
+typedef void (*mb_group_fn)(const double *cx, double cy, int max_iter, int *out);
+
+// ============================================================================
+// KERNELS
+// ============================================================================
+
+static void group_scalar(const double *cx, double cy, int max_iter, int *out) {
+	double zx = 0.0, zy = 0.0;
+	int iter = 0;
+	while (zx*zx + zy*zy <= 4.0 && iter < max_iter) {
+		double xt = zx*zx - zy*zy + cx[0];
+		zy = 2.0*zx*zy + cy;
+		zx = xt;
+		iter++;
+	}
+	out[0] = iter;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+static void group_avx2(const double *cx, double cy, int max_iter, int *out) {
+	const __m256d four = _mm256_set1_pd(4.0);
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d vcx = _mm256_loadu_pd(cx);
+	const __m256d vcy = _mm256_set1_pd(cy);
+	__m256d zx = _mm256_setzero_pd(), zy = _mm256_setzero_pd();
+	__m256d count = _mm256_setzero_pd();
+	__m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+	for (int i = 0; i < max_iter; i++) {
+		__m256d x2 = _mm256_mul_pd(zx, zx);
+		__m256d y2 = _mm256_mul_pd(zy, zy);
+		// Un lane que escapó no vuelve (y NaN compara falso)
+		active = _mm256_and_pd(active, _mm256_cmp_pd(_mm256_add_pd(x2, y2), four, _CMP_LE_OQ));
+		if (_mm256_movemask_pd(active) == 0) break;
+		count = _mm256_add_pd(count, _mm256_and_pd(active, one));
+
+		__m256d xy = _mm256_mul_pd(zx, zy);
+		zx = _mm256_add_pd(_mm256_sub_pd(x2, y2), vcx);
+		zy = _mm256_add_pd(_mm256_add_pd(xy, xy), vcy);
+	}
+
+	double counts[4];
+	_mm256_storeu_pd(counts, count);
+	for (int i = 0; i < 4; i++) out[i] = (int)counts[i];
+}
+
+__attribute__((target("avx512f")))
+static void group_avx512(const double *cx, double cy, int max_iter, int *out) {
+	const __m512d four = _mm512_set1_pd(4.0);
+	const __m512d one = _mm512_set1_pd(1.0);
+	const __m512d vcx = _mm512_loadu_pd(cx);
+	const __m512d vcy = _mm512_set1_pd(cy);
+	__m512d zx = _mm512_setzero_pd(), zy = _mm512_setzero_pd();
+	__m512d count = _mm512_setzero_pd();
+	__mmask8 active = 0xFF;
+
+	for (int i = 0; i < max_iter; i++) {
+		__m512d x2 = _mm512_mul_pd(zx, zx);
+		__m512d y2 = _mm512_mul_pd(zy, zy);
+		active = _mm512_mask_cmp_pd_mask(active, _mm512_add_pd(x2, y2), four, _CMP_LE_OQ);
+		if (active == 0) break;
+		count = _mm512_mask_add_pd(count, active, count, one);
+
+		__m512d xy = _mm512_mul_pd(zx, zy);
+		zx = _mm512_add_pd(_mm512_sub_pd(x2, y2), vcx);
+		zy = _mm512_add_pd(_mm512_add_pd(xy, xy), vcy);
+	}
+
+	double counts[8];
+	_mm512_storeu_pd(counts, count);
+	for (int i = 0; i < 8; i++) out[i] = (int)counts[i];
+}
+#endif
+
+// Lanes del mejor kernel soportado (1 = escalar)
+static int best_lanes(void) {
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return 8;
+	if (__builtin_cpu_supports("avx2")) return 4;
+#endif
+	return 1;
+}
+
+static mb_group_fn group_for_lanes(int lanes) {
+#if defined(__x86_64__)
+	if (lanes == 8) return group_avx512;
+	if (lanes == 4) return group_avx2;
+#endif
+	(void)lanes;
+	return group_scalar;
+}
+
+// Cardioide principal o bulbo de período 2: nunca escapan
+static int in_main_bulbs(double cx, double cy) {
+	double y2 = cy * cy;
+	double xq = cx - 0.25;
+	double q = xq * xq + y2;
+	if (q * (q + xq) <= 0.25 * y2) return 1;
+	double xb = cx + 1.0;
+	return xb * xb + y2 <= 0.0625;
+}
+
+typedef struct {
+	const mandelbrot_view_t *view;
+	int *iters;             // Fila y_begin
+	int y_begin;
+	int y_end;
+	int tiles_x;
+	int lanes;
+	mb_group_fn group;
+	int aborted;            // Deadline vencido (atómico)
+} render_ctx_t;
+
+static void run_group(const render_ctx_t *r, double *cx, double cy,
+                      const int *xs, int pending, int *row) {
+	int out[MB_MAX_LANES];
+	// Grupo incompleto al final de la fila: repetir el último punto
+	for (int i = pending; i < r->lanes; i++) cx[i] = cx[pending - 1];
+	r->group(cx, cy, r->view->max_iter, out);
+	for (int i = 0; i < pending; i++) row[xs[i]] = out[i];
+}
+
+static void render_tile(int index, void *arg) {
+	render_ctx_t *r = arg;
+	const mandelbrot_view_t *v = r->view;
+	if (__atomic_load_n(&r->aborted, __ATOMIC_RELAXED)) return;
+	if (deadline_expired()) {
+		__atomic_store_n(&r->aborted, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	int x0 = (index % r->tiles_x) * MB_TILE_W;
+	int y0 = r->y_begin + (index / r->tiles_x) * MB_TILE_H;
+	int x1 = x0 + MB_TILE_W < v->width ? x0 + MB_TILE_W : v->width;
+	int y1 = y0 + MB_TILE_H < r->y_end ? y0 + MB_TILE_H : r->y_end;
+
+	for (int y = y0; y < y1; y++) {
+		double cy = v->y_min + y * v->dy;
+		int *row = r->iters + (size_t)(y - r->y_begin) * v->width;
+
+		// Puntos a iterar, agrupados de a lanes
+		double cx[MB_MAX_LANES];
+		int xs[MB_MAX_LANES];
+		int pending = 0;
+		for (int x = x0; x < x1; x++) {
+			double px = v->x_min + x * v->dx;
+			if (in_main_bulbs(px, cy)) {
+				row[x] = v->max_iter;
+				continue;
+			}
+			cx[pending] = px;
+			xs[pending++] = x;
+			if (pending == r->lanes) {
+				run_group(r, cx, cy, xs, pending, row);
+				pending = 0;
+			}
+		}
+		if (pending > 0) run_group(r, cx, cy, xs, pending, row);
+	}
+}
+
+// Filas [y_begin, y_end) en iters (que arranca en la fila y_begin)
+static int render_rows(const mandelbrot_view_t *view, int *iters, int y_begin, int y_end,
+                       int threads, int lanes) {
+	int best = best_lanes();
+	if (lanes <= 0 || lanes > best) lanes = best;
+	if (lanes != 8 && lanes != 4) lanes = 1;
+
+	render_ctx_t r = {
+		.view = view,
+		.iters = iters,
+		.y_begin = y_begin,
+		.y_end = y_end,
+		.tiles_x = (view->width + MB_TILE_W - 1) / MB_TILE_W,
+		.lanes = lanes,
+		.group = group_for_lanes(lanes),
+		.aborted = 0
+	};
+	int tiles = r.tiles_x * ((y_end - y_begin + MB_TILE_H - 1) / MB_TILE_H);
+	parallel_for(tiles, threads, render_tile, &r);
+	return r.aborted ? -1 : lanes;
+}
+
+int mandelbrot_render(const mandelbrot_view_t *view, int *iters, int threads, int lanes) {
+	if (!view || !iters || view->width <= 0 || view->height <= 0) return -1;
+	return render_rows(view, iters, 0, view->height, threads, lanes);
+}
+
+// ============================================================================
+// HANDLER
+// ============================================================================
+
+// Parsear un double finito; NULL deja el default
+static int parse_view_param(const char *s, double *out) {
+	if (!s) return 0;
+	char *end;
+	double v = strtod(s, &end);
+	if (end == s || *end != '\0' || !isfinite(v)) return -1;
+	*out = v;
+	return 0;
+}
+
+// Escribir un entero no negativo; retorna el largo
+static int append_uint(char *dst, unsigned int v) {
+	char tmp[12];
+	int len = 0;
+	do {
+		tmp[len++] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v);
+	for (int i = 0; i < len; i++) dst[i] = tmp[len - 1 - i];
+	return len;
+}
+
+// Validar parámetros y armar la vista; retorna el JSON de error o NULL si ok
+static char* parse_request(const char* width_str, const char* height_str, const char* max_iter_str,
+                           const char* center_x_str, const char* center_y_str, const char* zoom_str,
+                           mandelbrot_view_t *view, double *center_x, double *center_y, double *zoom) {
 	int width = atoi(width_str);
 	int height = atoi(height_str);
 	int max_iter = atoi(max_iter_str);
@@ -15,50 +261,317 @@ char* handle_mandelbrot(const char* width_str, const char* height_str, const cha
 
 	// Limit total pixels to avoid huge responses
 	long total = (long)width * (long)height;
-	if (total > 200000) return strdup("{\"error\":\"Requested image too large; limit width*height <= 200000\"}");
+	if (total > MANDELBROT_MAX_PIXELS) {
+		char err[96];
+		snprintf(err, sizeof(err), "{\"error\":\"Requested image too large; limit width*height <= %d\"}",
+		         MANDELBROT_MAX_PIXELS);
+		return strdup(err);
+	}
+
+	*center_x = -0.5;
+	*center_y = 0.0;
+	*zoom = 1.0;
+	if (parse_view_param(center_x_str, center_x) != 0 ||
+	    parse_view_param(center_y_str, center_y) != 0 ||
+	    parse_view_param(zoom_str, zoom) != 0 || *zoom <= 0.0) {
+		return strdup("{\"error\":\"Invalid view parameters\"}");
+	}
+
+	view->width = width;
+	view->height = height;
+	view->max_iter = max_iter;
+	if (center_x_str || center_y_str || zoom_str) {
+		// Pixeles cuadrados: el ancho de la imagen cubre 3/zoom unidades
+		double scale = 3.0 / *zoom / (width > 1 ? width - 1 : 1);
+		view->x_min = *center_x - scale * (width - 1) / 2.0;
+		view->y_min = *center_y - scale * (height - 1) / 2.0;
+		view->dx = view->dy = scale;
+	} else {
+		// Encuadre original: [-2,1] x [-1.5,1.5] estirado a la imagen
+		view->x_min = -2.0;
+		view->y_min = -1.5;
+		view->dx = 3.0 / (width > 1 ? width - 1 : 1);
+		view->dy = 3.0 / (height > 1 ? height - 1 : 1);
+	}
+	return NULL;
+}
+
+char* handle_mandelbrot(const char* width_str, const char* height_str, const char* max_iter_str,
+                        const char* center_x_str, const char* center_y_str, const char* zoom_str) {
+	if (!width_str || !height_str || !max_iter_str) return NULL;
+
+	mandelbrot_view_t view;
+	double center_x, center_y, zoom;
+	char *error = parse_request(width_str, height_str, max_iter_str, center_x_str, center_y_str,
+	                            zoom_str, &view, &center_x, &center_y, &zoom);
+	if (error) return error;
+	bool custom_view = center_x_str || center_y_str || zoom_str;
+	int width = view.width, height = view.height, max_iter = view.max_iter;
+	long total = (long)width * (long)height;
 
 	http_timer_t timer; timer_start(&timer);
 
 	int *iters = malloc(sizeof(int) * total);
 	if (!iters) return strdup("{\"error\":\"Memory allocation failed\"}");
 
-	double x_min = -2.0, x_max = 1.0;
-	double y_min = -1.5, y_max = 1.5;
-	double dx = (x_max - x_min) / (width - 1);
-	double dy = (y_max - y_min) / (height - 1);
-
-	for (int y = 0; y < height; y++) {
-		for (int x = 0; x < width; x++) {
-			double cx = x_min + x * dx;
-			double cy = y_min + y * dy;
-			double zx = 0.0, zy = 0.0;
-			int iter = 0;
-			while (zx*zx + zy*zy <= 4.0 && iter < max_iter) {
-				double xt = zx*zx - zy*zy + cx;
-				zy = 2.0*zx*zy + cy;
-				zx = xt;
-				iter++;
-			}
-			iters[y * width + x] = iter;
-		}
-	}
+	int threads = total < MB_PARALLEL_MIN_PIXELS ? 1 : parallel_default_threads();
+	// Abort early if nobody is waiting for the answer anymore
+	if (mandelbrot_render(&view, iters, threads, 0) < 0) { free(iters); return NULL; }
 
 	timer_stop(&timer);
 	long elapsed = timer_elapsed_ms(&timer);
 
-	// Build JSON
-	size_t approx_size = total * 6 + 256;
+	// Build JSON: cada valor ocupa a lo sumo los dígitos de max_iter más la coma
+	char digits[12];
+	size_t per_value = (size_t)snprintf(digits, sizeof(digits), "%d", max_iter) + 1;
+	size_t approx_size = (size_t)total * per_value + 512;
 	char *json = malloc(approx_size);
 	if (!json) { free(iters); return strdup("{\"error\":\"Memory allocation failed\"}"); }
 
-	int pos = snprintf(json, approx_size, "{\"width\":%d,\"height\":%d,\"max_iter\":%d,\"elapsed_ms\":%ld,\"data\":[",
-					   width, height, max_iter, elapsed);
+	int pos = snprintf(json, approx_size, "{\"width\":%d,\"height\":%d,\"max_iter\":%d,", width, height, max_iter);
+	if (custom_view) {
+		pos += snprintf(json + pos, approx_size - pos, "\"center_x\":%.15g,\"center_y\":%.15g,\"zoom\":%.15g,",
+		                center_x, center_y, zoom);
+	}
+	pos += snprintf(json + pos, approx_size - pos, "\"elapsed_ms\":%ld,\"data\":[", elapsed);
+
+	char *p = json + pos;
 	for (long i = 0; i < total; i++) {
-		if (i) pos += snprintf(json + pos, approx_size - pos, ",%d", iters[i]);
-		else pos += snprintf(json + pos, approx_size - pos, "%d", iters[i]);
+		if (i) *p++ = ',';
+		p += append_uint(p, (unsigned int)iters[i]);
 	}
-	snprintf(json + pos, approx_size - pos, "]}");
+	memcpy(p, "]}", 3);
 
 	free(iters);
 	return json;
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// SALIDA BINARIA EN STREAMING (format=u16|u8|pgm|png)
+// ============================================================================
+//
+// La imagen se calcula en bandas de MB_BAND_ROWS filas: cada banda se reparte
+// entre los threads como el render completo, se codifica y se manda antes de
+// empezar la siguiente. Los headers salen recién con la primera banda, así
+// que un deadline que vence antes todavía se responde con 504.
+
+#define MB_BAND_ROWS 64
+#define MB_PNG_OUT   65536      // Salida de deflate por IDAT como máximo
+
+typedef enum {
+	MB_FORMAT_U16 = 0,
+	MB_FORMAT_U8,
+	MB_FORMAT_PGM,
+	MB_FORMAT_PNG
+} mb_format_t;
+
+static const struct {
+	const char *name;
+	const char *content_type;
+} g_formats[] = {
+	[MB_FORMAT_U16] = { "u16", "application/octet-stream" },
+	[MB_FORMAT_U8]  = { "u8",  "application/octet-stream" },
+	[MB_FORMAT_PGM] = { "pgm", "image/x-portable-graymap" },
+	[MB_FORMAT_PNG] = { "png", "image/png" },
+};
+
+// Gris de 8 bits: 0 = dentro del conjunto, 1..255 según la velocidad de escape
+static uint8_t shade(int iter, int max_iter) {
+	if (iter >= max_iter) return 0;
+	return (uint8_t)(1 + (uint64_t)iter * 254 / max_iter);
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >> 8);
+	p[3] = (uint8_t)v;
+}
+
+typedef struct {
+	const mandelbrot_sink_t *sink;
+	z_stream zs;
+	uint8_t out[MB_PNG_OUT];
+} png_writer_t;
+
+static void png_chunk(const mandelbrot_sink_t *sink, const char *type,
+                      const uint8_t *data, size_t len) {
+	uint8_t head[8];
+	put_be32(head, (uint32_t)len);
+	memcpy(head + 4, type, 4);
+	uint32_t crc = (uint32_t)crc32(0L, head + 4, 4);
+	if (len) crc = (uint32_t)crc32(crc, data, (uInt)len);
+	uint8_t tail[4];
+	put_be32(tail, crc);
+
+	sink->write(sink->ctx, head, sizeof(head));
+	if (len) sink->write(sink->ctx, data, len);
+	sink->write(sink->ctx, tail, sizeof(tail));
+}
+
+// Pasar bytes por deflate; cada salida es un IDAT
+static int png_deflate(png_writer_t *w, const uint8_t *in, size_t len, int flush) {
+	w->zs.next_in = (Bytef*)in;
+	w->zs.avail_in = (uInt)len;
+	do {
+		w->zs.next_out = w->out;
+		w->zs.avail_out = sizeof(w->out);
+		if (deflate(&w->zs, flush) == Z_STREAM_ERROR) return -1;
+		size_t produced = sizeof(w->out) - w->zs.avail_out;
+		if (produced) png_chunk(w->sink, "IDAT", w->out, produced);
+	} while (w->zs.avail_out == 0);
+	return 0;
+}
+
+static int png_begin(png_writer_t *w, const mandelbrot_sink_t *sink, int width, int height) {
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	w->sink = sink;
+	memset(&w->zs, 0, sizeof(w->zs));
+	// Nivel 1: la imagen tiene zonas planas enormes; más nivel casi no achica
+	if (deflateInit(&w->zs, Z_BEST_SPEED) != Z_OK) return -1;
+
+	uint8_t ihdr[13];
+	put_be32(ihdr, (uint32_t)width);
+	put_be32(ihdr + 4, (uint32_t)height);
+	ihdr[8] = 8;        // Bits por muestra
+	ihdr[9] = 0;        // Escala de grises
+	ihdr[10] = 0;       // Deflate
+	ihdr[11] = 0;       // Filtros adaptativos estándar
+	ihdr[12] = 0;       // Sin interlace
+	sink->write(sink->ctx, signature, sizeof(signature));
+	png_chunk(sink, "IHDR", ihdr, sizeof(ihdr));
+	return 0;
+}
+
+// Una banda de filas: filtro Sub por fila y flush de deflate al final, para
+// que el cliente pueda decodificar hasta acá
+static int png_band(png_writer_t *w, const int *iters, int width, int rows, int max_iter,
+                    uint8_t *line) {
+	for (int y = 0; y < rows; y++) {
+		const int *row = iters + (size_t)y * width;
+		line[0] = 1;    // Sub
+		uint8_t prev = 0;
+		for (int x = 0; x < width; x++) {
+			uint8_t v = shade(row[x], max_iter);
+			line[1 + x] = (uint8_t)(v - prev);
+			prev = v;
+		}
+		if (png_deflate(w, line, (size_t)width + 1, Z_NO_FLUSH) != 0) return -1;
+	}
+	return png_deflate(w, NULL, 0, Z_SYNC_FLUSH);
+}
+
+static int png_end(png_writer_t *w) {
+	int rc = png_deflate(w, NULL, 0, Z_FINISH);
+	deflateEnd(&w->zs);
+	if (rc == 0) png_chunk(w->sink, "IEND", NULL, 0);
+	return rc;
+}
+
+// Codificar una banda en el formato pedido
+static int write_band(mb_format_t format, png_writer_t *png, const mandelbrot_sink_t *sink,
+                      const int *iters, int width, int rows, int max_iter, uint8_t *scratch) {
+	size_t count = (size_t)width * rows;
+	switch (format) {
+		case MB_FORMAT_U16:
+			for (size_t i = 0; i < count; i++) {
+				unsigned int v = iters[i] > 0xFFFF ? 0xFFFF : (unsigned int)iters[i];
+				scratch[2 * i] = (uint8_t)v;
+				scratch[2 * i + 1] = (uint8_t)(v >> 8);
+			}
+			sink->write(sink->ctx, scratch, count * 2);
+			return 0;
+		case MB_FORMAT_U8:
+		case MB_FORMAT_PGM:
+			for (size_t i = 0; i < count; i++) scratch[i] = shade(iters[i], max_iter);
+			sink->write(sink->ctx, scratch, count);
+			return 0;
+		case MB_FORMAT_PNG:
+			return png_band(png, iters, width, rows, max_iter, scratch);
+	}
+	return -1;
+}
+
+int handle_mandelbrot_stream(const char* width_str, const char* height_str, const char* max_iter_str,
+                             const char* center_x_str, const char* center_y_str, const char* zoom_str,
+                             const char* format_str, const mandelbrot_sink_t *sink, char **error_json) {
+	*error_json = NULL;
+	if (!width_str || !height_str || !max_iter_str || !format_str || !sink) return MANDELBROT_STREAM_ERROR;
+
+	int format = -1;
+	for (int i = 0; i < (int)(sizeof(g_formats) / sizeof(g_formats[0])); i++) {
+		if (strcmp(format_str, g_formats[i].name) == 0) format = i;
+	}
+	if (format < 0) {
+		*error_json = strdup("{\"error\":\"Invalid format (json|u16|u8|pgm|png)\"}");
+		return MANDELBROT_STREAM_ERROR;
+	}
+
+	mandelbrot_view_t view;
+	double center_x, center_y, zoom;
+	*error_json = parse_request(width_str, height_str, max_iter_str, center_x_str, center_y_str,
+	                            zoom_str, &view, &center_x, &center_y, &zoom);
+	if (*error_json) return MANDELBROT_STREAM_ERROR;
+
+	int width = view.width;
+	int band_rows = view.height < MB_BAND_ROWS ? view.height : MB_BAND_ROWS;
+	int *iters = malloc(sizeof(int) * (size_t)width * band_rows);
+	// u16 usa 2 bytes por pixel; png una fila a la vez con el byte de filtro
+	uint8_t *scratch = malloc((size_t)width * band_rows * 2 + 1);
+	png_writer_t *png = format == MB_FORMAT_PNG ? malloc(sizeof(png_writer_t)) : NULL;
+	if (!iters || !scratch || (format == MB_FORMAT_PNG && !png)) {
+		free(iters); free(scratch); free(png);
+		*error_json = strdup("{\"error\":\"Memory allocation failed\"}");
+		return MANDELBROT_STREAM_ERROR;
+	}
+
+	long total = (long)width * view.height;
+	int threads = total < MB_PARALLEL_MIN_PIXELS ? 1 : parallel_default_threads();
+	int rc = MANDELBROT_STREAM_OK;
+	bool started = false;
+
+	for (int y0 = 0; y0 < view.height; y0 += band_rows) {
+		int rows = view.height - y0 < band_rows ? view.height - y0 : band_rows;
+		if (render_rows(&view, iters, y0, y0 + rows, threads, 0) < 0) {
+			// Deadline: antes de los headers el caller todavía puede responder 504
+			rc = started ? MANDELBROT_STREAM_ABORTED : MANDELBROT_STREAM_ERROR;
+			break;
+		}
+
+		if (!started) {
+			if (sink->begin(sink->ctx, g_formats[format].content_type, &view) != 0) {
+				rc = MANDELBROT_STREAM_ABORTED;
+				break;
+			}
+			started = true;
+			if (format == MB_FORMAT_PGM) {
+				char header[64];
+				int len = snprintf(header, sizeof(header), "P5\n%d %d\n255\n", width, view.height);
+				sink->write(sink->ctx, header, (size_t)len);
+			} else if (format == MB_FORMAT_PNG && png_begin(png, sink, width, view.height) != 0) {
+				rc = MANDELBROT_STREAM_ABORTED;
+				free(png);
+				png = NULL;
+				break;
+			}
+		}
+
+		if (write_band(format, png, sink, iters, width, rows, view.max_iter, scratch) != 0 ||
+		    sink->flush(sink->ctx) != 0) {
+			rc = MANDELBROT_STREAM_ABORTED;
+			break;
+		}
+	}
+
+	if (png) {
+		if (started && rc == MANDELBROT_STREAM_OK) {
+			if (png_end(png) != 0 || sink->flush(sink->ctx) != 0) rc = MANDELBROT_STREAM_ABORTED;
+		} else if (started) {
+			deflateEnd(&png->zs);
+		}
+		free(png);
+	}
+	free(iters);
+	free(scratch);
+	return rc;
+}
@@ -4,20 +4,289 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <math.h>
+#include "cpu_bound_commands.h"
 #include "../../utils/utils.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// ============================================================================
+// BLOQUEO (estilo GotoBLAS)
+// ============================================================================
+//
+// C se recorre en tiles de MC x NC (uno por tarea en paralelo). Dentro de un
+// tile, k avanza en bloques de KC: el bloque de B (KC x NC) se empaqueta en
+// paneles de NR columnas y queda en L2; el de A (MC x KC) en paneles de MR
+// filas que entran en L1. El micro-kernel calcula MR x NR elementos de C en
+// registros.
+//
+// Cada elemento de C es una sola cadena de fma() en k creciente, empezando
+// en 0: el resultado es idéntico bit a bit con AVX2 o escalar y con
+// cualquier cantidad de threads, así que result_hash es determinista.
+
+#define MM_MR   6
+#define MM_NR   8
+#define MM_KC   256
+#define MM_MC   96      // Múltiplo de MM_MR
+#define MM_NC   256     // Múltiplo de MM_NR
+
+#define MM_PARALLEL_MIN_SIZE 128    // Debajo de esto no vale crear threads
+
+typedef void (*mm_kernel_fn)(int kc, const double *a, const double *b,
+                             double *c, int ldc, int first);
+
+// ============================================================================
+// PRNG POR CONTADOR
+// ============================================================================
+
+// splitmix64: el valor i sale directo de (clave, i), sin estado compartido;
+// cada request (y cada bloque de filas) genera independiente
+static uint64_t mix64(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static uint64_t stream_key(unsigned int seed, unsigned int stream) {
+	return mix64(((uint64_t)stream << 32) | seed);
+}
+
+// Double en [0,1) con los 53 bits altos
+static double counter_uniform(uint64_t key, uint64_t i) {
+	return (double)(mix64(key + (i + 1) * 0x9E3779B97F4A7C15ULL) >> 11) * 0x1.0p-53;
+}
+
+#define MM_GEN_ROWS 64
+
+typedef struct {
+	double *m;
+	int n;
+	uint64_t key;
+} gen_ctx_t;
+
+static void gen_rows(int index, void *arg) {
+	gen_ctx_t *g = arg;
+	size_t first = (size_t)index * MM_GEN_ROWS * g->n;
+	size_t last = first + (size_t)MM_GEN_ROWS * g->n;
+	size_t total = (size_t)g->n * g->n;
+	if (last > total) last = total;
+	for (size_t i = first; i < last; i++) g->m[i] = counter_uniform(g->key, i);
+}
 
 // Generate pseudo-random matrix of doubles in [0,1)
-static double* gen_matrix(int n, unsigned int seed) {
-	double *m = malloc(sizeof(double) * n * n);
+static double* gen_matrix(int n, uint64_t key, int threads) {
+	double *m = malloc(sizeof(double) * (size_t)n * n);
 	if (!m) return NULL;
-	srand(seed);
-	for (int i = 0; i < n * n; i++) m[i] = (double)rand() / (double)RAND_MAX;
+	gen_ctx_t g = { .m = m, .n = n, .key = key };
+	parallel_for((n + MM_GEN_ROWS - 1) / MM_GEN_ROWS, threads, gen_rows, &g);
 	return m;
 }
 
 // Free matrix
 static void free_matrix(double* m) { free(m); }
 
+// ============================================================================
+// MICRO-KERNELS (MR x NR += A_panel * B_panel)
+// ============================================================================
+
+// a: kc x MR (k-major), b: kc x NR (k-major); first = C arranca en 0
+static void kernel_scalar(int kc, const double *a, const double *b,
+                          double *c, int ldc, int first) {
+	double acc[MM_MR][MM_NR];
+	for (int r = 0; r < MM_MR; r++) {
+		for (int j = 0; j < MM_NR; j++) acc[r][j] = first ? 0.0 : c[r * ldc + j];
+	}
+	for (int k = 0; k < kc; k++) {
+		for (int r = 0; r < MM_MR; r++) {
+			double ar = a[r];
+			for (int j = 0; j < MM_NR; j++) acc[r][j] = fma(ar, b[j], acc[r][j]);
+		}
+		a += MM_MR;
+		b += MM_NR;
+	}
+	for (int r = 0; r < MM_MR; r++) {
+		for (int j = 0; j < MM_NR; j++) c[r * ldc + j] = acc[r][j];
+	}
+}
+
+#if defined(__x86_64__)
+// 12 acumuladores de 4 doubles + 2 de B + 1 broadcast: entra en los 16 ymm
+__attribute__((target("avx2,fma")))
+static void kernel_avx2(int kc, const double *a, const double *b,
+                        double *c, int ldc, int first) {
+	__m256d c00, c01, c10, c11, c20, c21, c30, c31, c40, c41, c50, c51;
+	if (first) {
+		c00 = c01 = c10 = c11 = c20 = c21 = _mm256_setzero_pd();
+		c30 = c31 = c40 = c41 = c50 = c51 = _mm256_setzero_pd();
+	} else {
+		c00 = _mm256_loadu_pd(c + 0 * ldc); c01 = _mm256_loadu_pd(c + 0 * ldc + 4);
+		c10 = _mm256_loadu_pd(c + 1 * ldc); c11 = _mm256_loadu_pd(c + 1 * ldc + 4);
+		c20 = _mm256_loadu_pd(c + 2 * ldc); c21 = _mm256_loadu_pd(c + 2 * ldc + 4);
+		c30 = _mm256_loadu_pd(c + 3 * ldc); c31 = _mm256_loadu_pd(c + 3 * ldc + 4);
+		c40 = _mm256_loadu_pd(c + 4 * ldc); c41 = _mm256_loadu_pd(c + 4 * ldc + 4);
+		c50 = _mm256_loadu_pd(c + 5 * ldc); c51 = _mm256_loadu_pd(c + 5 * ldc + 4);
+	}
+
+	for (int k = 0; k < kc; k++) {
+		__m256d b0 = _mm256_load_pd(b);
+		__m256d b1 = _mm256_load_pd(b + 4);
+		__m256d ar;
+		ar = _mm256_broadcast_sd(a + 0);
+		c00 = _mm256_fmadd_pd(ar, b0, c00); c01 = _mm256_fmadd_pd(ar, b1, c01);
+		ar = _mm256_broadcast_sd(a + 1);
+		c10 = _mm256_fmadd_pd(ar, b0, c10); c11 = _mm256_fmadd_pd(ar, b1, c11);
+		ar = _mm256_broadcast_sd(a + 2);
+		c20 = _mm256_fmadd_pd(ar, b0, c20); c21 = _mm256_fmadd_pd(ar, b1, c21);
+		ar = _mm256_broadcast_sd(a + 3);
+		c30 = _mm256_fmadd_pd(ar, b0, c30); c31 = _mm256_fmadd_pd(ar, b1, c31);
+		ar = _mm256_broadcast_sd(a + 4);
+		c40 = _mm256_fmadd_pd(ar, b0, c40); c41 = _mm256_fmadd_pd(ar, b1, c41);
+		ar = _mm256_broadcast_sd(a + 5);
+		c50 = _mm256_fmadd_pd(ar, b0, c50); c51 = _mm256_fmadd_pd(ar, b1, c51);
+		a += MM_MR;
+		b += MM_NR;
+	}
+
+	_mm256_storeu_pd(c + 0 * ldc, c00); _mm256_storeu_pd(c + 0 * ldc + 4, c01);
+	_mm256_storeu_pd(c + 1 * ldc, c10); _mm256_storeu_pd(c + 1 * ldc + 4, c11);
+	_mm256_storeu_pd(c + 2 * ldc, c20); _mm256_storeu_pd(c + 2 * ldc + 4, c21);
+	_mm256_storeu_pd(c + 3 * ldc, c30); _mm256_storeu_pd(c + 3 * ldc + 4, c31);
+	_mm256_storeu_pd(c + 4 * ldc, c40); _mm256_storeu_pd(c + 4 * ldc + 4, c41);
+	_mm256_storeu_pd(c + 5 * ldc, c50); _mm256_storeu_pd(c + 5 * ldc + 4, c51);
+}
+
+static bool cpu_has_avx2_fma(void) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+#else
+static bool cpu_has_avx2_fma(void) { return false; }
+#endif
+
+// ============================================================================
+// EMPAQUETADO
+// ============================================================================
+
+// B[pc:pc+kc, jc:jc+nc] en paneles de NR columnas; columnas fuera de n en 0
+static void pack_b(const double *B, int n, int pc, int kc, int jc, int nc, double *out) {
+	for (int jr = 0; jr < nc; jr += MM_NR) {
+		for (int k = 0; k < kc; k++) {
+			const double *row = B + (size_t)(pc + k) * n + jc + jr;
+			int valid = nc - jr < MM_NR ? nc - jr : MM_NR;
+			for (int j = 0; j < MM_NR; j++) out[j] = j < valid ? row[j] : 0.0;
+			out += MM_NR;
+		}
+	}
+}
+
+// A[ic:ic+mc, pc:pc+kc] en paneles de MR filas; filas fuera de n en 0
+static void pack_a(const double *A, int n, int ic, int mc, int pc, int kc, double *out) {
+	for (int ir = 0; ir < mc; ir += MM_MR) {
+		int valid = mc - ir < MM_MR ? mc - ir : MM_MR;
+		for (int k = 0; k < kc; k++) {
+			for (int r = 0; r < MM_MR; r++) {
+				out[r] = r < valid ? A[(size_t)(ic + ir + r) * n + pc + k] : 0.0;
+			}
+			out += MM_MR;
+		}
+	}
+}
+
+// ============================================================================
+// TILES DE C (una tarea de parallel_for cada uno)
+// ============================================================================
+
+typedef struct {
+	int n;
+	const double *A;
+	const double *B;
+	double *C;
+	int tiles_j;            // Tiles por fila de tiles
+	mm_kernel_fn kernel;
+	int aborted;            // Deadline vencido o sin memoria (atómico)
+} gemm_ctx_t;
+
+static void gemm_tile(int index, void *arg) {
+	gemm_ctx_t *g = arg;
+	if (__atomic_load_n(&g->aborted, __ATOMIC_RELAXED)) return;
+
+	int n = g->n;
+	int ic = (index / g->tiles_j) * MM_MC;
+	int jc = (index % g->tiles_j) * MM_NC;
+	int mc = n - ic < MM_MC ? n - ic : MM_MC;
+	int nc = n - jc < MM_NC ? n - jc : MM_NC;
+
+	double *packed_a = aligned_alloc(64, sizeof(double) * MM_MC * MM_KC);
+	double *packed_b = aligned_alloc(64, sizeof(double) * MM_KC * MM_NC);
+	if (!packed_a || !packed_b) {
+		free(packed_a);
+		free(packed_b);
+		__atomic_store_n(&g->aborted, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	for (int pc = 0; pc < n; pc += MM_KC) {
+		if (deadline_expired()) {
+			__atomic_store_n(&g->aborted, 1, __ATOMIC_RELAXED);
+			break;
+		}
+		int kc = n - pc < MM_KC ? n - pc : MM_KC;
+		int first = pc == 0;
+		pack_b(g->B, n, pc, kc, jc, nc, packed_b);
+		pack_a(g->A, n, ic, mc, pc, kc, packed_a);
+
+		for (int jr = 0; jr < nc; jr += MM_NR) {
+			const double *b = packed_b + (size_t)jr * kc;
+			for (int ir = 0; ir < mc; ir += MM_MR) {
+				const double *a = packed_a + (size_t)ir * kc;
+				double *c = g->C + (size_t)(ic + ir) * n + jc + jr;
+				int rows = mc - ir < MM_MR ? mc - ir : MM_MR;
+				int cols = nc - jr < MM_NR ? nc - jr : MM_NR;
+
+				if (rows == MM_MR && cols == MM_NR) {
+					g->kernel(kc, a, b, c, n, first);
+					continue;
+				}
+
+				// Borde: el kernel siempre escribe MR x NR, pasa por un tile temporal
+				double edge[MM_MR * MM_NR] __attribute__((aligned(64))) = { 0 };
+				for (int r = 0; r < rows && !first; r++) {
+					memcpy(edge + r * MM_NR, c + (size_t)r * n, sizeof(double) * cols);
+				}
+				g->kernel(kc, a, b, edge, MM_NR, first);
+				for (int r = 0; r < rows; r++) {
+					memcpy(c + (size_t)r * n, edge + r * MM_NR, sizeof(double) * cols);
+				}
+			}
+		}
+	}
+
+	free(packed_a);
+	free(packed_b);
+}
+
+int matrixmul_multiply(int n, const double *A, const double *B, double *C,
+                       int threads, bool simd) {
+	if (n <= 0 || !A || !B || !C) return -1;
+
+	gemm_ctx_t g = {
+		.n = n, .A = A, .B = B, .C = C,
+		.tiles_j = (n + MM_NC - 1) / MM_NC,
+		.kernel = kernel_scalar,
+		.aborted = 0
+	};
+#if defined(__x86_64__)
+	if (simd && cpu_has_avx2_fma()) g.kernel = kernel_avx2;
+#else
+	(void)simd;
+#endif
+
+	int tiles = ((n + MM_MC - 1) / MM_MC) * g.tiles_j;
+	parallel_for(tiles, threads, gemm_tile, &g);
+	return g.aborted ? -1 : 0;
+}
+
 // FNV-1a 64-bit hash over raw bytes
 static void fnv1a_hash_bytes(const void* data, size_t len, unsigned char out_hex[17]) {
 	const uint8_t *p = (const uint8_t*)data;
@@ -37,28 +306,30 @@ char* handle_matrixmul(const char* size_str, const char* seed_str) {
 	if (!size_str || !seed_str) return NULL;
 	int n = atoi(size_str);
 	unsigned int seed = (unsigned int)atoi(seed_str);
-	if (n <= 0 || n > 400) return strdup("{\"error\":\"Invalid size (1..400)\"}");
+	if (n <= 0 || n > MATRIXMUL_MAX_SIZE) {
+		char err[64];
+		snprintf(err, sizeof(err), "{\"error\":\"Invalid size (1..%d)\"}", MATRIXMUL_MAX_SIZE);
+		return strdup(err);
+	}
 
 	http_timer_t timer; timer_start(&timer);
 
-	double *A = gen_matrix(n, seed);
-	double *B = gen_matrix(n, seed + 1);
-	double *C = calloc(n * n, sizeof(double));
+	int threads = n < MM_PARALLEL_MIN_SIZE ? 1 : parallel_default_threads();
+	double *A = gen_matrix(n, stream_key(seed, 0), threads);
+	double *B = gen_matrix(n, stream_key(seed, 1), threads);
+	double *C = malloc(sizeof(double) * (size_t)n * n);
 	if (!A || !B || !C) { free_matrix(A); free_matrix(B); free_matrix(C); return strdup("{\"error\":\"Memory allocation failed\"}"); }
 
-	// Multiply C = A * B (naive)
-	for (int i = 0; i < n; i++) {
-		for (int k = 0; k < n; k++) {
-			double aik = A[i*n + k];
-			for (int j = 0; j < n; j++) {
-				C[i*n + j] += aik * B[k*n + j];
-			}
-		}
+	if (matrixmul_multiply(n, A, B, C, threads, true) != 0) {
+		free_matrix(A); free_matrix(B); free_matrix(C);
+		// NULL = deadline vencido (el caller responde 504)
+		if (deadline_expired()) return NULL;
+		return strdup("{\"error\":\"Memory allocation failed\"}");
 	}
 
 	// Hash result matrix bytes
 	unsigned char hash_hex[17];
-	fnv1a_hash_bytes((const void*)C, sizeof(double) * n * n, hash_hex);
+	fnv1a_hash_bytes((const void*)C, sizeof(double) * (size_t)n * n, hash_hex);
 
 	timer_stop(&timer);
 	long elapsed = timer_elapsed_ms(&timer);
@@ -69,4 +340,4 @@ char* handle_matrixmul(const char* size_str, const char* seed_str) {
 
 	free_matrix(A); free_matrix(B); free_matrix(C);
 	return json;
-}
\ No newline at end of file
+}
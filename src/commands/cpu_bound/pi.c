@@ -1,56 +1,533 @@
-// pi.c - cálculo aproximado de PI usando fórmulas en coma flotante
-// Nota: para alta precisión (muchos dígitos) se recomienda instalar libgmp y
-// usar una implementación con aritmética de precisión arbitraria.
+// pi.c - dígitos de PI con Chudnovsky (binary splitting) sobre utils/bigint
+//
+//   1/pi = 12 * sum_k (-1)^k (6k)! (13591409 + 545140134k) / ((3k)! (k!)^3 640320^(3k+3/2))
+//
+// Cada término aporta ~14.18 dígitos. El binary splitting arma P, Q, T enteros
+// con pi = 426880 * sqrt(10005) * Q / T = 4270934400 * Q / (T * sqrt(10005)),
+// y la división y la raíz salen por Newton (solo multiplicaciones).
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include "cpu_bound_commands.h"
+#include "../../utils/bigint.h"
 #include "../../utils/utils.h"
 
-// Compute arctan(x) using Taylor series; accurate for |x|<=1, converges faster
-// for smaller x. We use long double for slightly better precision.
-static long double arctan_ld(long double x, int terms) {
-	long double xpow = x;
-	long double sum = x;
-	for (int n = 1; n < terms; n++) {
-		xpow *= x * x;
-		long double term = xpow / (2 * n + 1);
-		if (n % 2 == 1) sum -= term; else sum += term;
-	}
-	return sum;
+#define PI_DIGITS_PER_TERM  14.181647462725477
+#define PI_PARALLEL_DIGITS  20000       // Por debajo no vale la pena repartir
+#define PI_GUARD_LIMBS      2           // Dígitos extra contra errores de truncado
+#define PI_CHUNK_BYTES      65536       // Tamaño de cada write al stream
+
+// ============================================================================
+// BINARY SPLITTING
+// ============================================================================
+
+typedef struct {
+    bigint_t p;
+    bigint_t q;
+    bigint_t t;
+} bs_node_t;
+
+static void bs_init(bs_node_t *n) {
+    bigint_init(&n->p);
+    bigint_init(&n->q);
+    bigint_init(&n->t);
+}
+
+static void bs_free(bs_node_t *n) {
+    bigint_free(&n->p);
+    bigint_free(&n->q);
+    bigint_free(&n->t);
+}
+
+// Término k: P = (6k-5)(2k-1)(6k-1), Q = k^3 * 640320^3/24, T = +-P*(A + Bk).
+// Con k < 10^7 todo entra en 128 bits.
+static int bs_leaf(bs_node_t *r, long k) {
+    typedef unsigned __int128 u128;
+    u128 p = 1;
+    u128 q = 1;
+    if (k > 0) {
+        p = (u128)(6 * k - 5) * (u128)(2 * k - 1) * (u128)(6 * k - 1);
+        q = (u128)k * (u128)k * (u128)k * 10939058860032000ULL;
+    }
+    u128 t = p * (u128)(13591409ULL + 545140134ULL * (unsigned long)k);
+    if (bigint_set_u128(&r->p, p) != 0 || bigint_set_u128(&r->q, q) != 0 ||
+        bigint_set_u128(&r->t, t) != 0) {
+        return -1;
+    }
+    if (k & 1) r->t.sign = -1;
+    return 0;
+}
+
+// r = combinación de l = [a, m) y rr = [m, b); consume l y rr.
+// need_p = false en la raíz, donde P ya no se usa
+static int bs_merge(bs_node_t *r, bs_node_t *l, bs_node_t *rr, bool need_p) {
+    int rc = 0;
+    // T = Tl*Qr + Pl*Tr
+    rc |= bigint_mul(&l->t, &l->t, &rr->q);
+    rc |= bigint_mul(&rr->t, &l->p, &rr->t);
+    rc |= bigint_add(&r->t, &l->t, &rr->t);
+    rc |= bigint_mul(&r->q, &l->q, &rr->q);
+    if (need_p) rc |= bigint_mul(&r->p, &l->p, &rr->p);
+    return rc ? -1 : 0;
+}
+
+// [a, b) secuencial. Retorna -1 si faltó memoria o venció el deadline
+static int bs_range(bs_node_t *r, long a, long b, bool need_p) {
+    if (b - a == 1) return bs_leaf(r, a);
+    if (b - a >= 32 && deadline_expired()) return -1;
+
+    long m = (a + b) / 2;
+    bs_node_t l, rr;
+    bs_init(&l);
+    bs_init(&rr);
+    int rc = bs_range(&l, a, m, true);
+    if (rc == 0) rc = bs_range(&rr, m, b, true);
+    if (rc == 0) rc = bs_merge(r, &l, &rr, need_p);
+    bs_free(&l);
+    bs_free(&rr);
+    return rc;
+}
+
+// Versión paralela: los rangos hoja se calculan con parallel_for y después se
+// combinan de a pares por niveles, repartiendo los productos de cada par
+typedef struct {
+    bs_node_t *nodes;
+    long terms;
+    int chunks;
+    bigint_t *products;         // 4 por par: Pl*Pr, Ql*Qr, Tl*Qr, Pl*Tr
+    bool last_level;
+    int failed;                 // Atómico
+} bs_parallel_t;
+
+static void bs_chunk_task(int index, void *ctx) {
+    bs_parallel_t *bp = ctx;
+    long a = bp->terms * index / bp->chunks;
+    long b = bp->terms * (index + 1) / bp->chunks;
+    if (bs_range(&bp->nodes[index], a, b, true) != 0) {
+        __atomic_store_n(&bp->failed, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void bs_product_task(int index, void *ctx) {
+    bs_parallel_t *bp = ctx;
+    if (__atomic_load_n(&bp->failed, __ATOMIC_RELAXED) || deadline_expired()) {
+        __atomic_store_n(&bp->failed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    bs_node_t *l = &bp->nodes[2 * (index / 4)];
+    bs_node_t *r = l + 1;
+    bigint_t *out = &bp->products[index];
+    int rc = 0;
+    switch (index % 4) {
+        case 0: if (!bp->last_level) rc = bigint_mul(out, &l->p, &r->p); break;
+        case 1: rc = bigint_mul(out, &l->q, &r->q); break;
+        case 2: rc = bigint_mul(out, &l->t, &r->q); break;
+        case 3: rc = bigint_mul(out, &l->p, &r->t); break;
+    }
+    if (rc != 0) __atomic_store_n(&bp->failed, 1, __ATOMIC_RELAXED);
+}
+
+static int bs_parallel(bs_node_t *root, long terms, int threads) {
+    int chunks = 1;
+    while (chunks < 2 * threads && chunks * 2 <= terms) chunks *= 2;
+    if (chunks == 1) return bs_range(root, 0, terms, false);
+
+    bs_parallel_t bp = { .terms = terms, .chunks = chunks };
+    bp.nodes = malloc((size_t)chunks * sizeof(bs_node_t));
+    bp.products = malloc((size_t)chunks * 2 * sizeof(bigint_t));
+    if (!bp.nodes || !bp.products) {
+        free(bp.nodes);
+        free(bp.products);
+        return -1;
+    }
+    for (int i = 0; i < chunks; i++) bs_init(&bp.nodes[i]);
+    for (int i = 0; i < chunks * 2; i++) bigint_init(&bp.products[i]);
+
+    parallel_for(chunks, threads, bs_chunk_task, &bp);
+
+    // Niveles: el par (2i, 2i+1) queda en el nodo i
+    for (int count = chunks; count > 1 && !bp.failed; count /= 2) {
+        int pairs = count / 2;
+        bp.last_level = pairs == 1;
+        parallel_for(pairs * 4, threads, bs_product_task, &bp);
+        if (bp.failed) break;
+
+        for (int i = 0; i < pairs; i++) {
+            bs_node_t *dst = &bp.nodes[i];
+            bigint_t *prod = &bp.products[4 * i];
+            bs_node_t merged;
+            bs_init(&merged);
+            if (bigint_add(&merged.t, &prod[2], &prod[3]) != 0) bp.failed = 1;
+            merged.p = prod[0];
+            merged.q = prod[1];
+            bigint_init(&prod[0]);
+            bigint_init(&prod[1]);
+            bs_free(&bp.nodes[2 * i]);
+            bs_free(&bp.nodes[2 * i + 1]);
+            *dst = merged;
+        }
+    }
+
+    int rc = bp.failed ? -1 : 0;
+    if (rc == 0) {
+        *root = bp.nodes[0];
+        bs_init(&bp.nodes[0]);
+    }
+    for (int i = 0; i < chunks; i++) bs_free(&bp.nodes[i]);
+    for (int i = 0; i < chunks * 2; i++) bigint_free(&bp.products[i]);
+    free(bp.nodes);
+    free(bp.products);
+    return rc;
+}
+
+// ============================================================================
+// NEWTON: RECÍPROCO Y RAÍZ INVERSA
+// ============================================================================
+
+// Precisión del paso anterior de Newton: la mitad más un limb de guarda.
+// Sin la guarda el error relativo se eleva al cuadrado con su constante en
+// cada nivel y los últimos dígitos se pierden en cálculos largos
+static size_t newton_half(size_t k_limbs) {
+    size_t half = (k_limbs + 1) / 2 + 1;
+    return half < k_limbs ? half : k_limbs - 1;
+}
+
+// r ~= BASE^(2K) / D, con D de exactamente K limbs
+static int recip_int(bigint_t *r, const bigint_t *d, size_t k_limbs) {
+    typedef unsigned __int128 u128;
+    if (k_limbs <= 2) {
+        u128 dv = 0;
+        for (size_t i = d->len; i-- > 0;) dv = dv * BIGINT_BASE + d->limbs[i];
+        u128 num = k_limbs == 1 ? (u128)10000000000000000ULL
+                                : (u128)10000000000000000ULL * 10000000000000000ULL;
+        return bigint_set_u128(r, num / dv);
+    }
+
+    // Precisión a la mitad sobre los limbs altos de D, y un paso de Newton:
+    // y1 = 2*y0 - D*y0^2 / BASE^(2K)
+    size_t half = newton_half(k_limbs);
+    bigint_t dk, y, t;
+    bigint_init(&dk);
+    bigint_init(&y);
+    bigint_init(&t);
+    int rc = bigint_copy(&dk, d);
+    rc |= bigint_shift_limbs(&dk, -(long)(k_limbs - half));
+    if (rc == 0) rc = recip_int(&y, &dk, half);
+    rc |= bigint_shift_limbs(&y, (long)(k_limbs - half));
+
+    rc |= bigint_mul(&t, &y, &y);
+    rc |= bigint_shift_limbs(&t, -(long)k_limbs);
+    rc |= bigint_mul(&t, &t, d);
+    rc |= bigint_shift_limbs(&t, -(long)k_limbs);
+    rc |= bigint_add(r, &y, &y);
+    rc |= bigint_sub(r, r, &t);
+
+    bigint_free(&dk);
+    bigint_free(&y);
+    bigint_free(&t);
+    return rc ? -1 : 0;
+}
+
+// y ~= BASE^K / sqrt(x)
+static int rsqrt_int(bigint_t *y, uint32_t x, size_t k_limbs) {
+    if (k_limbs <= 2) {
+        long double v = powl(1e8L, (long double)k_limbs) / sqrtl((long double)x);
+        return bigint_set_u128(y, (unsigned __int128)v);
+    }
+
+    // y1 = y0 + y0 * (BASE^(2K) - x*y0^2) / (2 * BASE^(2K))
+    size_t half = newton_half(k_limbs);
+    bigint_t y0, e, one;
+    bigint_init(&y0);
+    bigint_init(&e);
+    bigint_init(&one);
+    int rc = rsqrt_int(&y0, x, half);
+    rc |= bigint_shift_limbs(&y0, (long)(k_limbs - half));
+
+    rc |= bigint_mul(&e, &y0, &y0);
+    rc |= bigint_mul_small(&e, &e, x);
+    rc |= bigint_set_u64(&one, 1);
+    rc |= bigint_shift_limbs(&one, (long)(2 * k_limbs));
+    rc |= bigint_sub(&e, &one, &e);
+
+    // Dividir por 2 es multiplicar por BASE/2 y correr un limb más
+    rc |= bigint_mul(&e, &e, &y0);
+    rc |= bigint_mul_small(&e, &e, BIGINT_BASE / 2);
+    rc |= bigint_shift_limbs(&e, -(long)(2 * k_limbs + 1));
+    rc |= bigint_add(y, &y0, &e);
+
+    bigint_free(&y0);
+    bigint_free(&e);
+    bigint_free(&one);
+    return rc ? -1 : 0;
+}
+
+// Punto flotante mínimo: valor = m * BASE^e
+typedef struct {
+    bigint_t m;
+    long e;
+} bigfloat_t;
+
+static int bf_truncate(bigfloat_t *x, size_t limbs) {
+    if (x->m.len <= limbs) return 0;
+    long drop = (long)(x->m.len - limbs);
+    x->e += drop;
+    return bigint_shift_limbs(&x->m, -drop);
+}
+
+static int bf_mul(bigfloat_t *r, const bigfloat_t *a, const bigfloat_t *b, size_t limbs) {
+    if (bigint_mul(&r->m, &a->m, &b->m) != 0) return -1;
+    r->e = a->e + b->e;
+    return bf_truncate(r, limbs);
+}
+
+// r = 1/d con limbs de precisión
+static int bf_recip(bigfloat_t *r, const bigfloat_t *d, size_t limbs) {
+    bigint_t dk;
+    bigint_init(&dk);
+    long shift = (long)limbs - (long)d->m.len;
+    int rc = bigint_copy(&dk, &d->m);
+    rc |= bigint_shift_limbs(&dk, shift);
+    if (rc == 0) rc = recip_int(&r->m, &dk, limbs);
+    // 1/(m * B^e) = B^shift / (dk * B^e) ~= r * B^(shift - 2K - e)
+    r->e = shift - 2 * (long)limbs - d->e;
+    bigint_free(&dk);
+    return rc ? -1 : bf_truncate(r, limbs);
+}
+
+// ============================================================================
+// CÁLCULO
+// ============================================================================
+
+/**
+ * Calcular los primeros dígitos de PI
+ *
+ * @param decimals Decimales pedidos (1..PI_MAX_DIGITS)
+ * @param threads Threads para el binary splitting
+ * @return "31415..." (1 + decimals dígitos, sin punto), o NULL si venció el
+ *         deadline o faltó memoria. Liberar con free()
+ */
+char* pi_compute_digits(int decimals, int threads) {
+    if (decimals <= 0) return NULL;
+
+    size_t frac_limbs = (size_t)decimals / BIGINT_BASE_DIGITS + PI_GUARD_LIMBS;
+    size_t limbs = frac_limbs + 2;
+    long terms = (long)(decimals / PI_DIGITS_PER_TERM) + 2;
+
+    bs_node_t root;
+    bs_init(&root);
+    bigfloat_t q = { .e = 0 }, t = { .e = 0 }, inv_t = { .e = 0 }, y = { .e = 0 };
+    bigint_init(&q.m);
+    bigint_init(&t.m);
+    bigint_init(&inv_t.m);
+    bigint_init(&y.m);
+    char *digits = NULL;
+
+    if (bs_parallel(&root, terms, decimals >= PI_PARALLEL_DIGITS ? threads : 1) != 0) goto done;
+    if (root.t.sign < 0 || root.t.len == 0 || deadline_expired()) goto done;
+
+    // pi = 4270934400 * Q * (1/T) * (1/sqrt(10005))
+    q.m = root.q;
+    t.m = root.t;
+    bigint_init(&root.q);
+    bigint_init(&root.t);
+    if (bf_truncate(&q, limbs) != 0 || bf_truncate(&t, limbs) != 0) goto done;
+    if (bf_recip(&inv_t, &t, limbs) != 0 || deadline_expired()) goto done;
+    if (rsqrt_int(&y.m, 10005, limbs) != 0 || deadline_expired()) goto done;
+    y.e = -(long)limbs;
+
+    if (bf_mul(&t, &q, &inv_t, limbs) != 0) goto done;
+    if (bf_mul(&q, &t, &y, limbs) != 0) goto done;
+    if (bigint_mul_small(&q.m, &q.m, 4270934400u) != 0) goto done;
+
+    // floor(pi * BASE^frac_limbs): "3" seguido de 8*frac_limbs decimales
+    if (bigint_shift_limbs(&q.m, q.e + (long)frac_limbs) != 0) goto done;
+    size_t total = bigint_digits(&q.m);
+    if (total < (size_t)decimals + 1) goto done;
+    digits = malloc(total + 1);
+    if (!digits) goto done;
+    bigint_write_decimal(&q.m, digits);
+    digits[decimals + 1] = '\0';
+
+done:
+    bs_free(&root);
+    bigint_free(&q.m);
+    bigint_free(&t.m);
+    bigint_free(&inv_t.m);
+    bigint_free(&y.m);
+    return digits;
+}
+
+// ============================================================================
+// CACHÉ DE DÍGITOS
+// ============================================================================
+//
+// Se guarda el resultado más largo calculado hasta ahora: cualquier pedido de
+// menos dígitos es un slice del mismo buffer. El buffer es inmutable y tiene
+// refcount, así un request lo puede seguir leyendo aunque otro más largo lo
+// reemplace en el caché.
+
+typedef struct {
+    int refs;                   // Protegido por el lock del caché
+    int decimals;
+    char text[];                // "31415..." (1 + decimals dígitos)
+} pi_digits_t;
+
+static pthread_mutex_t pi_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static pi_digits_t *pi_cache = NULL;
+
+static void pi_digits_release(pi_digits_t *d) {
+    if (!d) return;
+    pthread_mutex_lock(&pi_cache_lock);
+    bool last = --d->refs == 0;
+    pthread_mutex_unlock(&pi_cache_lock);
+    if (last) free(d);
+}
+
+// Dígitos del caché o recién calculados (*cached indica cuál); NULL si
+// venció el deadline o faltó memoria
+static pi_digits_t* pi_digits_get(int decimals, bool *cached) {
+    pthread_mutex_lock(&pi_cache_lock);
+    if (pi_cache && pi_cache->decimals >= decimals) {
+        pi_digits_t *hit = pi_cache;
+        hit->refs++;
+        pthread_mutex_unlock(&pi_cache_lock);
+        *cached = true;
+        return hit;
+    }
+    pthread_mutex_unlock(&pi_cache_lock);
+
+    *cached = false;
+    char *text = pi_compute_digits(decimals, parallel_default_threads());
+    if (!text) return NULL;
+
+    pi_digits_t *d = malloc(sizeof(pi_digits_t) + (size_t)decimals + 2);
+    if (!d) {
+        free(text);
+        return NULL;
+    }
+    d->refs = 1;
+    d->decimals = decimals;
+    memcpy(d->text, text, (size_t)decimals + 2);
+    free(text);
+
+    // Otro request pudo haber dejado uno más largo mientras calculábamos
+    pi_digits_t *old = NULL;
+    pthread_mutex_lock(&pi_cache_lock);
+    if (!pi_cache || pi_cache->decimals < decimals) {
+        old = pi_cache;
+        pi_cache = d;
+        d->refs++;
+    }
+    pthread_mutex_unlock(&pi_cache_lock);
+    pi_digits_release(old);
+    return d;
+}
+
+void pi_cache_clear(void) {
+    pthread_mutex_lock(&pi_cache_lock);
+    pi_digits_t *old = pi_cache;
+    pi_cache = NULL;
+    pthread_mutex_unlock(&pi_cache_lock);
+    pi_digits_release(old);
+}
+
+// ============================================================================
+// HANDLERS
+// ============================================================================
+
+static char* error_json(const char *message) {
+    char buf[160];
+    snprintf(buf, sizeof(buf), "{\"error\":\"%s\"}", message);
+    return strdup(buf);
+}
+
+int handle_pi_stream(const char* digits_str, const pi_sink_t *sink, char **error_out) {
+    *error_out = NULL;
+    if (!digits_str) {
+        *error_out = error_json("Missing 'digits' parameter");
+        return PI_STREAM_ERROR;
+    }
+    char *end = NULL;
+    long digits = strtol(digits_str, &end, 10);
+    if (end == digits_str || *end != '\0' || digits <= 0 || digits > PI_MAX_DIGITS) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "Invalid digits parameter (1..%d)", PI_MAX_DIGITS);
+        *error_out = error_json(msg);
+        return PI_STREAM_ERROR;
+    }
+
+    http_timer_t timer;
+    timer_start(&timer);
+    bool cached = false;
+    pi_digits_t *d = pi_digits_get((int)digits, &cached);
+    timer_stop(&timer);
+    if (!d) {
+        // NULL = deadline; si no, fue memoria
+        if (!deadline_expired()) *error_out = error_json("Memory allocation failed");
+        return PI_STREAM_ERROR;
+    }
+
+    if (sink->begin && sink->begin(sink->ctx) != 0) {
+        pi_digits_release(d);
+        return PI_STREAM_ABORTED;
+    }
+
+    char head[128];
+    int n = snprintf(head, sizeof(head),
+                     "{\"digits\":%ld,\"elapsed_ms\":%ld,\"cached\":%s,\"pi\":\"3.",
+                     digits, timer_elapsed_ms(&timer), cached ? "true" : "false");
+    sink->write(sink->ctx, head, (size_t)n);
+    for (long off = 0; off < digits; off += PI_CHUNK_BYTES) {
+        long len = digits - off < PI_CHUNK_BYTES ? digits - off : PI_CHUNK_BYTES;
+        sink->write(sink->ctx, d->text + 1 + off, (size_t)len);
+    }
+    sink->write(sink->ctx, "\"}", 2);
+
+    pi_digits_release(d);
+    return PI_STREAM_OK;
+}
+
+// Sink que arma el JSON en memoria (respuestas no streaming y jobs)
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} pi_buffer_t;
+
+static void buffer_write(void *ctx, const char *data, size_t len) {
+    pi_buffer_t *b = ctx;
+    if (!b->buf) return;
+    if (b->len + len + 1 > b->cap) {
+        size_t cap = (b->len + len + 1) * 2;
+        char *p = realloc(b->buf, cap);
+        if (!p) {
+            free(b->buf);
+            b->buf = NULL;
+            return;
+        }
+        b->buf = p;
+        b->cap = cap;
+    }
+    memcpy(b->buf + b->len, data, len);
+    b->len += len;
+    b->buf[b->len] = '\0';
 }
 
 char* handle_pi(const char* digits_str) {
-	if (!digits_str) return NULL;
-	int digits = atoi(digits_str);
-	if (digits <= 0) return strdup("{\"error\":\"Invalid digits parameter\"}");
-
-	// Warn/limit: without GMP we can only reliably return ~15 digits with long double
-	if (digits > 15) {
-		return strdup("{\"error\":\"Requested digits >15; install libgmp and recompile for higher precision\"}");
-	}
-
-	http_timer_t timer; timer_start(&timer);
-
-	// Machin-like formula: pi/4 = 4*arctan(1/5) - arctan(1/239)
-	int terms = 40; // enough for double/long double precision
-	long double a1 = arctan_ld(1.0L/5.0L, terms);
-	long double a2 = arctan_ld(1.0L/239.0L, terms);
-	long double pi_ld = 4.0L * (4.0L * a1 - a2);
-
-	timer_stop(&timer);
-	long elapsed = timer_elapsed_ms(&timer);
-
-	// Format to requested digits
-	char buf[128];
-	// Create format like "%.Nd" where N = digits
-	char fmt[16];
-	snprintf(fmt, sizeof(fmt), "%%.%dLf", digits);
-	snprintf(buf, sizeof(buf), fmt, pi_ld);
-
-	char *json = malloc(256);
-	if (!json) return NULL;
-	snprintf(json, 256, "{\"digits\":%d,\"elapsed_ms\":%ld,\"pi\":\"%s\"}", digits, elapsed, buf);
-	return json;
-}
\ No newline at end of file
+    if (!digits_str) return NULL;
+    pi_buffer_t b = { .buf = malloc(256), .len = 0, .cap = 256 };
+    if (!b.buf) return NULL;
+    b.buf[0] = '\0';
+    pi_sink_t sink = { .begin = NULL, .write = buffer_write, .ctx = &b };
+
+    char *err = NULL;
+    if (handle_pi_stream(digits_str, &sink, &err) != PI_STREAM_OK) {
+        free(b.buf);
+        return err;
+    }
+    return b.buf;
+}
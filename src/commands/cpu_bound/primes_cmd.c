@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "cpu_bound_commands.h"
+#include "../../utils/primes.h"
+#include "../../utils/utils.h"
+
+// Entero decimal de 64 bits: solo dígitos, sin signo ni overflow
+static bool parse_u64(const char *s, uint64_t *out) {
+    if (!s || !*s) return false;
+    uint64_t v = 0;
+    for (; *s; s++) {
+        if (*s < '0' || *s > '9') return false;
+        unsigned digit = (unsigned)(*s - '0');
+        if (v > (UINT64_MAX - digit) / 10) return false;
+        v = v * 10 + digit;
+    }
+    *out = v;
+    return true;
+}
+
+// Main handler function
+// Cuenta (y con list=true devuelve) los primos de [from, to] con la criba
+// segmentada de utils/primes.c, repartida entre todos los cores
+char* handle_primes(const char* from_str, const char* to_str, const char* list_str) {
+    if (!to_str) return NULL;
+
+    // Start timing
+    http_timer_t timer;
+    timer_start(&timer);
+
+    uint64_t from = 0, to;
+    if ((from_str && !parse_u64(from_str, &from)) || !parse_u64(to_str, &to) ||
+        to > PRIME_SIEVE_MAX || from > to) {
+        return strdup("{\"error\":\"Invalid range (0 <= from <= to <= 10^14)\"}");
+    }
+    bool list = list_str && (strcmp(list_str, "true") == 0 || strcmp(list_str, "1") == 0);
+    if (list && to - from > PRIMES_MAX_LIST_RANGE) {
+        return strdup("{\"error\":\"list=true requires to - from <= 10000000\"}");
+    }
+
+    uint64_t count;
+    uint64_t *primes = NULL;
+    if (prime_sieve_range(from, to, parallel_default_threads(), &count, list ? &primes : NULL) != 0) {
+        return NULL;        // Deadline (504) o sin memoria
+    }
+
+    // Stop timing
+    timer_stop(&timer);
+    long elapsed = timer_elapsed_ms(&timer);
+
+    // Build JSON response
+    // Format: {"from":A,"to":B,"count":C,"primes":[2,3,5],"elapsed_ms":E}
+    size_t json_len = 128 + (list ? (size_t)count * 21 : 0);
+    char* json = malloc(json_len);
+    if (!json) {
+        free(primes);
+        return NULL;
+    }
+    int offset = snprintf(json, json_len, "{\"from\":%llu,\"to\":%llu,\"count\":%llu",
+                          (unsigned long long)from, (unsigned long long)to,
+                          (unsigned long long)count);
+    if (list) {
+        offset += snprintf(json + offset, json_len - offset, ",\"primes\":[");
+        for (uint64_t i = 0; i < count; i++) {
+            offset += snprintf(json + offset, json_len - offset, "%s%llu",
+                               i ? "," : "", (unsigned long long)primes[i]);
+        }
+        offset += snprintf(json + offset, json_len - offset, "]");
+    }
+    snprintf(json + offset, json_len - offset, ",\"elapsed_ms\":%ld}", elapsed);
+
+    free(primes);
+    return json;
+}
+
+// Main handler function
+// nums separados por coma; los Miller-Rabin corren intercalados de a varios
+char* handle_isprime_batch(const char* nums_str) {
+    if (!nums_str) return NULL;
+
+    // Start timing
+    http_timer_t timer;
+    timer_start(&timer);
+
+    static const char invalid[] =
+        "{\"error\":\"Invalid nums parameter (up to 4096 comma-separated integers < 2^64)\"}";
+    size_t count = 1;
+    for (const char *p = nums_str; *p; p++) count += *p == ',';
+    if (count > ISPRIME_BATCH_MAX) return strdup(invalid);
+
+    uint64_t *nums = malloc(count * sizeof(uint64_t));
+    bool *results = malloc(count * sizeof(bool));
+    char *copy = strdup(nums_str);
+    if (!nums || !results || !copy) {
+        free(nums); free(results); free(copy);
+        return NULL;
+    }
+
+    // strsep (y no strtok) para que "1,,2" o una coma final sean inválidos
+    size_t n = 0;
+    bool ok = true;
+    for (char *rest = copy, *tok; ok && (tok = strsep(&rest, ",")) != NULL;) {
+        ok = parse_u64(tok, &nums[n++]);
+    }
+    free(copy);
+    if (!ok) {
+        free(nums); free(results);
+        return strdup(invalid);
+    }
+
+    prime_is_prime_u64_batch(nums, count, results);
+    size_t primes = 0;
+    for (size_t i = 0; i < count; i++) primes += results[i];
+
+    // Stop timing
+    timer_stop(&timer);
+    long elapsed = timer_elapsed_ms(&timer);
+
+    // Build JSON response
+    // Format: {"count":3,"primes":1,"results":[true,false,false],"elapsed_ms":E}
+    size_t json_len = 96 + count * 6;
+    char* json = malloc(json_len);
+    if (json) {
+        int offset = snprintf(json, json_len, "{\"count\":%zu,\"primes\":%zu,\"results\":[",
+                              count, primes);
+        for (size_t i = 0; i < count; i++) {
+            offset += snprintf(json + offset, json_len - offset, "%s%s",
+                               i ? "," : "", results[i] ? "true" : "false");
+        }
+        snprintf(json + offset, json_len - offset, "],\"elapsed_ms\":%ld}", elapsed);
+    }
+
+    free(nums);
+    free(results);
+    return json;
+}
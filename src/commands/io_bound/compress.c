@@ -1,68 +1,552 @@
+// Compresión y descompresión en proceso (zlib / liblzma), en streaming
 #include "io_bound_commands.h"
+#include "../../utils/utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <lzma.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
 
-//-----------------------------------------------------
-// /compress?name=FILE&codec=gzip|xz
-//-----------------------------------------------------
-char* handle_compress(const char *filename, const char *codec) {
-    char filepath[512];
-    char outname[512];
-    
-    // Construir rutas completas
-    snprintf(filepath, sizeof(filepath), "files/%s", filename);
-    
-    // Construye nombre de salida (.gz o .xz)
-    if (strcmp(codec, "gzip") == 0)
-        snprintf(outname, sizeof(outname), "files/%s.gz", filename);
-    else
-        snprintf(outname, sizeof(outname), "files/%s.xz", filename);
-
-    // Comando del sistema (usa gzip o xz)
-    char command[1024];
-    snprintf(command, sizeof(command),
-             "%s -c \"%s\" > \"%s\"",
-             strcmp(codec, "gzip") == 0 ? "gzip" : "xz",
-             filepath, outname);
-
-    // Medir tiempo
-    clock_t start = clock();
-    int ret = system(command);
-    clock_t end = clock();
-
-    if (ret != 0) {
-        char *err = malloc(256);
-        snprintf(err, 256, "{\"error\":\"Compression failed for %s\"}", filename);
-        return err;
-    }
-
-    // Obtener tamaño del archivo comprimido
-    struct stat st;
-    if (stat(outname, &st) != 0) {
-        char *err = malloc(256);
-        snprintf(err, 256, "{\"error\":\"Failed to stat output file\"}");
-        return err;
-    }
-
-    double elapsed_ms = (double)(end - start) * 1000.0 / CLOCKS_PER_SEC;
-
-    // Calcular tamaño necesario del buffer JSON
-    size_t needed = strlen(filename) + strlen(codec) + strlen(outname) + 128;
-    char *json = malloc(needed);
-    if (!json) {
-        char *err = malloc(128);
-        snprintf(err, 128, "{\"error\":\"Memory allocation failed\"}");
-        return err;
+#define COMPRESS_BUFFER_SIZE  (1 << 20)     // 1 MB por read()/write()
+#define COMPRESS_ALIGN        4096          // Buffers alineados a página
+#define COMPRESS_XZ_BLOCK_SIZE (4 << 20)    // Bloque del encoder xz multithread
+
+// ============================================================================
+// CODECS
+// ============================================================================
+//
+// Una interfaz mínima sobre z_stream y lzma_stream: el loop de archivos no
+// sabe qué codec corre.
+
+typedef struct {
+    compress_codec_t codec;
+    bool decompress;
+    bool at_boundary;           // gzip: terminó un miembro, esperando el siguiente
+    z_stream z;
+    lzma_stream x;
+} codec_stream_t;
+
+static int codec_init(codec_stream_t *cs, compress_codec_t codec, bool decompress, int threads) {
+    memset(cs, 0, sizeof(*cs));
+    cs->codec = codec;
+    cs->decompress = decompress;
+    if (codec == COMPRESS_CODEC_GZIP) {
+        // 16 + 15: formato gzip; 32 + 15: detectar gzip o zlib al leer
+        int rc = decompress ? inflateInit2(&cs->z, 32 + 15)
+                            : deflateInit2(&cs->z, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                                           16 + 15, 8, Z_DEFAULT_STRATEGY);
+        return rc == Z_OK ? 0 : -1;
+    }
+    cs->x = (lzma_stream)LZMA_STREAM_INIT;
+    // CONCATENATED: acepta varios streams .xz seguidos, como xz -d
+    lzma_ret rc;
+    if (decompress) {
+        rc = lzma_stream_decoder(&cs->x, UINT64_MAX, LZMA_CONCATENATED);
+    } else if (threads > 1) {
+        // Bloques independientes de COMPRESS_XZ_BLOCK_SIZE repartidos entre
+        // threads por liblzma; el resultado es un .xz normal de varios bloques
+        lzma_mt mt = {
+            .threads = (uint32_t)threads,
+            .block_size = COMPRESS_XZ_BLOCK_SIZE,
+            .preset = LZMA_PRESET_DEFAULT,
+            .check = LZMA_CHECK_CRC64,
+        };
+        rc = lzma_stream_encoder_mt(&cs->x, &mt);
+    } else {
+        rc = lzma_easy_encoder(&cs->x, LZMA_PRESET_DEFAULT, LZMA_CHECK_CRC64);
+    }
+    return rc == LZMA_OK ? 0 : -1;
+}
+
+static void codec_end(codec_stream_t *cs) {
+    if (cs->codec == COMPRESS_CODEC_GZIP) {
+        if (cs->decompress) inflateEnd(&cs->z);
+        else deflateEnd(&cs->z);
+    } else {
+        lzma_end(&cs->x);
+    }
+}
+
+/**
+ * Procesar entrada y producir salida
+ *
+ * @param cs Stream
+ * @param in Entrada; *in_len se actualiza con lo que queda sin consumir
+ * @param finish true cuando no hay más entrada
+ * @param out Buffer de salida; *out_len vuelve con los bytes producidos
+ * @return 1 si terminó el stream, 0 si hay que seguir, -1 si error (datos corruptos)
+ */
+static int codec_run(codec_stream_t *cs, const uint8_t **in, size_t *in_len, bool finish,
+                     uint8_t *out, size_t *out_len) {
+    size_t out_cap = *out_len;
+    if (cs->codec == COMPRESS_CODEC_GZIP) {
+        if (cs->at_boundary) {
+            // Fin de archivo justo después de un miembro: terminado
+            if (*in_len == 0) {
+                *out_len = 0;
+                return finish ? 1 : 0;
+            }
+            cs->at_boundary = false;
+        }
+        cs->z.next_in = (Bytef*)*in;
+        cs->z.avail_in = (uInt)*in_len;
+        cs->z.next_out = out;
+        cs->z.avail_out = (uInt)out_cap;
+        int rc = cs->decompress ? inflate(&cs->z, Z_NO_FLUSH)
+                                : deflate(&cs->z, finish ? Z_FINISH : Z_NO_FLUSH);
+        *in = cs->z.next_in;
+        *in_len = cs->z.avail_in;
+        *out_len = out_cap - cs->z.avail_out;
+        if (rc == Z_STREAM_END) {
+            // gzip -d también acepta varios miembros concatenados
+            if (cs->decompress && (*in_len > 0 || !finish)) {
+                cs->at_boundary = true;
+                return inflateReset(&cs->z) == Z_OK ? 0 : -1;
+            }
+            return 1;
+        }
+        if (rc == Z_BUF_ERROR) {
+            // Sin progreso: falta entrada; con finish el archivo está truncado
+            return cs->decompress && finish && *in_len == 0 && *out_len == 0 ? -1 : 0;
+        }
+        return rc == Z_OK ? 0 : -1;
+    }
+
+    cs->x.next_in = *in;
+    cs->x.avail_in = *in_len;
+    cs->x.next_out = out;
+    cs->x.avail_out = out_cap;
+    lzma_ret rc = lzma_code(&cs->x, finish ? LZMA_FINISH : LZMA_RUN);
+    *in = cs->x.next_in;
+    *in_len = cs->x.avail_in;
+    *out_len = out_cap - cs->x.avail_out;
+    if (rc == LZMA_STREAM_END) return 1;
+    return rc == LZMA_OK || rc == LZMA_BUF_ERROR ? 0 : -1;
+}
+
+// ============================================================================
+// E/S
+// ============================================================================
+
+static ssize_t read_full(int fd, uint8_t *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, buf + got, len - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        got += (size_t)n;
     }
+    return (ssize_t)got;
+}
 
+static int write_full(int fd, const uint8_t *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Un stream de principio a fin con el codec (xz usa el encoder multithread
+// de liblzma cuando threads > 1)
+static int stream_copy(int in_fd, int out_fd, compress_codec_t codec, bool decompress,
+                       int threads, compress_stats_t *stats) {
+    uint8_t *in_buf = NULL, *out_buf = NULL;
+    if (posix_memalign((void**)&in_buf, COMPRESS_ALIGN, COMPRESS_BUFFER_SIZE) != 0 ||
+        posix_memalign((void**)&out_buf, COMPRESS_ALIGN, COMPRESS_BUFFER_SIZE) != 0) {
+        free(in_buf);
+        return COMPRESS_ERR_IO;
+    }
+
+    codec_stream_t cs;
+    int result = COMPRESS_ERR_IO;
+    if (codec_init(&cs, codec, decompress, threads) != 0) {
+        free(in_buf);
+        free(out_buf);
+        return COMPRESS_ERR_IO;
+    }
+
+    bool eof = false;
+    for (;;) {
+        if (deadline_expired()) {
+            result = COMPRESS_ERR_DEADLINE;
+            break;
+        }
+        ssize_t got = read_full(in_fd, in_buf, COMPRESS_BUFFER_SIZE);
+        if (got < 0) break;
+        eof = (size_t)got < COMPRESS_BUFFER_SIZE;
+        stats->input_bytes += (uint64_t)got;
+
+        // Vaciar el codec: con eof hasta que termine el stream
+        const uint8_t *in = in_buf;
+        size_t in_len = (size_t)got;
+        int rc;
+        for (;;) {
+            size_t out_len = COMPRESS_BUFFER_SIZE;
+            rc = codec_run(&cs, &in, &in_len, eof, out_buf, &out_len);
+            if (rc < 0) break;
+            if (out_len > 0 && write_full(out_fd, out_buf, out_len) != 0) {
+                rc = -2;
+                break;
+            }
+            stats->output_bytes += out_len;
+            if (rc == 1) {
+                // Datos después del final del stream comprimido
+                if (in_len > 0 || !eof) rc = -1;
+                break;
+            }
+            if (in_len == 0 && out_len < COMPRESS_BUFFER_SIZE && !eof) break;
+            if (eof && in_len == 0 && out_len == 0) {
+                rc = -1;                            // Truncado
+                break;
+            }
+        }
+        if (rc == -1) result = COMPRESS_ERR_CORRUPT;
+        if (rc < 0) break;
+        if (rc == 1) {
+            result = COMPRESS_OK;
+            break;
+        }
+    }
+
+    codec_end(&cs);
+    free(in_buf);
+    free(out_buf);
+    return result;
+}
+
+// ============================================================================
+// GZIP POR BLOQUES EN PARALELO
+// ============================================================================
+//
+// Como pigz: la entrada se corta en bloques de COMPRESS_BLOCK_SIZE y cada uno
+// se comprime solo, como deflate crudo, con los últimos 32 KB del bloque
+// anterior como diccionario (casi no se pierde ratio). Cada bloque termina con
+// Z_SYNC_FLUSH, que lo alinea a byte, y el último con Z_FINISH: concatenados
+// forman un único miembro gzip. El CRC del archivo sale de combinar los CRC
+// de los bloques con crc32_combine.
+//
+// Se lee una ronda de threads * COMPRESS_BLOCKS_PER_THREAD bloques, se
+// comprimen con parallel_for y se escriben en orden: el arreglo de la ronda,
+// indexado por número de bloque, hace de buffer de reordenamiento.
+
+#define COMPRESS_DICT_SIZE          32768
+#define COMPRESS_BLOCKS_PER_THREAD  4
+
+typedef struct {
+    const uint8_t *in;
+    size_t in_len;
+    const uint8_t *dict;        // NULL en el primer bloque
+    size_t dict_len;
+    bool last;
+    uint8_t *out;
+    size_t out_cap;
+    size_t out_len;
+    uLong crc;
+    bool failed;
+} gzip_block_t;
+
+static void gzip_block_compress(int index, void *ctx) {
+    gzip_block_t *b = &((gzip_block_t*)ctx)[index];
+    b->failed = true;
+    b->crc = crc32(0L, b->in, (uInt)b->in_len);
+    if (deadline_expired()) return;
+
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return;
+    }
+    if (b->dict && deflateSetDictionary(&z, b->dict, (uInt)b->dict_len) != Z_OK) {
+        deflateEnd(&z);
+        return;
+    }
+    z.next_in = (Bytef*)b->in;
+    z.avail_in = (uInt)b->in_len;
+    z.next_out = b->out;
+    z.avail_out = (uInt)b->out_cap;
+    int rc = deflate(&z, b->last ? Z_FINISH : Z_SYNC_FLUSH);
+    // out_cap viene de deflateBound: todo entra en una llamada
+    bool ok = b->last ? rc == Z_STREAM_END : (rc == Z_OK && z.avail_in == 0 && z.avail_out > 0);
+    b->out_len = b->out_cap - z.avail_out;
+    deflateEnd(&z);
+    b->failed = !ok;
+}
+
+static int gzip_parallel(int in_fd, int out_fd, int threads, compress_stats_t *stats) {
+    int round = threads * COMPRESS_BLOCKS_PER_THREAD;
+    // Diccionario del primer bloque de la ronda + los bloques de la ronda
+    size_t in_cap = COMPRESS_DICT_SIZE + (size_t)round * COMPRESS_BLOCK_SIZE;
+    size_t out_block = deflateBound(NULL, COMPRESS_BLOCK_SIZE) + 16;
+    uint8_t *in_buf = NULL, *out_buf = NULL;
+    gzip_block_t *blocks = calloc((size_t)round, sizeof(gzip_block_t));
+    if (!blocks ||
+        posix_memalign((void**)&in_buf, COMPRESS_ALIGN, in_cap) != 0 ||
+        posix_memalign((void**)&out_buf, COMPRESS_ALIGN, (size_t)round * out_block) != 0) {
+        free(blocks);
+        free(in_buf);
+        return COMPRESS_ERR_IO;
+    }
+
+    // Header gzip mínimo: deflate, sin nombre ni mtime, OS = Unix
+    static const uint8_t header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+    int result = COMPRESS_ERR_IO;
+    if (write_full(out_fd, header, sizeof(header)) != 0) goto done;
+    stats->output_bytes = sizeof(header);
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    size_t dict_len = 0;                // Bytes de diccionario al inicio de in_buf
+    bool eof = false;
+    while (!eof) {
+        if (deadline_expired()) {
+            result = COMPRESS_ERR_DEADLINE;
+            goto done;
+        }
+        ssize_t got = read_full(in_fd, in_buf + dict_len, (size_t)round * COMPRESS_BLOCK_SIZE);
+        if (got < 0) goto done;
+        eof = (size_t)got < (size_t)round * COMPRESS_BLOCK_SIZE;
+        stats->input_bytes += (uint64_t)got;
+
+        // Un archivo vacío (o múltiplo exacto de la ronda) termina con un
+        // bloque vacío que solo lleva el final del stream
+        int count = (int)(((size_t)got + COMPRESS_BLOCK_SIZE - 1) / COMPRESS_BLOCK_SIZE);
+        if (count == 0) count = 1;
+        for (int i = 0; i < count; i++) {
+            gzip_block_t *b = &blocks[i];
+            size_t start = dict_len + (size_t)i * COMPRESS_BLOCK_SIZE;
+            size_t len = (size_t)got - (size_t)i * COMPRESS_BLOCK_SIZE;
+            b->in = in_buf + start;
+            b->in_len = len < COMPRESS_BLOCK_SIZE ? len : COMPRESS_BLOCK_SIZE;
+            b->dict_len = start < COMPRESS_DICT_SIZE ? start : COMPRESS_DICT_SIZE;
+            b->dict = b->dict_len ? b->in - b->dict_len : NULL;
+            b->last = eof && i == count - 1;
+            b->out = out_buf + (size_t)i * out_block;
+            b->out_cap = out_block;
+        }
+        parallel_for(count, threads, gzip_block_compress, blocks);
+
+        for (int i = 0; i < count; i++) {
+            if (blocks[i].failed) {
+                result = deadline_expired() ? COMPRESS_ERR_DEADLINE : COMPRESS_ERR_IO;
+                goto done;
+            }
+            if (write_full(out_fd, blocks[i].out, blocks[i].out_len) != 0) goto done;
+            stats->output_bytes += blocks[i].out_len;
+            crc = crc32_combine(crc, blocks[i].crc, (z_off_t)blocks[i].in_len);
+        }
+
+        // Los últimos 32 KB de la ronda pasan a ser el diccionario de la próxima
+        size_t total = dict_len + (size_t)got;
+        size_t keep = total < COMPRESS_DICT_SIZE ? total : COMPRESS_DICT_SIZE;
+        memmove(in_buf, in_buf + total - keep, keep);
+        dict_len = keep;
+    }
+
+    // Trailer: CRC32 e ISIZE (mod 2^32), little-endian
+    uint8_t trailer[8];
+    uint32_t isize = (uint32_t)stats->input_bytes;
+    for (int i = 0; i < 4; i++) {
+        trailer[i] = (uint8_t)(crc >> (8 * i));
+        trailer[4 + i] = (uint8_t)(isize >> (8 * i));
+    }
+    if (write_full(out_fd, trailer, sizeof(trailer)) != 0) goto done;
+    stats->output_bytes += sizeof(trailer);
+    result = COMPRESS_OK;
+
+done:
+    free(blocks);
+    free(in_buf);
+    free(out_buf);
+    return result;
+}
+
+// ============================================================================
+// ARCHIVOS
+// ============================================================================
+
+// Copia src -> dst pasando por el codec; dst se escribe en un temporal y se
+// renombra al final, así que nunca queda un archivo a medias con ese nombre.
+// Sin replace el temporal se publica con link(), que falla con EEXIST si
+// alguien creó dst mientras tanto: nunca se pisa un archivo existente
+int compress_file(const char *src_path, const char *dst_path, compress_codec_t codec,
+                  bool decompress, int threads, bool replace, compress_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (threads < 1) threads = 1;
+    if (threads > PARALLEL_MAX_THREADS) threads = PARALLEL_MAX_THREADS;
+    int in_fd = open(src_path, O_RDONLY);
+    if (in_fd < 0) return COMPRESS_ERR_NOT_FOUND;
+    // Chequeo temprano para no procesar todo de gusto; el que vale es el link()
+    if (!replace && access(dst_path, F_OK) == 0) {
+        close(in_fd);
+        return COMPRESS_ERR_EXISTS;
+    }
+    posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    size_t tmp_len = strlen(dst_path) + 8;
+    char *tmp_path = malloc(tmp_len);
+    if (!tmp_path) {
+        close(in_fd);
+        return COMPRESS_ERR_IO;
+    }
+    snprintf(tmp_path, tmp_len, "%s.XXXXXX", dst_path);
+    int out_fd = mkstemp(tmp_path);
+    int result = COMPRESS_ERR_IO;
+    if (out_fd >= 0) {
+        fchmod(out_fd, 0644);
+        if (codec == COMPRESS_CODEC_GZIP && !decompress && threads > 1) {
+            result = gzip_parallel(in_fd, out_fd, threads, stats);
+        } else {
+            result = stream_copy(in_fd, out_fd, codec, decompress, threads, stats);
+        }
+        if (close(out_fd) != 0 && result == COMPRESS_OK) result = COMPRESS_ERR_IO;
+        if (result == COMPRESS_OK) {
+            if (replace) {
+                if (rename(tmp_path, dst_path) != 0) result = COMPRESS_ERR_IO;
+            } else if (link(tmp_path, dst_path) != 0) {
+                result = errno == EEXIST ? COMPRESS_ERR_EXISTS : COMPRESS_ERR_IO;
+            }
+        }
+        if (result != COMPRESS_OK || !replace) unlink(tmp_path);
+    }
+    stats->threads = decompress ? 1 : threads;
+
+    close(in_fd);
+    free(tmp_path);
+    return result;
+}
+
+// ============================================================================
+// HANDLERS
+// ============================================================================
+
+// Relativo a files/, sin subir de directorio
+static bool valid_name(const char *name) {
+    if (!name || !*name || name[0] == '/') return false;
+    return strcmp(name, "..") != 0 && strncmp(name, "../", 3) != 0 &&
+           strstr(name, "/../") == NULL &&
+           (strlen(name) < 3 || strcmp(name + strlen(name) - 3, "/..") != 0);
+}
+
+static char* error_json(const char *message) {
+    size_t len = strlen(message) + 32;
+    char *json = malloc(len);
+    if (json) snprintf(json, len, "{\"error\":\"%s\"}", message);
+    return json;
+}
+
+// JSON común de compress/decompress. ratio = original / comprimido
+static char* run_codec(const char *name, const char *out_name, compress_codec_t codec,
+                       bool decompress, int threads, bool replace) {
+    char src[512], dst[512];
+    snprintf(src, sizeof(src), "files/%s", name);
+    snprintf(dst, sizeof(dst), "files/%s", out_name);
+
+    http_timer_t timer;
+    timer_start(&timer);
+    compress_stats_t stats;
+    int rc = compress_file(src, dst, codec, decompress, threads, replace, &stats);
+    timer_stop(&timer);
+
+    switch (rc) {
+        case COMPRESS_OK: break;
+        case COMPRESS_ERR_DEADLINE: return NULL;    // El caller responde 504
+        case COMPRESS_ERR_NOT_FOUND: return error_json("File not found");
+        case COMPRESS_ERR_CORRUPT: return error_json("Corrupt or truncated input");
+        case COMPRESS_ERR_EXISTS: return error_json("Output exists");
+        default: return error_json(decompress ? "Decompression failed" : "Compression failed");
+    }
+
+    double elapsed_ms = timer_elapsed_us(&timer) / 1000.0;
+    uint64_t original = decompress ? stats.output_bytes : stats.input_bytes;
+    uint64_t packed = decompress ? stats.input_bytes : stats.output_bytes;
+    double ratio = packed ? (double)original / (double)packed : 0.0;
+    double mb_per_s = elapsed_ms > 0 ? original / 1e6 / (elapsed_ms / 1000.0) : 0.0;
+
+    size_t needed = strlen(name) + strlen(dst) + 256;
+    char *json = malloc(needed);
+    if (!json) return NULL;
     snprintf(json, needed,
              "{\"file\":\"%s\",\"codec\":\"%s\","
-             "\"output\":\"%s\",\"size_bytes\":%ld,"
-             "\"elapsed_ms\":%.2f}",
-             filename, codec, outname, (long)st.st_size, elapsed_ms);
-
+             "\"output\":\"%s\",\"input_bytes\":%llu,\"size_bytes\":%llu,"
+             "\"ratio\":%.3f,\"threads\":%d,\"elapsed_ms\":%.2f,\"mb_per_s\":%.1f}",
+             name, codec == COMPRESS_CODEC_GZIP ? "gzip" : "xz", dst,
+             (unsigned long long)stats.input_bytes, (unsigned long long)stats.output_bytes,
+             ratio, stats.threads, elapsed_ms, mb_per_s);
     return json;
-}
\ No newline at end of file
+}
+
+//-----------------------------------------------------
+// /compress?name=FILE&codec=gzip|xz[&threads=N]
+//-----------------------------------------------------
+char* handle_compress(const char *filename, const char *codec, const char *threads_str) {
+    if (!filename || !codec) return NULL;
+    if (!valid_name(filename)) return error_json("Invalid file name");
+
+    // Por defecto todos los cores; threads=1 es un único stream secuencial
+    int threads = parallel_default_threads();
+    if (threads_str) {
+        char *end;
+        long t = strtol(threads_str, &end, 10);
+        if (*threads_str == '\0' || *end != '\0' || t < 1 || t > PARALLEL_MAX_THREADS) {
+            return error_json("Invalid threads parameter (1..64)");
+        }
+        threads = (int)t;
+    }
+
+    compress_codec_t c;
+    const char *ext;
+    if (strcmp(codec, "gzip") == 0) {
+        c = COMPRESS_CODEC_GZIP;
+        ext = ".gz";
+    } else if (strcmp(codec, "xz") == 0) {
+        c = COMPRESS_CODEC_XZ;
+        ext = ".xz";
+    } else {
+        return error_json("Unsupported codec. Use 'gzip' or 'xz'");
+    }
+
+    char out_name[512];
+    snprintf(out_name, sizeof(out_name), "%s%s", filename, ext);
+    return run_codec(filename, out_name, c, false, threads, true);
+}
+
+//-----------------------------------------------------
+// /decompress?name=FILE.gz|FILE.xz[&overwrite=true]  ->  files/FILE
+//-----------------------------------------------------
+char* handle_decompress(const char *filename, const char *overwrite_str) {
+    if (!filename) return NULL;
+    if (!valid_name(filename)) return error_json("Invalid file name");
+
+    // Por defecto no se pisa un archivo que ya esté en files/
+    bool overwrite = false;
+    if (overwrite_str) {
+        if (strcmp(overwrite_str, "true") == 0 || strcmp(overwrite_str, "1") == 0) {
+            overwrite = true;
+        } else if (strcmp(overwrite_str, "false") != 0 && strcmp(overwrite_str, "0") != 0) {
+            return error_json("Invalid overwrite parameter (true|false)");
+        }
+    }
+
+    size_t len = strlen(filename);
+    compress_codec_t c;
+    if (len > 3 && strcmp(filename + len - 3, ".gz") == 0) {
+        c = COMPRESS_CODEC_GZIP;
+    } else if (len > 3 && strcmp(filename + len - 3, ".xz") == 0) {
+        c = COMPRESS_CODEC_XZ;
+    } else {
+        return error_json("Unsupported file. Use a .gz or .xz name");
+    }
+
+    char out_name[512];
+    snprintf(out_name, sizeof(out_name), "%.*s", (int)(len - 3), filename);
+    return run_codec(filename, out_name, c, true, 1, overwrite);
+}
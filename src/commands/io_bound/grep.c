@@ -3,6 +3,7 @@
 #include <string.h>
 #include <regex.h>
 #include <time.h>
+#include "../../utils/utils.h"
 
 //-----------------------------------------------------
 // /grep?name=FILE&pattern=REGEX
@@ -29,8 +30,11 @@ char* handle_grep(const char *filename, const char *pattern) {
     int captured = 0;
 
     clock_t start = clock();
+    unsigned long lines_read = 0;
 
     while (fgets(buffer, sizeof(buffer), fp)) {
+        // Dejar de buscar si el deadline de la request ya venció
+        if ((++lines_read & 0x3FF) == 0 && deadline_expired()) break;
         if (regexec(&regex, buffer, 0, NULL, 0) == 0) {
             match_count++;
             if (captured < 10) {
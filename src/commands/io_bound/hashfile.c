@@ -45,7 +45,7 @@ static char* compute_file_hash(const char* filepath, const char* algo) {
     size_t bytes_read;
     
     while ((bytes_read = fread(buffer, 1, BUFFER_SIZE, file)) > 0) {
-        if (1 != EVP_DigestUpdate(mdctx, buffer, bytes_read)) {
+        if (deadline_expired() || 1 != EVP_DigestUpdate(mdctx, buffer, bytes_read)) {
             EVP_MD_CTX_free(mdctx);
             fclose(file);
             return NULL;
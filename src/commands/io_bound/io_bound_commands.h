@@ -1,17 +1,60 @@
 #ifndef IO_BOUND_COMMANDS_H
 #define IO_BOUND_COMMANDS_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+// Handlers may run under a per-request deadline (X-Request-Timeout-Ms header or
+// per-route default). Long loops should poll deadline_expired() from
+// utils/utils.h and return early; the caller answers 504 in that case.
+
 // Function declaration for sortfile command
 char* handle_sortfile(const char* name_str, const char* algo_str);
 
 // Function declaration for wordcount command
-char* handle_wordcount(const char* name_str);
+// threads_str NULL = todos los cores (chunks de WORDCOUNT_CHUNK_SIZE)
+char* handle_wordcount(const char* name_str, const char* threads_str);
+
+#define WORDCOUNT_CHUNK_SIZE (4 << 20)
 
 // Function declaration for hashfile command
 char* handle_hashfile(const char* name_str, const char* algo_str);
 
 char* handle_grep(const char *filename, const char *pattern);
-char* handle_compress(const char *filename, const char *codec);
+// threads_str NULL = todos los cores (gzip por bloques / xz multithread)
+char* handle_compress(const char *filename, const char *codec, const char *threads_str);
+
+// /decompress?name=FILE.gz|FILE.xz: codec según la extensión, salida sin ella.
+// Si la salida ya existe falla con "Output exists" salvo overwrite "true"/"1"
+char* handle_decompress(const char *filename, const char *overwrite_str);
+
+typedef enum {
+    COMPRESS_CODEC_GZIP,
+    COMPRESS_CODEC_XZ
+} compress_codec_t;
+
+typedef struct {
+    uint64_t input_bytes;
+    uint64_t output_bytes;
+    int threads;                // Threads usados
+} compress_stats_t;
+
+#define COMPRESS_OK             0
+#define COMPRESS_ERR_IO        -1
+#define COMPRESS_ERR_NOT_FOUND -2
+#define COMPRESS_ERR_CORRUPT   -3   // Entrada comprimida inválida o truncada
+#define COMPRESS_ERR_DEADLINE  -4
+#define COMPRESS_ERR_EXISTS    -5   // dst ya existe y replace == false
+
+#define COMPRESS_BLOCK_SIZE (128 * 1024)     // Bloque de gzip en paralelo
+
+// Comprimir (o descomprimir) src en dst en streaming, sin procesos externos.
+// Con threads > 1 la compresión gzip va por bloques en paralelo (un solo
+// miembro gzip válido) y la xz usa el encoder multithread; la descompresión
+// es siempre secuencial. dst aparece recién completo (temporal + rename);
+// con replace == false un dst existente no se toca. Retorna COMPRESS_*
+int compress_file(const char *src_path, const char *dst_path, compress_codec_t codec,
+                  bool decompress, int threads, bool replace, compress_stats_t *stats);
 
 #endif //IO_BOUND_COMMANDS_H
 
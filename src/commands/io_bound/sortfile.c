@@ -192,6 +192,16 @@ char* handle_sortfile(const char* name_str, const char* algo_str) {
         qsort(arr, count, sizeof(int), compare_int);
     }
     
+    // Don't bother writing the output if the request deadline already passed
+    if (deadline_expired()) {
+        free(arr);
+        free(decoded_name);
+        free(decoded_algo);
+        free(input_path);
+        free(output_path);
+        return NULL;
+    }
+    
     // Write sorted array to output file
     int write_result = write_integers_to_file(output_path, arr, count);
     free(arr);
@@ -2,10 +2,44 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <ctype.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include "io_bound_commands.h"
 #include "../../utils/utils.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// ============================================================================
+// CONTEO POR BLOQUES
+// ============================================================================
+//
+// El archivo se parte en chunks de WORDCOUNT_CHUNK_SIZE que los threads toman
+// con parallel_for; cada uno lo lee con pread() en bloques alineados de
+// WC_READ_SIZE (sin mmap: otro endpoint puede truncar el archivo mientras
+// tanto y un mapeo daría SIGBUS). Cada bloque se recorre de a 64 bytes:
+// el kernel (SSE2 o AVX2) arma tres máscaras de 64 bits -espacios (los de
+// isspace() en locale C), '\n' y bytes de continuación UTF-8 (10xxxxxx)- y
+// cuenta con popcount:
+//   - palabras: bytes no-espacio precedidos por un espacio,
+//     ~sp & (sp << 1 | espacio_anterior)
+//   - líneas: bits de '\n'
+//   - chars: code points UTF-8 = bytes que no son de continuación
+// El "espacio anterior" de un chunk es el byte previo al chunk (un pread de
+// un byte): no hace falta coser los bordes después. Se cuenta el tamaño que
+// tenía al empezar; si se achica durante el conteo, el resultado es un error
+// y no un conteo parcial.
+
+#define WC_BLOCK 64
+#define WC_READ_SIZE (256 << 10)
+
+#define WC_OK            0
+#define WC_ERR_IO       -1
+#define WC_ERR_DEADLINE -2
 
 // Structure to hold word count results
 typedef struct {
@@ -15,82 +49,257 @@ typedef struct {
     unsigned long chars;
 } wc_result_t;
 
+// Procesa los bloques completos de p[0..n); retorna los bytes consumidos.
+// prev_space entra y sale con el estado del último byte visto.
+typedef size_t (*wc_kernel_fn)(const unsigned char *p, size_t n, bool *prev_space,
+                               wc_result_t *r);
+
+// isspace() en locale C: ' ', \t, \n, \v, \f, \r
+static const unsigned char wc_space[256] = {
+    ['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1, [' '] = 1
+};
+
 // Function declarations
-char* handle_wordcount(const char* name_str);
-static int count_file(const char* filepath, wc_result_t* result);
-static int is_word_char(int c);
+char* handle_wordcount(const char* name_str, const char* threads_str);
+static int count_file(const char* filepath, int threads, wc_result_t* result);
 
-// Check if character is a word constituent
-static int is_word_char(int c) {
-    return !isspace(c);
+static inline void wc_block_masks(uint64_t sp, uint64_t nl, uint64_t cont,
+                                  bool *prev_space, wc_result_t *r) {
+    uint64_t starts = ~sp & ((sp << 1) | (uint64_t)*prev_space);
+    r->words += (unsigned long)__builtin_popcountll(starts);
+    r->lines += (unsigned long)__builtin_popcountll(nl);
+    r->chars += WC_BLOCK - (unsigned long)__builtin_popcountll(cont);
+    *prev_space = sp >> 63;
 }
 
-// Count lines, words, bytes, and characters in a file
-static int count_file(const char* filepath, wc_result_t* result) {
-    FILE* file = fopen(filepath, "rb");  // Open in binary mode for accurate byte count
-    if (!file) return -1;
-    
-    // Initialize counters
-    result->lines = 0;
-    result->words = 0;
-    result->bytes = 0;
-    result->chars = 0;
-    
-    int c;
-    int in_word = 0;
-    int prev_c = '\n';
-    
-    // Use buffered reading for better performance with large files
-    #define BUFFER_SIZE 8192
-    unsigned char buffer[BUFFER_SIZE];
-    size_t bytes_read;
-    
-    while ((bytes_read = fread(buffer, 1, BUFFER_SIZE, file)) > 0) {
-        for (size_t i = 0; i < bytes_read; i++) {
-            c = buffer[i];
-            result->bytes++;
-            result->chars++;  // For ASCII, chars == bytes
-            
-            // Count lines
-            if (c == '\n') {
-                result->lines++;
-            }
-            
-            // Count words
-            if (is_word_char(c)) {
-                if (!in_word) {
-                    result->words++;
-                    in_word = 1;
-                }
-            } else {
-                in_word = 0;
-            }
-            
-            prev_c = c;
+// Resto (o todo, sin SIMD) de a un byte
+static void wc_scalar(const unsigned char *p, size_t n, bool *prev_space, wc_result_t *r) {
+    bool prev = *prev_space;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = p[i];
+        bool sp = wc_space[c];
+        r->words += prev && !sp;
+        r->lines += c == '\n';
+        r->chars += (c & 0xC0) != 0x80;
+        prev = sp;
+    }
+    *prev_space = prev;
+}
+
+#if defined(__x86_64__)
+// SSE2 es parte de x86-64: siempre disponible
+static inline void wc_classify_sse2(__m128i x, uint32_t *sp, uint32_t *nl, uint32_t *cont) {
+    // c - 9 <= 4 (sin signo) cubre \t..\r
+    __m128i ctl = _mm_sub_epi8(x, _mm_set1_epi8(9));
+    __m128i is_ctl = _mm_cmpeq_epi8(_mm_min_epu8(ctl, _mm_set1_epi8(4)), ctl);
+    __m128i is_sp = _mm_or_si128(is_ctl, _mm_cmpeq_epi8(x, _mm_set1_epi8(' ')));
+    *sp = (uint32_t)_mm_movemask_epi8(is_sp);
+    *nl = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')));
+    // 0x80..0xBF son -128..-65 con signo: menores que (int8_t)0xC0
+    *cont = (uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(x, _mm_set1_epi8((char)0xC0)));
+}
+
+static size_t wc_kernel_sse2(const unsigned char *p, size_t n, bool *prev_space,
+                             wc_result_t *r) {
+    size_t done = 0;
+    for (; done + WC_BLOCK <= n; done += WC_BLOCK) {
+        uint64_t sp = 0, nl = 0, cont = 0;
+        for (int k = 0; k < 4; k++) {
+            uint32_t s, l, c;
+            wc_classify_sse2(_mm_loadu_si128((const __m128i *)(p + done + 16 * k)), &s, &l, &c);
+            sp |= (uint64_t)s << (16 * k);
+            nl |= (uint64_t)l << (16 * k);
+            cont |= (uint64_t)c << (16 * k);
+        }
+        wc_block_masks(sp, nl, cont, prev_space, r);
+    }
+    return done;
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t wc_kernel_avx2(const unsigned char *p, size_t n, bool *prev_space,
+                             wc_result_t *r) {
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i four = _mm256_set1_epi8(4);
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i lead = _mm256_set1_epi8((char)0xC0);
+    size_t done = 0;
+    for (; done + WC_BLOCK <= n; done += WC_BLOCK) {
+        uint64_t sp = 0, nl = 0, cont = 0;
+        for (int k = 0; k < 2; k++) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(p + done + 32 * k));
+            __m256i ctl = _mm256_sub_epi8(x, nine);
+            __m256i is_sp = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(ctl, four), ctl),
+                                            _mm256_cmpeq_epi8(x, space));
+            sp |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_sp) << (32 * k);
+            nl |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, newline)) << (32 * k);
+            cont |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(lead, x)) << (32 * k);
+        }
+        // Inlineado acá, popcount compila a popcnt nativo
+        wc_block_masks(sp, nl, cont, prev_space, r);
+    }
+    return done;
+}
+
+static wc_kernel_fn wc_pick_kernel(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) return wc_kernel_avx2;
+    return wc_kernel_sse2;
+}
+#else
+static wc_kernel_fn wc_pick_kernel(void) { return NULL; }
+#endif
+
+// ============================================================================
+// CHUNKS EN PARALELO
+// ============================================================================
+
+typedef struct {
+    int fd;
+    size_t size;                // Tamaño según fstat al empezar
+    wc_kernel_fn kernel;
+    wc_result_t *parts;         // Uno por chunk, sumados al final
+    unsigned char last_byte;    // Último byte del archivo (lo escribe el último chunk)
+    int failed;                 // WC_ERR_* del primer chunk que falló (acceso atómico)
+} wc_job_t;
+
+static void wc_fail(wc_job_t *job, int err) {
+    int expected = WC_OK;
+    __atomic_compare_exchange_n(&job->failed, &expected, err, false,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+// pread completo; false si hubo error o el archivo terminó antes (truncado)
+static bool wc_pread_full(int fd, unsigned char *buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+static void wc_chunk(int index, void *ctx) {
+    wc_job_t *job = ctx;
+    if (__atomic_load_n(&job->failed, __ATOMIC_RELAXED) != WC_OK) return;
+    if (deadline_expired()) {
+        wc_fail(job, WC_ERR_DEADLINE);
+        return;
+    }
+
+    size_t start = (size_t)index * WORDCOUNT_CHUNK_SIZE;
+    size_t n = job->size - start < WORDCOUNT_CHUNK_SIZE ? job->size - start : WORDCOUNT_CHUNK_SIZE;
+
+    // El inicio del archivo cuenta como espacio: una palabra al principio suma
+    bool prev_space = true;
+    if (start > 0) {
+        unsigned char before;
+        if (!wc_pread_full(job->fd, &before, 1, (off_t)start - 1)) {
+            wc_fail(job, WC_ERR_IO);
+            return;
+        }
+        prev_space = wc_space[before];
+    }
+
+    unsigned char *buf;
+    if (posix_memalign((void **)&buf, 4096, WC_READ_SIZE) != 0) {
+        wc_fail(job, WC_ERR_IO);
+        return;
+    }
+
+    wc_result_t *r = &job->parts[index];
+    for (size_t off = 0; off < n; off += WC_READ_SIZE) {
+        size_t len = n - off < WC_READ_SIZE ? n - off : WC_READ_SIZE;
+        if (!wc_pread_full(job->fd, buf, len, (off_t)(start + off))) {
+            wc_fail(job, WC_ERR_IO);
+            break;
         }
+        size_t done = job->kernel ? job->kernel(buf, len, &prev_space, r) : 0;
+        wc_scalar(buf + done, len - done, &prev_space, r);
+        if (start + off + len == job->size) job->last_byte = buf[len - 1];
     }
-    
-    // If file doesn't end with newline, but has content, count as a line
-    if (result->bytes > 0 && prev_c != '\n') {
-        result->lines++;
+    free(buf);
+}
+
+// Count lines, words, bytes, and characters in a file
+static int count_file(const char* filepath, int threads, wc_result_t* result) {
+    memset(result, 0, sizeof(*result));
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) return WC_ERR_IO;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return WC_ERR_IO;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return WC_OK;
     }
-    
-    fclose(file);
-    return 0;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    size_t size = (size_t)st.st_size;
+    int chunks = (int)((size + WORDCOUNT_CHUNK_SIZE - 1) / WORDCOUNT_CHUNK_SIZE);
+    wc_job_t job = {
+        .fd = fd,
+        .size = size,
+        .kernel = wc_pick_kernel(),
+        .parts = calloc((size_t)chunks, sizeof(wc_result_t)),
+        .failed = WC_OK,
+    };
+    if (!job.parts) {
+        close(fd);
+        return WC_ERR_IO;
+    }
+
+    parallel_for(chunks, threads, wc_chunk, &job);
+
+    int rc = job.failed;
+    if (rc == WC_OK) {
+        for (int i = 0; i < chunks; i++) {
+            result->lines += job.parts[i].lines;
+            result->words += job.parts[i].words;
+            result->chars += job.parts[i].chars;
+        }
+        result->bytes = size;
+
+        // If file doesn't end with newline, but has content, count as a line
+        if (job.last_byte != '\n') result->lines++;
+    }
+
+    free(job.parts);
+    close(fd);
+    return rc;
 }
 
 // Main handler function
-char* handle_wordcount(const char* name_str) {
+char* handle_wordcount(const char* name_str, const char* threads_str) {
     if (!name_str) return NULL;
-    
+
     // Start timing
     http_timer_t timer;
     timer_start(&timer);
-    
+
+    // Por defecto todos los cores; threads=1 recorre los chunks en orden
+    int threads = parallel_default_threads();
+    if (threads_str) {
+        char *end;
+        long t = strtol(threads_str, &end, 10);
+        if (*threads_str == '\0' || *end != '\0' || t < 1 || t > PARALLEL_MAX_THREADS) {
+            return strdup("{\"success\":false,\"error\":\"Invalid threads parameter (1..64)\"}");
+        }
+        threads = (int)t;
+    }
+
     // Decode the URL-encoded parameter
     char* decoded_name = url_decode(name_str);
     if (!decoded_name) return NULL;
-    
+
     // Build full file path
     size_t path_len = strlen("files/") + strlen(decoded_name) + 1;
     char* filepath = malloc(path_len);
@@ -99,13 +308,13 @@ char* handle_wordcount(const char* name_str) {
         return NULL;
     }
     snprintf(filepath, path_len, "files/%s", decoded_name);
-    
-    // Check if file exists and get size
+
+    // Check if file exists
     struct stat st;
     if (stat(filepath, &st) != 0) {
         timer_stop(&timer);
         long elapsed = timer_elapsed_ms(&timer);
-        
+
         size_t json_len = 256;
         char* json = malloc(json_len);
         if (json) {
@@ -113,23 +322,28 @@ char* handle_wordcount(const char* name_str) {
                 "{\"success\":false,\"error\":\"File not found\",\"elapsed_ms\":%ld}",
                 elapsed);
         }
-        
+
         free(decoded_name);
         free(filepath);
         return json;
     }
-    
-    long file_size = (long)st.st_size;
-    
-    // Count lines, words, and bytes
+
+    // Count lines, words, bytes and UTF-8 characters
     wc_result_t result;
-    int count_result = count_file(filepath, &result);
-    
+    int count_result = count_file(filepath, threads, &result);
+
     // Stop timing
     timer_stop(&timer);
     long elapsed = timer_elapsed_ms(&timer);
-    
-    if (count_result != 0) {
+
+    if (count_result == WC_ERR_DEADLINE) {
+        // El caller responde 504
+        free(decoded_name);
+        free(filepath);
+        return NULL;
+    }
+
+    if (count_result != WC_OK) {
         size_t json_len = 256;
         char* json = malloc(json_len);
         if (json) {
@@ -137,14 +351,14 @@ char* handle_wordcount(const char* name_str) {
                 "{\"success\":false,\"error\":\"Failed to read file\",\"elapsed_ms\":%ld}",
                 elapsed);
         }
-        
+
         free(decoded_name);
         free(filepath);
         return json;
     }
-    
+
     // Build success JSON response
-    // Format: {"success":true,"file":"name","lines":X,"words":Y,"bytes":Z,"chars":Z,"elapsed_ms":T}
+    // Format: {"success":true,"file":"name","lines":X,"words":Y,"bytes":Z,"chars":C,"threads":N,"elapsed_ms":T}
     size_t json_len = strlen(decoded_name) + 512;
     char* json = malloc(json_len);
     if (!json) {
@@ -152,14 +366,14 @@ char* handle_wordcount(const char* name_str) {
         free(filepath);
         return NULL;
     }
-    
+
     snprintf(json, json_len,
-        "{\"success\":true,\"file\":\"%s\",\"lines\":%lu,\"words\":%lu,\"bytes\":%lu,\"chars\":%lu,\"elapsed_ms\":%ld}",
-        decoded_name, result.lines, result.words, result.bytes, result.chars, elapsed);
-    
+        "{\"success\":true,\"file\":\"%s\",\"lines\":%lu,\"words\":%lu,\"bytes\":%lu,\"chars\":%lu,\"threads\":%d,\"elapsed_ms\":%ld}",
+        decoded_name, result.lines, result.words, result.bytes, result.chars, threads, elapsed);
+
     // Clean up
     free(decoded_name);
     free(filepath);
-    
+
     return json;
 }
@@ -0,0 +1,281 @@
+// Access log por request, en lotes
+#include "access_log.h"
+#include "counters.h"
+#include "../utils/utils.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+_Static_assert(sizeof(access_record_t) == 176, "access_record_t es parte del formato binario");
+
+typedef struct {
+    pthread_mutex_t mutex;
+    size_t len;
+    char buffer[ACCESS_LOG_BUFFER_SIZE];
+} __attribute__((aligned(64))) access_shard_t;
+
+static struct {
+    int enabled;
+    int fd;
+    access_log_format_t format;
+    int flush_ms;
+    access_shard_t *shards;
+
+    pthread_t flusher;
+    int stop;
+    pthread_mutex_t wake_mutex;
+    pthread_cond_t wake_cond;
+} g_access_log = {
+    .enabled = 0,
+    .fd = -1,
+    .wake_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake_cond = PTHREAD_COND_INITIALIZER
+};
+
+// ============================================================================
+// ESCRITURA
+// ============================================================================
+
+static void write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_WARN("Access log write failed: %s", strerror(errno));
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+// Con el mutex del shard tomado
+static void shard_flush_locked(access_shard_t *shard) {
+    if (shard->len > 0) {
+        write_all(g_access_log.fd, shard->buffer, shard->len);
+        shard->len = 0;
+    }
+}
+
+void access_log_flush(void) {
+    if (!__atomic_load_n(&g_access_log.enabled, __ATOMIC_ACQUIRE)) return;
+
+    for (int i = 0; i < ACCESS_LOG_SHARDS; i++) {
+        access_shard_t *shard = &g_access_log.shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        shard_flush_locked(shard);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
+
+static void* flusher_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_access_log.wake_mutex);
+    while (!g_access_log.stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += g_access_log.flush_ms / 1000;
+        deadline.tv_nsec += (long)(g_access_log.flush_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&g_access_log.wake_cond, &g_access_log.wake_mutex, &deadline);
+
+        pthread_mutex_unlock(&g_access_log.wake_mutex);
+        access_log_flush();
+        pthread_mutex_lock(&g_access_log.wake_mutex);
+    }
+    pthread_mutex_unlock(&g_access_log.wake_mutex);
+    return NULL;
+}
+
+// ============================================================================
+// INIT / SHUTDOWN
+// ============================================================================
+
+// Escribir el header en un archivo nuevo o validar el de uno existente
+static int prepare_binary_file(int fd, const char *path) {
+    access_log_header_t expected;
+    memcpy(expected.magic, ACCESS_LOG_MAGIC, 4);
+    expected.version = ACCESS_LOG_VERSION;
+    expected.record_size = (uint16_t)sizeof(access_record_t);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) return -1;
+
+    if (st.st_size == 0) {
+        write_all(fd, (const char*)&expected, sizeof(expected));
+        return 0;
+    }
+
+    access_log_header_t found;
+    if (pread(fd, &found, sizeof(found), 0) != (ssize_t)sizeof(found) ||
+        memcmp(&found, &expected, sizeof(expected)) != 0) {
+        LOG_ERROR("Access log %s exists and is not a v%d binary log", path, ACCESS_LOG_VERSION);
+        return -1;
+    }
+    return 0;
+}
+
+int access_log_init(const char *path, access_log_format_t format, int flush_ms) {
+    if (!path || __atomic_load_n(&g_access_log.enabled, __ATOMIC_ACQUIRE)) return -1;
+
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+    if (format == ACCESS_LOG_BINARY) {
+        flags = O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC; // pread del header
+    }
+    int fd = open(path, flags, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open access log %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (format == ACCESS_LOG_BINARY && prepare_binary_file(fd, path) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    access_shard_t *shards = aligned_alloc(64, sizeof(access_shard_t) * ACCESS_LOG_SHARDS);
+    if (!shards) {
+        close(fd);
+        return -1;
+    }
+    for (int i = 0; i < ACCESS_LOG_SHARDS; i++) {
+        pthread_mutex_init(&shards[i].mutex, NULL);
+        shards[i].len = 0;
+    }
+
+    g_access_log.fd = fd;
+    g_access_log.format = format;
+    g_access_log.flush_ms = flush_ms > 0 ? flush_ms : ACCESS_LOG_FLUSH_MS;
+    g_access_log.shards = shards;
+    g_access_log.stop = 0;
+
+    if (pthread_create(&g_access_log.flusher, NULL, flusher_thread, NULL) != 0) {
+        LOG_ERROR("Failed to start access log flusher");
+        free(shards);
+        close(fd);
+        g_access_log.fd = -1;
+        return -1;
+    }
+
+    __atomic_store_n(&g_access_log.enabled, 1, __ATOMIC_RELEASE);
+    LOG_INFO("Access log: %s (%s, flush cada %d ms)", path,
+             format == ACCESS_LOG_BINARY ? "binary" : "text", g_access_log.flush_ms);
+    return 0;
+}
+
+void access_log_after_fork(void) {
+    if (!__atomic_load_n(&g_access_log.enabled, __ATOMIC_ACQUIRE)) return;
+
+    // Los mutex pueden haber quedado tomados por un thread del padre. Lo que
+    // había en los buffers lo escribe el padre: el hijo empieza vacío.
+    pthread_mutex_init(&g_access_log.wake_mutex, NULL);
+    pthread_cond_init(&g_access_log.wake_cond, NULL);
+    for (int i = 0; i < ACCESS_LOG_SHARDS; i++) {
+        pthread_mutex_init(&g_access_log.shards[i].mutex, NULL);
+        g_access_log.shards[i].len = 0;
+    }
+
+    // El fd es compartido con O_APPEND: cada lote se escribe con un write()
+    g_access_log.stop = 0;
+    if (pthread_create(&g_access_log.flusher, NULL, flusher_thread, NULL) != 0) {
+        LOG_ERROR("Failed to restart access log flusher after fork");
+        __atomic_store_n(&g_access_log.enabled, 0, __ATOMIC_RELEASE);
+    }
+}
+
+void access_log_shutdown(void) {
+    if (!__atomic_load_n(&g_access_log.enabled, __ATOMIC_ACQUIRE)) return;
+
+    pthread_mutex_lock(&g_access_log.wake_mutex);
+    g_access_log.stop = 1;
+    pthread_cond_signal(&g_access_log.wake_cond);
+    pthread_mutex_unlock(&g_access_log.wake_mutex);
+    pthread_join(g_access_log.flusher, NULL);
+
+    // Último flush; después de esto access_log_record() no escribe nada
+    access_log_flush();
+    __atomic_store_n(&g_access_log.enabled, 0, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < ACCESS_LOG_SHARDS; i++) {
+        pthread_mutex_lock(&g_access_log.shards[i].mutex);
+        shard_flush_locked(&g_access_log.shards[i]);
+        pthread_mutex_unlock(&g_access_log.shards[i].mutex);
+    }
+
+    close(g_access_log.fd);
+    g_access_log.fd = -1;
+    // Los shards no se liberan: un thread de conexión puede estar esperando su mutex
+}
+
+bool access_log_enabled(void) {
+    return __atomic_load_n(&g_access_log.enabled, __ATOMIC_ACQUIRE) != 0;
+}
+
+// ============================================================================
+// REGISTRO
+// ============================================================================
+
+int access_log_format_line(const access_record_t *r, char *buffer, size_t size) {
+    time_t sec = (time_t)(r->timestamp_us / 1000000ULL);
+    struct tm tm_info;
+    gmtime_r(&sec, &tm_info);
+    char ts[32];
+    strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", &tm_info);
+
+    return snprintf(buffer, size,
+                    "%s.%06uZ\t%.*s\t%.*s\t%.*s\t%u\t%u\t%u\t%u\t%u\t%u\t%u",
+                    ts, (unsigned)(r->timestamp_us % 1000000ULL),
+                    (int)sizeof(r->request_id), r->request_id,
+                    (int)sizeof(r->method), r->method,
+                    (int)sizeof(r->target), r->target,
+                    (unsigned)r->status, r->bytes_in, r->bytes_out,
+                    r->parse_us, r->queue_us, r->exec_us, r->write_us);
+}
+
+int access_log_parse_format(const char *name, access_log_format_t *format) {
+    if (!name || !format) return -1;
+    if (strcmp(name, "text") == 0) {
+        *format = ACCESS_LOG_TEXT;
+    } else if (strcmp(name, "binary") == 0) {
+        *format = ACCESS_LOG_BINARY;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+void access_log_record(const access_record_t *record) {
+    if (!record || !__atomic_load_n(&g_access_log.enabled, __ATOMIC_ACQUIRE)) return;
+
+    access_record_t r = *record;
+    if (r.timestamp_us == 0) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        r.timestamp_us = (uint64_t)tv.tv_sec * 1000000ULL + (uint64_t)tv.tv_usec;
+    }
+
+    char line[512];
+    const char *data = (const char*)&r;
+    size_t len = sizeof(r);
+    if (g_access_log.format == ACCESS_LOG_TEXT) {
+        int n = access_log_format_line(&r, line, sizeof(line) - 1);
+        if (n < 0) return;
+        if ((size_t)n > sizeof(line) - 2) n = (int)sizeof(line) - 2;
+        line[n++] = '\n';
+        data = line;
+        len = (size_t)n;
+    }
+
+    access_shard_t *shard = &g_access_log.shards[counter_thread_slot() % ACCESS_LOG_SHARDS];
+    pthread_mutex_lock(&shard->mutex);
+    if (shard->len + len > sizeof(shard->buffer)) {
+        shard_flush_locked(shard); // Flush por tamaño
+    }
+    memcpy(shard->buffer + shard->len, data, len);
+    shard->len += len;
+    pthread_mutex_unlock(&shard->mutex);
+}
@@ -0,0 +1,110 @@
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// ============================================================================
+// ACCESS LOG - Una línea (o registro binario) por request
+// ============================================================================
+//
+// Los registros se acumulan en ACCESS_LOG_SHARDS buffers (el thread elige uno
+// por su slot de counter_thread_slot()) y se escriben en lotes: cuando un
+// buffer se llena, o cada flush_ms desde un thread de fondo.
+//
+// Formatos:
+//   ACCESS_LOG_TEXT   - TSV compacto, una línea por request:
+//                       ts  id  method  target  status  in  out  parse  queue  exec  write
+//   ACCESS_LOG_BINARY - Header access_log_header_t seguido de access_record_t
+//                       de tamaño fijo (endianness del host). Se decodifica
+//                       con tools/access_log_decode.
+
+#define ACCESS_LOG_MAGIC        "HSAL"
+#define ACCESS_LOG_VERSION      1
+#define ACCESS_LOG_SHARDS       16
+#define ACCESS_LOG_BUFFER_SIZE  32768   // Bytes por shard antes de forzar un flush
+#define ACCESS_LOG_FLUSH_MS     1000    // Flush por tiempo por defecto
+
+typedef enum {
+    ACCESS_LOG_TEXT,
+    ACCESS_LOG_BINARY
+} access_log_format_t;
+
+typedef struct {
+    char magic[4];              // ACCESS_LOG_MAGIC
+    uint16_t version;
+    uint16_t record_size;       // sizeof(access_record_t)
+} access_log_header_t;
+
+typedef struct {
+    uint64_t timestamp_us;      // Fin de la request (epoch, microsegundos)
+    uint32_t parse_us;
+    uint32_t queue_us;          // accept() -> inicio del thread
+    uint32_t exec_us;
+    uint32_t write_us;
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+    uint16_t status;
+    char method[8];
+    char request_id[40];
+    char target[94];            // path?query (truncado)
+} access_record_t;
+
+// ============================================================================
+// FUNCIONES PÚBLICAS
+// ============================================================================
+
+/**
+ * Abrir el access log y arrancar el thread de flush
+ *
+ * @param path Archivo (se abre en modo append)
+ * @param format Texto o binario; un archivo binario existente debe tener el mismo header
+ * @param flush_ms Intervalo del flush por tiempo (<= 0 usa ACCESS_LOG_FLUSH_MS)
+ * @return 0 si éxito, -1 si error
+ */
+int access_log_init(const char *path, access_log_format_t format, int flush_ms);
+
+/**
+ * Escribir lo pendiente, detener el thread de flush y cerrar el archivo
+ */
+void access_log_shutdown(void);
+
+/**
+ * Llamar en el hijo después de fork() (modo prefork): reinicia los mutex,
+ * descarta los buffers heredados y arranca un flusher propio
+ */
+void access_log_after_fork(void);
+
+/**
+ * true si hay un access log abierto
+ */
+bool access_log_enabled(void);
+
+/**
+ * Registrar una request (copia el registro al buffer del shard)
+ *
+ * @param record Registro completo; timestamp_us en 0 usa la hora actual
+ */
+void access_log_record(const access_record_t *record);
+
+/**
+ * Escribir todos los buffers ahora
+ */
+void access_log_flush(void);
+
+/**
+ * Formatear un registro como línea de texto (sin '\n')
+ *
+ * @return Largo de la línea, como snprintf
+ */
+int access_log_format_line(const access_record_t *record, char *buffer, size_t size);
+
+/**
+ * Parsear "text" o "binary"
+ *
+ * @return 0 si éxito, -1 si el nombre no es válido
+ */
+int access_log_parse_format(const char *name, access_log_format_t *format);
+
+#endif // ACCESS_LOG_H
@@ -0,0 +1,339 @@
+// Afinidad de threads y ubicación NUMA
+#include "affinity.h"
+#include "shm.h"
+#include "../utils/utils.h"
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#define MASK_WORDS (AFFINITY_MAX_CPUS / (8 * sizeof(unsigned long)))
+#define WORD_BITS  (8 * sizeof(unsigned long))
+
+// Máscara en el formato de sched_setaffinity (sin cpu_set_t: es de _GNU_SOURCE)
+typedef struct {
+    unsigned long bits[MASK_WORDS];
+} cpu_mask_t;
+
+typedef struct {
+    int tid;
+    int cpu;
+    int node;
+} pinned_worker_t;
+
+static struct {
+    bool enabled;
+    bool automatic;
+    int num_nodes;
+    signed char cpu_node[AFFINITY_MAX_CPUS];
+    cpu_mask_t io;
+    cpu_mask_t compute;
+    int compute_order[AFFINITY_MAX_CPUS];   // Intercalado por nodo
+    int compute_count;
+    unsigned long *next_worker;             // En shm: reparto de toda la flota
+
+    pthread_mutex_t lock;                   // Protege pinned
+    pinned_worker_t pinned[AFFINITY_MAX_PINNED];
+    int num_pinned;
+} g_affinity = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// ============================================================================
+// MÁSCARAS
+// ============================================================================
+
+static void mask_set(cpu_mask_t *m, int cpu) {
+    m->bits[cpu / WORD_BITS] |= 1UL << (cpu % WORD_BITS);
+}
+
+static bool mask_has(const cpu_mask_t *m, int cpu) {
+    return (m->bits[cpu / WORD_BITS] >> (cpu % WORD_BITS)) & 1UL;
+}
+
+static int mask_count(const cpu_mask_t *m) {
+    int n = 0;
+    for (size_t i = 0; i < MASK_WORDS; i++) n += __builtin_popcountl(m->bits[i]);
+    return n;
+}
+
+static bool mask_overlaps(const cpu_mask_t *a, const cpu_mask_t *b) {
+    for (size_t i = 0; i < MASK_WORDS; i++) {
+        if (a->bits[i] & b->bits[i]) return true;
+    }
+    return false;
+}
+
+static int set_thread_mask(const cpu_mask_t *m) {
+    // pid 0 = el thread que llama
+    return syscall(SYS_sched_setaffinity, 0, sizeof(*m), m) == 0 ? 0 : -1;
+}
+
+int affinity_parse_cpu_list(const char *list, int *cpus, int max) {
+    if (!list || !*list) return -1;
+
+    bool seen[AFFINITY_MAX_CPUS] = { false };
+    const char *p = list;
+    while (*p) {
+        char *end;
+        if (!isdigit((unsigned char)*p)) return -1;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            p++;
+            if (!isdigit((unsigned char)*p)) return -1;
+            last = strtol(p, &end, 10);
+            p = end;
+        }
+        if (first < 0 || last < first || last >= AFFINITY_MAX_CPUS) return -1;
+        for (long c = first; c <= last; c++) seen[c] = true;
+
+        if (*p == ',') {
+            p++;
+            if (!*p) return -1;
+        } else if (*p && !isspace((unsigned char)*p)) {
+            return -1;
+        } else {
+            break;      // Fin (sysfs termina con '\n')
+        }
+    }
+
+    int n = 0;
+    for (int c = 0; c < AFFINITY_MAX_CPUS; c++) {
+        if (!seen[c]) continue;
+        if (n >= max) return -1;
+        cpus[n++] = c;
+    }
+    return n;
+}
+
+static int parse_mask(const char *list, cpu_mask_t *m) {
+    int cpus[AFFINITY_MAX_CPUS];
+    int n = affinity_parse_cpu_list(list, cpus, AFFINITY_MAX_CPUS);
+    memset(m, 0, sizeof(*m));
+    for (int i = 0; i < n; i++) mask_set(m, cpus[i]);
+    return n;
+}
+
+// "0-3,8": rangos consecutivos compactados
+static int format_mask(const cpu_mask_t *m, char *buf, size_t cap) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for (int c = 0; c < AFFINITY_MAX_CPUS; c++) {
+        if (!mask_has(m, c)) continue;
+        int last = c;
+        while (last + 1 < AFFINITY_MAX_CPUS && mask_has(m, last + 1)) last++;
+        int w = (last > c) ? snprintf(buf + len, cap - len, "%s%d-%d", len ? "," : "", c, last)
+                           : snprintf(buf + len, cap - len, "%s%d", len ? "," : "", c);
+        if (w < 0 || (size_t)w >= cap - len) break;
+        len += (size_t)w;
+        c = last;
+    }
+    return (int)len;
+}
+
+// ============================================================================
+// TOPOLOGÍA
+// ============================================================================
+
+static void load_topology(void) {
+    memset(g_affinity.cpu_node, 0, sizeof(g_affinity.cpu_node));
+    g_affinity.num_nodes = 1;
+
+    for (int node = 0; node < AFFINITY_MAX_NODES; node++) {
+        char path[96], list[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        size_t n = fread(list, 1, sizeof(list) - 1, f);
+        fclose(f);
+        list[n] = '\0';
+
+        cpu_mask_t m;
+        if (parse_mask(list, &m) <= 0) continue;   // Nodo sin CPUs (solo memoria)
+        for (int c = 0; c < AFFINITY_MAX_CPUS; c++) {
+            if (mask_has(&m, c)) g_affinity.cpu_node[c] = (signed char)node;
+        }
+        if (node + 1 > g_affinity.num_nodes) g_affinity.num_nodes = node + 1;
+    }
+}
+
+// Split automático: por nodo, un octavo de sus CPUs (al menos una) para I/O
+static void split_auto(const cpu_mask_t *allowed) {
+    for (int node = 0; node < g_affinity.num_nodes; node++) {
+        int total = 0;
+        for (int c = 0; c < AFFINITY_MAX_CPUS; c++) {
+            if (mask_has(allowed, c) && g_affinity.cpu_node[c] == node) total++;
+        }
+        int io_n = (total + 7) / 8;
+        for (int c = 0, i = 0; c < AFFINITY_MAX_CPUS; c++) {
+            if (!mask_has(allowed, c) || g_affinity.cpu_node[c] != node) continue;
+            mask_set(i++ < io_n ? &g_affinity.io : &g_affinity.compute, c);
+        }
+    }
+}
+
+// Orden de reparto de workers: la i-ésima CPU de cada nodo antes que la
+// (i+1)-ésima de cualquiera, así pocos workers quedan repartidos en sockets
+static void build_compute_order(void) {
+    g_affinity.compute_count = 0;
+    for (int round = 0; g_affinity.compute_count < mask_count(&g_affinity.compute); round++) {
+        for (int node = 0; node < g_affinity.num_nodes; node++) {
+            int i = 0;
+            for (int c = 0; c < AFFINITY_MAX_CPUS; c++) {
+                if (!mask_has(&g_affinity.compute, c) || g_affinity.cpu_node[c] != node) continue;
+                if (i++ == round) {
+                    g_affinity.compute_order[g_affinity.compute_count++] = c;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+int affinity_init(const char *spec) {
+    g_affinity.enabled = false;
+    g_affinity.automatic = false;
+    load_topology();
+    if (!spec || strcmp(spec, "off") == 0) return 0;
+
+    cpu_mask_t allowed;
+    memset(&allowed, 0, sizeof(allowed));
+    if (syscall(SYS_sched_getaffinity, 0, sizeof(allowed), &allowed) < 0) {
+        LOG_ERROR("sched_getaffinity failed: %s", strerror(errno));
+        return -1;
+    }
+    memset(&g_affinity.io, 0, sizeof(g_affinity.io));
+    memset(&g_affinity.compute, 0, sizeof(g_affinity.compute));
+
+    if (strcmp(spec, "auto") == 0) {
+        g_affinity.automatic = true;
+        split_auto(&allowed);
+        if (mask_count(&g_affinity.compute) == 0) {
+            // Una CPU por nodo: no alcanza para separar
+            g_affinity.compute = g_affinity.io;
+        }
+    } else {
+        const char *colon = strchr(spec, ':');
+        if (!colon || colon == spec) return -1;
+        char io_list[256];
+        snprintf(io_list, sizeof(io_list), "%.*s", (int)(colon - spec), spec);
+        if (parse_mask(io_list, &g_affinity.io) <= 0 ||
+            parse_mask(colon + 1, &g_affinity.compute) <= 0) {
+            return -1;
+        }
+        for (int c = 0; c < AFFINITY_MAX_CPUS; c++) {
+            if ((mask_has(&g_affinity.io, c) || mask_has(&g_affinity.compute, c)) &&
+                !mask_has(&allowed, c)) {
+                LOG_ERROR("CPU %d is not available to this process", c);
+                return -1;
+            }
+        }
+    }
+
+    if (mask_overlaps(&g_affinity.io, &g_affinity.compute)) {
+        LOG_WARN("I/O and compute CPU sets overlap");
+    }
+    build_compute_order();
+
+    if (!g_affinity.next_worker) {
+        g_affinity.next_worker = shm_alloc(sizeof(unsigned long));
+        if (!g_affinity.next_worker) return -1;
+    }
+    g_affinity.enabled = true;
+
+    char io[256], compute[256];
+    format_mask(&g_affinity.io, io, sizeof(io));
+    format_mask(&g_affinity.compute, compute, sizeof(compute));
+    LOG_INFO("CPU affinity: I/O %s, compute %s (%d NUMA nodes)", io, compute, g_affinity.num_nodes);
+    return 0;
+}
+
+bool affinity_enabled(void) {
+    return g_affinity.enabled;
+}
+
+int affinity_pin_current(affinity_role_t role) {
+    if (!g_affinity.enabled) return 0;
+    return set_thread_mask(role == AFFINITY_IO ? &g_affinity.io : &g_affinity.compute);
+}
+
+int affinity_pin_worker(void) {
+    if (!g_affinity.enabled || g_affinity.compute_count == 0) return -1;
+
+    unsigned long idx = __atomic_fetch_add(g_affinity.next_worker, 1, __ATOMIC_RELAXED);
+    int cpu = g_affinity.compute_order[idx % (unsigned long)g_affinity.compute_count];
+    int node = g_affinity.cpu_node[cpu];
+
+    cpu_mask_t m;
+    memset(&m, 0, sizeof(m));
+    mask_set(&m, cpu);
+    if (set_thread_mask(&m) != 0) {
+        LOG_WARN("Failed to pin worker to CPU %d: %s", cpu, strerror(errno));
+        return -1;
+    }
+
+    // Memoria del worker en su nodo aunque el proceso herede otra política
+    // (p. ej. numactl --interleave). maxnode lleva +1 por cómo lo cuenta el kernel.
+    if (g_affinity.num_nodes > 1) {
+        unsigned long nodes = 1UL << node;
+        syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodes, (unsigned long)AFFINITY_MAX_NODES + 1);
+    }
+
+    pthread_mutex_lock(&g_affinity.lock);
+    if (g_affinity.num_pinned < AFFINITY_MAX_PINNED) {
+        pinned_worker_t *p = &g_affinity.pinned[g_affinity.num_pinned++];
+        p->tid = (int)syscall(SYS_gettid);
+        p->cpu = cpu;
+        p->node = node;
+    }
+    pthread_mutex_unlock(&g_affinity.lock);
+    return cpu;
+}
+
+int affinity_enter_compute(void) {
+    if (!g_affinity.enabled) return 0;
+    return set_thread_mask(&g_affinity.compute) == 0 ? 1 : 0;
+}
+
+void affinity_leave_compute(int token) {
+    if (token) set_thread_mask(&g_affinity.io);
+}
+
+int affinity_write_json(char *buf, size_t cap) {
+    if (!g_affinity.enabled) {
+        return snprintf(buf, cap, "{\"enabled\":false,\"numa_nodes\":%d}", g_affinity.num_nodes);
+    }
+
+    char io[256], compute[256];
+    format_mask(&g_affinity.io, io, sizeof(io));
+    format_mask(&g_affinity.compute, compute, sizeof(compute));
+
+    size_t len = 0;
+    int w = snprintf(buf, cap,
+                     "{\"enabled\":true,\"mode\":\"%s\",\"numa_nodes\":%d,"
+                     "\"io_cpus\":\"%s\",\"compute_cpus\":\"%s\",\"workers\":[",
+                     g_affinity.automatic ? "auto" : "manual", g_affinity.num_nodes, io, compute);
+    if (w < 0) return w;
+    len = (size_t)w;
+
+    pthread_mutex_lock(&g_affinity.lock);
+    for (int i = 0; i < g_affinity.num_pinned; i++) {
+        const pinned_worker_t *p = &g_affinity.pinned[i];
+        w = snprintf(len < cap ? buf + len : NULL, len < cap ? cap - len : 0,
+                     "%s{\"tid\":%d,\"cpu\":%d,\"node\":%d}",
+                     i ? "," : "", p->tid, p->cpu, p->node);
+        if (w > 0) len += (size_t)w;
+    }
+    pthread_mutex_unlock(&g_affinity.lock);
+
+    w = snprintf(len < cap ? buf + len : NULL, len < cap ? cap - len : 0, "]}");
+    if (w > 0) len += (size_t)w;
+    return (int)len;
+}
@@ -0,0 +1,95 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// ============================================================================
+// AFFINITY - Ubicación de threads en CPUs y nodos NUMA
+// ============================================================================
+//
+// Con --affinity las CPUs del proceso se dividen en dos sets disjuntos:
+//
+//   I/O       accept loop y threads de conexión (la heredan al crearse)
+//   compute   workers del job executor, uno por CPU, y las rutas CPU-bound
+//             mientras ejecutan el handler
+//
+// Un worker fijo en una CPU no migra y conserva su cache; su memoria va al
+// nodo NUMA de esa CPU (política preferida del thread + first-touch). La
+// topología se lee de /sys/devices/system/node; sin NUMA todo es el nodo 0.
+//
+// Sin --affinity no se fija nada y todo corre donde decida el scheduler.
+
+#define AFFINITY_MAX_CPUS     1024
+#define AFFINITY_MAX_NODES    64
+#define AFFINITY_MAX_PINNED   64      // Workers que se reportan por proceso
+
+typedef enum {
+    AFFINITY_IO = 0,
+    AFFINITY_COMPUTE
+} affinity_role_t;
+
+/**
+ * Configurar los sets de CPUs (llamar antes de crear threads y, en modo
+ * prefork, antes de fork: el reparto de CPUs entre workers es de la flota)
+ *
+ * @param spec "auto" (un octavo de cada nodo para I/O, el resto compute),
+ *             "IO:COMPUTE" con listas tipo "0-1:2-7,9", o NULL/"off"
+ * @return 0 si éxito, -1 si spec es inválido o usa CPUs no permitidas
+ */
+int affinity_init(const char *spec);
+
+/**
+ * true si hay sets configurados
+ */
+bool affinity_enabled(void);
+
+/**
+ * Fijar el thread actual a todo el set del rol
+ *
+ * @return 0 si éxito (o deshabilitado), -1 si error
+ */
+int affinity_pin_current(affinity_role_t role);
+
+/**
+ * Fijar el thread actual (worker de cómputo) a una sola CPU del set compute,
+ * en round-robin intercalando nodos, con su memoria en el nodo de esa CPU
+ *
+ * @return CPU asignada, o -1 si deshabilitado o error
+ */
+int affinity_pin_worker(void);
+
+/**
+ * Pasar el thread actual al set compute mientras corre un handler CPU-bound
+ *
+ * @return Token para affinity_leave_compute (0 si no cambió nada)
+ */
+int affinity_enter_compute(void);
+
+/**
+ * Volver al set I/O después de affinity_enter_compute
+ *
+ * @param token Valor retornado por affinity_enter_compute
+ */
+void affinity_leave_compute(int token);
+
+/**
+ * Parsear una lista de CPUs ("0-3,8")
+ *
+ * @param list Lista
+ * @param cpus Salida: CPUs en orden creciente
+ * @param max Capacidad de cpus
+ * @return Cantidad de CPUs, o -1 si la lista es inválida
+ */
+int affinity_parse_cpu_list(const char *list, int *cpus, int max);
+
+/**
+ * Ubicación como objeto JSON (para /status)
+ *
+ * @param buf Buffer
+ * @param cap Capacidad
+ * @return Largo escrito (como snprintf)
+ */
+int affinity_write_json(char *buf, size_t cap);
+
+#endif // AFFINITY_H
@@ -0,0 +1,51 @@
+// Contadores repartidos por thread (sin locks en el camino de escritura)
+#include "counters.h"
+#include "shm.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Slot asignado a cada thread la primera vez que incrementa algo
+static __thread int tl_slot = -1;
+static unsigned int g_next_slot = 0;
+
+int counter_thread_slot(void) {
+    if (tl_slot < 0) {
+        tl_slot = (int)(__atomic_fetch_add(&g_next_slot, 1, __ATOMIC_RELAXED) % COUNTER_SLOTS);
+    }
+    return tl_slot;
+}
+
+counter_set_t* counter_set_create(int num_fields) {
+    if (num_fields <= 0 || num_fields > COUNTER_MAX_FIELDS) {
+        return NULL;
+    }
+
+    // En modo prefork queda en memoria compartida: suman todos los workers
+    counter_set_t *set = shm_alloc(sizeof(counter_set_t));
+    if (!set) {
+        return NULL;
+    }
+    set->num_fields = num_fields;
+    return set;
+}
+
+void counter_set_destroy(counter_set_t *set) {
+    shm_free(set);
+}
+
+void counter_set_add(counter_set_t *set, int field, uint64_t delta) {
+    if (!set || field < 0 || field >= set->num_fields) return;
+
+    counter_slot_t *slot = &set->slots[counter_thread_slot()];
+    __atomic_fetch_add(&slot->values[field], delta, __ATOMIC_RELAXED);
+}
+
+uint64_t counter_set_read(const counter_set_t *set, int field) {
+    if (!set || field < 0 || field >= set->num_fields) return 0;
+
+    uint64_t total = 0;
+    for (int i = 0; i < COUNTER_SLOTS; i++) {
+        total += __atomic_load_n(&set->slots[i].values[field], __ATOMIC_RELAXED);
+    }
+    return total;
+}
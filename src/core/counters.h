@@ -0,0 +1,62 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdint.h>
+
+// ============================================================================
+// COUNTERS - Contadores repartidos por thread
+// ============================================================================
+//
+// Un counter_set_t agrupa hasta COUNTER_MAX_FIELDS contadores. Cada thread
+// escribe en su propio slot (una línea de caché con todos los campos), así
+// que incrementar no toma locks ni hace rebotar una línea compartida entre
+// cores. Leer suma todos los slots.
+//
+// Si hay más threads que COUNTER_SLOTS, varios comparten slot; por eso las
+// sumas son atómicas (relajadas): sin contención cuestan casi lo mismo que
+// una suma normal.
+
+#define COUNTER_SLOTS      64
+#define COUNTER_MAX_FIELDS 8     // 8 x uint64_t = 64 bytes = una línea de caché
+
+typedef struct {
+    uint64_t values[COUNTER_MAX_FIELDS];
+} __attribute__((aligned(64))) counter_slot_t;
+
+typedef struct {
+    counter_slot_t slots[COUNTER_SLOTS];
+    int num_fields;
+} counter_set_t;
+
+/**
+ * Crear un set de contadores en cero
+ *
+ * @param num_fields Número de campos (1..COUNTER_MAX_FIELDS)
+ * @return Puntero al set o NULL si falla
+ */
+counter_set_t* counter_set_create(int num_fields);
+
+/**
+ * Liberar set de contadores
+ */
+void counter_set_destroy(counter_set_t *set);
+
+/**
+ * Sumar delta al campo field en el slot del thread actual (sin locks)
+ */
+void counter_set_add(counter_set_t *set, int field, uint64_t delta);
+
+/**
+ * Leer el total de un campo (suma de todos los slots)
+ */
+uint64_t counter_set_read(const counter_set_t *set, int field);
+
+/**
+ * Slot asignado al thread actual (round-robin la primera vez que se pide).
+ * También lo usan otras estructuras repartidas por thread (histogramas).
+ *
+ * @return Índice en [0, COUNTER_SLOTS)
+ */
+int counter_thread_slot(void);
+
+#endif // COUNTERS_H
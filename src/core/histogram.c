@@ -0,0 +1,166 @@
+// Histograma log-lineal con shards por thread
+#include "histogram.h"
+#include "counters.h"
+#include "shm.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Mismo reparto por thread que los contadores (counter_thread_slot)
+static inline int current_shard(void) {
+    return counter_thread_slot() % HIST_SHARDS;
+}
+
+// ============================================================================
+// BUCKETS
+// ============================================================================
+
+int histogram_bucket_index(uint64_t value) {
+    if (value > HIST_MAX_VALUE) {
+        value = HIST_MAX_VALUE;
+    }
+    if (value < 2 * HIST_SUB_BUCKETS) {
+        return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - HIST_SUB_BUCKET_BITS;
+    return shift * HIST_SUB_BUCKETS + (int)(value >> shift);
+}
+
+uint64_t histogram_bucket_lower(int index) {
+    if (index < 2 * HIST_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int shift = index / HIST_SUB_BUCKETS - 1;
+    uint64_t sub = (uint64_t)(index - shift * HIST_SUB_BUCKETS);
+    return sub << shift;
+}
+
+uint64_t histogram_bucket_upper(int index) {
+    if (index < 2 * HIST_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int shift = index / HIST_SUB_BUCKETS - 1;
+    return histogram_bucket_lower(index) + (1ULL << shift) - 1;
+}
+
+// ============================================================================
+// CREACIÓN Y REGISTRO
+// ============================================================================
+
+histogram_t* histogram_create(void) {
+    return shm_alloc(sizeof(histogram_t));
+}
+
+void histogram_destroy(histogram_t *h) {
+    shm_free(h);
+}
+
+void histogram_record(histogram_t *h, uint64_t value) {
+    if (!h) return;
+
+    if (value > HIST_MAX_VALUE) {
+        value = HIST_MAX_VALUE;
+    }
+
+    histogram_shard_t *s = &h->shards[current_shard()];
+    __atomic_fetch_add(&s->counts[histogram_bucket_index(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->total_count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->total_sum, value, __ATOMIC_RELAXED);
+
+    uint64_t cur = __atomic_load_n(&s->max, __ATOMIC_RELAXED);
+    while (value > cur &&
+           !__atomic_compare_exchange_n(&s->max, &cur, value, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        // cur se actualiza con el valor actual; reintentar
+    }
+}
+
+// ============================================================================
+// LECTURA
+// ============================================================================
+
+uint64_t histogram_merge(const histogram_t *h, uint64_t *counts) {
+    memset(counts, 0, sizeof(uint64_t) * HIST_BUCKETS);
+    if (!h) return 0;
+
+    uint64_t total = 0;
+    for (int s = 0; s < HIST_SHARDS; s++) {
+        const histogram_shard_t *shard = &h->shards[s];
+        for (int i = 0; i < HIST_BUCKETS; i++) {
+            uint64_t c = __atomic_load_n(&shard->counts[i], __ATOMIC_RELAXED);
+            counts[i] += c;
+            total += c;
+        }
+    }
+    return total;
+}
+
+uint64_t histogram_sum(const histogram_t *h) {
+    if (!h) return 0;
+
+    uint64_t sum = 0;
+    for (int s = 0; s < HIST_SHARDS; s++) {
+        sum += __atomic_load_n(&h->shards[s].total_sum, __ATOMIC_RELAXED);
+    }
+    return sum;
+}
+
+uint64_t histogram_percentile(const uint64_t *counts, uint64_t total, double percentile) {
+    if (!counts || total == 0) return 0;
+
+    if (percentile < 0.0) percentile = 0.0;
+    if (percentile > 100.0) percentile = 100.0;
+
+    uint64_t rank = (uint64_t)ceil(percentile / 100.0 * (double)total);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return histogram_bucket_upper(i);
+        }
+    }
+    return histogram_bucket_upper(HIST_BUCKETS - 1);
+}
+
+void histogram_summarize(const histogram_t *h, histogram_summary_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!h) return;
+
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total = histogram_merge(h, counts);
+    if (total == 0) return;
+
+    out->sum = histogram_sum(h);
+    for (int s = 0; s < HIST_SHARDS; s++) {
+        uint64_t m = __atomic_load_n(&h->shards[s].max, __ATOMIC_RELAXED);
+        if (m > out->max) out->max = m;
+    }
+
+    out->count = total;
+    out->mean = (double)out->sum / (double)total;
+
+    // Varianza aproximada usando el punto medio de cada bucket
+    double acc = 0.0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        if (counts[i] == 0) continue;
+        double lo = (double)histogram_bucket_lower(i);
+        double hi = (double)histogram_bucket_upper(i);
+        double diff = (lo + hi) / 2.0 - out->mean;
+        acc += (double)counts[i] * diff * diff;
+    }
+    out->stddev = sqrt(acc / (double)total);
+
+    // El límite superior del bucket nunca debe superar el máximo observado
+    out->p50 = histogram_percentile(counts, total, 50.0);
+    out->p90 = histogram_percentile(counts, total, 90.0);
+    out->p99 = histogram_percentile(counts, total, 99.0);
+    out->p999 = histogram_percentile(counts, total, 99.9);
+    if (out->p50 > out->max) out->p50 = out->max;
+    if (out->p90 > out->max) out->p90 = out->max;
+    if (out->p99 > out->max) out->p99 = out->max;
+    if (out->p999 > out->max) out->p999 = out->max;
+}
@@ -0,0 +1,123 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// HISTOGRAM - Histograma log-lineal estilo HDR (valores en microsegundos)
+// ============================================================================
+//
+// Cada potencia de 2 se divide en HIST_SUB_BUCKETS sub-buckets lineales, así
+// que el error relativo de cualquier percentil es <= 1/HIST_SUB_BUCKETS (~3%).
+// Los valores < 2 * HIST_SUB_BUCKETS se guardan exactos.
+//
+// Registrar es O(1) y no toma locks: cada thread escribe (con atómicos
+// relajados) en uno de HIST_SHARDS shards, elegido por un id thread-local.
+// Las lecturas suman los shards; pueden ver una muestra a medio registrar,
+// pero nunca bloquean a los threads que registran.
+
+#define HIST_SUB_BUCKET_BITS 5
+#define HIST_SUB_BUCKETS     (1 << HIST_SUB_BUCKET_BITS)   // 32
+#define HIST_BUCKETS         1024                          // cubre hasta ~19 h
+#define HIST_MAX_VALUE       ((1ULL << 36) - 1)            // valores mayores se saturan
+#define HIST_SHARDS          4
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total_count;
+    uint64_t total_sum;
+    uint64_t max;
+} __attribute__((aligned(64))) histogram_shard_t;
+
+typedef struct {
+    histogram_shard_t shards[HIST_SHARDS];
+} histogram_t;
+
+/**
+ * Resumen calculado al leer (merge de todos los shards)
+ */
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    double mean;
+    double stddev;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+} histogram_summary_t;
+
+// ============================================================================
+// FUNCIONES PÚBLICAS
+// ============================================================================
+
+/**
+ * Crear histograma vacío
+ *
+ * @return Puntero al histograma o NULL si falla
+ */
+histogram_t* histogram_create(void);
+
+/**
+ * Liberar histograma
+ */
+void histogram_destroy(histogram_t *h);
+
+/**
+ * Registrar un valor (O(1), sin locks)
+ *
+ * @param h Histograma
+ * @param value Valor en microsegundos (se satura en HIST_MAX_VALUE)
+ */
+void histogram_record(histogram_t *h, uint64_t value);
+
+/**
+ * Sumar todos los shards en un array de HIST_BUCKETS contadores
+ *
+ * @param h Histograma
+ * @param counts Array de salida (HIST_BUCKETS elementos)
+ * @return Total de muestras en counts
+ */
+uint64_t histogram_merge(const histogram_t *h, uint64_t *counts);
+
+/**
+ * Suma de todos los valores registrados (para _sum en Prometheus)
+ */
+uint64_t histogram_sum(const histogram_t *h);
+
+/**
+ * Calcular count, media, desviación estándar, percentiles y máximo
+ *
+ * @param h Histograma
+ * @param out Resumen de salida
+ */
+void histogram_summarize(const histogram_t *h, histogram_summary_t *out);
+
+/**
+ * Percentil sobre buckets ya sumados
+ *
+ * @param counts Array de HIST_BUCKETS contadores
+ * @param total Total de muestras en counts
+ * @param percentile Percentil en [0, 100]
+ * @return Límite superior del bucket que contiene el percentil
+ */
+uint64_t histogram_percentile(const uint64_t *counts, uint64_t total, double percentile);
+
+/**
+ * Índice del bucket donde cae un valor
+ */
+int histogram_bucket_index(uint64_t value);
+
+/**
+ * Menor valor que cae en el bucket index
+ */
+uint64_t histogram_bucket_lower(int index);
+
+/**
+ * Mayor valor que cae en el bucket index
+ */
+uint64_t histogram_bucket_upper(int index);
+
+#endif // HISTOGRAM_H
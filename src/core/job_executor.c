@@ -20,6 +20,20 @@ static worker_pool_t *g_worker_pool = NULL;
 static int execute_command(task_t *task, char **result_json, char **error_msg);
 static char* get_param(const char *query, const char *key);
 
+/**
+ * Callback de la cola para tareas cuyo deadline venció antes de ejecutarse
+ */
+static void job_expired_handler(task_t *task, void *ctx) {
+    (void)ctx;
+    
+    if (task->job_id) {
+        job_mark_error(task->job_id, "Deadline exceeded before execution");
+    } else if (task->client_fd >= 0) {
+        http_send_error(task->client_fd, HTTP_GATEWAY_TIMEOUT,
+                        "Deadline exceeded", task->request_id);
+    }
+}
+
 /**
  * Handler que ejecuta cada job
  * Llamado por los workers del pool
@@ -29,6 +43,13 @@ static int job_handler(task_t *task, void *user_ctx) {
     
     if (!task) return -1;
     
+    // Exponer el deadline de la tarea a los handlers de comandos
+    if (task->deadline.tv_sec != 0 || task->deadline.tv_usec != 0) {
+        deadline_set(&task->deadline);
+    } else {
+        deadline_clear();
+    }
+    
     // Si el task tiene job_id, es un job asíncrono
     if (task->job_id) {
         // Marcar como running
@@ -39,7 +60,11 @@ static int job_handler(task_t *task, void *user_ctx) {
         char *error = NULL;
         int rc = execute_command(task, &result, &error);
         
-        if (rc == 0 && result) {
+        if (deadline_expired()) {
+            job_mark_error(task->job_id, "Deadline exceeded");
+            free(result);
+            free(error);
+        } else if (rc == 0 && result) {
             // Éxito: marcar como done
             job_mark_done(task->job_id, result);
             free(result);
@@ -55,7 +80,11 @@ static int job_handler(task_t *task, void *user_ctx) {
         char *error = NULL;
         int rc = execute_command(task, &result, &error);
         
-        if (rc == 0 && result) {
+        if (deadline_expired()) {
+            http_send_error(task->client_fd, HTTP_GATEWAY_TIMEOUT, "Deadline exceeded", task->request_id);
+            free(result);
+            free(error);
+        } else if (rc == 0 && result) {
             http_send_json(task->client_fd, HTTP_OK, result, task->request_id);
             free(result);
         } else {
@@ -65,6 +94,7 @@ static int job_handler(task_t *task, void *user_ctx) {
         }
     }
     
+    deadline_clear();
     return 0;
 }
 
@@ -190,6 +220,26 @@ static int execute_command(task_t *task, char **result_json, char **error_msg) {
         return (*result_json) ? 0 : -1;
     }
     
+    if (strcmp(path, "/primes") == 0) {
+        const char *to = GET_PARAM("to");
+        if (!to) {
+            if (error_msg) *error_msg = strdup("Missing 'to' parameter");
+            return -1;
+        }
+        *result_json = handle_primes(GET_PARAM("from"), to, GET_PARAM("list"));
+        return (*result_json) ? 0 : -1;
+    }
+    
+    if (strcmp(path, "/isprime_batch") == 0) {
+        const char *nums = GET_PARAM("nums");
+        if (!nums) {
+            if (error_msg) *error_msg = strdup("Missing 'nums' parameter");
+            return -1;
+        }
+        *result_json = handle_isprime_batch(nums);
+        return (*result_json) ? 0 : -1;
+    }
+    
     if (strcmp(path, "/pi") == 0) {
         const char *digits = GET_PARAM("digits");
         if (!digits) {
@@ -208,7 +258,8 @@ static int execute_command(task_t *task, char **result_json, char **error_msg) {
             if (error_msg) *error_msg = strdup("Missing parameters");
             return -1;
         }
-        *result_json = handle_mandelbrot(width, height, max_iter);
+        *result_json = handle_mandelbrot(width, height, max_iter,
+                                         GET_PARAM("cx"), GET_PARAM("cy"), GET_PARAM("zoom"));
         return (*result_json) ? 0 : -1;
     }
     
@@ -244,7 +295,7 @@ static int execute_command(task_t *task, char **result_json, char **error_msg) {
             if (error_msg) *error_msg = strdup("Missing 'name' parameter");
             return -1;
         }
-        *result_json = handle_wordcount(name);
+        *result_json = handle_wordcount(name, GET_PARAM("threads"));
         return (*result_json) ? 0 : -1;
     }
     
@@ -266,7 +317,17 @@ static int execute_command(task_t *task, char **result_json, char **error_msg) {
             if (error_msg) *error_msg = strdup("Missing parameters");
             return -1;
         }
-        *result_json = handle_compress(name, codec);
+        *result_json = handle_compress(name, codec, GET_PARAM("threads"));
+        return (*result_json) ? 0 : -1;
+    }
+    
+    if (strcmp(path, "/decompress") == 0) {
+        const char *name = GET_PARAM("name");
+        if (!name) {
+            if (error_msg) *error_msg = strdup("Missing 'name' parameter");
+            return -1;
+        }
+        *result_json = handle_decompress(name, GET_PARAM("overwrite"));
         return (*result_json) ? 0 : -1;
     }
     
@@ -370,6 +431,7 @@ int job_executor_init(int num_workers, int queue_depth) {
     // Crear cola
     g_job_queue = queue_create(queue_depth);
     if (!g_job_queue) return -1;
+    queue_set_expired_handler(g_job_queue, job_expired_handler, NULL);
     
     // Crear worker pool
     g_worker_pool = worker_pool_create(num_workers, g_job_queue, job_handler, NULL);
@@ -411,6 +473,47 @@ int job_executor_enqueue(task_t *task) {
     return queue_enqueue(g_job_queue, task, 100);
 }
 
+int job_executor_requeue(const char *job_id, const char *task_name, const char *query) {
+    if (!g_job_queue || !job_id || !task_name) return -1;
+    
+    char path[128];
+    snprintf(path, sizeof(path), "/%s", task_name);
+    task_t *task = task_create(-1, path, query ? query : "", job_id);
+    if (!task) return -1;
+    task->job_id = strdup(job_id);
+    
+    if (!task->job_id || job_executor_enqueue(task) != 0) {
+        task_free(task);
+        return -1;
+    }
+    return 0;
+}
+
+int job_executor_release(const char *error_msg) {
+    if (!g_job_queue) return 0;
+    
+    // Sacar lo pendiente sin ejecutarlo: en disco sigue QUEUED y lo toma
+    // el proceso nuevo (job_manager_recover), salvo que haya error_msg
+    int released = 0;
+    task_t *task;
+    while ((task = queue_dequeue_timeout(g_job_queue, 0)) != NULL) {
+        if (task->job_id) {
+            if (error_msg) job_mark_error(task->job_id, error_msg);
+            released++;
+        } else {
+            job_handler(task, NULL);    // Request síncrona: tiene un cliente esperando
+        }
+        task_free(task);
+    }
+    return released;
+}
+
+int job_executor_pending(void) {
+    int queued = g_job_queue ? queue_size(g_job_queue) : 0;
+    int busy = g_worker_pool ? worker_pool_get_busy(g_worker_pool) : 0;
+    return queued + busy;
+}
+
 int job_executor_execute_direct(task_t *task) {
     if (!task) return -1;
     
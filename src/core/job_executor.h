@@ -29,6 +29,31 @@ void job_executor_shutdown();
  */
 int job_executor_enqueue(task_t *task);
 
+/**
+ * Re-encolar un job recuperado del disco (job_requeue_fn de job_manager_recover)
+ * 
+ * @param job_id ID del job (también se usa como request_id)
+ * @param task_name Comando (sin '/')
+ * @param query Parámetros key=value&...
+ * @return 0 on success, -1 si error o cola llena
+ */
+int job_executor_requeue(const char *job_id, const char *task_name, const char *query);
+
+/**
+ * Descartar los jobs que esperan en la cola sin ejecutarlos. Los que están
+ * corriendo terminan en job_executor_shutdown().
+ * 
+ * @param error_msg NULL: quedan QUEUED en disco para el proceso nuevo (hot
+ *                  restart). Si no, se marcan con este error.
+ * @return Jobs liberados
+ */
+int job_executor_release(const char *error_msg);
+
+/**
+ * Jobs en cola más los que se están ejecutando (0 = executor ocioso)
+ */
+int job_executor_pending(void);
+
 /**
  * Ejecutar un comando directamente (síncrono)
  * Útil para comandos rápidos que no necesitan job
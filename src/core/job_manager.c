@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <ctype.h>
+#include <dirent.h>
 
 // Implementación simple en memoria con persistencia por archivo
 typedef struct job_entry {
@@ -25,6 +27,7 @@ typedef struct job_entry {
 static job_entry_t *jobs_head = NULL;
 static pthread_mutex_t jobs_mutex = PTHREAD_MUTEX_INITIALIZER;
 static char storage_path[1024] = "data/jobs";
+static long g_owner = 0;           // Proceso (master) dueño de los jobs de esta instancia
 
 // Helpers
 static void ensure_storage_dir() {
@@ -51,10 +54,12 @@ static job_entry_t* find_job_locked(const char *job_id) {
 
 static void persist_job_locked(job_entry_t *job) {
     ensure_storage_dir();
-    char path[1200];
+    char path[1200], tmp[1232];
     snprintf(path, sizeof(path), "%s/%s.json", storage_path, job->job_id);
+    // Escribir aparte y renombrar: otro proceso puede estar leyendo el archivo
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
 
-    FILE *f = fopen(path, "w");
+    FILE *f = fopen(tmp, "w");
     if (!f) return;
     fprintf(f, "{\n");
     fprintf(f, "  \"job_id\": \"%s\",\n", job->job_id);
@@ -65,9 +70,77 @@ static void persist_job_locked(job_entry_t *job) {
     if (job->payload_json) fprintf(f, "  \"payload\": %s,\n", job->payload_json);
     if (job->result_json) fprintf(f, "  \"result\": %s,\n", job->result_json);
     if (job->error_msg) fprintf(f, "  \"error\": \"%s\",\n", job->error_msg);
+    fprintf(f, "  \"owner\": %ld,\n", g_owner);
     fprintf(f, "  \"created_at\": %ld\n", job->created_at.tv_sec);
     fprintf(f, "}\n");
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        unlink(tmp);
+    }
+}
+
+// ============================================================================
+// JOBS DE OTROS PROCESOS
+// ============================================================================
+//
+// En modo prefork cada worker tiene su propia lista en memoria: un job creado
+// por otro worker solo se ve a través del archivo persistido (un campo por
+// línea, ver persist_job_locked).
+
+// Los IDs llegan del cliente y forman parte de un path
+static int valid_job_id(const char *job_id) {
+    if (!job_id[0] || strlen(job_id) > 64) return 0;
+    for (const char *p = job_id; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '-') return 0;
+    }
+    return 1;
+}
+
+// Contenido del archivo del job (malloc) o NULL si no existe
+static char* load_persisted(const char *job_id) {
+    if (!valid_job_id(job_id)) return NULL;
+
+    char path[1200];
+    snprintf(path, sizeof(path), "%s/%s.json", storage_path, job_id);
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+
+    size_t cap = 4096, len = 0;
+    char *doc = malloc(cap);
+    size_t n;
+    while (doc && (n = fread(doc + len, 1, cap - len - 1, f)) > 0) {
+        len += n;
+        if (len + 1 == cap) {
+            char *bigger = realloc(doc, cap * 2);
+            if (!bigger) { free(doc); doc = NULL; break; }
+            doc = bigger;
+            cap *= 2;
+        }
+    }
     fclose(f);
+    if (doc) doc[len] = '\0';
+    return doc;
+}
+
+// Valor crudo de "key" (sin la coma final), o NULL si no está
+static char* persisted_field(const char *doc, const char *key) {
+    char needle[64];
+    snprintf(needle, sizeof(needle), "\n  \"%s\": ", key);
+    const char *start = strstr(doc, needle);
+    if (!start) return NULL;
+    start += strlen(needle);
+
+    const char *end = strchr(start, '\n');
+    if (!end) end = start + strlen(start);
+    if (end > start && end[-1] == ',') end--;
+    return strndup(start, (size_t)(end - start));
+}
+
+static long persisted_long(const char *doc, const char *key, long fallback) {
+    char *value = persisted_field(doc, key);
+    if (!value) return fallback;
+    long n = strtol(value, NULL, 10);
+    free(value);
+    return n;
 }
 
 int job_manager_init(const char *storage_dir) {
@@ -75,10 +148,15 @@ int job_manager_init(const char *storage_dir) {
         strncpy(storage_path, storage_dir, sizeof(storage_path)-1);
         storage_path[sizeof(storage_path)-1] = '\0';
     }
+    if (g_owner == 0) g_owner = (long)getpid();
     ensure_storage_dir();
     return 0;
 }
 
+void job_manager_set_owner(long owner) {
+    g_owner = owner;
+}
+
 void job_manager_shutdown() {
     // Persist all jobs
     pthread_mutex_lock(&jobs_mutex);
@@ -90,6 +168,99 @@ void job_manager_shutdown() {
     pthread_mutex_unlock(&jobs_mutex);
 }
 
+// Query del executor (key=value&...) a partir del payload {"k":"v",...}
+static char* payload_to_query(const char *payload) {
+    size_t cap = payload ? strlen(payload) + 1 : 1;
+    char *query = malloc(cap);
+    if (!query) return NULL;
+    size_t len = 0;
+    int field = 0;      // 0 = fuera de string, 1 = key, 2 = value
+    bool want_value = false;
+
+    for (const char *p = payload; p && *p; p++) {
+        if (*p == '"') {
+            if (field == 0) {
+                field = want_value ? 2 : 1;
+                if (field == 1 && len > 0) query[len++] = '&';
+            } else {
+                want_value = (field == 1);
+                if (want_value) query[len++] = '=';
+                field = 0;
+            }
+        } else if (field != 0) {
+            if (*p == '\\' && p[1]) p++;
+            query[len++] = *p;
+        }
+    }
+    query[len] = '\0';
+    return query;
+}
+
+int job_manager_recover(long owner, job_requeue_fn requeue) {
+    if (!requeue || owner <= 0) return -1;
+
+    DIR *dir = opendir(storage_path);
+    if (!dir) return -1;
+
+    int recovered = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        size_t n = strlen(de->d_name);
+        if (n <= 5 || n > 69 || strcmp(de->d_name + n - 5, ".json") != 0) continue;
+        char job_id[65];
+        memcpy(job_id, de->d_name, n - 5);
+        job_id[n - 5] = '\0';
+
+        pthread_mutex_lock(&jobs_mutex);
+        bool known = find_job_locked(job_id) != NULL;
+        pthread_mutex_unlock(&jobs_mutex);
+        if (known) continue;
+
+        char *doc = load_persisted(job_id);
+        if (!doc) continue;
+        long status = persisted_long(doc, "status", -1);
+        if ((status != JOB_STATUS_QUEUED && status != JOB_STATUS_RUNNING) ||
+            persisted_long(doc, "owner", 0) != owner) {
+            free(doc);
+            continue;
+        }
+
+        // Reconstruir la entrada en memoria: el executor marca el progreso sobre ella
+        char *task_name = persisted_field(doc, "task_name");   // Entre comillas
+        job_entry_t *job = calloc(1, sizeof(job_entry_t));
+        if (!task_name || !job || strlen(task_name) < 2) {
+            free(task_name);
+            free(job);
+            free(doc);
+            continue;
+        }
+        task_name[strlen(task_name) - 1] = '\0';
+        job->job_id = strdup_safe(job_id);
+        job->task_name = strdup_safe(task_name + 1);
+        job->payload_json = persisted_field(doc, "payload");
+        job->status = JOB_STATUS_QUEUED;
+        job->eta_ms = -1;
+        job->created_at.tv_sec = persisted_long(doc, "created_at", 0);
+        free(task_name);
+        free(doc);
+
+        pthread_mutex_lock(&jobs_mutex);
+        job->next = jobs_head;
+        jobs_head = job;
+        persist_job_locked(job);
+        pthread_mutex_unlock(&jobs_mutex);
+
+        // Si no entra en la cola queda QUEUED en disco, como en job_submit
+        char *query = payload_to_query(job->payload_json);
+        if (query && requeue(job->job_id, job->task_name, query) == 0) {
+            recovered++;
+        }
+        free(query);
+    }
+    closedir(dir);
+    return recovered;
+}
+
 char* job_submit(const char *task_name, const char *payload_json, int priority_ms_timeout __attribute__((unused))) {
     char idbuf[128];
     generate_request_id(idbuf, sizeof(idbuf));
@@ -121,7 +292,14 @@ int job_get_status(const char *job_id, job_status_info_t *out) {
     job_entry_t *job = find_job_locked(job_id);
     if (!job) {
         pthread_mutex_unlock(&jobs_mutex);
-        return -1;
+
+        char *doc = load_persisted(job_id);
+        if (!doc) return -1;
+        out->status = (job_status_t)persisted_long(doc, "status", JOB_STATUS_ERROR);
+        out->progress = (int)persisted_long(doc, "progress", 0);
+        out->eta_ms = persisted_long(doc, "eta_ms", -1);
+        free(doc);
+        return 0;
     }
     out->status = job->status;
     out->progress = job->progress;
@@ -134,7 +312,27 @@ char* job_get_result(const char *job_id) {
     if (!job_id) return NULL;
     pthread_mutex_lock(&jobs_mutex);
     job_entry_t *job = find_job_locked(job_id);
-    if (!job) { pthread_mutex_unlock(&jobs_mutex); return NULL; }
+    if (!job) {
+        pthread_mutex_unlock(&jobs_mutex);
+
+        char *doc = load_persisted(job_id);
+        if (!doc) return NULL;
+        char *res = NULL;
+        long status = persisted_long(doc, "status", -1);
+        if (status == JOB_STATUS_DONE) {
+            res = persisted_field(doc, "result");
+        } else if (status == JOB_STATUS_ERROR) {
+            char *msg = persisted_field(doc, "error");    // Ya entre comillas
+            if (msg) {
+                size_t n = strlen(msg) + 16;
+                res = malloc(n);
+                if (res) snprintf(res, n, "{\"error\": %s}", msg);
+                free(msg);
+            }
+        }
+        free(doc);
+        return res;
+    }
     char *res = NULL;
     if (job->status == JOB_STATUS_DONE && job->result_json) {
         res = strdup_safe(job->result_json);
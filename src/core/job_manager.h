@@ -29,6 +29,18 @@ int job_manager_init(const char *storage_dir);
 // Shutdown: libera recursos (no cancela trabajos en curso necesariamente)
 void job_manager_shutdown();
 
+// Re-encolar un job recuperado (ver job_manager_recover). Retorna 0 si quedó encolado.
+typedef int (*job_requeue_fn)(const char *job_id, const char *task_name, const char *query);
+
+// Dueño que se graba en cada job (default: el pid de quien llama a
+// job_manager_init). En modo prefork el master lo fija antes de fork().
+void job_manager_set_owner(long owner);
+
+// Hot restart: tomar los jobs de owner que quedaron QUEUED/RUNNING en disco
+// y re-encolarlos con requeue. Solo llamar cuando ese proceso ya no ejecuta
+// nada. Retorna cuántos se re-encolaron, -1 si error.
+int job_manager_recover(long owner, job_requeue_fn requeue);
+
 // Crear un job; 'payload_json' puede ser NULL. Retorna job_id (malloc) que el caller debe liberar.
 // El job se registra con estado QUEUED.
 char* job_submit(const char *task_name, const char *payload_json, int priority_ms_timeout);
@@ -1,182 +1,283 @@
 #include "metrics.h"
+#include "shm.h"
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <math.h>
 
-// Singleton global
-static metrics_manager_t g_metrics_manager;
+// Singleton global (en el arena compartido si existe)
+static metrics_manager_t *g_metrics = NULL;
 static bool g_metrics_initialized = false;
 
+// Identidad de este proceso en modo prefork
+static int g_proc_slot = 0;
+static bool g_proc_is_worker = false;
+
+static const char *g_phase_names[METRICS_PHASE_COUNT] = {
+    "parse", "queue", "exec", "write"
+};
+
 // ============================================================================
 // INICIALIZACIÓN
 // ============================================================================
 
+// Un worker puede morir con el mutex tomado: con un mutex robusto el
+// siguiente lock recibe EOWNERDEAD y lo recupera (los datos que protege
+// son de solo registro, no quedan inconsistentes)
+static void metrics_lock(void) {
+    if (pthread_mutex_lock(&g_metrics->mutex) == EOWNERDEAD) {
+        pthread_mutex_consistent(&g_metrics->mutex);
+    }
+}
+
+static void metrics_unlock(void) {
+    pthread_mutex_unlock(&g_metrics->mutex);
+}
+
 void metrics_init() {
     if (g_metrics_initialized) {
         return;
     }
-    
-    memset(&g_metrics_manager, 0, sizeof(metrics_manager_t));
-    pthread_mutex_init(&g_metrics_manager.mutex, NULL);
-    gettimeofday(&g_metrics_manager.start_time, NULL);
-    
+
+    g_metrics = shm_alloc(sizeof(metrics_manager_t));
+    if (!g_metrics) {
+        return;
+    }
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    if (shm_contains(g_metrics)) {
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    }
+    pthread_mutex_init(&g_metrics->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    gettimeofday(&g_metrics->start_time, NULL);
+    g_metrics->num_procs = 1;
+    g_metrics->counters = counter_set_create(METRICS_CTR_COUNT);
+
+    g_proc_slot = 0;
+    g_proc_is_worker = false;
     g_metrics_initialized = true;
 }
 
+void metrics_set_process(int slot, int num_procs) {
+    if (!g_metrics_initialized) return;
+    if (slot < 0 || slot >= METRICS_MAX_PROCS) slot = 0;
+    if (num_procs < 1) num_procs = 1;
+    if (num_procs > METRICS_MAX_PROCS) num_procs = METRICS_MAX_PROCS;
+
+    g_proc_slot = slot;
+    g_proc_is_worker = true;
+    __atomic_store_n(&g_metrics->num_procs, num_procs, __ATOMIC_RELAXED);
+
+    int n = __atomic_load_n(&g_metrics->num_commands, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        __atomic_store_n(&g_metrics->commands[i].queue_size_by_proc[slot], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&g_metrics->commands[i].busy_workers_by_proc[slot], 0, __ATOMIC_RELAXED);
+    }
+}
+
 void metrics_destroy() {
     if (!g_metrics_initialized) {
         return;
     }
-    
-    pthread_mutex_lock(&g_metrics_manager.mutex);
-    
-    // Liberar buffers de cada comando
-    for (int i = 0; i < g_metrics_manager.num_commands; i++) {
-        command_metrics_t *cmd = &g_metrics_manager.commands[i];
-        free(cmd->wait_times_ms);
-        free(cmd->exec_times_ms);
-        pthread_mutex_destroy(&cmd->mutex);
+
+    // Las métricas compartidas son del master: un worker solo se desengancha
+    if (g_proc_is_worker) {
+        g_metrics_initialized = false;
+        return;
     }
-    
-    pthread_mutex_unlock(&g_metrics_manager.mutex);
-    pthread_mutex_destroy(&g_metrics_manager.mutex);
-    
+
+    metrics_lock();
+
+    // Liberar histogramas de cada comando
+    for (int i = 0; i < g_metrics->num_commands; i++) {
+        command_metrics_t *cmd = &g_metrics->commands[i];
+        for (int p = 0; p < METRICS_PHASE_COUNT; p++) {
+            histogram_destroy(cmd->phases[p]);
+            cmd->phases[p] = NULL;
+        }
+        window_destroy(cmd->window);
+        cmd->window = NULL;
+    }
+
+    counter_set_destroy(g_metrics->counters);
+    g_metrics->counters = NULL;
+
+    metrics_unlock();
+    pthread_mutex_destroy(&g_metrics->mutex);
+
+    shm_free(g_metrics);
+    g_metrics = NULL;
     g_metrics_initialized = false;
 }
 
 int metrics_register_command(const char *command_name, int num_workers,
                              int queue_capacity, int buffer_size) {
+    (void)buffer_size;
+
     if (!g_metrics_initialized) {
         metrics_init();
+        if (!g_metrics_initialized) return -1;
     }
-    
-    pthread_mutex_lock(&g_metrics_manager.mutex);
-    
+
+    metrics_lock();
+
     // Verificar si ya existe
-    for (int i = 0; i < g_metrics_manager.num_commands; i++) {
-        if (strcmp(g_metrics_manager.commands[i].command_name, command_name) == 0) {
-            pthread_mutex_unlock(&g_metrics_manager.mutex);
+    for (int i = 0; i < g_metrics->num_commands; i++) {
+        if (strcmp(g_metrics->commands[i].command_name, command_name) == 0) {
+            metrics_unlock();
             return i; // Ya registrado
         }
     }
-    
+
     // Verificar límite
-    if (g_metrics_manager.num_commands >= MAX_COMMANDS) {
-        pthread_mutex_unlock(&g_metrics_manager.mutex);
+    if (g_metrics->num_commands >= MAX_COMMANDS) {
+        metrics_unlock();
         return -1;
     }
-    
-    int idx = g_metrics_manager.num_commands++;
-    command_metrics_t *cmd = &g_metrics_manager.commands[idx];
-    
+
+    int idx = g_metrics->num_commands;
+    command_metrics_t *cmd = &g_metrics->commands[idx];
+
     // Inicializar
+    memset(cmd, 0, sizeof(*cmd));
     strncpy(cmd->command_name, command_name, sizeof(cmd->command_name) - 1);
-    cmd->total_wait_time_us = 0;
-    cmd->total_exec_time_us = 0;
-    cmd->count = 0;
-    
-    cmd->buffer_size = buffer_size;
-    cmd->buffer_index = 0;
-    cmd->buffer_count = 0;
-    cmd->wait_times_ms = (double*)calloc(buffer_size, sizeof(double));
-    cmd->exec_times_ms = (double*)calloc(buffer_size, sizeof(double));
+
+    bool ok = true;
+    for (int p = 0; p < METRICS_PHASE_COUNT; p++) {
+        cmd->phases[p] = histogram_create();
+        ok = ok && cmd->phases[p];
+    }
+    cmd->window = window_create();
+    ok = ok && cmd->window;
     
-    cmd->current_queue_size = 0;
+    if (!ok) {
+        for (int p = 0; p < METRICS_PHASE_COUNT; p++) {
+            histogram_destroy(cmd->phases[p]);
+            cmd->phases[p] = NULL;
+        }
+        window_destroy(cmd->window);
+        cmd->window = NULL;
+        metrics_unlock();
+        return -1;
+    }
+
     cmd->max_queue_size = queue_capacity;
-    
     cmd->total_workers = num_workers;
-    cmd->busy_workers = 0;
-    
-    pthread_mutex_init(&cmd->mutex, NULL);
-    
-    pthread_mutex_unlock(&g_metrics_manager.mutex);
-    
+
+    // Publicar el comando: los lectores sin lock leen num_commands con acquire
+    __atomic_store_n(&g_metrics->num_commands, idx + 1, __ATOMIC_RELEASE);
+
+    metrics_unlock();
+
     return idx;
 }
 
+int metrics_command_count(void) {
+    if (!g_metrics_initialized) return 0;
+    return __atomic_load_n(&g_metrics->num_commands, __ATOMIC_RELAXED);
+}
+
 // ============================================================================
 // HELPERS INTERNOS
 // ============================================================================
 
 static command_metrics_t* find_command(const char *command_name) {
-    for (int i = 0; i < g_metrics_manager.num_commands; i++) {
-        if (strcmp(g_metrics_manager.commands[i].command_name, command_name) == 0) {
-            return &g_metrics_manager.commands[i];
+    if (!command_name || !g_metrics) return NULL;
+
+    int n = __atomic_load_n(&g_metrics->num_commands, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(g_metrics->commands[i].command_name, command_name) == 0) {
+            return &g_metrics->commands[i];
         }
     }
     return NULL;
 }
 
+const char* metrics_command_from_path(const char *path) {
+    if (!path) return "";
+    return (path[0] == '/') ? path + 1 : path;
+}
+
 // ============================================================================
 // REGISTRO DE MÉTRICAS
 // ============================================================================
 
-void metrics_record_wait_time(const char *command_name, unsigned long wait_time_us) {
+void metrics_record_phase(const char *command_name, metrics_phase_t phase,
+                          unsigned long duration_us) {
+    if (phase < 0 || phase >= METRICS_PHASE_COUNT) return;
+
     command_metrics_t *cmd = find_command(command_name);
     if (!cmd) return;
-    
-    pthread_mutex_lock(&cmd->mutex);
-    
-    cmd->total_wait_time_us += wait_time_us;
-    cmd->count++;
-    
-    // Agregar al buffer circular
-    double wait_ms = wait_time_us / 1000.0;
-    cmd->wait_times_ms[cmd->buffer_index] = wait_ms;
-    
-    cmd->buffer_index = (cmd->buffer_index + 1) % cmd->buffer_size;
-    if (cmd->buffer_count < cmd->buffer_size) {
-        cmd->buffer_count++;
+
+    histogram_record(cmd->phases[phase], duration_us);
+
+    if (phase == METRICS_PHASE_QUEUE) {
+        __atomic_fetch_add(&cmd->total_wait_time_us, duration_us, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&cmd->count, 1, __ATOMIC_RELAXED);
+    } else if (phase == METRICS_PHASE_EXEC) {
+        __atomic_fetch_add(&cmd->total_exec_time_us, duration_us, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&cmd->exec_count, 1, __ATOMIC_RELAXED);
     }
-    
-    pthread_mutex_unlock(&cmd->mutex);
 }
 
-void metrics_record_exec_time(const char *command_name, unsigned long exec_time_us) {
+void metrics_record_request(const char *command_name, unsigned long latency_us,
+                            bool is_error) {
     command_metrics_t *cmd = find_command(command_name);
     if (!cmd) return;
-    
-    pthread_mutex_lock(&cmd->mutex);
-    
-    cmd->total_exec_time_us += exec_time_us;
-    
-    // Agregar al buffer circular
-    double exec_ms = exec_time_us / 1000.0;
-    int idx = (cmd->buffer_index - 1 + cmd->buffer_size) % cmd->buffer_size;
-    cmd->exec_times_ms[idx] = exec_ms;
-    
-    pthread_mutex_unlock(&cmd->mutex);
+
+    window_record(cmd->window, latency_us, is_error);
+}
+
+void metrics_record_wait_time(const char *command_name, unsigned long wait_time_us) {
+    metrics_record_phase(command_name, METRICS_PHASE_QUEUE, wait_time_us);
+}
+
+void metrics_record_exec_time(const char *command_name, unsigned long exec_time_us) {
+    metrics_record_phase(command_name, METRICS_PHASE_EXEC, exec_time_us);
 }
 
 void metrics_update_queue_size(const char *command_name, int queue_size) {
     command_metrics_t *cmd = find_command(command_name);
     if (!cmd) return;
-    
-    pthread_mutex_lock(&cmd->mutex);
-    cmd->current_queue_size = queue_size;
-    pthread_mutex_unlock(&cmd->mutex);
+
+    __atomic_store_n(&cmd->queue_size_by_proc[g_proc_slot], queue_size, __ATOMIC_RELAXED);
 }
 
 void metrics_update_workers(const char *command_name, int busy_count) {
     command_metrics_t *cmd = find_command(command_name);
     if (!cmd) return;
-    
-    pthread_mutex_lock(&cmd->mutex);
-    cmd->busy_workers = busy_count;
-    pthread_mutex_unlock(&cmd->mutex);
+
+    __atomic_store_n(&cmd->busy_workers_by_proc[g_proc_slot], busy_count, __ATOMIC_RELAXED);
+}
+
+void metrics_adjust_queue_size(const char *command_name, int delta) {
+    command_metrics_t *cmd = find_command(command_name);
+    if (!cmd) return;
+
+    __atomic_add_fetch(&cmd->queue_size_by_proc[g_proc_slot], delta, __ATOMIC_RELAXED);
+}
+
+void metrics_adjust_workers(const char *command_name, int delta) {
+    command_metrics_t *cmd = find_command(command_name);
+    if (!cmd) return;
+
+    __atomic_add_fetch(&cmd->busy_workers_by_proc[g_proc_slot], delta, __ATOMIC_RELAXED);
 }
 
 void metrics_increment_requests() {
-    pthread_mutex_lock(&g_metrics_manager.mutex);
-    g_metrics_manager.total_requests++;
-    pthread_mutex_unlock(&g_metrics_manager.mutex);
+    if (!g_metrics) return;
+    counter_set_add(g_metrics->counters, METRICS_CTR_REQUESTS, 1);
 }
 
 void metrics_increment_errors() {
-    pthread_mutex_lock(&g_metrics_manager.mutex);
-    g_metrics_manager.total_errors++;
-    pthread_mutex_unlock(&g_metrics_manager.mutex);
+    if (!g_metrics) return;
+    counter_set_add(g_metrics->counters, METRICS_CTR_ERRORS, 1);
 }
 
 // ============================================================================
@@ -184,204 +285,439 @@ void metrics_increment_errors() {
 // ============================================================================
 
 int metrics_get_command(const char *command_name, command_metrics_t *metrics) {
+    command_metrics_t *cmd = find_command(command_name);
+    if (!cmd || !metrics) return -1;
+
+    memcpy(metrics->command_name, cmd->command_name, sizeof(metrics->command_name));
+    metrics->total_wait_time_us = __atomic_load_n(&cmd->total_wait_time_us, __ATOMIC_RELAXED);
+    metrics->total_exec_time_us = __atomic_load_n(&cmd->total_exec_time_us, __ATOMIC_RELAXED);
+    metrics->count = __atomic_load_n(&cmd->count, __ATOMIC_RELAXED);
+    metrics->exec_count = __atomic_load_n(&cmd->exec_count, __ATOMIC_RELAXED);
+    for (int p = 0; p < METRICS_PHASE_COUNT; p++) {
+        metrics->phases[p] = cmd->phases[p];
+    }
+    metrics->window = cmd->window;
+    metrics->max_queue_size = cmd->max_queue_size;
+
+    // Gauges: suma de los procesos (cada uno con sus propios pools)
+    int procs = __atomic_load_n(&g_metrics->num_procs, __ATOMIC_RELAXED);
+    int queue_size = 0, busy = 0;
+    for (int p = 0; p < procs; p++) {
+        queue_size += __atomic_load_n(&cmd->queue_size_by_proc[p], __ATOMIC_RELAXED);
+        busy += __atomic_load_n(&cmd->busy_workers_by_proc[p], __ATOMIC_RELAXED);
+    }
+    metrics->current_queue_size = queue_size;
+    metrics->total_workers = cmd->total_workers * procs;
+    metrics->busy_workers = busy;
+
+    return 0;
+}
+
+int metrics_get_phase_summary(const char *command_name, metrics_phase_t phase,
+                              histogram_summary_t *out) {
+    if (phase < 0 || phase >= METRICS_PHASE_COUNT || !out) return -1;
+
     command_metrics_t *cmd = find_command(command_name);
     if (!cmd) return -1;
-    
-    pthread_mutex_lock(&cmd->mutex);
-    memcpy(metrics, cmd, sizeof(command_metrics_t));
-    pthread_mutex_unlock(&cmd->mutex);
-    
+
+    histogram_summarize(cmd->phases[phase], out);
+    return 0;
+}
+
+int metrics_get_window(const char *command_name, int seconds, window_summary_t *out) {
+    if (!out) return -1;
+
+    command_metrics_t *cmd = find_command(command_name);
+    if (!cmd) return -1;
+
+    window_summarize(cmd->window, seconds, out);
     return 0;
 }
 
 double metrics_get_avg_wait_time_ms(const char *command_name) {
     command_metrics_t *cmd = find_command(command_name);
     if (!cmd) return -1.0;
-    
-    pthread_mutex_lock(&cmd->mutex);
-    
-    if (cmd->count == 0) {
-        pthread_mutex_unlock(&cmd->mutex);
+
+    unsigned long count = __atomic_load_n(&cmd->count, __ATOMIC_RELAXED);
+    if (count == 0) {
         return 0.0;
     }
-    
-    double avg = (double)cmd->total_wait_time_us / (double)cmd->count / 1000.0;
-    
-    pthread_mutex_unlock(&cmd->mutex);
-    return avg;
+
+    unsigned long total = __atomic_load_n(&cmd->total_wait_time_us, __ATOMIC_RELAXED);
+    return (double)total / (double)count / 1000.0;
 }
 
 double metrics_get_avg_exec_time_ms(const char *command_name) {
     command_metrics_t *cmd = find_command(command_name);
     if (!cmd) return -1.0;
-    
-    pthread_mutex_lock(&cmd->mutex);
-    
-    if (cmd->count == 0) {
-        pthread_mutex_unlock(&cmd->mutex);
+
+    unsigned long count = __atomic_load_n(&cmd->exec_count, __ATOMIC_RELAXED);
+    if (count == 0) {
         return 0.0;
     }
-    
-    double avg = (double)cmd->total_exec_time_us / (double)cmd->count / 1000.0;
-    
-    pthread_mutex_unlock(&cmd->mutex);
-    return avg;
+
+    unsigned long total = __atomic_load_n(&cmd->total_exec_time_us, __ATOMIC_RELAXED);
+    return (double)total / (double)count / 1000.0;
 }
 
 double calculate_stddev(double *values, int count, double mean) {
     if (count == 0) return 0.0;
-    
+
     double sum_sq_diff = 0.0;
     for (int i = 0; i < count; i++) {
         double diff = values[i] - mean;
         sum_sq_diff += diff * diff;
     }
-    
+
     return sqrt(sum_sq_diff / count);
 }
 
-double metrics_get_stddev_wait_time_ms(const char *command_name) {
-    command_metrics_t *cmd = find_command(command_name);
-    if (!cmd) return -1.0;
-    
-    pthread_mutex_lock(&cmd->mutex);
-    
-    if (cmd->buffer_count == 0) {
-        pthread_mutex_unlock(&cmd->mutex);
-        return 0.0;
-    }
-    
-    // Calcular media
-    double sum = 0.0;
-    for (int i = 0; i < cmd->buffer_count; i++) {
-        sum += cmd->wait_times_ms[i];
+// La desviación estándar sale del histograma: costo fijo (HIST_BUCKETS),
+// independiente de cuántas muestras se registraron.
+static double phase_stddev_ms(const char *command_name, metrics_phase_t phase) {
+    histogram_summary_t summary;
+    if (metrics_get_phase_summary(command_name, phase, &summary) != 0) {
+        return -1.0;
     }
-    double mean = sum / cmd->buffer_count;
-    
-    // Calcular desviación estándar
-    double stddev = calculate_stddev(cmd->wait_times_ms, cmd->buffer_count, mean);
-    
-    pthread_mutex_unlock(&cmd->mutex);
-    return stddev;
+    return summary.stddev / 1000.0;
+}
+
+double metrics_get_stddev_wait_time_ms(const char *command_name) {
+    return phase_stddev_ms(command_name, METRICS_PHASE_QUEUE);
 }
 
 double metrics_get_stddev_exec_time_ms(const char *command_name) {
-    command_metrics_t *cmd = find_command(command_name);
-    if (!cmd) return -1.0;
-    
-    pthread_mutex_lock(&cmd->mutex);
-    
-    if (cmd->buffer_count == 0) {
-        pthread_mutex_unlock(&cmd->mutex);
-        return 0.0;
-    }
-    
-    // Calcular media
-    double sum = 0.0;
-    for (int i = 0; i < cmd->buffer_count; i++) {
-        sum += cmd->exec_times_ms[i];
-    }
-    double mean = sum / cmd->buffer_count;
-    
-    // Calcular desviación estándar
-    double stddev = calculate_stddev(cmd->exec_times_ms, cmd->buffer_count, mean);
-    
-    pthread_mutex_unlock(&cmd->mutex);
-    return stddev;
+    return phase_stddev_ms(command_name, METRICS_PHASE_EXEC);
 }
 
 // ============================================================================
 // GENERACIÓN DE JSON
 // ============================================================================
 
+// Agregar texto formateado al buffer. El offset siempre avanza el largo
+// completo (como snprintf), aunque el buffer ya esté lleno.
+static void json_appendf(char *buffer, size_t buffer_size, size_t *offset,
+                         const char *fmt, ...) {
+    char *dst = NULL;
+    size_t avail = 0;
+    if (*offset < buffer_size) {
+        dst = buffer + *offset;
+        avail = buffer_size - *offset;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(dst, avail, fmt, args);
+    va_end(args);
+
+    if (n > 0) {
+        *offset += (size_t)n;
+    }
+}
+
 int metrics_get_json(char *buffer, size_t buffer_size) {
-    if (!buffer || buffer_size == 0) return -1;
-    
-    int offset = 0;
-    
+    if (!buffer || buffer_size == 0 || !g_metrics) return -1;
+
+    size_t offset = 0;
+
     // Inicio del JSON
-    offset += snprintf(buffer + offset, buffer_size - offset, "{\n");
-    
+    json_appendf(buffer, buffer_size, &offset, "{\n");
+
     // Métricas globales
-    pthread_mutex_lock(&g_metrics_manager.mutex);
-    
+    metrics_lock();
+
     struct timeval now;
     gettimeofday(&now, NULL);
-    long uptime = now.tv_sec - g_metrics_manager.start_time.tv_sec;
-    
-    offset += snprintf(buffer + offset, buffer_size - offset,
-                      "  \"uptime_seconds\": %ld,\n"
-                      "  \"total_requests\": %lu,\n"
-                      "  \"total_errors\": %lu,\n",
-                      uptime,
-                      g_metrics_manager.total_requests,
-                      g_metrics_manager.total_errors);
-    
+    long uptime = now.tv_sec - g_metrics->start_time.tv_sec;
+
+    json_appendf(buffer, buffer_size, &offset,
+                 "  \"uptime_seconds\": %ld,\n"
+                 "  \"total_requests\": %lu,\n"
+                 "  \"total_errors\": %lu,\n",
+                 uptime,
+                 (unsigned long)counter_set_read(g_metrics->counters, METRICS_CTR_REQUESTS),
+                 (unsigned long)counter_set_read(g_metrics->counters, METRICS_CTR_ERRORS));
+
     // Métricas por comando
-    offset += snprintf(buffer + offset, buffer_size - offset, "  \"commands\": {\n");
-    
-    for (int i = 0; i < g_metrics_manager.num_commands; i++) {
-        command_metrics_t *cmd = &g_metrics_manager.commands[i];
-        
-        pthread_mutex_lock(&cmd->mutex);
-        
-        double avg_wait = cmd->count > 0 ? 
-                         (double)cmd->total_wait_time_us / cmd->count / 1000.0 : 0.0;
-        double avg_exec = cmd->count > 0 ?
-                         (double)cmd->total_exec_time_us / cmd->count / 1000.0 : 0.0;
-        
-        // Calcular stddev
-        double stddev_wait = 0.0, stddev_exec = 0.0;
-        if (cmd->buffer_count > 0) {
-            double sum_wait = 0.0, sum_exec = 0.0;
-            for (int j = 0; j < cmd->buffer_count; j++) {
-                sum_wait += cmd->wait_times_ms[j];
-                sum_exec += cmd->exec_times_ms[j];
-            }
-            double mean_wait = sum_wait / cmd->buffer_count;
-            double mean_exec = sum_exec / cmd->buffer_count;
-            
-            stddev_wait = calculate_stddev(cmd->wait_times_ms, cmd->buffer_count, mean_wait);
-            stddev_exec = calculate_stddev(cmd->exec_times_ms, cmd->buffer_count, mean_exec);
+    json_appendf(buffer, buffer_size, &offset, "  \"commands\": {\n");
+
+    for (int i = 0; i < g_metrics->num_commands; i++) {
+        command_metrics_t cmd;
+        metrics_get_command(g_metrics->commands[i].command_name, &cmd);
+
+        histogram_summary_t phases[METRICS_PHASE_COUNT];
+        for (int p = 0; p < METRICS_PHASE_COUNT; p++) {
+            histogram_summarize(cmd.phases[p], &phases[p]);
         }
-        
-        offset += snprintf(buffer + offset, buffer_size - offset,
-                          "    \"%s\": {\n"
-                          "      \"count\": %lu,\n"
-                          "      \"avg_wait_ms\": %.2f,\n"
-                          "      \"stddev_wait_ms\": %.2f,\n"
-                          "      \"avg_exec_ms\": %.2f,\n"
-                          "      \"stddev_exec_ms\": %.2f,\n"
-                          "      \"queue_size\": %d,\n"
-                          "      \"queue_capacity\": %d,\n"
-                          "      \"workers\": {\n"
-                          "        \"total\": %d,\n"
-                          "        \"busy\": %d,\n"
-                          "        \"idle\": %d\n"
-                          "      }\n"
-                          "    }%s\n",
-                          cmd->command_name,
-                          cmd->count,
-                          avg_wait,
-                          stddev_wait,
-                          avg_exec,
-                          stddev_exec,
-                          cmd->current_queue_size,
-                          cmd->max_queue_size,
-                          cmd->total_workers,
-                          cmd->busy_workers,
-                          cmd->total_workers - cmd->busy_workers,
-                          (i < g_metrics_manager.num_commands - 1) ? "," : "");
-        
-        pthread_mutex_unlock(&cmd->mutex);
+
+        double avg_wait = cmd.count > 0 ?
+                         (double)cmd.total_wait_time_us / cmd.count / 1000.0 : 0.0;
+        double avg_exec = cmd.exec_count > 0 ?
+                         (double)cmd.total_exec_time_us / cmd.exec_count / 1000.0 : 0.0;
+
+        json_appendf(buffer, buffer_size, &offset,
+                     "    \"%s\": {\n"
+                     "      \"count\": %lu,\n"
+                     "      \"avg_wait_ms\": %.2f,\n"
+                     "      \"stddev_wait_ms\": %.2f,\n"
+                     "      \"avg_exec_ms\": %.2f,\n"
+                     "      \"stddev_exec_ms\": %.2f,\n"
+                     "      \"queue_size\": %d,\n"
+                     "      \"queue_capacity\": %d,\n"
+                     "      \"workers\": {\n"
+                     "        \"total\": %d,\n"
+                     "        \"busy\": %d,\n"
+                     "        \"idle\": %d\n"
+                     "      },\n"
+                     "      \"latency_us\": {\n",
+                     cmd.command_name,
+                     cmd.count,
+                     avg_wait,
+                     phases[METRICS_PHASE_QUEUE].stddev / 1000.0,
+                     avg_exec,
+                     phases[METRICS_PHASE_EXEC].stddev / 1000.0,
+                     cmd.current_queue_size,
+                     cmd.max_queue_size,
+                     cmd.total_workers,
+                     cmd.busy_workers,
+                     cmd.total_workers - cmd.busy_workers);
+
+        for (int p = 0; p < METRICS_PHASE_COUNT; p++) {
+            const histogram_summary_t *h = &phases[p];
+            json_appendf(buffer, buffer_size, &offset,
+                         "        \"%s\": {\"count\": %llu, \"p50\": %llu, \"p90\": %llu, "
+                         "\"p99\": %llu, \"p999\": %llu, \"max\": %llu}%s\n",
+                         g_phase_names[p],
+                         (unsigned long long)h->count,
+                         (unsigned long long)h->p50,
+                         (unsigned long long)h->p90,
+                         (unsigned long long)h->p99,
+                         (unsigned long long)h->p999,
+                         (unsigned long long)h->max,
+                         (p < METRICS_PHASE_COUNT - 1) ? "," : "");
+        }
+
+        json_appendf(buffer, buffer_size, &offset,
+                     "      }\n"
+                     "    }%s\n",
+                     (i < g_metrics->num_commands - 1) ? "," : "");
     }
-    
-    offset += snprintf(buffer + offset, buffer_size - offset, "  }\n");
-    
-    pthread_mutex_unlock(&g_metrics_manager.mutex);
-    
+
+    json_appendf(buffer, buffer_size, &offset, "  }\n");
+
+    metrics_unlock();
+
     // Fin del JSON
-    offset += snprintf(buffer + offset, buffer_size - offset, "}\n");
-    
-    return offset;
-}
\ No newline at end of file
+    json_appendf(buffer, buffer_size, &offset, "}\n");
+
+    return (int)offset;
+}
+
+int metrics_get_window_json(char *buffer, size_t buffer_size, int window_seconds) {
+    if (!buffer || buffer_size == 0 || !g_metrics) return -1;
+
+    int n = __atomic_load_n(&g_metrics->num_commands, __ATOMIC_ACQUIRE);
+    window_summary_t *summaries = calloc(n > 0 ? (size_t)n : 1, sizeof(window_summary_t));
+    if (!summaries) return -1;
+
+    // Primero todos los resúmenes, para poder emitir el total antes que el detalle
+    uint64_t total_requests = 0, total_errors = 0;
+    for (int i = 0; i < n; i++) {
+        window_summarize(g_metrics->commands[i].window, window_seconds, &summaries[i]);
+        total_requests += summaries[i].requests;
+        total_errors += summaries[i].errors;
+    }
+    int seconds = window_seconds < 1 ? 1 :
+                  (window_seconds > WINDOW_MAX_SECONDS ? WINDOW_MAX_SECONDS : window_seconds);
+
+    size_t offset = 0;
+    json_appendf(buffer, buffer_size, &offset,
+                 "{\n"
+                 "  \"window_seconds\": %d,\n"
+                 "  \"total\": {\n"
+                 "    \"requests\": %llu,\n"
+                 "    \"errors\": %llu,\n"
+                 "    \"requests_per_sec\": %.2f,\n"
+                 "    \"errors_per_sec\": %.2f,\n"
+                 "    \"error_rate\": %.4f\n"
+                 "  },\n"
+                 "  \"commands\": {\n",
+                 seconds,
+                 (unsigned long long)total_requests,
+                 (unsigned long long)total_errors,
+                 (double)total_requests / seconds,
+                 (double)total_errors / seconds,
+                 total_requests > 0 ? (double)total_errors / (double)total_requests : 0.0);
+
+    for (int i = 0; i < n; i++) {
+        const window_summary_t *w = &summaries[i];
+        json_appendf(buffer, buffer_size, &offset,
+                     "    \"%s\": {\"requests\": %llu, \"errors\": %llu, "
+                     "\"requests_per_sec\": %.2f, \"errors_per_sec\": %.2f, \"error_rate\": %.4f, "
+                     "\"latency_us\": {\"mean\": %.1f, \"p50\": %llu, \"p90\": %llu, "
+                     "\"p99\": %llu, \"p999\": %llu}}%s\n",
+                     g_metrics->commands[i].command_name,
+                     (unsigned long long)w->requests,
+                     (unsigned long long)w->errors,
+                     w->requests_per_sec,
+                     w->errors_per_sec,
+                     w->error_rate,
+                     w->mean_us,
+                     (unsigned long long)w->p50,
+                     (unsigned long long)w->p90,
+                     (unsigned long long)w->p99,
+                     (unsigned long long)w->p999,
+                     (i < n - 1) ? "," : "");
+    }
+
+    json_appendf(buffer, buffer_size, &offset, "  }\n}\n");
+
+    free(summaries);
+    return (int)offset;
+}
+
+// ============================================================================
+// EXPOSICIÓN PROMETHEUS
+// ============================================================================
+
+// Límites de los buckets exportados. Los buckets internos son log-lineales y
+// no coinciden con estos límites: cada límite cuenta los buckets internos
+// cuyo máximo no lo supera (error <= 1/HIST_SUB_BUCKETS, igual que los percentiles).
+static const struct {
+    uint64_t us;
+    const char *le;
+} g_prom_buckets[] = {
+    { 50, "0.00005" }, { 100, "0.0001" }, { 250, "0.00025" }, { 500, "0.0005" },
+    { 1000, "0.001" }, { 2500, "0.0025" }, { 5000, "0.005" }, { 10000, "0.01" },
+    { 25000, "0.025" }, { 50000, "0.05" }, { 100000, "0.1" }, { 250000, "0.25" },
+    { 500000, "0.5" }, { 1000000, "1" }, { 2500000, "2.5" }, { 5000000, "5" },
+    { 10000000, "10" }, { 30000000, "30" }, { 60000000, "60" },
+};
+
+static void emitf(metrics_emit_fn emit, void *ctx, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+static void emitf(metrics_emit_fn emit, void *ctx, const char *fmt, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if (n <= 0) return;
+    if ((size_t)n >= sizeof(line)) n = sizeof(line) - 1;
+    emit(ctx, line, (size_t)n);
+}
+
+static void emit_phase_histogram(metrics_emit_fn emit, void *ctx,
+                                 const char *command, metrics_phase_t phase,
+                                 const histogram_t *h, uint64_t *counts) {
+    uint64_t total = histogram_merge(h, counts);
+    uint64_t sum_us = histogram_sum(h);
+
+    uint64_t cumulative = 0;
+    int i = 0;
+    for (size_t b = 0; b < sizeof(g_prom_buckets) / sizeof(g_prom_buckets[0]); b++) {
+        while (i < HIST_BUCKETS && histogram_bucket_upper(i) <= g_prom_buckets[b].us) {
+            cumulative += counts[i++];
+        }
+        emitf(emit, ctx,
+              "http_server_command_phase_seconds_bucket{command=\"%s\",phase=\"%s\",le=\"%s\"} %llu\n",
+              command, g_phase_names[phase], g_prom_buckets[b].le,
+              (unsigned long long)cumulative);
+    }
+    emitf(emit, ctx,
+          "http_server_command_phase_seconds_bucket{command=\"%s\",phase=\"%s\",le=\"+Inf\"} %llu\n",
+          command, g_phase_names[phase], (unsigned long long)total);
+    emitf(emit, ctx,
+          "http_server_command_phase_seconds_sum{command=\"%s\",phase=\"%s\"} %.6f\n",
+          command, g_phase_names[phase], (double)sum_us / 1e6);
+    emitf(emit, ctx,
+          "http_server_command_phase_seconds_count{command=\"%s\",phase=\"%s\"} %llu\n",
+          command, g_phase_names[phase], (unsigned long long)total);
+}
+
+int metrics_write_prometheus(metrics_emit_fn emit, void *ctx) {
+    if (!emit || !g_metrics_initialized) return -1;
+
+    // Snapshot de los valores escalares (sin locks: todo son atómicos)
+    int n = __atomic_load_n(&g_metrics->num_commands, __ATOMIC_ACQUIRE);
+    command_metrics_t *snap = calloc(n > 0 ? (size_t)n : 1, sizeof(command_metrics_t));
+    uint64_t *counts = malloc(sizeof(uint64_t) * HIST_BUCKETS);
+    if (!snap || !counts) {
+        free(snap);
+        free(counts);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        metrics_get_command(g_metrics->commands[i].command_name, &snap[i]);
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    emitf(emit, ctx,
+          "# HELP http_server_uptime_seconds Seconds since the metrics system started.\n"
+          "# TYPE http_server_uptime_seconds gauge\n"
+          "http_server_uptime_seconds %ld\n",
+          (long)(now.tv_sec - g_metrics->start_time.tv_sec));
+    emitf(emit, ctx,
+          "# HELP http_server_requests_total Requests answered by the router.\n"
+          "# TYPE http_server_requests_total counter\n"
+          "http_server_requests_total %llu\n",
+          (unsigned long long)counter_set_read(g_metrics->counters, METRICS_CTR_REQUESTS));
+    emitf(emit, ctx,
+          "# HELP http_server_errors_total Requests that failed before a response was sent.\n"
+          "# TYPE http_server_errors_total counter\n"
+          "http_server_errors_total %llu\n",
+          (unsigned long long)counter_set_read(g_metrics->counters, METRICS_CTR_ERRORS));
+
+    emitf(emit, ctx,
+          "# HELP http_server_command_executions_total Executions per command.\n"
+          "# TYPE http_server_command_executions_total counter\n");
+    for (int i = 0; i < n; i++) {
+        emitf(emit, ctx, "http_server_command_executions_total{command=\"%s\"} %lu\n",
+              snap[i].command_name, snap[i].exec_count);
+    }
+
+    emitf(emit, ctx,
+          "# HELP http_server_command_queue_size Tasks waiting in the queue.\n"
+          "# TYPE http_server_command_queue_size gauge\n");
+    for (int i = 0; i < n; i++) {
+        emitf(emit, ctx, "http_server_command_queue_size{command=\"%s\"} %d\n",
+              snap[i].command_name, snap[i].current_queue_size);
+    }
+
+    emitf(emit, ctx,
+          "# HELP http_server_command_queue_capacity Queue capacity per command.\n"
+          "# TYPE http_server_command_queue_capacity gauge\n");
+    for (int i = 0; i < n; i++) {
+        emitf(emit, ctx, "http_server_command_queue_capacity{command=\"%s\"} %d\n",
+              snap[i].command_name, snap[i].max_queue_size);
+    }
+
+    emitf(emit, ctx,
+          "# HELP http_server_command_workers Workers per command by state.\n"
+          "# TYPE http_server_command_workers gauge\n");
+    for (int i = 0; i < n; i++) {
+        emitf(emit, ctx,
+              "http_server_command_workers{command=\"%s\",state=\"busy\"} %d\n"
+              "http_server_command_workers{command=\"%s\",state=\"idle\"} %d\n",
+              snap[i].command_name, snap[i].busy_workers,
+              snap[i].command_name, snap[i].total_workers - snap[i].busy_workers);
+    }
+
+    emitf(emit, ctx,
+          "# HELP http_server_command_phase_seconds Request latency per command and phase.\n"
+          "# TYPE http_server_command_phase_seconds histogram\n");
+    for (int i = 0; i < n; i++) {
+        for (int p = 0; p < METRICS_PHASE_COUNT; p++) {
+            emit_phase_histogram(emit, ctx, snap[i].command_name, (metrics_phase_t)p,
+                                 snap[i].phases[p], counts);
+        }
+    }
+
+    free(counts);
+    free(snap);
+    return 0;
+}
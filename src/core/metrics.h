@@ -4,25 +4,47 @@
 #include <pthread.h>
 #include <sys/time.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "histogram.h"
+#include "counters.h"
+#include "window.h"
+
+// ============================================================================
+// FASES DE UNA REQUEST
+// ============================================================================
+
+// Cada request se mide por fases; cada fase tiene su propio histograma
+typedef enum {
+    METRICS_PHASE_PARSE = 0,        // Parseo del request HTTP
+    METRICS_PHASE_QUEUE,            // Espera (accept -> thread, o enqueue -> dequeue)
+    METRICS_PHASE_EXEC,             // Ejecución del handler del comando
+    METRICS_PHASE_WRITE,            // Escritura de la respuesta al socket
+    METRICS_PHASE_COUNT
+} metrics_phase_t;
 
 // ============================================================================
 // COMMAND METRICS - Métricas por comando
 // ============================================================================
 
+// Todos los campos numéricos se actualizan con atómicos: registrar una
+// medición nunca toma un mutex.
+
+#define METRICS_MAX_PROCS 64        // Workers en modo prefork
+
 typedef struct {
     char command_name[64];          // Nombre del comando (ej: "isprime")
     
     // Métricas de tiempo (en microsegundos)
     unsigned long total_wait_time_us;     // Tiempo total en cola
     unsigned long total_exec_time_us;     // Tiempo total de ejecución
-    unsigned long count;                   // Número de ejecuciones
+    unsigned long count;                   // Número de ejecuciones (muestras de espera)
+    unsigned long exec_count;              // Muestras de ejecución
+    
+    // Histogramas de latencia por fase (percentiles, máximo, stddev)
+    histogram_t *phases[METRICS_PHASE_COUNT];
     
-    // Arrays para calcular desviación estándar (últimas N mediciones)
-    double *wait_times_ms;          // Circular buffer de tiempos de espera
-    double *exec_times_ms;          // Circular buffer de tiempos de ejecución
-    int buffer_size;                // Tamaño del buffer (ej: 1000)
-    int buffer_index;               // Índice actual en buffer circular
-    int buffer_count;               // Cuántos elementos hay (max = buffer_size)
+    // Requests, errores y latencia de los últimos 60 s (por segundo)
+    rolling_window_t *window;
     
     // Métricas de cola
     int current_queue_size;         // Tamaño actual de la cola
@@ -32,8 +54,10 @@ typedef struct {
     int total_workers;              // Total de workers para este comando
     int busy_workers;               // Workers actualmente ocupados
     
-    // Thread safety
-    pthread_mutex_t mutex;
+    // Gauges por proceso (modo prefork): cada proceso escribe su slot y
+    // metrics_get_command() devuelve la suma en current_queue_size/busy_workers
+    int queue_size_by_proc[METRICS_MAX_PROCS];
+    int busy_workers_by_proc[METRICS_MAX_PROCS];
     
 } command_metrics_t;
 
@@ -43,15 +67,24 @@ typedef struct {
 
 #define MAX_COMMANDS 32
 
+// Campos del counter_set_t global
+enum {
+    METRICS_CTR_REQUESTS = 0,
+    METRICS_CTR_ERRORS,
+    METRICS_CTR_COUNT
+};
+
+// Con un arena de shm activo (ver shm.h) el manager entero vive en memoria
+// compartida y su mutex es PTHREAD_PROCESS_SHARED y robusto.
 typedef struct {
     command_metrics_t commands[MAX_COMMANDS];
     int num_commands;
+    int num_procs;                  // Procesos que registran (1 sin prefork)
     pthread_mutex_t mutex;
     
-    // Métricas globales del servidor
+    // Métricas globales del servidor (contadores por thread, sin mutex)
     struct timeval start_time;
-    unsigned long total_requests;
-    unsigned long total_errors;
+    counter_set_t *counters;        // METRICS_CTR_REQUESTS / METRICS_CTR_ERRORS
     
 } metrics_manager_t;
 
@@ -64,6 +97,16 @@ typedef struct {
  */
 void metrics_init();
 
+/**
+ * Identificar al proceso actual en modo prefork. Pone en cero sus gauges
+ * (pueden haber quedado de un worker anterior que murió en ese slot). Un
+ * worker no destruye las métricas compartidas en metrics_destroy().
+ *
+ * @param slot Índice del worker [0, METRICS_MAX_PROCS)
+ * @param num_procs Total de workers (escala total_workers en los reportes)
+ */
+void metrics_set_process(int slot, int num_procs);
+
 /**
  * Destruir sistema de métricas
  */
@@ -75,12 +118,20 @@ void metrics_destroy();
  * @param command_name Nombre del comando (ej: "isprime")
  * @param num_workers Número de workers para este comando
  * @param queue_capacity Capacidad máxima de la cola
- * @param buffer_size Tamaño del buffer para cálculo de std dev (ej: 1000)
+ * @param buffer_size Sin uso (la std dev sale de los histogramas); se
+ *                    mantiene por compatibilidad
  * @return Índice del comando o -1 si error
  */
 int metrics_register_command(const char *command_name, int num_workers, 
                              int queue_capacity, int buffer_size);
 
+/**
+ * Cantidad de comandos registrados
+ *
+ * @return Número de comandos (0 si el sistema no está inicializado)
+ */
+int metrics_command_count(void);
+
 // ============================================================================
 // FUNCIONES DE REGISTRO DE MÉTRICAS
 // ============================================================================
@@ -101,6 +152,37 @@ void metrics_record_wait_time(const char *command_name, unsigned long wait_time_
  */
 void metrics_record_exec_time(const char *command_name, unsigned long exec_time_us);
 
+/**
+ * Registrar la duración de una fase de la request
+ * 
+ * O(1) y sin locks. QUEUE y EXEC también alimentan los promedios de
+ * espera y ejecución.
+ * 
+ * @param command_name Nombre del comando
+ * @param phase Fase medida
+ * @param duration_us Duración en microsegundos
+ */
+void metrics_record_phase(const char *command_name, metrics_phase_t phase,
+                          unsigned long duration_us);
+
+/**
+ * Registrar una request terminada en la ventana deslizante del comando
+ * 
+ * @param command_name Nombre del comando
+ * @param latency_us Latencia total de la request en microsegundos
+ * @param is_error true si la request terminó en error
+ */
+void metrics_record_request(const char *command_name, unsigned long latency_us,
+                            bool is_error);
+
+/**
+ * Nombre de comando asociado a un path ("/isprime" -> "isprime")
+ * 
+ * @param path Path de la request
+ * @return Puntero dentro de path (no liberar)
+ */
+const char* metrics_command_from_path(const char *path);
+
 /**
  * Actualizar tamaño de cola
  * 
@@ -117,6 +199,24 @@ void metrics_update_queue_size(const char *command_name, int queue_size);
  */
 void metrics_update_workers(const char *command_name, int busy_count);
 
+/**
+ * Sumar delta al gauge de tareas en cola de un comando (la cola llama con +1
+ * al encolar y -1 al sacar la tarea, sea cual sea el motivo)
+ * 
+ * @param command_name Nombre del comando
+ * @param delta +1 o -1
+ */
+void metrics_adjust_queue_size(const char *command_name, int delta);
+
+/**
+ * Sumar delta al gauge de workers ocupados con un comando (+1 al empezar a
+ * ejecutar una tarea, -1 al terminarla)
+ * 
+ * @param command_name Nombre del comando
+ * @param delta +1 o -1
+ */
+void metrics_adjust_workers(const char *command_name, int delta);
+
 /**
  * Incrementar contador de requests totales
  */
@@ -156,6 +256,27 @@ double metrics_get_avg_wait_time_ms(const char *command_name);
  */
 double metrics_get_avg_exec_time_ms(const char *command_name);
 
+/**
+ * Resumen (percentiles, máximo, media) de una fase de un comando
+ * 
+ * @param command_name Nombre del comando
+ * @param phase Fase
+ * @param out Resumen de salida (en microsegundos)
+ * @return 0 si éxito, -1 si no encontrado
+ */
+int metrics_get_phase_summary(const char *command_name, metrics_phase_t phase,
+                              histogram_summary_t *out);
+
+/**
+ * Tasas y percentiles de los últimos `seconds` segundos completos
+ * 
+ * @param command_name Nombre del comando
+ * @param seconds Largo de la ventana (1..WINDOW_MAX_SECONDS)
+ * @param out Resumen de salida
+ * @return 0 si éxito, -1 si no encontrado
+ */
+int metrics_get_window(const char *command_name, int seconds, window_summary_t *out);
+
 /**
  * Calcular desviación estándar de tiempo de espera
  * 
@@ -175,12 +296,49 @@ double metrics_get_stddev_exec_time_ms(const char *command_name);
 /**
  * Obtener todas las métricas en formato JSON
  * 
+ * Igual que snprintf: si el resultado no entra, se trunca y se retorna el
+ * tamaño que hubiera hecho falta (sin contar el '\0').
+ * 
  * @param buffer Buffer donde escribir el JSON
  * @param buffer_size Tamaño del buffer
- * @return Número de bytes escritos, o -1 si error
+ * @return Longitud total del JSON, o -1 si error
  */
 int metrics_get_json(char *buffer, size_t buffer_size);
 
+/**
+ * Métricas de una ventana deslizante en formato JSON (/metrics?window=10s)
+ * 
+ * Mismas reglas de tamaño que metrics_get_json.
+ * 
+ * @param buffer Buffer donde escribir el JSON
+ * @param buffer_size Tamaño del buffer
+ * @param window_seconds Largo de la ventana (1..WINDOW_MAX_SECONDS)
+ * @return Longitud total del JSON, o -1 si error
+ */
+int metrics_get_window_json(char *buffer, size_t buffer_size, int window_seconds);
+
+// ============================================================================
+// EXPOSICIÓN PROMETHEUS
+// ============================================================================
+
+/**
+ * Callback que recibe el texto generado (ej: escribir a un http_stream_t)
+ */
+typedef void (*metrics_emit_fn)(void *ctx, const char *data, size_t len);
+
+/**
+ * Escribir todas las métricas en formato de texto Prometheus (0.0.4)
+ * 
+ * Toma un snapshot de los valores por comando y emite los histogramas de
+ * fases con buckets acumulados (le en segundos). No toma locks de comandos:
+ * los histogramas se suman desde sus shards mientras se emiten.
+ * 
+ * @param emit Callback de salida
+ * @param ctx Contexto para el callback
+ * @return 0 si éxito, -1 si error
+ */
+int metrics_write_prometheus(metrics_emit_fn emit, void *ctx);
+
 // ============================================================================
 // HELPER - Calcular desviación estándar
 // ============================================================================
@@ -1,4 +1,6 @@
 #include "queue.h"
+#include "metrics.h"
+#include "../utils/utils.h"
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -29,6 +31,42 @@ static void calculate_timeout_ts(struct timespec *ts, int timeout_ms) {
     }
 }
 
+/**
+ * Extraer el primer nodo de la cola (requiere lock tomado y size > 0)
+ */
+static task_t* pop_head_locked(queue_t *queue) {
+    queue_node_t *node = queue->head;
+    task_t *task = node->task;
+    
+    queue->head = node->next;
+    if (!queue->head) {
+        // Era el último elemento
+        queue->tail = NULL;
+    }
+    
+    free(node);
+    queue->size--;
+    queue->total_dequeued++;
+    metrics_adjust_queue_size(metrics_command_from_path(task->path), -1);
+    
+    // Señalar que hay espacio disponible
+    if (queue->max_size > 0) {
+        pthread_cond_signal(&queue->not_full);
+    }
+    
+    return task;
+}
+
+/**
+ * Descartar una tarea vencida (llamar SIN el lock tomado)
+ */
+static void discard_expired(queue_t *queue, task_t *task) {
+    if (queue->expired_handler) {
+        queue->expired_handler(task, queue->expired_ctx);
+    }
+    task_free(task);
+}
+
 // ============================================================================
 // QUEUE - CREAR Y DESTRUIR
 // ============================================================================
@@ -48,6 +86,9 @@ queue_t* queue_create(int max_size) {
     queue->total_enqueued = 0;
     queue->total_dequeued = 0;
     queue->total_dropped = 0;
+    queue->total_expired = 0;
+    queue->expired_handler = NULL;
+    queue->expired_ctx = NULL;
     
     // Inicializar primitivas de sincronización
     if (pthread_mutex_init(&queue->mutex, NULL) != 0) {
@@ -80,6 +121,7 @@ void queue_destroy(queue_t *queue) {
     queue_node_t *current = queue->head;
     while (current) {
         queue_node_t *next = current->next;
+        metrics_adjust_queue_size(metrics_command_from_path(current->task->path), -1);
         task_free(current->task);
         free(current);
         current = next;
@@ -173,6 +215,8 @@ int queue_enqueue(queue_t *queue, task_t *task, int timeout_ms) {
     
     queue->size++;
     queue->total_enqueued++;
+    // Gauge por comando: lo que está en cola de este comando, no de toda la cola
+    metrics_adjust_queue_size(metrics_command_from_path(task->path), 1);
     
     // Señalar que hay una tarea disponible
     pthread_cond_signal(&queue->not_empty);
@@ -190,34 +234,28 @@ task_t* queue_dequeue(queue_t *queue) {
     
     pthread_mutex_lock(&queue->mutex);
     
-    // Esperar hasta que haya una tarea o se active shutdown
-    while (queue->size == 0 && !queue->shutdown) {
-        pthread_cond_wait(&queue->not_empty, &queue->mutex);
-    }
-    
-    // Si shutdown y cola vacía, terminar
-    if (queue->shutdown && queue->size == 0) {
+    task_t *task;
+    for (;;) {
+        // Esperar hasta que haya una tarea o se active shutdown
+        while (queue->size == 0 && !queue->shutdown) {
+            pthread_cond_wait(&queue->not_empty, &queue->mutex);
+        }
+        
+        // Si shutdown y cola vacía, terminar
+        if (queue->shutdown && queue->size == 0) {
+            pthread_mutex_unlock(&queue->mutex);
+            return NULL;
+        }
+        
+        // Extraer primer nodo (FIFO)
+        task = pop_head_locked(queue);
+        if (!task_is_expired(task)) break;
+        
+        // Nadie espera ya esta respuesta: descartarla sin ejecutar
+        queue->total_expired++;
         pthread_mutex_unlock(&queue->mutex);
-        return NULL;
-    }
-    
-    // Extraer primer nodo (FIFO)
-    queue_node_t *node = queue->head;
-    task_t *task = node->task;
-    
-    queue->head = node->next;
-    if (!queue->head) {
-        // Era el último elemento
-        queue->tail = NULL;
-    }
-    
-    free(node);
-    queue->size--;
-    queue->total_dequeued++;
-    
-    // Señalar que hay espacio disponible
-    if (queue->max_size > 0) {
-        pthread_cond_signal(&queue->not_full);
+        discard_expired(queue, task);
+        pthread_mutex_lock(&queue->mutex);
     }
     
     pthread_mutex_unlock(&queue->mutex);
@@ -233,36 +271,31 @@ task_t* queue_dequeue_timeout(queue_t *queue, int timeout_ms) {
     struct timespec ts;
     calculate_timeout_ts(&ts, timeout_ms);
     
-    // Esperar hasta que haya una tarea, timeout, o shutdown
-    while (queue->size == 0 && !queue->shutdown) {
-        int ret = pthread_cond_timedwait(&queue->not_empty, &queue->mutex, &ts);
-        if (ret == ETIMEDOUT) {
+    task_t *task;
+    for (;;) {
+        // Esperar hasta que haya una tarea, timeout, o shutdown
+        while (queue->size == 0 && !queue->shutdown) {
+            int ret = pthread_cond_timedwait(&queue->not_empty, &queue->mutex, &ts);
+            if (ret == ETIMEDOUT) {
+                pthread_mutex_unlock(&queue->mutex);
+                return NULL; // Timeout
+            }
+        }
+        
+        // Si shutdown y cola vacía, terminar
+        if (queue->shutdown && queue->size == 0) {
             pthread_mutex_unlock(&queue->mutex);
-            return NULL; // Timeout
+            return NULL;
         }
-    }
-    
-    // Si shutdown y cola vacía, terminar
-    if (queue->shutdown && queue->size == 0) {
+        
+        // Extraer tarea
+        task = pop_head_locked(queue);
+        if (!task_is_expired(task)) break;
+        
+        queue->total_expired++;
         pthread_mutex_unlock(&queue->mutex);
-        return NULL;
-    }
-    
-    // Extraer tarea
-    queue_node_t *node = queue->head;
-    task_t *task = node->task;
-    
-    queue->head = node->next;
-    if (!queue->head) {
-        queue->tail = NULL;
-    }
-    
-    free(node);
-    queue->size--;
-    queue->total_dequeued++;
-    
-    if (queue->max_size > 0) {
-        pthread_cond_signal(&queue->not_full);
+        discard_expired(queue, task);
+        pthread_mutex_lock(&queue->mutex);
     }
     
     pthread_mutex_unlock(&queue->mutex);
@@ -318,6 +351,25 @@ void queue_get_stats(queue_t *queue,
     pthread_mutex_unlock(&queue->mutex);
 }
 
+unsigned long queue_get_expired(queue_t *queue) {
+    if (!queue) return 0;
+    
+    pthread_mutex_lock(&queue->mutex);
+    unsigned long expired = queue->total_expired;
+    pthread_mutex_unlock(&queue->mutex);
+    
+    return expired;
+}
+
+void queue_set_expired_handler(queue_t *queue, queue_expired_handler_t handler, void *ctx) {
+    if (!queue) return;
+    
+    pthread_mutex_lock(&queue->mutex);
+    queue->expired_handler = handler;
+    queue->expired_ctx = ctx;
+    pthread_mutex_unlock(&queue->mutex);
+}
+
 // ============================================================================
 // QUEUE - SHUTDOWN
 // ============================================================================
@@ -362,6 +414,7 @@ task_t* task_create(int client_fd, const char *path, const char *query, const ch
     
     // Timestamp se asigna en queue_enqueue
     memset(&task->enqueue_time, 0, sizeof(task->enqueue_time));
+    memset(&task->deadline, 0, sizeof(task->deadline)); // Sin deadline
     
     return task;
 }
@@ -381,4 +434,22 @@ void task_free(task_t *task) {
     }
     
     free(task);
-}
\ No newline at end of file
+}
+
+void task_set_deadline_ms(task_t *task, long timeout_ms) {
+    if (!task) return;
+    
+    if (timeout_ms <= 0) {
+        memset(&task->deadline, 0, sizeof(task->deadline));
+        return;
+    }
+    deadline_from_timeout_ms(&task->deadline, timeout_ms);
+}
+
+bool task_is_expired(const task_t *task) {
+    return task && deadline_expired_at(&task->deadline);
+}
+
+long task_remaining_ms(const task_t *task) {
+    return task ? deadline_remaining_ms_of(&task->deadline) : -1;
+}
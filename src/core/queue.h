@@ -26,6 +26,7 @@ typedef struct task {
     
     // Metadata
     struct timeval enqueue_time;   // Cuándo se encoló
+    struct timeval deadline;       // Deadline absoluto (0 = sin deadline)
     int priority;                  // 0=low, 1=normal, 2=high
     
     // Para jobs asíncronos (opcional)
@@ -36,6 +37,10 @@ typedef struct task {
 // QUEUE - Cola thread-safe con backpressure
 // ============================================================================
 
+// Callback invocado (fuera del lock) por cada tarea descartada por deadline
+// vencido al momento del dequeue. Después del callback la cola libera la tarea.
+typedef void (*queue_expired_handler_t)(task_t *task, void *ctx);
+
 // Nodo interno de la cola (lista enlazada)
 typedef struct queue_node {
     task_t *task;
@@ -62,6 +67,11 @@ typedef struct queue {
     unsigned long total_enqueued;  // Total de tareas encoladas (histórico)
     unsigned long total_dequeued;  // Total de tareas desencoladas
     unsigned long total_dropped;   // Tareas rechazadas por cola llena
+    unsigned long total_expired;   // Tareas descartadas por deadline vencido
+    
+    // Tareas vencidas (opcional)
+    queue_expired_handler_t expired_handler;
+    void *expired_ctx;
 } queue_t;
 
 // ============================================================================
@@ -107,6 +117,9 @@ int queue_enqueue(queue_t *queue, task_t *task, int timeout_ms);
  * - Hay una tarea disponible (retorna la tarea)
  * - Se activa shutdown (retorna NULL)
  * 
+ * Las tareas cuyo deadline ya pasó se saltan: se cuentan en total_expired,
+ * se entregan al expired_handler (si hay) y se liberan.
+ * 
  * @param queue Cola origen
  * @return Tarea desencolada, o NULL si shutdown
  */
@@ -121,6 +134,17 @@ task_t* queue_dequeue(queue_t *queue);
  */
 task_t* queue_dequeue_timeout(queue_t *queue, int timeout_ms);
 
+/**
+ * Registrar callback para tareas descartadas por deadline vencido
+ * 
+ * Útil para responder 504 al cliente o marcar el job como error.
+ * 
+ * @param queue Cola a configurar
+ * @param handler Callback (NULL = solo liberar la tarea)
+ * @param ctx Contexto pasado al callback
+ */
+void queue_set_expired_handler(queue_t *queue, queue_expired_handler_t handler, void *ctx);
+
 /**
  * Obtener tamaño actual de la cola (thread-safe)
  * 
@@ -170,6 +194,14 @@ void queue_get_stats(queue_t *queue,
                      unsigned long *dequeued,
                      unsigned long *dropped);
 
+/**
+ * Obtener total de tareas descartadas por deadline (thread-safe)
+ * 
+ * @param queue Cola a consultar
+ * @return Número de tareas vencidas al desencolar
+ */
+unsigned long queue_get_expired(queue_t *queue);
+
 // ============================================================================
 // TASK - Funciones de utilidad
 // ============================================================================
@@ -192,4 +224,28 @@ task_t* task_create(int client_fd, const char *path, const char *query, const ch
  */
 void task_free(task_t *task);
 
+/**
+ * Fijar deadline relativo a ahora
+ * 
+ * @param task Tarea a configurar
+ * @param timeout_ms Milisegundos de presupuesto (<= 0 = sin deadline)
+ */
+void task_set_deadline_ms(task_t *task, long timeout_ms);
+
+/**
+ * Verificar si el deadline de la tarea ya pasó
+ * 
+ * @param task Tarea a consultar
+ * @return true si tiene deadline y está vencido
+ */
+bool task_is_expired(const task_t *task);
+
+/**
+ * Milisegundos restantes antes del deadline
+ * 
+ * @param task Tarea a consultar
+ * @return Restante en ms (0 si vencido), -1 si no tiene deadline
+ */
+long task_remaining_ms(const task_t *task);
+
 #endif // QUEUE_H
\ No newline at end of file
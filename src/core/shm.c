@@ -0,0 +1,69 @@
+// Arena de memoria compartida entre procesos
+#include "shm.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define SHM_ALIGN 64
+
+static struct {
+    char *base;
+    size_t size;
+    size_t used;                // Avanza con fetch_add (también desde varios procesos)
+} *g_arena = NULL;
+
+int shm_arena_init(size_t size) {
+    if (g_arena) return 0;
+    if (size < 2 * SHM_ALIGN) return -1;
+
+    // El header del arena vive en el propio mapeo: `used` es compartido
+    char *base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) return -1;
+
+    g_arena = (void *)base;
+    g_arena->base = base;
+    g_arena->size = size;
+    g_arena->used = SHM_ALIGN;      // Primer bloque: el header
+    return 0;
+}
+
+bool shm_enabled(void) {
+    return g_arena != NULL;
+}
+
+void* shm_alloc(size_t size) {
+    size = (size + SHM_ALIGN - 1) & ~(size_t)(SHM_ALIGN - 1);
+
+    if (g_arena && size > 0) {
+        size_t off = __atomic_fetch_add(&g_arena->used, size, __ATOMIC_RELAXED);
+        if (off + size <= g_arena->size) {
+            return g_arena->base + off;     // mmap entrega páginas en cero
+        }
+        // Agotado: seguir con memoria privada (se pierde la agregación)
+    }
+
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, SHM_ALIGN, size > 0 ? size : SHM_ALIGN) != 0) {
+        return NULL;
+    }
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+bool shm_contains(const void *ptr) {
+    return g_arena && (const char *)ptr >= g_arena->base &&
+           (const char *)ptr < g_arena->base + g_arena->size;
+}
+
+void shm_free(void *ptr) {
+    if (!ptr || shm_contains(ptr)) return;
+    free(ptr);
+}
+
+size_t shm_used(void) {
+    if (!g_arena) return 0;
+    size_t used = __atomic_load_n(&g_arena->used, __ATOMIC_RELAXED);
+    return used < g_arena->size ? used : g_arena->size;
+}
@@ -0,0 +1,60 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// ============================================================================
+// SHM - Memoria compartida entre procesos (modo prefork)
+// ============================================================================
+//
+// Un arena MAP_SHARED | MAP_ANONYMOUS que se reserva antes de fork(). Lo que
+// se aloja ahí (contadores, histogramas, ventanas, el registro de métricas,
+// los rings de trazas) queda en la misma dirección en todos los workers, y
+// los atómicos que ya usan los threads funcionan igual entre procesos: cada
+// worker suma en la misma memoria y /metrics muestra el total de la flota.
+//
+// Es un bump allocator: shm_free() no devuelve memoria del arena (todo lo
+// que vive ahí dura lo que el proceso). Sin arena, o si se agota,
+// shm_alloc() cae a posix_memalign y shm_free() a free().
+
+#define SHM_ARENA_DEFAULT_SIZE  (64UL << 20)    // Reservado, no comprometido
+
+/**
+ * Reservar el arena compartido (llamar antes de crear las estructuras y
+ * antes de fork)
+ *
+ * @param size Bytes a reservar
+ * @return 0 si éxito, -1 si error
+ */
+int shm_arena_init(size_t size);
+
+/**
+ * true si hay un arena compartido activo
+ */
+bool shm_enabled(void);
+
+/**
+ * Reservar memoria alineada a 64 bytes y en cero (compartida si hay arena)
+ *
+ * @param size Bytes
+ * @return Puntero o NULL si falla
+ */
+void* shm_alloc(size_t size);
+
+/**
+ * Liberar memoria de shm_alloc (no hace nada si es del arena)
+ */
+void shm_free(void *ptr);
+
+/**
+ * true si ptr apunta dentro del arena compartido
+ */
+bool shm_contains(const void *ptr);
+
+/**
+ * Bytes usados del arena (0 si no hay arena)
+ */
+size_t shm_used(void);
+
+#endif // SHM_H
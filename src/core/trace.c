@@ -0,0 +1,241 @@
+// Trazas por request muestreadas
+#include "trace.h"
+#include "counters.h"
+#include "shm.h"
+#include "../utils/utils.h"
+#include <unistd.h>
+#include <sys/syscall.h>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#define TRACE_RING_MASK (TRACE_RING_EVENTS - 1)
+
+typedef struct {
+    uint64_t seq;               // 2*idx+1 escribiendo, 2*idx+2 publicado
+    uint64_t start;
+    uint64_t end;
+    const char *name;
+    uint32_t pid;               // En modo prefork, worker que registró el span
+    uint32_t tid;
+    char request_id[40];
+} trace_event_t;
+
+typedef struct {
+    uint64_t next __attribute__((aligned(64)));
+    trace_event_t events[TRACE_RING_EVENTS];
+} trace_ring_t;
+
+static struct {
+    int enabled;
+    uint32_t threshold;         // Muestreado si hash % 10000 < threshold
+    trace_ring_t *rings;
+
+    // Conversión ticks -> microsegundos de CLOCK_MONOTONIC
+    uint64_t base_ticks;
+    double base_us;
+    double us_per_tick;
+} g_trace;
+
+__thread int trace_tl_active = 0;
+static __thread char tl_request_id[40];
+static __thread uint32_t tl_tid = 0;
+static __thread uint32_t tl_pid = 0;
+
+// ============================================================================
+// RELOJ
+// ============================================================================
+
+static double monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+uint64_t trace_now(void) {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void calibrate_clock(void) {
+#if defined(__x86_64__)
+    double us0 = monotonic_us();
+    uint64_t t0 = __rdtsc();
+    struct timespec pause = { 0, 10 * 1000 * 1000 };    // 10 ms
+    nanosleep(&pause, NULL);
+    double us1 = monotonic_us();
+    uint64_t t1 = __rdtsc();
+
+    g_trace.base_ticks = t0;
+    g_trace.base_us = us0;
+    g_trace.us_per_tick = (t1 > t0) ? (us1 - us0) / (double)(t1 - t0) : 0.0;
+#else
+    g_trace.base_ticks = trace_now();
+    g_trace.base_us = g_trace.base_ticks / 1e3;
+    g_trace.us_per_tick = 1e-3;
+#endif
+}
+
+static double ticks_to_us(uint64_t ticks) {
+    return g_trace.base_us + ((double)ticks - (double)g_trace.base_ticks) * g_trace.us_per_tick;
+}
+
+// ============================================================================
+// INIT / SHUTDOWN
+// ============================================================================
+
+int trace_init(double sample_percent) {
+    if (sample_percent < 0.0) sample_percent = 0.0;
+    if (sample_percent > 100.0) sample_percent = 100.0;
+
+    if (!g_trace.rings) {
+        // Compartidos si hay arena: /debug/trace ve los spans de todos los workers
+        g_trace.rings = shm_alloc(sizeof(trace_ring_t) * TRACE_SHARDS);
+        if (!g_trace.rings) return -1;
+        calibrate_clock();
+    }
+
+    __atomic_store_n(&g_trace.threshold, (uint32_t)(sample_percent * 100.0 + 0.5), __ATOMIC_RELAXED);
+    __atomic_store_n(&g_trace.enabled, sample_percent > 0.0, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void trace_shutdown(void) {
+    __atomic_store_n(&g_trace.enabled, 0, __ATOMIC_RELEASE);
+}
+
+// ============================================================================
+// REGISTRO
+// ============================================================================
+
+// FNV-1a: el mismo request_id da siempre la misma decisión
+static uint32_t hash_id(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool trace_request_begin(const char *request_id) {
+    trace_tl_active = 0;
+    if (!request_id || !__atomic_load_n(&g_trace.enabled, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    if (hash_id(request_id) % 10000 >= __atomic_load_n(&g_trace.threshold, __ATOMIC_RELAXED)) {
+        return false;
+    }
+
+    snprintf(tl_request_id, sizeof(tl_request_id), "%s", request_id);
+    // tl_pid distingue un thread heredado por fork() de su original
+    uint32_t pid = (uint32_t)getpid();
+    if (tl_tid == 0 || tl_pid != pid) {
+        tl_tid = (uint32_t)syscall(SYS_gettid);
+        tl_pid = pid;
+    }
+    trace_tl_active = 1;
+    return true;
+}
+
+void trace_request_end(void) {
+    trace_tl_active = 0;
+}
+
+void trace_span(const char *name, uint64_t start, uint64_t end) {
+    if (!trace_tl_active || !g_trace.rings) return;
+
+    trace_ring_t *ring = &g_trace.rings[counter_thread_slot() % TRACE_SHARDS];
+    uint64_t idx = __atomic_fetch_add(&ring->next, 1, __ATOMIC_RELAXED);
+    trace_event_t *e = &ring->events[idx & TRACE_RING_MASK];
+
+    __atomic_store_n(&e->seq, 2 * idx + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    e->start = start;
+    e->end = end >= start ? end : start;
+    e->name = name;
+    e->pid = tl_pid;
+    e->tid = tl_tid;
+    memcpy(e->request_id, tl_request_id, sizeof(e->request_id));
+    __atomic_store_n(&e->seq, 2 * idx + 2, __ATOMIC_RELEASE);
+}
+
+void trace_span_timeval(const char *name, const struct timeval *start, const struct timeval *end) {
+    if (!trace_tl_active || !start || g_trace.us_per_tick <= 0.0) return;
+
+    // Llevar ambos extremos a ticks restándolos de "ahora" en los dos relojes
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    uint64_t now_ticks = trace_now();
+    if (!end) end = &now;
+
+    double start_ago = (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_usec - start->tv_usec);
+    double end_ago = (now.tv_sec - end->tv_sec) * 1e6 + (now.tv_usec - end->tv_usec);
+    if (end_ago < 0) end_ago = 0;
+    if (start_ago < end_ago) start_ago = end_ago;
+
+    uint64_t start_ticks = (uint64_t)(start_ago / g_trace.us_per_tick);
+    uint64_t end_ticks = (uint64_t)(end_ago / g_trace.us_per_tick);
+    if (start_ticks > now_ticks) start_ticks = now_ticks;
+    trace_span(name, now_ticks - start_ticks, now_ticks - end_ticks);
+}
+
+// ============================================================================
+// EXPORT
+// ============================================================================
+
+int trace_write_chrome_json(int seconds, void (*emit)(void *ctx, const char *data, size_t len),
+                            void *ctx) {
+    if (!emit) return -1;
+    if (seconds < 1) seconds = 1;
+    if (seconds > TRACE_MAX_SECONDS) seconds = TRACE_MAX_SECONDS;
+
+    char line[512];
+    int count = 0;
+
+    static const char header[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    emit(ctx, header, sizeof(header) - 1);
+
+    if (g_trace.rings && g_trace.us_per_tick > 0.0) {
+        double cutoff_us = monotonic_us() - seconds * 1e6;
+
+        for (int s = 0; s < TRACE_SHARDS; s++) {
+            trace_ring_t *ring = &g_trace.rings[s];
+            for (int i = 0; i < TRACE_RING_EVENTS; i++) {
+                trace_event_t *src = &ring->events[i];
+                uint64_t seq = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE);
+                if (seq == 0 || (seq & 1)) continue;   // Vacío o a medio escribir
+
+                trace_event_t e;
+                memcpy(&e, src, sizeof(e));
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&src->seq, __ATOMIC_RELAXED) != seq) continue; // Sobreescrito
+                e.request_id[sizeof(e.request_id) - 1] = '\0';
+
+                double ts = ticks_to_us(e.start);
+                if (ts < cutoff_us) continue;
+
+                int len = snprintf(line, sizeof(line),
+                                   "%s{\"name\":\"%s\",\"cat\":\"http\",\"ph\":\"X\","
+                                   "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,\"tid\":%u,"
+                                   "\"args\":{\"request_id\":\"%s\"}}",
+                                   count > 0 ? ",\n" : "", e.name, ts,
+                                   (double)(e.end - e.start) * g_trace.us_per_tick,
+                                   e.pid, e.tid, e.request_id);
+                if (len > 0 && (size_t)len < sizeof(line)) {
+                    emit(ctx, line, (size_t)len);
+                    count++;
+                }
+            }
+        }
+    }
+
+    static const char footer[] = "\n]}\n";
+    emit(ctx, footer, sizeof(footer) - 1);
+    return count;
+}
@@ -0,0 +1,104 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/time.h>
+
+// ============================================================================
+// TRACE - Spans por request con export a Chrome trace_event (Perfetto)
+// ============================================================================
+//
+// El muestreo se decide con un hash del request_id, así que cualquier parte
+// del servidor (el thread de la conexión, el worker que ejecuta un job)
+// llega a la misma decisión sin pasarse nada. En una request no muestreada
+// cada TRACE_BEGIN/TRACE_END cuesta una lectura de una variable thread-local.
+//
+// Los spans se guardan en TRACE_SHARDS rings (el thread elige uno por su slot
+// de counter_thread_slot()); cada escritor reserva un slot con fetch_add y lo
+// publica con un número de secuencia, sin locks. Los rings se sobreescriben:
+// /debug/trace devuelve lo que queda de los últimos N segundos.
+//
+// Los rings se reservan con shm_alloc: en modo prefork todos los workers
+// escriben en los mismos y cada span lleva el pid de su proceso.
+//
+// Los timestamps son ticks del TSC (x86-64, calibrado contra CLOCK_MONOTONIC
+// al iniciar) o nanosegundos de CLOCK_MONOTONIC en otras arquitecturas.
+
+#define TRACE_SHARDS        16
+#define TRACE_RING_EVENTS   4096    // Por shard (potencia de 2)
+#define TRACE_MAX_SECONDS   60
+#define TRACE_DEFAULT_SAMPLE_PERCENT 1.0
+
+// true mientras el thread atiende una request muestreada
+extern __thread int trace_tl_active;
+
+// ============================================================================
+// FUNCIONES PÚBLICAS
+// ============================================================================
+
+/**
+ * Reservar los rings y calibrar el reloj
+ *
+ * @param sample_percent Porcentaje de requests a trazar [0, 100]; 0 desactiva
+ * @return 0 si éxito, -1 si error
+ */
+int trace_init(double sample_percent);
+
+/**
+ * Dejar de trazar. Los rings no se liberan: un thread detached puede
+ * estar escribiendo todavía.
+ */
+void trace_shutdown(void);
+
+/**
+ * Decidir si el request se traza y dejarlo como request actual del thread
+ *
+ * @param request_id Id del request o del job
+ * @return true si el request quedó muestreado
+ */
+bool trace_request_begin(const char *request_id);
+
+/**
+ * Terminar el request actual del thread
+ */
+void trace_request_end(void);
+
+/**
+ * Timestamp en ticks del reloj de trazas
+ */
+uint64_t trace_now(void);
+
+/**
+ * Registrar un span [start, end] del request actual (si está muestreado)
+ *
+ * @param name Nombre del span (literal: se guarda el puntero)
+ */
+void trace_span(const char *name, uint64_t start, uint64_t end);
+
+/**
+ * Registrar un span medido con gettimeofday() (p. ej. accept_time, enqueue_time)
+ *
+ * @param start Inicio
+ * @param end Fin, o NULL para "ahora"
+ */
+void trace_span_timeval(const char *name, const struct timeval *start, const struct timeval *end);
+
+/**
+ * Escribir los spans de los últimos `seconds` segundos como JSON trace_event
+ *
+ * @param seconds Ventana (se limita a [1, TRACE_MAX_SECONDS])
+ * @param emit Callback que recibe cada fragmento
+ * @param ctx Contexto del callback
+ * @return Cantidad de spans escritos
+ */
+int trace_write_chrome_json(int seconds, void (*emit)(void *ctx, const char *data, size_t len),
+                            void *ctx);
+
+// Span alrededor de un bloque: TRACE_BEGIN(t); ...; TRACE_END("parse", t);
+#define TRACE_BEGIN(var) uint64_t var = trace_tl_active ? trace_now() : 0
+#define TRACE_END(name, var) \
+    do { if (var) trace_span((name), (var), trace_now()); } while (0)
+
+#endif // TRACE_H
@@ -0,0 +1,182 @@
+// Ventanas deslizantes de un segundo por slot (sin locks al registrar)
+#include "window.h"
+#include "shm.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#define WINDOW_RESETTING (1ULL << 63)
+#define WINDOW_MAX_VALUE ((1ULL << 36) - 1)
+
+static uint64_t now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec;
+}
+
+// ============================================================================
+// BUCKETS DE LATENCIA
+// ============================================================================
+
+static int lat_bucket_index(uint64_t value) {
+    if (value > WINDOW_MAX_VALUE) value = WINDOW_MAX_VALUE;
+    if (value < (2 << WINDOW_SUB_BUCKET_BITS)) {
+        return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - WINDOW_SUB_BUCKET_BITS;
+    return (shift << WINDOW_SUB_BUCKET_BITS) + (int)(value >> shift);
+}
+
+static uint64_t lat_bucket_upper(int index) {
+    if (index < (2 << WINDOW_SUB_BUCKET_BITS)) {
+        return (uint64_t)index;
+    }
+    int shift = (index >> WINDOW_SUB_BUCKET_BITS) - 1;
+    uint64_t sub = (uint64_t)(index - (shift << WINDOW_SUB_BUCKET_BITS));
+    return (sub << shift) + (1ULL << shift) - 1;
+}
+
+// ============================================================================
+// CREACIÓN Y REGISTRO
+// ============================================================================
+
+rolling_window_t* window_create(void) {
+    return shm_alloc(sizeof(rolling_window_t));
+}
+
+void window_destroy(rolling_window_t *w) {
+    shm_free(w);
+}
+
+// Obtener el slot del segundo sec, reciclándolo si todavía guarda uno viejo.
+// Retorna NULL si el slot ya pertenece a un segundo posterior (thread demorado).
+static window_slot_t* acquire_slot(rolling_window_t *w, uint64_t sec) {
+    window_slot_t *slot = &w->slots[sec % WINDOW_SLOTS];
+
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        uint64_t epoch = __atomic_load_n(&slot->epoch, __ATOMIC_ACQUIRE);
+        if (epoch == sec) {
+            return slot;
+        }
+        if (epoch & WINDOW_RESETTING) {
+            continue; // Otro thread lo está poniendo en cero
+        }
+        if (epoch > sec) {
+            return NULL;
+        }
+        if (__atomic_compare_exchange_n(&slot->epoch, &epoch, sec | WINDOW_RESETTING, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&slot->requests, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&slot->errors, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&slot->latency_sum_us, 0, __ATOMIC_RELAXED);
+            for (int i = 0; i < WINDOW_LAT_BUCKETS; i++) {
+                __atomic_store_n(&slot->latency[i], 0, __ATOMIC_RELAXED);
+            }
+            __atomic_store_n(&slot->epoch, sec, __ATOMIC_RELEASE);
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+void window_record_at(rolling_window_t *w, uint64_t now_sec, uint64_t latency_us, bool is_error) {
+    if (!w) return;
+
+    window_slot_t *slot = acquire_slot(w, now_sec);
+    if (!slot) return;
+
+    __atomic_fetch_add(&slot->requests, 1, __ATOMIC_RELAXED);
+    if (is_error) {
+        __atomic_fetch_add(&slot->errors, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&slot->latency_sum_us, latency_us, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&slot->latency[lat_bucket_index(latency_us)], 1, __ATOMIC_RELAXED);
+}
+
+void window_record(rolling_window_t *w, uint64_t latency_us, bool is_error) {
+    window_record_at(w, now_seconds(), latency_us, is_error);
+}
+
+// ============================================================================
+// LECTURA
+// ============================================================================
+
+static uint64_t lat_percentile(const uint64_t *counts, uint64_t total, double percentile) {
+    if (total == 0) return 0;
+
+    uint64_t rank = (uint64_t)ceil(percentile / 100.0 * (double)total);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < WINDOW_LAT_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return lat_bucket_upper(i);
+        }
+    }
+    return lat_bucket_upper(WINDOW_LAT_BUCKETS - 1);
+}
+
+void window_summarize_at(const rolling_window_t *w, uint64_t now_sec, int seconds,
+                         window_summary_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+
+    if (seconds < 1) seconds = 1;
+    if (seconds > WINDOW_MAX_SECONDS) seconds = WINDOW_MAX_SECONDS;
+    out->seconds = seconds;
+    if (!w) return;
+
+    uint64_t counts[WINDOW_LAT_BUCKETS] = {0};
+    uint64_t slot_counts[WINDOW_LAT_BUCKETS];
+    uint64_t latency_sum = 0;
+
+    for (int s = 1; s <= seconds; s++) {
+        if ((uint64_t)s > now_sec) break;
+        uint64_t sec = now_sec - (uint64_t)s;
+        const window_slot_t *slot = &w->slots[sec % WINDOW_SLOTS];
+
+        if (__atomic_load_n(&slot->epoch, __ATOMIC_ACQUIRE) != sec) {
+            continue; // Slot vacío o de otro segundo
+        }
+
+        uint64_t requests = __atomic_load_n(&slot->requests, __ATOMIC_RELAXED);
+        uint64_t errors = __atomic_load_n(&slot->errors, __ATOMIC_RELAXED);
+        uint64_t sum = __atomic_load_n(&slot->latency_sum_us, __ATOMIC_RELAXED);
+        for (int i = 0; i < WINDOW_LAT_BUCKETS; i++) {
+            slot_counts[i] = __atomic_load_n(&slot->latency[i], __ATOMIC_RELAXED);
+        }
+
+        // Si el slot se recicló mientras se leía, descartar lo leído
+        if (__atomic_load_n(&slot->epoch, __ATOMIC_ACQUIRE) != sec) {
+            continue;
+        }
+
+        out->requests += requests;
+        out->errors += errors;
+        latency_sum += sum;
+        for (int i = 0; i < WINDOW_LAT_BUCKETS; i++) {
+            counts[i] += slot_counts[i];
+        }
+    }
+
+    out->requests_per_sec = (double)out->requests / seconds;
+    out->errors_per_sec = (double)out->errors / seconds;
+    if (out->requests > 0) {
+        out->error_rate = (double)out->errors / (double)out->requests;
+        out->mean_us = (double)latency_sum / (double)out->requests;
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < WINDOW_LAT_BUCKETS; i++) total += counts[i];
+    out->p50 = lat_percentile(counts, total, 50.0);
+    out->p90 = lat_percentile(counts, total, 90.0);
+    out->p99 = lat_percentile(counts, total, 99.0);
+    out->p999 = lat_percentile(counts, total, 99.9);
+}
+
+void window_summarize(const rolling_window_t *w, int seconds, window_summary_t *out) {
+    window_summarize_at(w, now_seconds(), seconds, out);
+}
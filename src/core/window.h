@@ -0,0 +1,94 @@
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ============================================================================
+// ROLLING WINDOW - Tasas y latencias de los últimos N segundos
+// ============================================================================
+//
+// Anillo de WINDOW_SLOTS slots de un segundo. Cada slot guarda el segundo
+// (CLOCK_MONOTONIC) al que pertenece; el primer thread que registra en un
+// segundo nuevo reclama el slot con un CAS sobre ese campo y lo pone en cero.
+// Registrar no toma locks. Las lecturas ignoran los slots de otro segundo o
+// que se estén reciclando mientras se leen.
+//
+// El segundo en curso no se incluye en las lecturas (está incompleto): una
+// ventana de 10 s cubre los 10 segundos completos anteriores.
+
+#define WINDOW_SLOTS        61      // 60 s de historia + el segundo en curso
+#define WINDOW_MAX_SECONDS  (WINDOW_SLOTS - 1)
+
+// Histograma compacto por slot: 8 sub-buckets por potencia de 2 (~12% de error)
+#define WINDOW_SUB_BUCKET_BITS 3
+#define WINDOW_LAT_BUCKETS     272  // cubre hasta 2^36 us, igual que histogram_t
+
+typedef struct {
+    uint64_t epoch;                           // Segundo del slot (bit alto = reciclando)
+    uint32_t requests;
+    uint32_t errors;
+    uint64_t latency_sum_us;
+    uint32_t latency[WINDOW_LAT_BUCKETS];
+} window_slot_t;
+
+typedef struct {
+    window_slot_t slots[WINDOW_SLOTS];
+} rolling_window_t;
+
+typedef struct {
+    int seconds;                    // Largo de la ventana
+    uint64_t requests;
+    uint64_t errors;
+    double requests_per_sec;
+    double errors_per_sec;
+    double error_rate;              // errors / requests (0 si no hubo requests)
+    double mean_us;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+} window_summary_t;
+
+// ============================================================================
+// FUNCIONES PÚBLICAS
+// ============================================================================
+
+/**
+ * Crear ventana vacía
+ *
+ * @return Puntero a la ventana o NULL si falla
+ */
+rolling_window_t* window_create(void);
+
+/**
+ * Liberar ventana
+ */
+void window_destroy(rolling_window_t *w);
+
+/**
+ * Registrar una request terminada en el segundo actual (sin locks)
+ *
+ * @param w Ventana
+ * @param latency_us Latencia de la request en microsegundos
+ * @param is_error true si la request terminó en error
+ */
+void window_record(rolling_window_t *w, uint64_t latency_us, bool is_error);
+
+/**
+ * Resumir los últimos `seconds` segundos completos
+ *
+ * @param w Ventana
+ * @param seconds Largo de la ventana (se limita a [1, WINDOW_MAX_SECONDS])
+ * @param out Resumen de salida
+ */
+void window_summarize(const rolling_window_t *w, int seconds, window_summary_t *out);
+
+/**
+ * Variantes con el segundo explícito (tests y callers que ya tienen la hora)
+ */
+void window_record_at(rolling_window_t *w, uint64_t now_sec, uint64_t latency_us, bool is_error);
+void window_summarize_at(const rolling_window_t *w, uint64_t now_sec, int seconds,
+                         window_summary_t *out);
+
+#endif // WINDOW_H
@@ -1,4 +1,7 @@
 #include "worker_pool.h"
+#include "metrics.h"
+#include "trace.h"
+#include "affinity.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
@@ -6,6 +9,9 @@
 static void *worker_thread_fn(void *arg) {
     worker_pool_t *pool = (worker_pool_t*)arg;
 
+    // Con --affinity: una CPU del set compute y memoria en su nodo
+    affinity_pin_worker();
+
     while (1) {
         // Dequeue a task (bloqueante)
         task_t *task = queue_dequeue(pool->queue);
@@ -21,16 +27,45 @@ static void *worker_thread_fn(void *arg) {
             continue;
         }
 
-        // Mark busy
+        // Métricas: espera en cola (enqueue -> dequeue) por comando
+        struct timeval start;
+        gettimeofday(&start, NULL);
+        // Copia: task->path se libera antes de la última actualización
+        char command[64];
+        snprintf(command, sizeof(command), "%s", metrics_command_from_path(task->path));
+        // Los spans del job quedan bajo el request_id de quien lo encoló
+        if (trace_request_begin(task->request_id) && task->enqueue_time.tv_sec != 0) {
+            trace_span_timeval("job.queue_wait", &task->enqueue_time, &start);
+        }
+        long wait_us = 0;
+        if (task->enqueue_time.tv_sec != 0) {
+            wait_us = (start.tv_sec - task->enqueue_time.tv_sec) * 1000000L +
+                      (start.tv_usec - task->enqueue_time.tv_usec);
+            if (wait_us < 0) wait_us = 0;
+            metrics_record_wait_time(command, (unsigned long)wait_us);
+        }
+
+        // Mark busy (el gauge es de este comando; el total del pool es aparte)
         pthread_mutex_lock(&pool->mutex);
         pool->busy_workers++;
         pthread_mutex_unlock(&pool->mutex);
+        metrics_adjust_workers(command, 1);
 
         // Ejecutar handler
+        int rc = 0;
+        TRACE_BEGIN(exec_span);
         if (pool->handler) {
-            int rc = pool->handler(task, pool->handler_ctx);
-            (void)rc; // handler decide qué hacer con errores
+            rc = pool->handler(task, pool->handler_ctx); // handler decide qué hacer con errores
         }
+        TRACE_END("job.exec", exec_span);
+        trace_request_end();
+
+        struct timeval end;
+        gettimeofday(&end, NULL);
+        long exec_us = (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_usec - start.tv_usec);
+        if (exec_us < 0) exec_us = 0;
+        metrics_record_exec_time(command, (unsigned long)exec_us);
+        metrics_record_request(command, (unsigned long)(wait_us + exec_us), rc != 0);
 
         // Liberar task si corresponde (asumimos ownership de la cola sobre task)
         task_free(task);
@@ -41,6 +76,7 @@ static void *worker_thread_fn(void *arg) {
         // Notify anyone waiting
         if (pool->busy_workers == 0) pthread_cond_broadcast(&pool->cond);
         pthread_mutex_unlock(&pool->mutex);
+        metrics_adjust_workers(command, -1);
 
         // Verificar shutdown
         pthread_mutex_lock(&pool->mutex);
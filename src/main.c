@@ -3,10 +3,17 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <unistd.h>
+#include <getopt.h>
 #include "server/server.h"
 #include "core/job_manager.h"
 #include "core/job_executor.h"
 #include "core/metrics.h"
+#include "core/access_log.h"
+#include "core/trace.h"
+#include "core/shm.h"
+#include "core/affinity.h"
+#include "server/prefork.h"
+#include "server/handoff.h"
 #include "utils/utils.h"
 
 // Variable global para el servidor (para signal handler)
@@ -19,30 +26,294 @@ static server_state_t *g_server = NULL;
 void signal_handler(int signum) {
     (void)signum;
     
-    printf("\n");
-    LOG_INFO("Received signal, shutting down gracefully...");
+    // Master prefork: solo reenviar a los workers (cada uno cierra lo suyo)
+    if (prefork_is_master()) {
+        prefork_stop();
+        return;
+    }
     
+    // Primera señal: drain (503 a lo nuevo); la segunda detiene en seco.
+    // Nada de printf/LOG_*: el accept loop loguea al leer el pipe
     if (g_server) {
+        server_begin_drain(g_server);
+    }
+}
+
+// ============================================================================
+// LÍNEA DE COMANDOS
+// ============================================================================
+
+typedef struct {
+    int port;
+    const char *access_log;
+    access_log_format_t access_log_format;
+    int access_log_flush_ms;
+    request_id_format_t request_id_format;
+    double trace_sample_percent;
+    int workers;                    // 0 = un solo proceso
+    const char *handoff_socket;     // Hot restart (NULL = deshabilitado)
+    int drain_timeout_ms;
+    const char *affinity;           // NULL = sin fijar CPUs
+} options_t;
+
+static void print_usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] [port]\n"
+            "  -p, --port N                  Puerto (default 8080)\n"
+            "  -w, --workers N               Modo prefork con N procesos (default 0 = uno solo)\n"
+            "      --access-log FILE         Access log por request\n"
+            "      --access-log-format FMT   text (default) o binary\n"
+            "      --access-log-flush-ms N   Flush por tiempo (default %d)\n"
+            "      --request-id-format FMT   compact (default) o uuid7\n"
+            "      --affinity SPEC           CPUs de I/O y de cómputo: auto o IO:COMPUTE (ej. 0-1:2-15)\n"
+            "      --drain-timeout MS        Espera máxima al detenerse (default %d, 0 = sin drain)\n"
+            "      --handoff-socket PATH     Hot restart: tomar/entregar el listener por este socket Unix\n"
+            "      --trace-sample PCT        %% de requests trazadas para /debug/trace (default %.0f)\n"
+            "  -h, --help                    Mostrar esta ayuda\n",
+            prog, ACCESS_LOG_FLUSH_MS, SERVER_DRAIN_TIMEOUT_MS, TRACE_DEFAULT_SAMPLE_PERCENT);
+}
+
+static int parse_port(const char *value) {
+    char *end = NULL;
+    long port = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || port <= 0 || port > 65535) {
+        fprintf(stderr, "Invalid port: %s\n", value);
+        return -1;
+    }
+    return (int)port;
+}
+
+// Retorna 0 si éxito, 1 si hay que salir con error, -1 si se pidió --help
+static int parse_options(int argc, char *argv[], options_t *opts) {
+    enum { OPT_ACCESS_LOG = 256, OPT_ACCESS_LOG_FORMAT, OPT_ACCESS_LOG_FLUSH_MS,
+           OPT_REQUEST_ID_FORMAT, OPT_TRACE_SAMPLE, OPT_HANDOFF_SOCKET,
+           OPT_DRAIN_TIMEOUT, OPT_AFFINITY };
+    static const struct option long_options[] = {
+        { "port",                required_argument, NULL, 'p' },
+        { "workers",             required_argument, NULL, 'w' },
+        { "access-log",          required_argument, NULL, OPT_ACCESS_LOG },
+        { "access-log-format",   required_argument, NULL, OPT_ACCESS_LOG_FORMAT },
+        { "access-log-flush-ms", required_argument, NULL, OPT_ACCESS_LOG_FLUSH_MS },
+        { "request-id-format",   required_argument, NULL, OPT_REQUEST_ID_FORMAT },
+        { "trace-sample",        required_argument, NULL, OPT_TRACE_SAMPLE },
+        { "handoff-socket",      required_argument, NULL, OPT_HANDOFF_SOCKET },
+        { "drain-timeout",       required_argument, NULL, OPT_DRAIN_TIMEOUT },
+        { "affinity",            required_argument, NULL, OPT_AFFINITY },
+        { "help",                no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    
+    int c;
+    while ((c = getopt_long(argc, argv, "p:w:h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'p':
+                if ((opts->port = parse_port(optarg)) < 0) return 1;
+                break;
+            case 'w': {
+                char *end = NULL;
+                long n = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || n < 0 || n > PREFORK_MAX_WORKERS) {
+                    fprintf(stderr, "Invalid workers: %s (0..%d)\n", optarg, PREFORK_MAX_WORKERS);
+                    return 1;
+                }
+                opts->workers = (int)n;
+                break;
+            }
+            case OPT_ACCESS_LOG:
+                opts->access_log = optarg;
+                break;
+            case OPT_ACCESS_LOG_FORMAT:
+                if (access_log_parse_format(optarg, &opts->access_log_format) != 0) {
+                    fprintf(stderr, "Invalid access log format: %s (text|binary)\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_ACCESS_LOG_FLUSH_MS:
+                opts->access_log_flush_ms = atoi(optarg);
+                if (opts->access_log_flush_ms <= 0) {
+                    fprintf(stderr, "Invalid flush interval: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_REQUEST_ID_FORMAT:
+                if (request_id_parse_format(optarg, &opts->request_id_format) != 0) {
+                    fprintf(stderr, "Invalid request id format: %s (compact|uuid7)\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_TRACE_SAMPLE: {
+                char *end = NULL;
+                opts->trace_sample_percent = strtod(optarg, &end);
+                if (end == optarg || *end != '\0' ||
+                    opts->trace_sample_percent < 0.0 || opts->trace_sample_percent > 100.0) {
+                    fprintf(stderr, "Invalid trace sample percent: %s (0..100)\n", optarg);
+                    return 1;
+                }
+                break;
+            }
+            case OPT_HANDOFF_SOCKET:
+                opts->handoff_socket = optarg;
+                break;
+            case OPT_DRAIN_TIMEOUT: {
+                char *end = NULL;
+                long ms = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || ms < 0 || ms > 3600000) {
+                    fprintf(stderr, "Invalid drain timeout: %s (0..3600000 ms)\n", optarg);
+                    return 1;
+                }
+                opts->drain_timeout_ms = (int)ms;
+                break;
+            }
+            case OPT_AFFINITY:
+                opts->affinity = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return -1;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    
+    // Compatibilidad: el puerto también se acepta como argumento posicional
+    if (optind < argc) {
+        if ((opts->port = parse_port(argv[optind])) < 0) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// SERVICIOS POR PROCESO
+// ============================================================================
+
+// Job manager + executor: tienen threads, así que en modo prefork los arranca
+// cada worker después del fork
+static int start_jobs(void) {
+    LOG_INFO("Initializing Job Manager...");
+    if (job_manager_init("data/jobs") != 0) {
+        LOG_ERROR("Failed to initialize Job Manager");
+        return -1;
+    }
+    
+    // Inicializar job executor (4 workers, cola de 100)
+    LOG_INFO("Initializing Job Executor (4 workers, queue depth: 100)...");
+    if (job_executor_init(4, 100) != 0) {
+        LOG_ERROR("Failed to initialize Job Executor");
+        job_manager_shutdown();
+        return -1;
+    }
+    return 0;
+}
+
+// Hot restart, proceso nuevo: el anterior terminó, tomar sus jobs en cola
+static void recover_jobs(void) {
+    int n = job_manager_recover(handoff_predecessor_pid(), job_executor_requeue);
+    LOG_INFO("Handoff: %d jobs recovered from PID %ld", n > 0 ? n : 0, handoff_predecessor_pid());
+}
+
+// Hot restart, proceso viejo: un proceso nuevo ya atiende en el mismo socket
+static void on_takeover(void) {
+    if (prefork_is_master()) {
+        prefork_stop();
+    } else if (g_server) {
         server_shutdown(g_server);
     }
 }
 
+// Después de server_start(). Hot restart: terminar las conexiones en curso y
+// dejar la cola de jobs para el proceso nuevo. Drain: lo que no empezó antes
+// del plazo ya no corre. Retorna false si quedan threads de conexión vivos
+// (no se pueden liberar las métricas ni el servidor).
+static bool finish_drain(void) {
+    if (handoff_requested()) {
+        server_drain(g_server, HANDOFF_DRAIN_TIMEOUT_MS);
+        int released = job_executor_release(NULL);
+        LOG_INFO("Handoff: %d queued jobs left for the new process", released);
+    } else if (server_is_draining(g_server)) {
+        int released = job_executor_release("Server shut down before the job started");
+        if (released > 0) LOG_WARN("Drain: %d queued jobs not started", released);
+    }
+    
+    int stuck = server_drain(g_server, SERVER_DRAIN_GRACE_MS);
+    if (stuck > 0) {
+        LOG_WARN("%d connection threads still running, skipping cleanup", stuck);
+    }
+    return stuck == 0;
+}
+
+// drained = false: quedan threads de conexión que pueden encolar en el
+// executor, así que la cola no se libera; solo se persisten los jobs
+static void stop_jobs(bool drained) {
+    if (drained) {
+        LOG_INFO("Shutting down Job Executor...");
+        job_executor_shutdown();
+    } else {
+        LOG_WARN("Connection threads still running, leaving Job Executor up");
+    }
+    
+    LOG_INFO("Shutting down Job Manager...");
+    job_manager_shutdown();
+}
+
+// Cuerpo de cada worker en modo prefork
+static int worker_main(int slot, void *ctx) {
+    (void)ctx;
+    
+    // Solo el thread que hizo fork() existe en el hijo
+    logger_after_fork();
+    access_log_after_fork();
+    metrics_set_process(slot, prefork_num_workers());
+    LOG_INFO("Worker %d started (PID %d)", slot, getpid());
+    
+    if (start_jobs() != 0) {
+        logger_shutdown();
+        return 1;
+    }
+    if (slot == 0) {
+        handoff_watch_predecessor(recover_jobs);
+    }
+    
+    int result = server_start(g_server);
+    
+    bool drained = finish_drain();
+    stop_jobs(drained);
+    access_log_shutdown();
+    if (drained) {
+        metrics_destroy();  // Un worker no libera las métricas compartidas
+    }
+    logger_shutdown();
+    return result == 0 ? 0 : 1;
+}
+
 // ============================================================================
 // MAIN
 // ============================================================================
 
 int main(int argc, char *argv[]) {
-    // Parsear puerto desde argumentos (o usar default)
-    int port = 8080;
-    
-    if (argc > 1) {
-        port = atoi(argv[1]);
-        if (port <= 0 || port > 65535) {
-            fprintf(stderr, "Invalid port: %s\n", argv[1]);
-            fprintf(stderr, "Usage: %s [port]\n", argv[0]);
-            return 1;
-        }
+    options_t opts = {
+        .port = 8080,
+        .access_log = NULL,
+        .access_log_format = ACCESS_LOG_TEXT,
+        .access_log_flush_ms = ACCESS_LOG_FLUSH_MS,
+        .request_id_format = REQUEST_ID_COMPACT,
+        .trace_sample_percent = TRACE_DEFAULT_SAMPLE_PERCENT,
+        .workers = 0,
+        .handoff_socket = NULL,
+        .drain_timeout_ms = SERVER_DRAIN_TIMEOUT_MS,
+        .affinity = NULL
+    };
+    
+    int rc = parse_options(argc, argv, &opts);
+    if (rc != 0) {
+        return rc < 0 ? 0 : 1;
     }
+    int port = opts.port;
+    bool prefork = opts.workers > 0;
+    request_id_set_format(opts.request_id_format);
     
     // Inicializar logger
     logger_init(LOG_INFO, NULL); // NULL = stderr
@@ -52,19 +323,28 @@ int main(int argc, char *argv[]) {
     LOG_INFO("===========================================");
     LOG_INFO("PID: %d", getpid());
     
-    // Inicializar job manager
-    LOG_INFO("Initializing Job Manager...");
-    if (job_manager_init("data/jobs") != 0) {
-        LOG_ERROR("Failed to initialize Job Manager");
+    // Los jobs quedan a nombre de este proceso (también los de sus workers)
+    job_manager_set_owner((long)getpid());
+    
+    // Modo prefork: métricas, contadores y trazas en memoria compartida.
+    // Tiene que existir antes de crear cualquiera de ellos.
+    if (prefork) {
+        if (shm_arena_init(SHM_ARENA_DEFAULT_SIZE) != 0) {
+            LOG_ERROR("Failed to map shared memory arena");
+            logger_shutdown();
+            return 1;
+        }
+        LOG_INFO("Prefork mode: %d worker processes", opts.workers);
+    }
+    
+    // Antes de crear los workers del executor (se fijan al arrancar)
+    if (affinity_init(opts.affinity) != 0) {
+        LOG_ERROR("Invalid --affinity: %s", opts.affinity);
         logger_shutdown();
         return 1;
     }
     
-    // Inicializar job executor (4 workers, cola de 100)
-    LOG_INFO("Initializing Job Executor (4 workers, queue depth: 100)...");
-    if (job_executor_init(4, 100) != 0) {
-        LOG_ERROR("Failed to initialize Job Executor");
-        job_manager_shutdown();
+    if (!prefork && start_jobs() != 0) {
         logger_shutdown();
         return 1;
     }
@@ -73,23 +353,68 @@ int main(int argc, char *argv[]) {
     LOG_INFO("Initializing Metrics System...");
     metrics_init();
     
+    // Trazas muestreadas (/debug/trace)
+    if (opts.trace_sample_percent > 0.0) {
+        LOG_INFO("Tracing %.2f%% of requests", opts.trace_sample_percent);
+        trace_init(opts.trace_sample_percent);
+    }
+    
+    // Access log (opcional)
+    if (opts.access_log &&
+        access_log_init(opts.access_log, opts.access_log_format, opts.access_log_flush_ms) != 0) {
+        LOG_ERROR("Failed to open access log %s", opts.access_log);
+        if (!prefork) stop_jobs(true);
+        logger_shutdown();
+        return 1;
+    }
+    
     // Configurar servidor
     server_config_t config = {
         .port = port,
         .max_connections = 100,
         .request_timeout_sec = 30,
         .max_request_size = 8192,
+        .drain_timeout_ms = opts.drain_timeout_ms,
         .running = false
     };
     
+    // Hot restart: si otro proceso escucha en el handoff socket, usar su listener
+    int listen_fd = -1;
+    if (opts.handoff_socket) {
+        listen_fd = handoff_takeover(opts.handoff_socket);
+        if (listen_fd == -2) {
+            LOG_ERROR("Hot restart failed");
+            if (!prefork) stop_jobs(true);
+            logger_shutdown();
+            return 1;
+        }
+    }
+    
     // Inicializar servidor
-    g_server = server_init(&config);
+    g_server = server_init_with_listener(&config, listen_fd);
     if (!g_server) {
         LOG_ERROR("Failed to initialize server");
         logger_shutdown();
         return 1;
     }
     
+    // Listo para atender: desde acá el proceso anterior (si lo hay) deja de aceptar
+    if (opts.handoff_socket &&
+        handoff_listen(opts.handoff_socket, g_server->server_fd, on_takeover) != 0) {
+        LOG_ERROR("Failed to open handoff socket %s", opts.handoff_socket);
+        if (!prefork) stop_jobs(true);
+        server_destroy(g_server);
+        logger_shutdown();
+        return 1;
+    }
+    if (!prefork) {
+        handoff_watch_predecessor(recover_jobs);
+    }
+    
+    if (prefork) {
+        LOG_INFO("Shared memory arena: %zu KB in use", shm_used() / 1024);
+    }
+    
     // Configurar signal handlers para graceful shutdown
     signal(SIGINT, signal_handler);   // Ctrl+C
     signal(SIGTERM, signal_handler);  // kill
@@ -98,25 +423,37 @@ int main(int argc, char *argv[]) {
     LOG_INFO("Try: curl http://localhost:%d/status", port);
     LOG_INFO("     curl http://localhost:%d/help", port);
     
-    // Iniciar servidor (bloquea hasta shutdown)
-    int result = server_start(g_server);
+    // Iniciar servidor (bloquea hasta shutdown). En modo prefork el master
+    // solo supervisa: los workers heredan el socket y hacen accept().
+    int result = prefork ? prefork_run(opts.workers, worker_main, NULL)
+                         : server_start(g_server);
     
     // Cleanup
     LOG_INFO("Cleaning up...");
     
-    LOG_INFO("Shutting down Job Executor...");
-    job_executor_shutdown();
+    bool drained = true;
+    if (!prefork) {
+        drained = finish_drain();
+        stop_jobs(drained);
+    }
     
-    LOG_INFO("Shutting down Job Manager...");
-    job_manager_shutdown();
+    // Los jobs ya están en disco: el proceso nuevo puede tomarlos
+    handoff_complete();
+    handoff_shutdown();
     
-    LOG_INFO("Shutting down Metrics...");
-    metrics_destroy();
+    access_log_shutdown();
+    trace_shutdown();
     
-    server_destroy(g_server);
+    // Con threads de conexión todavía vivos, liberar sería un use-after-free:
+    // el proceso termina igual
+    if (drained) {
+        LOG_INFO("Shutting down Metrics...");
+        metrics_destroy();
+        server_destroy(g_server);
+    }
     logger_shutdown();
     
     LOG_INFO("Server stopped successfully");
     
     return result == 0 ? 0 : 1;
-}
\ No newline at end of file
+}
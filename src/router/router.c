@@ -3,6 +3,9 @@
 #include "../core/job_manager.h"
 #include "../core/job_executor.h"
 #include "../core/metrics.h"
+#include "../core/trace.h"
+#include "../core/affinity.h"
+#include "../server/prefork.h"
 #include "../utils/utils.h"
 #include "../commands/basic/basic_commands.h"
 #include "../commands/cpu_bound/cpu_bound_commands.h"
@@ -18,7 +21,8 @@
    The helper was unused and generated a compiler warning; removing it keeps the
    code simpler until a shared JSON builder is added. */
 char* handle_pi(const char* digits_str);
-char* handle_mandelbrot(const char* width_str, const char* height_str, const char* max_iter_str);
+char* handle_mandelbrot(const char* width_str, const char* height_str, const char* max_iter_str,
+                        const char* center_x_str, const char* center_y_str, const char* zoom_str);
 char* handle_matrixmul(const char* size_str, const char* seed_str);
 
 // Construir un JSON sencillo a partir de query_params_t (todos strings)
@@ -74,6 +78,248 @@ static const char* job_status_to_string(job_status_t s) {
     }
 }
 
+// ============================================================================
+// DEADLINES POR RUTA
+// ============================================================================
+
+// Presupuesto por defecto de la ruta; X-Request-Timeout-Ms puede acortarlo
+// pero no extenderlo. Solo los comandos largos tienen default; el resto corre
+// sin deadline (o con el del header).
+static const struct {
+    const char *path;
+    long timeout_ms;
+} g_route_deadlines[] = {
+    { "/isprime",    10000 },
+    { "/factor",     60000 },
+    { "/primes",     30000 },
+    { "/isprime_batch", 10000 },
+    { "/fibonacci",  30000 },
+    { "/pi",         30000 },
+    { "/mandelbrot", 30000 },
+    { "/matrixmul",  60000 },
+    { "/sortfile",  120000 },
+    { "/wordcount",  60000 },
+    { "/grep",       60000 },
+    { "/compress",  120000 },
+    { "/decompress", 120000 },
+    { "/hashfile",   60000 },
+};
+
+// Rutas CPU-bound: con --affinity el handler corre en el set compute
+static const char *g_compute_routes[] = {
+    "/isprime", "/factor", "/primes", "/isprime_batch", "/fibonacci", "/pi",
+    "/mandelbrot", "/matrixmul"
+};
+
+static bool route_is_compute(const char *path) {
+    for (size_t i = 0; i < sizeof(g_compute_routes) / sizeof(g_compute_routes[0]); i++) {
+        if (strcmp(g_compute_routes[i], path) == 0) return true;
+    }
+    return false;
+}
+
+static long route_default_timeout_ms(const char *path) {
+    for (size_t i = 0; i < sizeof(g_route_deadlines) / sizeof(g_route_deadlines[0]); i++) {
+        if (strcmp(g_route_deadlines[i].path, path) == 0) {
+            return g_route_deadlines[i].timeout_ms;
+        }
+    }
+    return 0;
+}
+
+// Enviar el resultado de un handler de comando. Si el deadline de la request
+// venció mientras el handler corría, la respuesta ya no le sirve a nadie:
+// se descarta y se responde 504. Toma ownership de json.
+static ssize_t send_command_result(int client_fd, char *json, const char *request_id) {
+    if (deadline_expired()) {
+        free(json);
+        return http_send_error(client_fd, HTTP_GATEWAY_TIMEOUT, "Deadline exceeded", request_id);
+    }
+    if (!json) {
+        return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id);
+    }
+    ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
+    free(json);
+    return sent;
+}
+
+// ============================================================================
+// MÉTRICAS PROMETHEUS
+// ============================================================================
+
+// "10s", "10", "1m" -> segundos. Retorna -1 si es inválido o está fuera de
+// lo que guarda la ventana deslizante.
+static int parse_window_seconds(const char *value) {
+    char *end = NULL;
+    long n = strtol(value, &end, 10);
+    if (end == value || n <= 0) return -1;
+    
+    if (*end == 'm' && end[1] == '\0') {
+        n *= 60;
+    } else if (!(*end == '\0' || (*end == 's' && end[1] == '\0'))) {
+        return -1;
+    }
+    
+    return (n <= WINDOW_MAX_SECONDS) ? (int)n : -1;
+}
+
+// /metrics en JSON: acumulado, o la ventana de los últimos window_seconds
+// (> 0). Retorna el largo total como metrics_get_json
+static int metrics_json(char *buffer, size_t size, int window_seconds) {
+    return window_seconds > 0 ? metrics_get_window_json(buffer, size, window_seconds)
+                              : metrics_get_json(buffer, size);
+}
+
+// Callback de los generadores que escriben por partes (Prometheus, trazas)
+static void prometheus_emit(void *ctx, const char *data, size_t len) {
+    http_stream_write((http_stream_t*)ctx, data, len);
+}
+
+// /metrics/prometheus: se escribe directo al socket a medida que se genera,
+// sin armar el documento completo en memoria
+static ssize_t send_prometheus_metrics(int client_fd, const char *request_id,
+                                       server_state_t *server) {
+    http_stream_t stream;
+    if (http_stream_begin(&stream, client_fd, HTTP_OK,
+                          "text/plain; version=0.0.4; charset=utf-8", request_id) != 0) {
+        return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to start response", request_id);
+    }
+
+    server_stats_t stats = {0};
+    server_get_stats(server, &stats);
+    http_stream_printf(&stream,
+        "# HELP http_server_connections_total Connections accepted.\n"
+        "# TYPE http_server_connections_total counter\n"
+        "http_server_connections_total %lu\n"
+        "# HELP http_server_responses_total Responses by outcome.\n"
+        "# TYPE http_server_responses_total counter\n"
+        "http_server_responses_total{outcome=\"ok\"} %lu\n"
+        "http_server_responses_total{outcome=\"error\"} %lu\n"
+        "# HELP http_server_received_bytes_total Request bytes received.\n"
+        "# TYPE http_server_received_bytes_total counter\n"
+        "http_server_received_bytes_total %lu\n"
+        "# HELP http_server_sent_bytes_total Response bytes sent.\n"
+        "# TYPE http_server_sent_bytes_total counter\n"
+        "http_server_sent_bytes_total %lu\n",
+        stats.connections_served, stats.requests_ok, stats.requests_error,
+        stats.bytes_received, stats.bytes_sent);
+
+    metrics_write_prometheus(prometheus_emit, &stream);
+
+    return http_stream_end(&stream);
+}
+
+// /debug/trace: spans muestreados de los últimos N segundos en formato
+// trace_event de Chrome (se abre con Perfetto o chrome://tracing)
+static ssize_t send_trace(int client_fd, const char *request_id, int seconds) {
+    http_stream_t stream;
+    if (http_stream_begin(&stream, client_fd, HTTP_OK, "application/json", request_id) != 0) {
+        return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to start response", request_id);
+    }
+    trace_write_chrome_json(seconds, prometheus_emit, &stream);
+    return http_stream_end(&stream);
+}
+
+// /mandelbrot?format=u16|u8|pgm|png: el body sale por bandas de filas a medida
+// que se calculan
+typedef struct {
+    http_stream_t stream;
+    int client_fd;
+    const char *request_id;
+} mandelbrot_response_t;
+
+static int mandelbrot_begin(void *ctx, const char *content_type, const mandelbrot_view_t *view) {
+    mandelbrot_response_t *r = ctx;
+    // Los formatos crudos no dicen el tamaño: va en headers
+    char headers[128];
+    snprintf(headers, sizeof(headers),
+             "X-Image-Width: %d\r\nX-Image-Height: %d\r\nX-Max-Iter: %d\r\n",
+             view->width, view->height, view->max_iter);
+    return http_stream_begin_with_headers(&r->stream, r->client_fd, HTTP_OK, content_type,
+                                          r->request_id, headers);
+}
+
+static void mandelbrot_write(void *ctx, const void *data, size_t len) {
+    http_stream_write(&((mandelbrot_response_t*)ctx)->stream, data, len);
+}
+
+static int mandelbrot_flush(void *ctx) {
+    mandelbrot_response_t *r = ctx;
+    http_stream_flush(&r->stream);
+    return r->stream.error ? -1 : 0;
+}
+
+static ssize_t send_mandelbrot_stream(int client_fd, const char *request_id, query_params_t *qp,
+                                      const char *format) {
+    mandelbrot_response_t response = { .client_fd = client_fd, .request_id = request_id };
+    mandelbrot_sink_t sink = {
+        .begin = mandelbrot_begin,
+        .write = mandelbrot_write,
+        .flush = mandelbrot_flush,
+        .ctx = &response
+    };
+
+    char *error_json = NULL;
+    int rc = handle_mandelbrot_stream(get_query_param(qp, "width"), get_query_param(qp, "height"),
+                                      get_query_param(qp, "max_iter"), get_query_param(qp, "cx"),
+                                      get_query_param(qp, "cy"), get_query_param(qp, "zoom"),
+                                      format, &sink, &error_json);
+    if (rc == MANDELBROT_STREAM_ERROR) {
+        return send_command_result(client_fd, error_json, request_id);
+    }
+    // Cortado a mitad: el cliente ve el body incompleto al cerrarse la conexión
+    ssize_t sent = http_stream_end(&response.stream);
+    return rc == MANDELBROT_STREAM_OK ? sent : -1;
+}
+
+// /pi y /fibonacci: el resultado se calcula (o sale del caché) antes de mandar
+// nada, así un deadline vencido todavía puede ser un 504; después el JSON sale
+// por partes sin copiar los millones de dígitos a otro buffer
+typedef struct {
+    http_stream_t stream;
+    int client_fd;
+    const char *request_id;
+} json_stream_response_t;
+
+static int json_stream_begin(void *ctx) {
+    json_stream_response_t *r = ctx;
+    return http_stream_begin(&r->stream, r->client_fd, HTTP_OK, "application/json", r->request_id);
+}
+
+static void json_stream_write(void *ctx, const char *data, size_t len) {
+    http_stream_write(&((json_stream_response_t*)ctx)->stream, data, len);
+}
+
+static ssize_t send_pi_stream(int client_fd, const char *request_id, const char *digits) {
+    json_stream_response_t response = { .client_fd = client_fd, .request_id = request_id };
+    pi_sink_t sink = { .begin = json_stream_begin, .write = json_stream_write, .ctx = &response };
+
+    char *error_json = NULL;
+    int rc = handle_pi_stream(digits, &sink, &error_json);
+    if (rc == PI_STREAM_ERROR) {
+        return send_command_result(client_fd, error_json, request_id);
+    }
+    if (rc == PI_STREAM_ABORTED) {
+        return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to start response", request_id);
+    }
+    return http_stream_end(&response.stream);
+}
+
+static ssize_t send_fibonacci_stream(int client_fd, const char *request_id, const char *num) {
+    json_stream_response_t response = { .client_fd = client_fd, .request_id = request_id };
+    fibonacci_sink_t sink = { .begin = json_stream_begin, .write = json_stream_write, .ctx = &response };
+
+    char *error_json = NULL;
+    int rc = handle_fibonacci_stream(num, &sink, &error_json);
+    if (rc == FIBONACCI_STREAM_ERROR) {
+        return send_command_result(client_fd, error_json, request_id);
+    }
+    if (rc == FIBONACCI_STREAM_ABORTED) {
+        return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to start response", request_id);
+    }
+    return http_stream_end(&response.stream);
+}
+
 // Implementación de los endpoints de jobs
 
 static ssize_t handle_jobs_submit(int client_fd, const char *request_id, query_params_t *qp) {
@@ -137,6 +383,9 @@ static ssize_t handle_jobs_submit(int client_fd, const char *request_id, query_p
     }
     // task_create duplica path/query internamente; guardamos job_id en la tarea
     t->job_id = strdup(job_id);
+    
+    // Propagar el deadline de la request (si el cliente envió uno)
+    deadline_get(&t->deadline);
 
     // Encolar para ejecución asíncrona (job_executor toma ownership de task en caso de éxito)
     int rc = job_executor_enqueue(t);
@@ -237,13 +486,9 @@ ssize_t handle_jobs_request(const char *subpath, int client_fd, const char *requ
     return http_send_error(client_fd, HTTP_NOT_FOUND, "Invalid jobs endpoint", request_id);
 }
 
-ssize_t router_handle_request(const http_request_t *req, int client_fd,
-                              const char *request_id,
-                              server_state_t *server,
-                              size_t bytes_received) {
-    if (!req || client_fd < 0) return -1;
-    (void)bytes_received; // parámetro no usado en este router, evitar warning
-
+static ssize_t dispatch_request(const http_request_t *req, int client_fd,
+                                const char *request_id,
+                                server_state_t *server) {
     // Parsear query params
     query_params_t *qp = parse_query_string(req->query);
 
@@ -258,14 +503,7 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
             return http_send_error(client_fd, HTTP_BAD_REQUEST, "Missing 'num' parameter", request_id); 
         }
         
-        char *json = handle_fibonacci(num);
-        if (!json) {
-            free_query_params(qp);
-            return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id);
-        }
-        
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json);
+        ssize_t sent = send_fibonacci_stream(client_fd, request_id, num);
         free_query_params(qp);
         return sent;
     }
@@ -313,14 +551,20 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
     }
 
     if (strcmp(req->path, "/status") == 0) {
-        // Construir status JSON (básico)
-        char json[512];
+        // Construir status JSON (básico). En modo prefork los contadores son
+        // de toda la flota y pid es el worker que respondió (affinity.workers
+        // son los de ese proceso).
+        char affinity[3072];
+        affinity_write_json(affinity, sizeof(affinity));
+        char json[4096];
         long uptime = server_get_uptime(server);
         server_stats_t stats;
         server_get_stats(server, &stats);
+        int processes = prefork_num_workers() > 0 ? prefork_num_workers() : 1;
         int n = snprintf(json, sizeof(json),
-            "{\"status\":\"running\",\"pid\":%d,\"uptime_seconds\":%ld,\"connections_served\":%lu,\"requests_ok\":%lu,\"requests_error\":%lu}",
-            getpid(), uptime, stats.connections_served, stats.requests_ok, stats.requests_error);
+            "{\"status\":\"running\",\"pid\":%d,\"processes\":%d,\"worker_restarts\":%lu,\"uptime_seconds\":%ld,\"connections_served\":%lu,\"requests_ok\":%lu,\"requests_error\":%lu,\"affinity\":%s}",
+            getpid(), processes, prefork_restarts(), uptime,
+            stats.connections_served, stats.requests_ok, stats.requests_error, affinity);
         (void)n;
         ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
         free_query_params(qp);
@@ -487,15 +731,8 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
         }
         
         char *json = handle_isprime(n);
-        if (!json) {
-            free_query_params(qp);
-            return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id);
-        }
-        
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json);
         free_query_params(qp);
-        return sent;
+        return send_command_result(client_fd, json, request_id);
     }
 
     if (strcmp(req->path, "/factor") == 0) {
@@ -506,24 +743,32 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
         }
         
         char *json = handle_factor(n);
-        if (!json) {
-            free_query_params(qp);
-            return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id);
-        }
-        
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json);
         free_query_params(qp);
-        return sent;
+        return send_command_result(client_fd, json, request_id);
+    }
+
+    if (strcmp(req->path, "/primes") == 0) {
+        const char *to = get_query_param(qp, "to");
+        if (!to) { free_query_params(qp); return http_send_error(client_fd, HTTP_BAD_REQUEST, "Missing 'to' parameter", request_id); }
+        char *json = handle_primes(get_query_param(qp, "from"), to, get_query_param(qp, "list"));
+        free_query_params(qp);
+        return send_command_result(client_fd, json, request_id);
+    }
+
+    if (strcmp(req->path, "/isprime_batch") == 0) {
+        const char *nums = get_query_param(qp, "nums");
+        if (!nums) { free_query_params(qp); return http_send_error(client_fd, HTTP_BAD_REQUEST, "Missing 'nums' parameter", request_id); }
+        char *json = handle_isprime_batch(nums);
+        free_query_params(qp);
+        return send_command_result(client_fd, json, request_id);
     }
   
     if (strcmp(req->path, "/pi") == 0) {
         const char *digits = get_query_param(qp, "digits");
         if (!digits) { free_query_params(qp); return http_send_error(client_fd, HTTP_BAD_REQUEST, "Missing 'digits' parameter", request_id); }
-        char *json = handle_pi(digits);
-        if (!json) { free_query_params(qp); return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id); }
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json); free_query_params(qp); return sent;
+        ssize_t sent = send_pi_stream(client_fd, request_id, digits);
+        free_query_params(qp);
+        return sent;
     }
 
     if (strcmp(req->path, "/mandelbrot") == 0) {
@@ -531,10 +776,16 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
         const char *height = get_query_param(qp, "height");
         const char *max_iter = get_query_param(qp, "max_iter");
         if (!width || !height || !max_iter) { free_query_params(qp); return http_send_error(client_fd, HTTP_BAD_REQUEST, "Missing 'width','height' or 'max_iter' parameter", request_id); }
-        char *json = handle_mandelbrot(width, height, max_iter);
-        if (!json) { free_query_params(qp); return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id); }
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json); free_query_params(qp); return sent;
+        const char *format = get_query_param(qp, "format");
+        if (format && strcmp(format, "json") != 0) {
+            ssize_t sent = send_mandelbrot_stream(client_fd, request_id, qp, format);
+            free_query_params(qp);
+            return sent;
+        }
+        char *json = handle_mandelbrot(width, height, max_iter, get_query_param(qp, "cx"),
+                                       get_query_param(qp, "cy"), get_query_param(qp, "zoom"));
+        free_query_params(qp);
+        return send_command_result(client_fd, json, request_id);
     }
 
     if (strcmp(req->path, "/matrixmul") == 0) {
@@ -542,9 +793,8 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
         const char *seed = get_query_param(qp, "seed");
         if (!size || !seed) { free_query_params(qp); return http_send_error(client_fd, HTTP_BAD_REQUEST, "Missing 'size' or 'seed' parameter", request_id); }
         char *json = handle_matrixmul(size, seed);
-        if (!json) { free_query_params(qp); return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id); }
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json); free_query_params(qp); return sent;
+        free_query_params(qp);
+        return send_command_result(client_fd, json, request_id);
     }
     
     //*************************************** */
@@ -561,15 +811,8 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
         }
         
         char *json = handle_sortfile(name, algo);
-        if (!json) {
-            free_query_params(qp);
-            return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id);
-        }
-        
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json);
         free_query_params(qp);
-        return sent;
+        return send_command_result(client_fd, json, request_id);
     }
 
     if (strcmp(req->path, "/wordcount") == 0) {
@@ -580,16 +823,9 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
             return http_send_error(client_fd, HTTP_BAD_REQUEST, "Missing 'name' parameter", request_id); 
         }
         
-        char *json = handle_wordcount(name);
-        if (!json) {
-            free_query_params(qp);
-            return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id);
-        }
-        
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json);
+        char *json = handle_wordcount(name, get_query_param(qp, "threads"));
         free_query_params(qp);
-        return sent;
+        return send_command_result(client_fd, json, request_id);
     }
 
     if (strcmp(req->path, "/grep") == 0) {
@@ -602,15 +838,8 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
         }
 
         char *json = handle_grep(name, pattern);
-        if (!json) {
-            free_query_params(qp);
-            return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id);
-        }
-
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json);
         free_query_params(qp);
-        return sent;
+        return send_command_result(client_fd, json, request_id);
     }
 
     if (strcmp(req->path, "/compress") == 0) {
@@ -622,16 +851,22 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
             return http_send_error(client_fd, HTTP_BAD_REQUEST, "Missing 'name' or 'codec' parameter", request_id); 
         }
 
-        char *json = handle_compress(name, codec);
-        if (!json) {
-            free_query_params(qp);
-            return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id);
+        char *json = handle_compress(name, codec, get_query_param(qp, "threads"));
+        free_query_params(qp);
+        return send_command_result(client_fd, json, request_id);
+    }
+
+    if (strcmp(req->path, "/decompress") == 0) {
+        const char *name = get_query_param(qp, "name");
+
+        if (!name) { 
+            free_query_params(qp); 
+            return http_send_error(client_fd, HTTP_BAD_REQUEST, "Missing 'name' parameter", request_id); 
         }
 
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json);
+        char *json = handle_decompress(name, get_query_param(qp, "overwrite"));
         free_query_params(qp);
-        return sent;
+        return send_command_result(client_fd, json, request_id);
     }
 
     if (strcmp(req->path, "/hashfile") == 0) {
@@ -644,25 +879,56 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
         }
         
         char *json = handle_hashfile(name, algo);
-        if (!json) {
-            free_query_params(qp);
-            return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Failed to process request", request_id);
-        }
-        
-        ssize_t sent = http_send_json(client_fd, HTTP_OK, json, request_id);
-        free(json);
         free_query_params(qp);
-        return sent;
+        return send_command_result(client_fd, json, request_id);
     } 
 
+    if (strcmp(req->path, "/debug/trace") == 0) {
+        int seconds = get_query_param_int(qp, "seconds", 5);
+        free_query_params(qp);
+        if (seconds < 1 || seconds > TRACE_MAX_SECONDS) {
+            return http_send_error(client_fd, HTTP_BAD_REQUEST,
+                                   "Invalid 'seconds' (1..60)", request_id);
+        }
+        return send_trace(client_fd, request_id, seconds);
+    }
+
+    if (strcmp(req->path, "/metrics/prometheus") == 0) {
+        free_query_params(qp);
+        return send_prometheus_metrics(client_fd, request_id, server);
+    }
+
     if (strcmp(req->path, "/metrics") == 0) {
-        char *json = malloc(8192); // Buffer suficiente para las métricas
+        const char *window = get_query_param(qp, "window");
+        int window_seconds = 0;
+        if (window) {
+            window_seconds = parse_window_seconds(window);
+            if (window_seconds <= 0) {
+                free_query_params(qp);
+                return http_send_error(client_fd, HTTP_BAD_REQUEST,
+                                       "Invalid 'window' (use 1s..60s or 1m)", request_id);
+            }
+        }
+        
+        size_t cap = 16384;
+        char *json = malloc(cap);
         if (!json) {
             free_query_params(qp);
             return http_send_error(client_fd, HTTP_INTERNAL_ERROR, "Memory allocation failed", request_id);
         }
         
-        int written = metrics_get_json(json, 8192);
+        // metrics_get_json retorna el largo total: si no entró, agrandar y repetir
+        int written = metrics_json(json, cap, window_seconds);
+        while (written > 0 && (size_t)written >= cap) {
+            cap = (size_t)written + 1024;
+            char *tmp = realloc(json, cap);
+            if (!tmp) {
+                written = -1;
+                break;
+            }
+            json = tmp;
+            written = metrics_json(json, cap, window_seconds);
+        }
         if (written <= 0) {
             free(json);
             free_query_params(qp);
@@ -688,3 +954,61 @@ ssize_t router_handle_request(const http_request_t *req, int client_fd,
     return http_send_error(client_fd, HTTP_NOT_FOUND, "Endpoint not found", request_id);
 }
 
+ssize_t router_handle_request(const http_request_t *req, int client_fd,
+                              const char *request_id,
+                              server_state_t *server,
+                              size_t bytes_received,
+                              router_result_t *result) {
+    if (!req || client_fd < 0) return -1;
+    (void)bytes_received; // parámetro no usado en este router, evitar warning
+
+    // Deadline: el default de la ruta, o el header del cliente si es menor (el
+    // header solo puede acortarlo); sin default, el header (ya recortado)
+    long timeout_ms = route_default_timeout_ms(req->path);
+    if (req->timeout_ms > 0 && (timeout_ms <= 0 || req->timeout_ms < timeout_ms)) {
+        timeout_ms = req->timeout_ms;
+    }
+    if (timeout_ms > 0) {
+        struct timeval deadline;
+        deadline_from_timeout_ms(&deadline, timeout_ms);
+        deadline_set(&deadline);
+    } else {
+        deadline_clear();
+    }
+
+    // Fases EXEC y WRITE: http_send_* acumula por thread el tiempo de
+    // escritura, el resto del dispatch es ejecución del handler
+    http_timer_t timer;
+    http_take_write_time_us();
+    http_take_last_status();
+    timer_start(&timer);
+
+    int compute = route_is_compute(req->path) ? affinity_enter_compute() : 0;
+    TRACE_BEGIN(handler_span);
+    ssize_t sent = dispatch_request(req, client_fd, request_id, server);
+    TRACE_END("handler", handler_span);
+    affinity_leave_compute(compute);
+
+    timer_stop(&timer);
+    unsigned long write_us = http_take_write_time_us();
+    long total_us = timer_elapsed_us(&timer);
+    unsigned long exec_us = (total_us > (long)write_us) ? (unsigned long)total_us - write_us : 0;
+
+    const char *command = metrics_command_from_path(req->path);
+    metrics_record_phase(command, METRICS_PHASE_EXEC, exec_us);
+    metrics_record_phase(command, METRICS_PHASE_WRITE, write_us);
+
+    // Ventana deslizante: los 5xx y los envíos fallidos cuentan como error
+    int status = http_take_last_status();
+    metrics_record_request(command, (unsigned long)(total_us > 0 ? total_us : 0),
+                           sent < 0 || status >= 500);
+
+    if (result) {
+        result->status = status;
+        result->exec_us = exec_us;
+        result->write_us = write_us;
+    }
+
+    deadline_clear();
+    return sent;
+}
@@ -7,13 +7,22 @@
 #include "../server/server.h"
 #include "../utils/utils.h"  // Para query_params_t
 
+// Resultado de un request para el access log
+typedef struct {
+    int status;                 // Status HTTP enviado (0 si no se envió nada)
+    unsigned long exec_us;
+    unsigned long write_us;
+} router_result_t;
+
 // Maneja una petición HTTP parseada. Debe escribir la respuesta al socket
 // client_fd y retornar el número de bytes enviados o -1 en caso de error.
 // bytes_received se pasa para que el router pueda reportar métricas si lo desea.
+// result (opcional) recibe el status y los tiempos de ejecución y escritura.
 ssize_t router_handle_request(const http_request_t *req, int client_fd,
                               const char *request_id,
                               server_state_t *server,
-                              size_t bytes_received);
+                              size_t bytes_received,
+                              router_result_t *result);
 
 ssize_t handle_jobs_request(const char *subpath, int client_fd,
                           const char *request_id, query_params_t *qp);
@@ -0,0 +1,283 @@
+// Hot restart: entrega del socket de escucha por SCM_RIGHTS
+#include "handoff.h"
+#include "../core/shm.h"
+#include "../utils/utils.h"
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+typedef struct {
+    int requested;              // Un proceso nuevo tomó el listener
+    int recovered;              // Los jobs del anterior ya se re-encolaron
+} handoff_shared_t;
+
+static struct {
+    char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+    int unix_fd;                // Socket Unix en listen()
+    int listen_fd;              // Listener TCP que se entrega
+    int successor;              // Conexión con el proceso nuevo (lado viejo)
+    int predecessor;            // Conexión con el proceso anterior (lado nuevo)
+    long predecessor_pid;       // Su pid (viene en el mensaje 'F')
+    void (*on_takeover)(void);
+    void (*on_done)(void);
+    handoff_shared_t *shared;
+} g_handoff = { .unix_fd = -1, .listen_fd = -1, .successor = -1, .predecessor = -1 };
+
+static int make_address(const char *path, struct sockaddr_un *addr) {
+    if (!path || strlen(path) >= sizeof(addr->sun_path)) return -1;
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+static int write_byte(int fd, char c) {
+    ssize_t n;
+    do {
+        n = write(fd, &c, 1);
+    } while (n < 0 && errno == EINTR);
+    return n == 1 ? 0 : -1;
+}
+
+// Retorna el byte leído, o -1 si EOF/error/timeout
+static int read_byte(int fd) {
+    char c;
+    ssize_t n;
+    do {
+        n = read(fd, &c, 1);
+    } while (n < 0 && errno == EINTR);
+    return n == 1 ? (unsigned char)c : -1;
+}
+
+// ============================================================================
+// SCM_RIGHTS
+// ============================================================================
+
+// Mensaje 'F': tag + pid del proceso que entrega (dueño de sus jobs), con el
+// fd como dato auxiliar
+#define HANDOFF_HELLO_LEN (1 + sizeof(int32_t))
+
+static int send_fd(int sock, int fd) {
+    char hello[HANDOFF_HELLO_LEN];
+    int32_t pid = (int32_t)getpid();
+    hello[0] = 'F';
+    memcpy(hello + 1, &pid, sizeof(pid));
+    struct iovec iov = { .iov_base = hello, .iov_len = sizeof(hello) };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = control.buf, .msg_controllen = sizeof(control.buf)
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    ssize_t n;
+    do {
+        n = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t)sizeof(hello) ? 0 : -1;
+}
+
+static int recv_fd(int sock, long *pid) {
+    char hello[HANDOFF_HELLO_LEN] = { 0 };
+    struct iovec iov = { .iov_base = hello, .iov_len = sizeof(hello) };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct msghdr msg = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = control.buf, .msg_controllen = sizeof(control.buf)
+    };
+
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n != (ssize_t)sizeof(hello) || hello[0] != 'F') return -1;
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int))) {
+        return -1;
+    }
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    int32_t sender;
+    memcpy(&sender, hello + 1, sizeof(sender));
+    *pid = sender;
+    return fd;
+}
+
+// ============================================================================
+// LADO NUEVO
+// ============================================================================
+
+int handoff_takeover(const char *path) {
+    struct sockaddr_un addr;
+    if (make_address(path, &addr) != 0) return -2;
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -2;
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        // Nadie escucha (o socket viejo de un proceso muerto): arranque normal
+        close(sock);
+        return -1;
+    }
+
+    int fd = recv_fd(sock, &g_handoff.predecessor_pid);
+    if (fd < 0) {
+        LOG_ERROR("Handoff: no listener received from %s", path);
+        close(sock);
+        return -2;
+    }
+
+    g_handoff.predecessor = sock;
+    LOG_INFO("Handoff: took over listener from PID %ld", g_handoff.predecessor_pid);
+    return fd;
+}
+
+static void* predecessor_thread(void *arg) {
+    (void)arg;
+
+    // 'D' o EOF: en los dos casos el anterior ya no ejecuta nada
+    int c = read_byte(g_handoff.predecessor);
+    LOG_INFO("Handoff: previous process %s", c == 'D' ? "finished" : "went away");
+
+    // Un worker relanzado vuelve a esperar: solo el primero re-encola
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&g_handoff.shared->recovered, &expected, 1, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        g_handoff.on_done();
+    }
+    return NULL;
+}
+
+void handoff_watch_predecessor(void (*on_done)(void)) {
+    if (g_handoff.predecessor < 0 || !on_done || !g_handoff.shared) return;
+
+    g_handoff.on_done = on_done;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, predecessor_thread, NULL) == 0) {
+        pthread_detach(thread);
+    }
+}
+
+// ============================================================================
+// LADO VIEJO
+// ============================================================================
+
+static void* listener_thread(void *arg) {
+    (void)arg;
+
+    for (;;) {
+        int conn = accept(g_handoff.unix_fd, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return NULL;    // handoff_shutdown() cerró el socket
+        }
+        fcntl(conn, F_SETFD, FD_CLOEXEC);
+
+        struct timeval tv = { .tv_sec = HANDOFF_READY_TIMEOUT_SEC, .tv_usec = 0 };
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        LOG_INFO("Handoff: new process connected, sending listener");
+        if (send_fd(conn, g_handoff.listen_fd) != 0 || read_byte(conn) != 'R') {
+            // El nuevo falló antes de estar listo: seguir atendiendo
+            LOG_WARN("Handoff aborted: new process not ready");
+            close(conn);
+            continue;
+        }
+
+        LOG_INFO("Handoff: new process ready, draining");
+        g_handoff.successor = conn;
+        __atomic_store_n(&g_handoff.shared->requested, 1, __ATOMIC_RELEASE);
+        if (g_handoff.on_takeover) g_handoff.on_takeover();
+        return NULL;
+    }
+}
+
+int handoff_listen(const char *path, int listen_fd, void (*on_takeover)(void)) {
+    struct sockaddr_un addr;
+    if (make_address(path, &addr) != 0 || listen_fd < 0) return -1;
+
+    g_handoff.shared = shm_alloc(sizeof(handoff_shared_t));
+    if (!g_handoff.shared) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    // El path puede ser del proceso anterior (ya nos entregó el listener) o
+    // de uno que murió sin borrarlo
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        LOG_ERROR("Handoff: cannot listen on %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    chmod(path, 0600);
+
+    snprintf(g_handoff.path, sizeof(g_handoff.path), "%s", path);
+    g_handoff.unix_fd = fd;
+    g_handoff.listen_fd = listen_fd;
+    g_handoff.on_takeover = on_takeover;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, listener_thread, NULL) != 0) {
+        close(fd);
+        g_handoff.unix_fd = -1;
+        return -1;
+    }
+    pthread_detach(thread);
+
+    // Recién ahora el anterior puede dejar de aceptar
+    if (g_handoff.predecessor >= 0 && write_byte(g_handoff.predecessor, 'R') != 0) {
+        LOG_WARN("Handoff: previous process did not get the ready signal");
+    }
+    LOG_INFO("Handoff socket: %s", path);
+    return 0;
+}
+
+long handoff_predecessor_pid(void) {
+    return g_handoff.predecessor_pid;
+}
+
+bool handoff_requested(void) {
+    return g_handoff.shared && __atomic_load_n(&g_handoff.shared->requested, __ATOMIC_ACQUIRE);
+}
+
+void handoff_complete(void) {
+    if (g_handoff.successor < 0) return;
+
+    write_byte(g_handoff.successor, 'D');
+    close(g_handoff.successor);
+    g_handoff.successor = -1;
+    LOG_INFO("Handoff complete");
+}
+
+void handoff_shutdown(void) {
+    if (g_handoff.unix_fd < 0) return;
+
+    // Despierta el accept() del listener_thread
+    shutdown(g_handoff.unix_fd, SHUT_RDWR);
+    close(g_handoff.unix_fd);
+    g_handoff.unix_fd = -1;
+
+    // Si hubo relevo el path ya es del proceso nuevo
+    if (!handoff_requested()) unlink(g_handoff.path);
+}
@@ -0,0 +1,77 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <stdbool.h>
+
+// ============================================================================
+// HANDOFF - Hot restart pasando el socket de escucha a un proceso nuevo
+// ============================================================================
+//
+// Con --handoff-socket PATH el servidor escucha en un socket Unix. Un binario
+// nuevo arrancado con el mismo PATH se conecta y:
+//
+//   viejo -> nuevo   'F' + su pid, y el fd del listener TCP (SCM_RIGHTS)
+//   nuevo -> viejo   'R' cuando ya puede atender (mismo socket, sin bind)
+//   viejo -> nuevo   'D' cuando terminó las conexiones en curso y los jobs
+//                    que estaban corriendo
+//
+// Entre 'R' y 'D' los dos procesos hacen accept() sobre el mismo socket: no
+// se pierde ninguna conexión. Los jobs que el viejo tenía en cola quedan
+// QUEUED en disco y el nuevo los re-encola al recibir 'D' (o EOF, si el
+// viejo murió).
+
+#define HANDOFF_READY_TIMEOUT_SEC  30     // Espera máxima del 'R'
+#define HANDOFF_DRAIN_TIMEOUT_MS   30000  // Conexiones en curso en el proceso viejo
+
+/**
+ * Tomar el listener de un proceso que escucha en path
+ *
+ * @param path Socket Unix del proceso anterior
+ * @return fd del listener TCP, -1 si no hay proceso anterior (arranque
+ *         normal), -2 si lo hay pero el handoff falló
+ */
+int handoff_takeover(const char *path);
+
+/**
+ * Empezar a escuchar en path para el próximo hot restart. Si este proceso
+ * tomó el listener de otro, le avisa que ya está listo ('R').
+ *
+ * Llamar antes de fork() en modo prefork (reserva estado compartido).
+ *
+ * @param path Socket Unix
+ * @param listen_fd Listener TCP a entregar
+ * @param on_takeover Se llama (desde el thread del handoff) cuando un proceso
+ *                    nuevo tomó el listener: hay que dejar de aceptar
+ * @return 0 si éxito, -1 si error
+ */
+int handoff_listen(const char *path, int listen_fd, void (*on_takeover)(void));
+
+/**
+ * true si un proceso nuevo tomó el listener (visible en todos los workers)
+ */
+bool handoff_requested(void);
+
+/**
+ * PID del proceso que entregó el listener (0 si no hubo)
+ */
+long handoff_predecessor_pid(void);
+
+/**
+ * Proceso viejo: avisar al nuevo que ya no ejecuta nada ('D')
+ */
+void handoff_complete(void);
+
+/**
+ * Proceso nuevo: esperar en un thread el 'D' del anterior y entonces llamar
+ * a on_done una sola vez en toda la flota (para re-encolar sus jobs)
+ *
+ * @param on_done Callback; no se llama si no hubo proceso anterior
+ */
+void handoff_watch_predecessor(void (*on_done)(void));
+
+/**
+ * Cerrar el socket Unix (lo borra si nadie tomó el relevo)
+ */
+void handoff_shutdown(void);
+
+#endif // HANDOFF_H
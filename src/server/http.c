@@ -1,11 +1,13 @@
 // Parser + Response builder (combinado)
 #include "http.h"
 #include "../utils/utils.h"
+#include "../core/trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <stdarg.h>
 
 // Helper: ensure all bytes are written to the socket (handle partial writes)
 static ssize_t write_all(int fd, const void *buf, size_t len) {
@@ -25,6 +27,24 @@ static ssize_t write_all(int fd, const void *buf, size_t len) {
     return (ssize_t)len;
 }
 
+// Tiempo de escritura acumulado por thread (ver http_take_write_time_us)
+static __thread unsigned long tl_write_time_us = 0;
+
+unsigned long http_take_write_time_us(void) {
+    unsigned long us = tl_write_time_us;
+    tl_write_time_us = 0;
+    return us;
+}
+
+// Último status enviado por este thread (ver http_take_last_status)
+static __thread int tl_last_status = 0;
+
+int http_take_last_status(void) {
+    int status = tl_last_status;
+    tl_last_status = 0;
+    return status;
+}
+
 // ============================================================================
 // HTTP PARSING
 // ============================================================================
@@ -114,6 +134,15 @@ int http_parse_request(const char *raw_request, http_request_t *request) {
                 if (strcasecmp(value, "keep-alive") == 0) {
                     request->connection_close = false;
                 }
+            } else if (strcasecmp(key, "X-Request-Timeout-Ms") == 0) {
+                // Valores inválidos o <= 0 se ignoran (sin deadline); los
+                // enormes (incluido el overflow de strtol) se recortan al tope
+                char *end;
+                long ms = strtol(value, &end, 10);
+                if (end != value && ms > 0) {
+                    request->timeout_ms = ms < HTTP_MAX_REQUEST_TIMEOUT_MS
+                                        ? ms : HTTP_MAX_REQUEST_TIMEOUT_MS;
+                }
             }
         }
         
@@ -160,21 +189,20 @@ const char* http_status_text(int status_code) {
         case 429: return "Too Many Requests";
         case 500: return "Internal Server Error";
         case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
         default:  return "Unknown";
     }
 }
 
-int http_send_response(int client_fd, const http_response_t *response) {
-    if (client_fd < 0 || !response) {
-        return -1;
-    }
-    
-    char header_buffer[4096];
+// Construir status line + headers. content_length < 0 omite Content-Length
+// (respuestas en streaming: el cierre de la conexión delimita el body).
+static int format_headers(const http_response_t *response, long content_length,
+                          char *header_buffer, size_t buffer_size) {
     int header_len = 0;
     
     // Status line
     header_len += snprintf(header_buffer + header_len, 
-                          sizeof(header_buffer) - header_len,
+                          buffer_size - header_len,
                           "HTTP/1.0 %d %s\r\n",
                           response->status_code,
                           http_status_text(response->status_code));
@@ -182,69 +210,90 @@ int http_send_response(int client_fd, const http_response_t *response) {
     // Content-Type
     if (response->content_type) {
         header_len += snprintf(header_buffer + header_len,
-                              sizeof(header_buffer) - header_len,
+                              buffer_size - header_len,
                               "Content-Type: %s\r\n",
                               response->content_type);
     }
     
     // Content-Length
-    size_t body_len = response->body_length > 0 ? 
-                      response->body_length : 
-                      (response->body ? strlen(response->body) : 0);
-    
-    header_len += snprintf(header_buffer + header_len,
-                          sizeof(header_buffer) - header_len,
-                          "Content-Length: %zu\r\n",
-                          body_len);
+    if (content_length >= 0) {
+        header_len += snprintf(header_buffer + header_len,
+                              buffer_size - header_len,
+                              "Content-Length: %ld\r\n",
+                              content_length);
+    }
     
     // X-Request-Id
     if (response->request_id) {
         header_len += snprintf(header_buffer + header_len,
-                              sizeof(header_buffer) - header_len,
+                              buffer_size - header_len,
                               "X-Request-Id: %s\r\n",
                               response->request_id);
     }
     
     // X-Worker-Pid
     header_len += snprintf(header_buffer + header_len,
-                          sizeof(header_buffer) - header_len,
+                          buffer_size - header_len,
                           "X-Worker-Pid: %d\r\n",
                           response->worker_pid);
     
     // Connection: close (HTTP/1.0)
     header_len += snprintf(header_buffer + header_len,
-                          sizeof(header_buffer) - header_len,
+                          buffer_size - header_len,
                           "Connection: close\r\n");
     
     // Headers extra (si existen)
     if (response->extra_headers) {
         header_len += snprintf(header_buffer + header_len,
-                              sizeof(header_buffer) - header_len,
+                              buffer_size - header_len,
                               "%s",
                               response->extra_headers);
     }
     
     // Línea vacía para separar headers del body
     header_len += snprintf(header_buffer + header_len,
-                          sizeof(header_buffer) - header_len,
+                          buffer_size - header_len,
                           "\r\n");
     
-    // Enviar headers (asegurando escrituras completas)
-    ssize_t sent = write_all(client_fd, header_buffer, (size_t)header_len);
-    if (sent < 0) {
+    return header_len;
+}
+
+int http_send_response(int client_fd, const http_response_t *response) {
+    if (client_fd < 0 || !response) {
         return -1;
     }
-
+    
+    tl_last_status = response->status_code;
+    
+    size_t body_len = response->body_length > 0 ? 
+                      response->body_length : 
+                      (response->body ? strlen(response->body) : 0);
+    
+    char header_buffer[4096];
+    int header_len = format_headers(response, (long)body_len,
+                                    header_buffer, sizeof(header_buffer));
+    
+    http_timer_t timer;
+    TRACE_BEGIN(write_span);
+    timer_start(&timer);
+    
+    // Enviar headers (asegurando escrituras completas)
+    ssize_t sent = write_all(client_fd, header_buffer, (size_t)header_len);
+    
     // Enviar body si existe
-    if (response->body && body_len > 0) {
-        ssize_t body_sent = write_all(client_fd, response->body, body_len);
-        if (body_sent < 0) {
-            return -1;
-        }
-        return header_len + body_sent;
+    ssize_t body_sent = 0;
+    if (sent >= 0 && response->body && body_len > 0) {
+        body_sent = write_all(client_fd, response->body, body_len);
     }
-
-    return header_len;
+    
+    timer_stop(&timer);
+    TRACE_END("write", write_span);
+    tl_write_time_us += (unsigned long)timer_elapsed_us(&timer);
+    
+    if (sent < 0 || body_sent < 0) {
+        return -1;
+    }
+    return header_len + (int)body_sent;
 }
 
 int http_send_json(int client_fd, int status_code, const char *json_body,
@@ -317,6 +366,139 @@ int http_send_503_backpressure(int client_fd, int retry_after_ms,
     return http_send_response(client_fd, &response);
 }
 
+// ============================================================================
+// HTTP STREAMING
+// ============================================================================
+
+// Enviar lo acumulado en el buffer del stream
+static void stream_flush(http_stream_t *stream) {
+    if (stream->error || stream->len == 0) {
+        stream->len = 0;
+        return;
+    }
+    
+    http_timer_t timer;
+    TRACE_BEGIN(write_span);
+    timer_start(&timer);
+    ssize_t w = write_all(stream->fd, stream->buf, stream->len);
+    timer_stop(&timer);
+    TRACE_END("write", write_span);
+    tl_write_time_us += (unsigned long)timer_elapsed_us(&timer);
+    
+    if (w < 0) {
+        stream->error = true;
+    } else {
+        stream->total += (size_t)w;
+    }
+    stream->len = 0;
+}
+
+int http_stream_begin(http_stream_t *stream, int client_fd, int status_code,
+                      const char *content_type, const char *request_id) {
+    return http_stream_begin_with_headers(stream, client_fd, status_code, content_type,
+                                          request_id, NULL);
+}
+
+int http_stream_begin_with_headers(http_stream_t *stream, int client_fd, int status_code,
+                                   const char *content_type, const char *request_id,
+                                   const char *extra_headers) {
+    if (!stream || client_fd < 0) {
+        return -1;
+    }
+    
+    tl_last_status = status_code;
+    
+    stream->fd = client_fd;
+    stream->len = 0;
+    stream->total = 0;
+    stream->error = false;
+    
+    http_response_t response = {
+        .status_code = status_code,
+        .content_type = content_type,
+        .request_id = request_id,
+        .worker_pid = getpid(),
+        .extra_headers = extra_headers
+    };
+    
+    // Los headers quedan en el buffer y salen con el primer flush
+    int header_len = format_headers(&response, -1, stream->buf, sizeof(stream->buf));
+    if (header_len < 0 || (size_t)header_len >= sizeof(stream->buf)) {
+        stream->error = true;
+        return -1;
+    }
+    stream->len = (size_t)header_len;
+    return 0;
+}
+
+void http_stream_write(http_stream_t *stream, const void *data, size_t len) {
+    if (!stream || stream->error || !data) return;
+    
+    const char *p = data;
+    while (len > 0) {
+        size_t space = sizeof(stream->buf) - stream->len;
+        if (space == 0) {
+            stream_flush(stream);
+            if (stream->error) return;
+            continue;
+        }
+        size_t n = len < space ? len : space;
+        memcpy(stream->buf + stream->len, p, n);
+        stream->len += n;
+        p += n;
+        len -= n;
+    }
+}
+
+void http_stream_printf(http_stream_t *stream, const char *fmt, ...) {
+    if (!stream || stream->error) return;
+    
+    va_list args;
+    va_start(args, fmt);
+    size_t space = sizeof(stream->buf) - stream->len;
+    int n = vsnprintf(stream->buf + stream->len, space, fmt, args);
+    va_end(args);
+    
+    if (n < 0) {
+        return;
+    }
+    if ((size_t)n < space) {
+        stream->len += (size_t)n;
+        return;
+    }
+    
+    // No entró: vaciar el buffer y reintentar (o formatear aparte si es enorme)
+    stream_flush(stream);
+    if (stream->error) return;
+    
+    va_start(args, fmt);
+    if ((size_t)n < sizeof(stream->buf)) {
+        vsnprintf(stream->buf, sizeof(stream->buf), fmt, args);
+        stream->len = (size_t)n;
+    } else {
+        char *tmp = malloc((size_t)n + 1);
+        if (tmp) {
+            vsnprintf(tmp, (size_t)n + 1, fmt, args);
+            http_stream_write(stream, tmp, (size_t)n);
+            free(tmp);
+        } else {
+            stream->error = true;
+        }
+    }
+    va_end(args);
+}
+
+void http_stream_flush(http_stream_t *stream) {
+    if (stream) stream_flush(stream);
+}
+
+ssize_t http_stream_end(http_stream_t *stream) {
+    if (!stream) return -1;
+    
+    stream_flush(stream);
+    return stream->error ? -1 : (ssize_t)stream->total;
+}
+
 // ============================================================================
 // HTTP UTILITIES
 // ============================================================================
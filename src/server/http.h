@@ -4,6 +4,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <sys/types.h>
 
 
 // ============================================================================
@@ -17,11 +18,16 @@
 #define HTTP_TOO_MANY_REQUESTS     429
 #define HTTP_INTERNAL_ERROR        500
 #define HTTP_SERVICE_UNAVAILABLE   503
+#define HTTP_GATEWAY_TIMEOUT       504
 
 // ============================================================================
 // HTTP STRUCTURES
 // ============================================================================
 
+// Tope de X-Request-Timeout-Ms: valores mayores se recortan a esto. Las rutas
+// con deadline por defecto además usan el menor entre el header y su default
+#define HTTP_MAX_REQUEST_TIMEOUT_MS 600000L
+
 // Estructura de un HTTP request parseado
 typedef struct {
     char method[16];           // GET, HEAD, etc.
@@ -31,6 +37,7 @@ typedef struct {
     char host[256];            // Host header (opcional)
     int content_length;        // Content-Length header
     bool connection_close;     // Connection: close
+    long timeout_ms;           // X-Request-Timeout-Ms (0 = sin deadline)
 } http_request_t;
 
 // Estructura de un HTTP response
@@ -144,6 +151,83 @@ int http_send_error(int client_fd, int status_code, const char *error_message,
 int http_send_503_backpressure(int client_fd, int retry_after_ms, 
                                 const char *request_id);
 
+/**
+ * Tiempo acumulado (en microsegundos) que el thread actual pasó escribiendo
+ * respuestas al socket desde la última llamada. Resetea el acumulador.
+ * 
+ * Lo usa el router para separar la fase de escritura de la de ejecución.
+ * 
+ * @return Microsegundos de escritura del thread actual
+ */
+unsigned long http_take_write_time_us(void);
+
+/**
+ * Último status HTTP enviado por el thread actual (0 si no envió nada desde
+ * la última llamada). Resetea el valor.
+ * 
+ * @return Código de status
+ */
+int http_take_last_status(void);
+
+// ============================================================================
+// HTTP STREAMING
+// ============================================================================
+
+// Respuesta escrita por partes, sin armar el body completo en memoria.
+// HTTP/1.0 sin Content-Length: el cierre de la conexión marca el fin del body.
+typedef struct {
+    int fd;
+    char buf[8192];            // Se vacía al socket cuando se llena
+    size_t len;
+    size_t total;              // Bytes ya enviados (headers incluidos)
+    bool error;                // Falló un write: el resto se descarta
+} http_stream_t;
+
+/**
+ * Iniciar una respuesta en streaming (status line + headers)
+ * 
+ * @param stream Estado del stream (lo inicializa esta función)
+ * @param client_fd File descriptor del cliente
+ * @param status_code Código HTTP
+ * @param content_type Content-Type de la respuesta
+ * @param request_id Request ID único
+ * @return 0 si éxito, -1 si error
+ */
+int http_stream_begin(http_stream_t *stream, int client_fd, int status_code,
+                      const char *content_type, const char *request_id);
+
+/**
+ * Como http_stream_begin, con headers extra ("Nombre: valor\r\n" cada uno)
+ */
+int http_stream_begin_with_headers(http_stream_t *stream, int client_fd, int status_code,
+                                   const char *content_type, const char *request_id,
+                                   const char *extra_headers);
+
+/**
+ * Agregar bytes al body
+ */
+void http_stream_write(http_stream_t *stream, const void *data, size_t len);
+
+/**
+ * Agregar texto formateado al body
+ */
+void http_stream_printf(http_stream_t *stream, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * Mandar ya lo acumulado (sin esperar a llenar el buffer); stream->error
+ * queda en true si el cliente se fue
+ */
+void http_stream_flush(http_stream_t *stream);
+
+/**
+ * Enviar lo que quede en el buffer
+ * 
+ * @param stream Stream iniciado con http_stream_begin
+ * @return Bytes enviados en total, o -1 si algún write falló
+ */
+ssize_t http_stream_end(http_stream_t *stream);
+
 // ============================================================================
 // HTTP UTILITIES
 // ============================================================================
@@ -0,0 +1,176 @@
+// Modo prefork: master + N procesos worker
+#include "prefork.h"
+#include "../core/shm.h"
+#include "../utils/utils.h"
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+#define PREFORK_BACKOFF_MIN_MS  100
+#define PREFORK_BACKOFF_MAX_MS  5000
+#define PREFORK_MIN_UPTIME_MS   1000    // Menos que esto cuenta como crash al arrancar
+
+typedef struct {
+    pid_t pid;                  // 0 = slot sin proceso
+    long started_ms;
+    long backoff_ms;
+} prefork_slot_t;
+
+static struct {
+    volatile sig_atomic_t stop;
+    bool master;
+    int slot;
+    int num_workers;
+    prefork_slot_t workers[PREFORK_MAX_WORKERS];
+    unsigned long *restarts;    // En shm: lo leen los workers para /status
+} g_prefork = { .slot = -1 };
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+// Dormir hasta ms milisegundos, cortando antes si llega prefork_stop()
+static void sleep_unless_stopped(long ms) {
+    while (ms > 0 && !g_prefork.stop) {
+        long step = ms < 50 ? ms : 50;
+        struct timespec pause = { 0, step * 1000000L };
+        nanosleep(&pause, NULL);
+        ms -= step;
+    }
+}
+
+// ============================================================================
+// WORKERS
+// ============================================================================
+
+static int spawn_worker(int slot, prefork_worker_fn worker_main, void *ctx) {
+    logger_flush();     // Que el hijo no herede mensajes a medio escribir
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        LOG_ERROR("fork() failed for worker %d: %s", slot, strerror(errno));
+        return -1;
+    }
+
+    if (pid == 0) {
+        g_prefork.master = false;
+        g_prefork.slot = slot;
+        // Si el master muere (incluso con SIGKILL) los workers no quedan huérfanos
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() == 1) _exit(0);
+        _exit(worker_main(slot, ctx));
+    }
+
+    g_prefork.workers[slot].pid = pid;
+    g_prefork.workers[slot].started_ms = now_ms();
+
+    // prefork_stop() pudo llegar entre el fork y el registro del pid
+    if (g_prefork.stop) kill(pid, SIGTERM);
+    return 0;
+}
+
+static int find_slot(pid_t pid) {
+    for (int i = 0; i < g_prefork.num_workers; i++) {
+        if (g_prefork.workers[i].pid == pid) return i;
+    }
+    return -1;
+}
+
+// ============================================================================
+// MASTER
+// ============================================================================
+
+int prefork_run(int num_workers, prefork_worker_fn worker_main, void *ctx) {
+    if (num_workers < 1 || num_workers > PREFORK_MAX_WORKERS || !worker_main) {
+        return -1;
+    }
+
+    g_prefork.master = true;
+    g_prefork.num_workers = num_workers;
+    g_prefork.restarts = shm_alloc(sizeof(unsigned long));
+    if (!g_prefork.restarts) return -1;
+
+    int live = 0;
+    for (int i = 0; i < num_workers; i++) {
+        g_prefork.workers[i].backoff_ms = PREFORK_BACKOFF_MIN_MS;
+        if (spawn_worker(i, worker_main, ctx) == 0) live++;
+    }
+    if (live == 0) {
+        g_prefork.master = false;
+        return -1;
+    }
+    LOG_INFO("Prefork master %d supervising %d workers", getpid(), num_workers);
+
+    while (live > 0) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;      // ECHILD: no queda nadie
+        }
+
+        int slot = find_slot(pid);
+        if (slot < 0) continue;
+        prefork_slot_t *w = &g_prefork.workers[slot];
+        w->pid = 0;
+        live--;
+
+        if (g_prefork.stop) continue;
+
+        if (WIFSIGNALED(status)) {
+            LOG_ERROR("Worker %d (PID %d) killed by signal %d", slot, pid, WTERMSIG(status));
+        } else {
+            LOG_WARN("Worker %d (PID %d) exited with status %d", slot, pid, WEXITSTATUS(status));
+        }
+
+        // Un worker que muere apenas arranca se relanza cada vez más despacio
+        if (now_ms() - w->started_ms < PREFORK_MIN_UPTIME_MS) {
+            LOG_WARN("Worker %d crashed on startup, restarting in %ld ms", slot, w->backoff_ms);
+            sleep_unless_stopped(w->backoff_ms);
+            w->backoff_ms *= 2;
+            if (w->backoff_ms > PREFORK_BACKOFF_MAX_MS) w->backoff_ms = PREFORK_BACKOFF_MAX_MS;
+        } else {
+            w->backoff_ms = PREFORK_BACKOFF_MIN_MS;
+        }
+        if (g_prefork.stop) continue;
+
+        if (spawn_worker(slot, worker_main, ctx) == 0) {
+            live++;
+            __atomic_fetch_add(g_prefork.restarts, 1, __ATOMIC_RELAXED);
+            LOG_INFO("Worker %d restarted (PID %d)", slot, g_prefork.workers[slot].pid);
+        }
+    }
+
+    LOG_INFO("All workers stopped");
+    g_prefork.master = false;
+    return 0;
+}
+
+void prefork_stop(void) {
+    g_prefork.stop = 1;
+    // Solo kill(): esto corre dentro de un signal handler
+    for (int i = 0; i < g_prefork.num_workers; i++) {
+        pid_t pid = g_prefork.workers[i].pid;
+        if (pid > 0) kill(pid, SIGTERM);
+    }
+}
+
+bool prefork_is_master(void) {
+    return g_prefork.master;
+}
+
+int prefork_worker_slot(void) {
+    return g_prefork.slot;
+}
+
+int prefork_num_workers(void) {
+    return g_prefork.num_workers;
+}
+
+unsigned long prefork_restarts(void) {
+    return g_prefork.restarts ? __atomic_load_n(g_prefork.restarts, __ATOMIC_RELAXED) : 0;
+}
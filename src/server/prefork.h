@@ -0,0 +1,70 @@
+#ifndef PREFORK_H
+#define PREFORK_H
+
+#include <stdbool.h>
+
+// ============================================================================
+// PREFORK - Master que supervisa N procesos worker
+// ============================================================================
+//
+// El master abre el socket (server_init) y prepara todo lo compartido antes
+// de fork(): los workers heredan el listener y cada uno hace su propio
+// accept(). Si un worker muere (crash, kill), el master lanza otro en el
+// mismo slot; un worker que muere al arrancar se relanza con backoff.
+//
+// Cada worker es un proceso aparte: un crash no tumba a los demás y cada
+// uno tiene su propio heap. Lo que deba verse en toda la flota (métricas,
+// contadores, trazas) tiene que estar en el arena de shm.h.
+
+#define PREFORK_MAX_WORKERS 64      // Igual a METRICS_MAX_PROCS
+
+/**
+ * Función que corre en cada worker después del fork
+ *
+ * @param slot Índice del worker [0, num_workers)
+ * @param ctx Puntero pasado a prefork_run
+ * @return Exit code del proceso worker
+ */
+typedef int (*prefork_worker_fn)(int slot, void *ctx);
+
+/**
+ * Lanzar los workers y supervisarlos hasta prefork_stop()
+ *
+ * En el master retorna cuando todos los workers terminaron (0 si éxito,
+ * -1 si error). En un worker no retorna: termina el proceso con _exit()
+ * usando el valor de worker_main.
+ *
+ * @param num_workers Cantidad de procesos [1, PREFORK_MAX_WORKERS]
+ * @param worker_main Función de cada worker
+ * @param ctx Contexto para worker_main
+ * @return 0 si éxito, -1 si error
+ */
+int prefork_run(int num_workers, prefork_worker_fn worker_main, void *ctx);
+
+/**
+ * Pedir que el master deje de relanzar workers y les envíe SIGTERM
+ * (async-signal-safe: se puede llamar desde un signal handler)
+ */
+void prefork_stop(void);
+
+/**
+ * true en el proceso master mientras prefork_run está activo
+ */
+bool prefork_is_master(void);
+
+/**
+ * Slot del worker actual, o -1 si no es un worker
+ */
+int prefork_worker_slot(void);
+
+/**
+ * Workers configurados (0 si no se usa prefork)
+ */
+int prefork_num_workers(void);
+
+/**
+ * Workers relanzados desde el arranque (crashes)
+ */
+unsigned long prefork_restarts(void);
+
+#endif // PREFORK_H
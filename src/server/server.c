@@ -4,6 +4,10 @@
 #include "../utils/utils.h"
 #include "../router/router.h"
 #include "../core/metrics.h"
+#include "../core/access_log.h"
+#include "../core/trace.h"
+#include "../core/job_executor.h"
+#include "../core/affinity.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,13 +17,55 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/select.h>
 
 // ============================================================================
 // SERVER INITIALIZATION
 // ============================================================================
 
+// Crear el socket, bind() y listen(). Retorna el fd o -1.
+static int create_listener(int port, int backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create socket: %s", strerror(errno));
+        return -1;
+    }
+    
+    // Permitir reutilizar dirección inmediatamente (SO_REUSEADDR)
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        LOG_WARN("Failed to set SO_REUSEADDR: %s", strerror(errno));
+    }
+    
+    // Configurar dirección
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY; // Escuchar en todas las interfaces
+    addr.sin_port = htons(port);
+    
+    // Bind
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        LOG_ERROR("Failed to bind to port %d: %s", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    
+    // Listen
+    if (listen(fd, backlog) < 0) {
+        LOG_ERROR("Failed to listen: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
 server_state_t* server_init(const server_config_t *config) {
+    return server_init_with_listener(config, -1);
+}
+
+server_state_t* server_init_with_listener(const server_config_t *config, int listen_fd) {
     if (!config) {
         LOG_ERROR("Config is NULL");
         return NULL;
@@ -34,11 +80,19 @@ server_state_t* server_init(const server_config_t *config) {
     // Copiar configuración
     server->config = *config;
     server->shutdown_requested = false;
+    server->wake_fd[0] = server->wake_fd[1] = -1;
+    server->active_connections = 0;
+    server->inflight_connections = 0;
+    server->draining = 0;
     
     // Inicializar estadísticas
-    memset(&server->stats, 0, sizeof(server_stats_t));
-    gettimeofday(&server->stats.start_time, NULL);
-    pthread_mutex_init(&server->stats.mutex, NULL);
+    gettimeofday(&server->start_time, NULL);
+    server->counters = counter_set_create(SERVER_CTR_COUNT);
+    if (!server->counters) {
+        LOG_ERROR("Failed to allocate server counters");
+        free(server);
+        return NULL;
+    }
     pthread_mutex_init(&server->shutdown_mutex, NULL);
 
     // ============================================================
@@ -55,6 +109,8 @@ server_state_t* server_init(const server_config_t *config) {
     // ============================================================
     metrics_register_command("factor", 4, 100, 100);
     metrics_register_command("isprime", 4, 100, 100);
+    metrics_register_command("primes", 4, 100, 100);
+    metrics_register_command("isprime_batch", 4, 100, 100);
     metrics_register_command("mandelbrot", 4, 100, 100);
     metrics_register_command("matrixmul", 4, 100, 100);
     metrics_register_command("pi", 4, 100, 100);
@@ -62,6 +118,7 @@ server_state_t* server_init(const server_config_t *config) {
     metrics_register_command("sortfile", 4, 100, 100);      // sorting es CPU-intensivo
     metrics_register_command("wordcount", 4, 100, 100);     // análisis de texto es CPU-intensivo
     metrics_register_command("compress", 4, 100, 100);      // compresión es CPU-intensivo
+    metrics_register_command("decompress", 4, 100, 100);
 
     // ============================================================
     // COMANDOS I/O-BOUND (operaciones de disco/red)
@@ -79,53 +136,35 @@ server_state_t* server_init(const server_config_t *config) {
     metrics_register_command("reverse", 1, 100, 100);
     metrics_register_command("timestamp", 1, 100, 100);
     metrics_register_command("toupper", 1, 100, 100);
-    metrics_register_command("sleep_cmd", 1, 100, 100);
+    metrics_register_command("sleep", 1, 100, 100);
     metrics_register_command("simulate", 1, 100, 100);
+    metrics_register_command("fibonacci", 1, 100, 100);
+    metrics_register_command("hash", 1, 100, 100);
+    metrics_register_command("loadtest", 1, 100, 100);
 
-    LOG_INFO("Metrics system initialized with %d commands", 18);
+    LOG_INFO("Metrics system initialized with %d commands", metrics_command_count());
     // ============================================================
     // ============================================================
     
-    // Crear socket TCP
-    server->server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    // Socket TCP: propio, o heredado del proceso anterior (hot restart)
+    server->server_fd = listen_fd >= 0 ? listen_fd
+                                       : create_listener(config->port, config->max_connections);
     if (server->server_fd < 0) {
-        LOG_ERROR("Failed to create socket: %s", strerror(errno));
-        free(server);
-        return NULL;
-    }
-    
-    // Permitir reutilizar dirección inmediatamente (SO_REUSEADDR)
-    int opt = 1;
-    if (setsockopt(server->server_fd, SOL_SOCKET, SO_REUSEADDR, 
-                   &opt, sizeof(opt)) < 0) {
-        LOG_WARN("Failed to set SO_REUSEADDR: %s", strerror(errno));
-    }
-    
-    // Configurar dirección
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY; // Escuchar en todas las interfaces
-    addr.sin_port = htons(config->port);
-    
-    // Bind
-    if (bind(server->server_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        LOG_ERROR("Failed to bind to port %d: %s", config->port, strerror(errno));
-        close(server->server_fd);
+        counter_set_destroy(server->counters);
         free(server);
         return NULL;
     }
     
-    // Listen
-    if (listen(server->server_fd, config->max_connections) < 0) {
-        LOG_ERROR("Failed to listen: %s", strerror(errno));
-        close(server->server_fd);
-        free(server);
-        return NULL;
+    // No bloqueante: en modo prefork varios procesos esperan en el mismo
+    // listener y solo uno se lleva cada conexión (los demás reciben EAGAIN)
+    int fl = fcntl(server->server_fd, F_GETFL);
+    if (fl < 0 || fcntl(server->server_fd, F_SETFL, fl | O_NONBLOCK) < 0) {
+        LOG_WARN("Failed to set listener non-blocking: %s", strerror(errno));
     }
     
-    LOG_INFO("Server initialized on port %d (max connections: %d)",
-             config->port, config->max_connections);
+    LOG_INFO("Server initialized on port %d (max connections: %d%s)",
+             config->port, config->max_connections,
+             listen_fd >= 0 ? ", inherited listener" : "");
     
     return server;
 }
@@ -134,6 +173,30 @@ server_state_t* server_init(const server_config_t *config) {
 // SERVER START (ACCEPT LOOP)
 // ============================================================================
 
+// Entrada del thread de conexión: lleva la cuenta de conexiones en curso
+// para server_drain() y para el drain del accept loop
+static void* connection_thread(void *arg) {
+    connection_info_t *conn = (connection_info_t*)arg;
+    server_state_t *server = conn->server;
+    bool counted = !conn->reject;       // connection_handler libera conn
+    connection_handler(arg);
+    if (counted) __atomic_sub_fetch(&server->inflight_connections, 1, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&server->active_connections, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+// Drain terminado: nada de lo aceptado antes del drain sigue en curso
+static bool drain_done(server_state_t *server) {
+    return __atomic_load_n(&server->inflight_connections, __ATOMIC_ACQUIRE) == 0 &&
+           job_executor_pending() == 0;
+}
+
 int server_start(server_state_t *server) {
     if (!server) {
         return -1;
@@ -141,9 +204,77 @@ int server_start(server_state_t *server) {
     
     LOG_INFO("Server starting... PID: %d", getpid());
     
+    // El pipe se crea acá y no en server_init: en modo prefork cada worker
+    // tiene que poder despertarse solo a sí mismo
+    if (pipe(server->wake_fd) != 0) {
+        LOG_ERROR("Failed to create wake pipe: %s", strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(server->wake_fd[i], F_SETFD, FD_CLOEXEC);
+        fcntl(server->wake_fd[i], F_SETFL, O_NONBLOCK);
+    }
+    
+    // Accept loop en el set I/O: los threads de conexión heredan la máscara
+    if (affinity_pin_current(AFFINITY_IO) != 0) {
+        LOG_WARN("Failed to pin accept loop to I/O CPUs: %s", strerror(errno));
+    }
+    
     server->config.running = true;
+    // 0 = sin drain en curso (la señal pudo llegar antes de crear el pipe)
+    long drain_deadline = server_is_draining(server)
+                        ? monotonic_ms() + server->config.drain_timeout_ms : 0;
     
     while (!server->shutdown_requested) {
+        // Durante el drain se sigue aceptando (para responder 503) y se revisa
+        // cada 10 ms si ya terminó lo que estaba en curso
+        int timeout = -1;
+        if (drain_deadline) {
+            if (drain_done(server)) {
+                LOG_INFO("Drain complete");
+                break;
+            }
+            if (monotonic_ms() >= drain_deadline) {
+                LOG_WARN("Drain timeout: %d connections and %d jobs still pending",
+                         __atomic_load_n(&server->inflight_connections, __ATOMIC_ACQUIRE),
+                         job_executor_pending());
+                break;
+            }
+            timeout = 10;
+        }
+        
+        // Esperar una conexión o el aviso de server_shutdown()/server_begin_drain()
+        struct pollfd pfd[2] = {
+            { .fd = server->server_fd, .events = POLLIN },
+            { .fd = server->wake_fd[0], .events = POLLIN }
+        };
+        int ready = poll(pfd, 2, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("poll failed: %s", strerror(errno));
+            break;
+        }
+        if (pfd[1].revents) {
+            char cmd[16];
+            ssize_t n = read(server->wake_fd[0], cmd, sizeof(cmd));
+            // 'x' = server_shutdown(); 'd'/'s' = server_begin_drain() desde un
+            // signal handler, que no puede loguear: se loguea acá
+            if (n > 0 && memchr(cmd, 's', (size_t)n)) {
+                LOG_INFO("Received signal, stopping now");
+                break;
+            }
+            if (n > 0 && memchr(cmd, 'x', (size_t)n)) break;
+            if (!drain_deadline) {
+                LOG_INFO("Received signal, shutting down gracefully...");
+                drain_deadline = monotonic_ms() + server->config.drain_timeout_ms;
+                LOG_INFO("Draining: %d connections in flight, %d jobs pending (up to %d ms)",
+                         __atomic_load_n(&server->inflight_connections, __ATOMIC_ACQUIRE),
+                         job_executor_pending(), server->config.drain_timeout_ms);
+            }
+            continue;
+        }
+        if (ready == 0) continue;
+        
         // Accept nueva conexión
         struct sockaddr_in client_addr;
         socklen_t client_len = sizeof(client_addr);
@@ -153,8 +284,8 @@ int server_start(server_state_t *server) {
                               &client_len);
         
         if (client_fd < 0) {
-            if (errno == EINTR) {
-                // Interrupción por señal, continuar
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Señal, u otro proceso se llevó la conexión
                 continue;
             }
             
@@ -188,6 +319,8 @@ int server_start(server_state_t *server) {
         conn_info->client_fd = client_fd;
         conn_info->client_addr = client_addr;
         conn_info->server = server;
+        conn_info->reject = __atomic_load_n(&server->draining, __ATOMIC_ACQUIRE) != 0;
+        gettimeofday(&conn_info->accept_time, NULL);
         
         // Crear thread para manejar la conexión
         pthread_t thread;
@@ -195,8 +328,13 @@ int server_start(server_state_t *server) {
         pthread_attr_init(&attr);
         pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
         
-        if (pthread_create(&thread, &attr, connection_handler, conn_info) != 0) {
+        bool counted = !conn_info->reject;
+        __atomic_add_fetch(&server->active_connections, 1, __ATOMIC_RELAXED);
+        if (counted) __atomic_add_fetch(&server->inflight_connections, 1, __ATOMIC_RELAXED);
+        if (pthread_create(&thread, &attr, connection_thread, conn_info) != 0) {
             LOG_ERROR("Failed to create connection thread: %s", strerror(errno));
+            __atomic_sub_fetch(&server->active_connections, 1, __ATOMIC_RELAXED);
+            if (counted) __atomic_sub_fetch(&server->inflight_connections, 1, __ATOMIC_RELAXED);
             free(conn_info);
             close(client_fd);
         }
@@ -204,14 +342,19 @@ int server_start(server_state_t *server) {
         pthread_attr_destroy(&attr);
         
         // Incrementar contador de conexiones
-        pthread_mutex_lock(&server->stats.mutex);
-        server->stats.connections_served++;
-        pthread_mutex_unlock(&server->stats.mutex);
+        counter_set_add(server->counters, SERVER_CTR_CONNECTIONS, 1);
     }
     
     LOG_INFO("Server stopped");
     server->config.running = false;
     
+    // Solo cerrar: shutdown() sobre el listener lo cerraría también para los
+    // demás procesos que lo comparten
+    if (server->server_fd >= 0) {
+        close(server->server_fd);
+        server->server_fd = -1;
+    }
+    
     return 0;
 }
 
@@ -219,6 +362,65 @@ int server_start(server_state_t *server) {
 // CONNECTION HANDLER
 // ============================================================================
 
+// Registrar la request en el access log (no hace nada si está deshabilitado).
+// req puede ser NULL si la request no se pudo parsear.
+static void log_access(const char *request_id, const http_request_t *req, int status,
+                       ssize_t bytes_in, ssize_t bytes_out,
+                       http_timer_t *queue_timer, http_timer_t *parse_timer,
+                       const router_result_t *result) {
+    if (!access_log_enabled()) return;
+    
+    access_record_t r;
+    memset(&r, 0, sizeof(r));
+    r.status = (uint16_t)status;
+    r.bytes_in = bytes_in > 0 ? (uint32_t)bytes_in : 0;
+    r.bytes_out = bytes_out > 0 ? (uint32_t)bytes_out : 0;
+    r.queue_us = (uint32_t)timer_elapsed_us(queue_timer);
+    r.parse_us = (uint32_t)timer_elapsed_us(parse_timer);
+    if (result) {
+        r.exec_us = (uint32_t)result->exec_us;
+        r.write_us = (uint32_t)result->write_us;
+    }
+    // Los campos del registro son de tamaño fijo: truncar sin warning
+    snprintf(r.request_id, sizeof(r.request_id), "%.*s",
+             (int)sizeof(r.request_id) - 1, request_id);
+    if (req) {
+        snprintf(r.method, sizeof(r.method), "%.*s", (int)sizeof(r.method) - 1, req->method);
+        int len = snprintf(r.target, sizeof(r.target), "%.*s",
+                           (int)sizeof(r.target) - 1, req->path);
+        if (req->query[0] && len < (int)sizeof(r.target) - 1) {
+            snprintf(r.target + len, sizeof(r.target) - len, "?%.*s",
+                     (int)(sizeof(r.target) - len - 2), req->query);
+        }
+    } else {
+        strcpy(r.method, "-");
+        strcpy(r.target, "-");
+    }
+    
+    access_log_record(&r);
+}
+
+// 503 para las conexiones aceptadas durante el drain
+static ssize_t send_draining(int client_fd, const char *request_id) {
+    char json[128];
+    char extra_headers[64];
+    snprintf(json, sizeof(json), "{\"error\": \"Server shutting down\", \"retry_after_ms\": %d}",
+             SERVER_DRAIN_RETRY_AFTER_MS);
+    snprintf(extra_headers, sizeof(extra_headers), "Retry-After: %d\r\n",
+             (SERVER_DRAIN_RETRY_AFTER_MS + 999) / 1000);
+    
+    http_response_t response = {
+        .status_code = HTTP_SERVICE_UNAVAILABLE,
+        .content_type = "application/json",
+        .body = json,
+        .body_length = strlen(json),
+        .request_id = request_id,
+        .worker_pid = getpid(),
+        .extra_headers = extra_headers
+    };
+    return http_send_response(client_fd, &response);
+}
+
 void* connection_handler(void *arg) {
     connection_info_t *conn = (connection_info_t*)arg;
     
@@ -229,17 +431,30 @@ void* connection_handler(void *arg) {
     int client_fd = conn->client_fd;
     server_state_t *server = conn->server;
     
+    // Tiempo entre accept() y el inicio de este thread
+    http_timer_t queue_timer = { .start = conn->accept_time };
+    timer_stop(&queue_timer);
+    
+    // Generar request ID único (antes de leer, para poder trazar la lectura)
+    char request_id[64];
+    generate_request_id(request_id, sizeof(request_id));
+    if (trace_request_begin(request_id)) {
+        trace_span_timeval("accept", &conn->accept_time, &queue_timer.end);
+    }
+    
     // Buffer para el request
     char request_buffer[8192];
     memset(request_buffer, 0, sizeof(request_buffer));
     
     // Leer request HTTP
+    TRACE_BEGIN(read_span);
     ssize_t bytes_read = server_read_request(
         client_fd, 
         request_buffer, 
         sizeof(request_buffer) - 1,
         server->config.request_timeout_sec
     );
+    TRACE_END("read", read_span);
     
     if (bytes_read <= 0) {
         if (bytes_read == 0) {
@@ -247,6 +462,7 @@ void* connection_handler(void *arg) {
         } else {
             LOG_ERROR("Failed to read request: %s", strerror(errno));
         }
+        trace_request_end();
         close(client_fd);
         free(conn);
         return NULL;
@@ -254,20 +470,26 @@ void* connection_handler(void *arg) {
     
     request_buffer[bytes_read] = '\0';
     
-    // Generar request ID único
-    char request_id[64];
-    generate_request_id(request_id, sizeof(request_id));
-    
     LOG_DEBUG("Request received (id=%s, size=%zd bytes)", request_id, bytes_read);
     
     // Parsear HTTP request
     http_request_t http_req;
-    if (http_parse_request(request_buffer, &http_req) != 0) {
+    http_timer_t parse_timer;
+    TRACE_BEGIN(parse_span);
+    timer_start(&parse_timer);
+    int parse_rc = http_parse_request(request_buffer, &http_req);
+    timer_stop(&parse_timer);
+    TRACE_END("parse", parse_span);
+    
+    if (parse_rc != 0) {
         LOG_WARN("Failed to parse HTTP request (id=%s)", request_id);
-        http_send_error(client_fd, HTTP_BAD_REQUEST, 
-                       "Malformed HTTP request", request_id);
+        ssize_t sent = http_send_error(client_fd, HTTP_BAD_REQUEST, 
+                                       "Malformed HTTP request", request_id);
         
         server_update_stats(server, false, bytes_read, 0);
+        log_access(request_id, NULL, HTTP_BAD_REQUEST, bytes_read, sent,
+                   &queue_timer, &parse_timer, NULL);
+        trace_request_end();
         close(client_fd);
         free(conn);
         return NULL;
@@ -276,10 +498,13 @@ void* connection_handler(void *arg) {
     // Verificar método soportado
     if (!http_is_method_supported(http_req.method)) {
         LOG_WARN("Unsupported method: %s (id=%s)", http_req.method, request_id);
-        http_send_error(client_fd, HTTP_BAD_REQUEST,
-                       "Method not supported", request_id);
+        ssize_t sent = http_send_error(client_fd, HTTP_BAD_REQUEST,
+                                       "Method not supported", request_id);
         
         server_update_stats(server, false, bytes_read, 0);
+        log_access(request_id, &http_req, HTTP_BAD_REQUEST, bytes_read, sent,
+                   &queue_timer, &parse_timer, NULL);
+        trace_request_end();
         close(client_fd);
         free(conn);
         return NULL;
@@ -288,15 +513,36 @@ void* connection_handler(void *arg) {
     // Verificar path seguro
     if (!http_is_path_safe(http_req.path)) {
         LOG_WARN("Unsafe path detected: %s (id=%s)", http_req.path, request_id);
-        http_send_error(client_fd, HTTP_BAD_REQUEST,
-                       "Invalid path", request_id);
+        ssize_t sent = http_send_error(client_fd, HTTP_BAD_REQUEST,
+                                       "Invalid path", request_id);
         
         server_update_stats(server, false, bytes_read, 0);
+        log_access(request_id, &http_req, HTTP_BAD_REQUEST, bytes_read, sent,
+                   &queue_timer, &parse_timer, NULL);
+        trace_request_end();
         close(client_fd);
         free(conn);
         return NULL;
     }
     
+    // Drain: la request llegó después del SIGTERM, que la atienda otro
+    if (conn->reject) {
+        LOG_DEBUG("Rejecting %s while draining (id=%s)", http_req.path, request_id);
+        ssize_t sent = send_draining(client_fd, request_id);
+        
+        server_update_stats(server, false, bytes_read, sent > 0 ? (size_t)sent : 0);
+        log_access(request_id, &http_req, HTTP_SERVICE_UNAVAILABLE, bytes_read, sent,
+                   &queue_timer, &parse_timer, NULL);
+        trace_request_end();
+        close(client_fd);
+        free(conn);
+        return NULL;
+    }
+    
+    const char *command = metrics_command_from_path(http_req.path);
+    metrics_record_phase(command, METRICS_PHASE_QUEUE, (unsigned long)timer_elapsed_us(&queue_timer));
+    metrics_record_phase(command, METRICS_PHASE_PARSE, (unsigned long)timer_elapsed_us(&parse_timer));
+    
     LOG_INFO("Processing: %s %s%s%s (id=%s)", 
              http_req.method, 
              http_req.path,
@@ -309,7 +555,11 @@ void* connection_handler(void *arg) {
     // El router se encarga de validar parámetros y de enviar la respuesta
     // ========================================================================
     
-    ssize_t bytes_sent = router_handle_request(&http_req, client_fd, request_id, server, (size_t)bytes_read);
+    router_result_t result = {0};
+    TRACE_BEGIN(route_span);
+    ssize_t bytes_sent = router_handle_request(&http_req, client_fd, request_id, server,
+                                               (size_t)bytes_read, &result);
+    TRACE_END("route", route_span);
     if (bytes_sent >= 0) {
         server_update_stats(server, true, bytes_read, (size_t)bytes_sent);
         metrics_increment_requests(); 
@@ -318,6 +568,9 @@ void* connection_handler(void *arg) {
         server_update_stats(server, false, bytes_read, 0);
         metrics_increment_errors();  
     }
+    log_access(request_id, &http_req, result.status, bytes_read, bytes_sent,
+               &queue_timer, &parse_timer, &result);
+    trace_request_end();
 
     // Cerrar conexión
     close(client_fd);
@@ -403,14 +656,48 @@ void server_shutdown(server_state_t *server) {
     
     LOG_INFO("Shutdown requested");
     
-    // Cerrar socket listener para desbloquear accept()
-    if (server->server_fd >= 0) {
-        shutdown(server->server_fd, SHUT_RDWR);
-        close(server->server_fd);
-        server->server_fd = -1;
+    // Despertar el accept loop (write es async-signal-safe); el listener lo
+    // cierra server_start() al salir
+    if (server->wake_fd[1] >= 0) {
+        ssize_t ignored = write(server->wake_fd[1], "x", 1);
+        (void)ignored;
+    }
+}
+
+void server_begin_drain(server_state_t *server) {
+    if (!server) return;
+    
+    // Segunda señal durante el drain, o drain deshabilitado: detener ya.
+    // Corre en un signal handler: ni mutex ni LOG_*, solo write() al pipe
+    bool stop = server->config.drain_timeout_ms <= 0 ||
+                __atomic_exchange_n(&server->draining, 1, __ATOMIC_ACQ_REL);
+    if (server->wake_fd[1] >= 0) {
+        ssize_t ignored = write(server->wake_fd[1], stop ? "s" : "d", 1);
+        (void)ignored;
     }
 }
 
+bool server_is_draining(server_state_t *server) {
+    return server && __atomic_load_n(&server->draining, __ATOMIC_ACQUIRE);
+}
+
+int server_drain(server_state_t *server, int timeout_ms) {
+    if (!server) return 0;
+    
+    int active = __atomic_load_n(&server->active_connections, __ATOMIC_ACQUIRE);
+    if (active > 0) {
+        LOG_INFO("Draining %d in-flight connections (up to %d ms)", active, timeout_ms);
+    }
+    for (int waited = 0; active > 0 && waited < timeout_ms; waited += 10) {
+        usleep(10 * 1000);
+        active = __atomic_load_n(&server->active_connections, __ATOMIC_ACQUIRE);
+    }
+    if (active > 0) {
+        LOG_WARN("Drain timeout: %d connections still in flight", active);
+    }
+    return active;
+}
+
 void server_destroy(server_state_t *server) {
     if (!server) return;
 
@@ -421,8 +708,11 @@ void server_destroy(server_state_t *server) {
     if (server->server_fd >= 0) {
         close(server->server_fd);
     }
+    for (int i = 0; i < 2; i++) {
+        if (server->wake_fd[i] >= 0) close(server->wake_fd[i]);
+    }
     
-    pthread_mutex_destroy(&server->stats.mutex);
+    counter_set_destroy(server->counters);
     pthread_mutex_destroy(&server->shutdown_mutex);
     
     free(server);
@@ -435,9 +725,12 @@ void server_destroy(server_state_t *server) {
 void server_get_stats(server_state_t *server, server_stats_t *stats) {
     if (!server || !stats) return;
     
-    pthread_mutex_lock(&server->stats.mutex);
-    *stats = server->stats;
-    pthread_mutex_unlock(&server->stats.mutex);
+    stats->connections_served = counter_set_read(server->counters, SERVER_CTR_CONNECTIONS);
+    stats->requests_ok = counter_set_read(server->counters, SERVER_CTR_REQUESTS_OK);
+    stats->requests_error = counter_set_read(server->counters, SERVER_CTR_REQUESTS_ERROR);
+    stats->bytes_received = counter_set_read(server->counters, SERVER_CTR_BYTES_RECEIVED);
+    stats->bytes_sent = counter_set_read(server->counters, SERVER_CTR_BYTES_SENT);
+    stats->start_time = server->start_time;
 }
 
 long server_get_uptime(server_state_t *server) {
@@ -446,27 +739,19 @@ long server_get_uptime(server_state_t *server) {
     struct timeval now;
     gettimeofday(&now, NULL);
     
-    pthread_mutex_lock(&server->stats.mutex);
-    long uptime = now.tv_sec - server->stats.start_time.tv_sec;
-    pthread_mutex_unlock(&server->stats.mutex);
-    
-    return uptime;
+    return now.tv_sec - server->start_time.tv_sec;
 }
 
 void server_update_stats(server_state_t *server, bool is_ok,
                         size_t bytes_received, size_t bytes_sent) {
     if (!server) return;
     
-    pthread_mutex_lock(&server->stats.mutex);
-    
-    if (is_ok) {
-        server->stats.requests_ok++;
-    } else {
-        server->stats.requests_error++;
+    counter_set_add(server->counters,
+                    is_ok ? SERVER_CTR_REQUESTS_OK : SERVER_CTR_REQUESTS_ERROR, 1);
+    if (bytes_received > 0) {
+        counter_set_add(server->counters, SERVER_CTR_BYTES_RECEIVED, bytes_received);
     }
-    
-    server->stats.bytes_received += bytes_received;
-    server->stats.bytes_sent += bytes_sent;
-    
-    pthread_mutex_unlock(&server->stats.mutex);
-}
\ No newline at end of file
+    if (bytes_sent > 0) {
+        counter_set_add(server->counters, SERVER_CTR_BYTES_SENT, bytes_sent);
+    }
+}
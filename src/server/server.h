@@ -8,6 +8,7 @@
 #include <sys/socket.h>    // For socket functions (Linux)
 #include <netinet/in.h>    // For sockaddr_in (Linux)
 #include <unistd.h>        // For close() (Linux)
+#include "../core/counters.h"
 
 
 
@@ -15,11 +16,16 @@
 // SERVER CONFIGURATION
 // ============================================================================
 
+#define SERVER_DRAIN_TIMEOUT_MS     10000   // Default de --drain-timeout
+#define SERVER_DRAIN_RETRY_AFTER_MS 1000    // Retry-After de los 503 durante el drain
+#define SERVER_DRAIN_GRACE_MS       2000    // Espera extra por los threads que quedan
+
 typedef struct {
     int port;                       // Puerto del servidor
     int max_connections;            // Máximo de conexiones simultáneas
     int request_timeout_sec;        // Timeout para leer request (segundos)
     int max_request_size;           // Tamaño máximo del request (bytes)
+    int drain_timeout_ms;           // Plazo del drain (0 = detener sin drain)
     bool running;                   // Flag de estado del servidor
 } server_config_t;
 
@@ -27,6 +33,7 @@ typedef struct {
 // SERVER STATISTICS
 // ============================================================================
 
+// Snapshot de estadísticas (ver server_get_stats)
 typedef struct {
     unsigned long connections_served;    // Total de conexiones atendidas
     unsigned long requests_ok;           // Requests con status 2xx
@@ -34,17 +41,31 @@ typedef struct {
     unsigned long bytes_received;        // Bytes totales recibidos
     unsigned long bytes_sent;            // Bytes totales enviados
     struct timeval start_time;           // Timestamp de inicio del servidor
-    pthread_mutex_t mutex;               // Mutex para actualizar stats
 } server_stats_t;
 
+// Campos del counter_set_t del servidor
+typedef enum {
+    SERVER_CTR_CONNECTIONS = 0,
+    SERVER_CTR_REQUESTS_OK,
+    SERVER_CTR_REQUESTS_ERROR,
+    SERVER_CTR_BYTES_RECEIVED,
+    SERVER_CTR_BYTES_SENT,
+    SERVER_CTR_COUNT
+} server_counter_t;
+
 // ============================================================================
 // SERVER STATE
 // ============================================================================
 
 typedef struct {
     server_config_t config;
-    server_stats_t stats;
+    struct timeval start_time;           // Timestamp de inicio del servidor
+    counter_set_t *counters;             // Estadísticas por thread (sin mutex)
     int server_fd;                       // File descriptor del socket listener
+    int wake_fd[2];                      // Pipe para despertar el accept loop (por proceso)
+    int active_connections;              // Threads de conexión en curso (atómico)
+    int inflight_connections;            // Aceptadas antes del drain, sin terminar (atómico)
+    int draining;                        // server_begin_drain() llamado (atómico)
     bool shutdown_requested;             // Flag para graceful shutdown
     pthread_mutex_t shutdown_mutex;      // Mutex para shutdown
 } server_state_t;
@@ -63,6 +84,18 @@ typedef struct {
  */
 server_state_t* server_init(const server_config_t *config);
 
+/**
+ * Inicializar servidor sobre un socket que ya escucha
+ * 
+ * Igual que server_init() pero sin bind()/listen(): el socket viene de otro
+ * proceso (hot restart, ver handoff.h)
+ * 
+ * @param config Configuración del servidor
+ * @param listen_fd Socket en listen(), o -1 para crear uno (= server_init)
+ * @return Puntero al estado del servidor, o NULL si falla
+ */
+server_state_t* server_init_with_listener(const server_config_t *config, int listen_fd);
+
 /**
  * Iniciar servidor (accept loop)
  * 
@@ -88,6 +121,36 @@ int server_start(server_state_t *server);
  */
 void server_shutdown(server_state_t *server);
 
+/**
+ * Empezar el drain: las conexiones nuevas reciben 503 (con Retry-After) y
+ * server_start() retorna cuando terminan las que ya estaban en curso y los
+ * jobs del executor, o al vencer config.drain_timeout_ms
+ * 
+ * Async-signal-safe (solo escribe al pipe del accept loop, que es el que
+ * loguea). Con drain_timeout_ms == 0, o si ya estaba en drain, detiene el
+ * accept loop como server_shutdown().
+ * 
+ * @param server Estado del servidor
+ */
+void server_begin_drain(server_state_t *server);
+
+/**
+ * true desde server_begin_drain()
+ */
+bool server_is_draining(server_state_t *server);
+
+/**
+ * Esperar a que terminen las conexiones en curso
+ * 
+ * Llamar después de que server_start() haya retornado (ya no entran
+ * conexiones nuevas)
+ * 
+ * @param server Estado del servidor
+ * @param timeout_ms Espera máxima
+ * @return Conexiones que seguían en curso al vencer el plazo (0 = todas terminaron)
+ */
+int server_drain(server_state_t *server, int timeout_ms);
+
 /**
  * Liberar recursos del servidor
  * 
@@ -101,6 +164,9 @@ void server_destroy(server_state_t *server);
 /**
  * Obtener estadísticas del servidor (thread-safe)
  * 
+ * Suma los slots por thread de cada contador; el snapshot puede quedar
+ * levemente desfasado respecto de requests en curso.
+ * 
  * @param server Estado del servidor
  * @param stats Buffer donde copiar las estadísticas
  */
@@ -115,7 +181,7 @@ void server_get_stats(server_state_t *server, server_stats_t *stats);
 long server_get_uptime(server_state_t *server);
 
 /**
- * Actualizar contadores de estadísticas (thread-safe)
+ * Actualizar contadores de estadísticas (thread-safe, sin locks)
  * 
  * @param server Estado del servidor
  * @param is_ok true si fue 2xx, false si fue error
@@ -136,6 +202,8 @@ typedef struct {
     int client_fd;                  // File descriptor del cliente
     struct sockaddr_in client_addr; // Dirección del cliente
     server_state_t *server;         // Referencia al servidor
+    struct timeval accept_time;     // Cuándo se aceptó (fase de espera en métricas)
+    bool reject;                    // Aceptada durante el drain: responder 503
 } connection_info_t;
 
 /**
@@ -0,0 +1,538 @@
+// Enteros de precisión arbitraria en base 10^8 (schoolbook / Karatsuba / NTT)
+#include "bigint.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BASE BIGINT_BASE
+
+void bigint_init(bigint_t *x) {
+    x->limbs = NULL;
+    x->len = 0;
+    x->cap = 0;
+    x->sign = 1;
+}
+
+void bigint_free(bigint_t *x) {
+    free(x->limbs);
+    bigint_init(x);
+}
+
+static int reserve(bigint_t *x, size_t cap) {
+    if (x->cap >= cap) return 0;
+    uint32_t *p = realloc(x->limbs, cap * sizeof(uint32_t));
+    if (!p) return -1;
+    x->limbs = p;
+    x->cap = cap;
+    return 0;
+}
+
+static void trim(bigint_t *x) {
+    while (x->len > 0 && x->limbs[x->len - 1] == 0) x->len--;
+    if (x->len == 0) x->sign = 1;
+}
+
+// Reemplazar el contenido de r por tmp (que queda vacío)
+static void take(bigint_t *r, bigint_t *tmp) {
+    free(r->limbs);
+    *r = *tmp;
+    bigint_init(tmp);
+    trim(r);
+}
+
+int bigint_set_u128(bigint_t *x, unsigned __int128 value) {
+    if (reserve(x, 5) != 0) return -1;
+    x->len = 0;
+    x->sign = 1;
+    while (value) {
+        x->limbs[x->len++] = (uint32_t)(value % BASE);
+        value /= BASE;
+    }
+    return 0;
+}
+
+int bigint_set_u64(bigint_t *x, uint64_t value) {
+    return bigint_set_u128(x, value);
+}
+
+int bigint_copy(bigint_t *dst, const bigint_t *src) {
+    if (dst == src) return 0;
+    if (reserve(dst, src->len ? src->len : 1) != 0) return -1;
+    if (src->len) memcpy(dst->limbs, src->limbs, src->len * sizeof(uint32_t));
+    dst->len = src->len;
+    dst->sign = src->sign;
+    return 0;
+}
+
+// ============================================================================
+// MAGNITUDES (arrays de limbs)
+// ============================================================================
+
+static int cmp_mag(const uint32_t *a, size_t na, const uint32_t *b, size_t nb) {
+    if (na != nb) return na < nb ? -1 : 1;
+    for (size_t i = na; i-- > 0;) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+// dst[0..dn) += src[0..sn), sn <= dn; el acarreo no sale de dst
+static void add_into(uint32_t *dst, size_t dn, const uint32_t *src, size_t sn) {
+    uint32_t carry = 0;
+    size_t i = 0;
+    for (; i < sn; i++) {
+        uint32_t v = dst[i] + src[i] + carry;
+        carry = v >= BASE;
+        dst[i] = carry ? v - BASE : v;
+    }
+    for (; carry && i < dn; i++) {
+        uint32_t v = dst[i] + 1;
+        carry = v >= BASE;
+        dst[i] = carry ? 0 : v;
+    }
+}
+
+// dst[0..dn) -= src[0..sn), con dst >= src
+static void sub_into(uint32_t *dst, size_t dn, const uint32_t *src, size_t sn) {
+    uint32_t borrow = 0;
+    size_t i = 0;
+    for (; i < sn; i++) {
+        uint32_t s = src[i] + borrow;
+        borrow = dst[i] < s;
+        dst[i] = borrow ? dst[i] + BASE - s : dst[i] - s;
+    }
+    for (; borrow && i < dn; i++) {
+        borrow = dst[i] == 0;
+        dst[i] = borrow ? BASE - 1 : dst[i] - 1;
+    }
+}
+
+static void mul_school(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    memset(out, 0, (na + nb) * sizeof(uint32_t));
+    for (size_t i = 0; i < na; i++) {
+        uint64_t ai = a[i];
+        if (ai == 0) continue;
+        uint64_t carry = 0;
+        for (size_t j = 0; j < nb; j++) {
+            uint64_t cur = out[i + j] + ai * b[j] + carry;
+            out[i + j] = (uint32_t)(cur % BASE);
+            carry = cur / BASE;
+        }
+        for (size_t k = i + nb; carry; k++) {
+            uint64_t cur = out[k] + carry;
+            out[k] = (uint32_t)(cur % BASE);
+            carry = cur / BASE;
+        }
+    }
+}
+
+// ============================================================================
+// KARATSUBA
+// ============================================================================
+
+// Scratch que necesita kara() para n limbs
+static size_t kara_scratch(size_t n) {
+    size_t total = 0;
+    while (n >= BIGINT_KARATSUBA_LIMBS) {
+        size_t h2 = n - n / 2;
+        total += 4 * (h2 + 1);
+        n = h2 + 1;
+    }
+    return total;
+}
+
+// out[0..2n) = a[0..n) * b[0..n)
+static void kara(const uint32_t *a, const uint32_t *b, size_t n, uint32_t *out, uint32_t *scratch) {
+    if (n < BIGINT_KARATSUBA_LIMBS) {
+        mul_school(a, n, b, n, out);
+        return;
+    }
+    size_t h = n / 2;
+    size_t h2 = n - h;
+
+    kara(a, b, h, out, scratch);                    // z0 = a0*b0
+    kara(a + h, b + h, h2, out + 2 * h, scratch);   // z2 = a1*b1
+
+    // z1 = (a0+a1)(b0+b1) - z0 - z2
+    uint32_t *sa = scratch;
+    uint32_t *sb = sa + (h2 + 1);
+    uint32_t *z1 = sb + (h2 + 1);
+    uint32_t *rest = z1 + 2 * (h2 + 1);
+    memcpy(sa, a + h, h2 * sizeof(uint32_t));
+    sa[h2] = 0;
+    add_into(sa, h2 + 1, a, h);
+    memcpy(sb, b + h, h2 * sizeof(uint32_t));
+    sb[h2] = 0;
+    add_into(sb, h2 + 1, b, h);
+
+    kara(sa, sb, h2 + 1, z1, rest);
+    sub_into(z1, 2 * (h2 + 1), out, 2 * h);
+    sub_into(z1, 2 * (h2 + 1), out + 2 * h, 2 * h2);
+
+    // z1 < B^(2*h2+1): los limbs de más arriba son cero
+    size_t z1_len = 2 * (h2 + 1);
+    while (z1_len > 0 && z1[z1_len - 1] == 0) z1_len--;
+    add_into(out + h, 2 * n - h, z1, z1_len);
+}
+
+// ============================================================================
+// NTT (módulo p = 2^64 - 2^32 + 1)
+// ============================================================================
+
+#define NTT_P       0xFFFFFFFF00000001ULL
+#define NTT_EPSILON 0xFFFFFFFFULL       // 2^64 mod p
+#define NTT_ROOT    7                   // Generador del grupo multiplicativo
+#define NTT_DIGIT   10000u              // Cada limb se parte en dos dígitos
+
+// Sin saltos (los datos son aleatorios y el branch predictor falla la mitad):
+// las correcciones van con máscaras
+
+static inline uint64_t ntt_add(uint64_t a, uint64_t b) {
+    // a + b = a - (p - b), que no desborda
+    uint64_t t = NTT_P - b;
+    uint64_t r = a - t;
+    return r + (NTT_P & -(uint64_t)(a < t));
+}
+
+static inline uint64_t ntt_sub(uint64_t a, uint64_t b) {
+    uint64_t r = a - b;
+    return r + (NTT_P & -(uint64_t)(a < b));
+}
+
+// x mod p usando 2^64 = 2^32 - 1 y 2^96 = -1 (mod p)
+static inline uint64_t ntt_reduce(unsigned __int128 x) {
+    uint64_t lo = (uint64_t)x;
+    uint64_t hi = (uint64_t)(x >> 64);
+    uint64_t hi_hi = hi >> 32;
+    uint64_t hi_lo = hi & NTT_EPSILON;
+
+    uint64_t t0 = lo - hi_hi;
+    t0 -= NTT_EPSILON & -(uint64_t)(lo < hi_hi);
+    uint64_t t1 = hi_lo * NTT_EPSILON;
+    uint64_t r = t0 + t1;
+    r += NTT_EPSILON & -(uint64_t)(r < t1);
+    return r - (NTT_P & -(uint64_t)(r >= NTT_P));
+}
+
+static inline uint64_t ntt_mul(uint64_t a, uint64_t b) {
+    return ntt_reduce((unsigned __int128)a * b);
+}
+
+static uint64_t ntt_pow(uint64_t base, uint64_t exp) {
+    uint64_t result = 1;
+    while (exp) {
+        if (exp & 1) result = ntt_mul(result, base);
+        base = ntt_mul(base, base);
+        exp >>= 1;
+    }
+    return result;
+}
+
+// Raíces por nivel: roots[half + j] = w_len^j para len = 2*half <= n, j < half
+// (n - 1 valores, índices 1..n-1). inverse usa w_len^-1
+static void ntt_roots(uint64_t *roots, size_t n, int inverse) {
+    size_t half = n / 2;
+    uint64_t w = ntt_pow(NTT_ROOT, (NTT_P - 1) / n);
+    if (inverse) w = ntt_pow(w, NTT_P - 2);
+    roots[half] = 1;
+    for (size_t j = 1; j < half; j++) roots[half + j] = ntt_mul(roots[half + j - 1], w);
+    // El nivel de abajo usa una raíz de cada dos
+    for (size_t h = half / 2; h >= 1; h /= 2) {
+        for (size_t j = 0; j < h; j++) roots[h + j] = roots[2 * h + 2 * j];
+    }
+}
+
+#define NTT_LEAF 1024   // Por debajo, niveles iterativos (el bloque entra en L1)
+
+// Gentleman-Sande: entrada en orden natural, salida en bit-reverso. Recursivo
+// en profundidad para que cada sub-transformada trabaje dentro de la caché
+static void ntt_forward(uint64_t *a, size_t n, const uint64_t *roots) {
+    if (n > NTT_LEAF) {
+        size_t half = n / 2;
+        const uint64_t *w = roots + half;
+        for (size_t j = 0; j < half; j++) {
+            uint64_t u = a[j], v = a[j + half];
+            a[j] = ntt_add(u, v);
+            a[j + half] = ntt_mul(ntt_sub(u, v), w[j]);
+        }
+        ntt_forward(a, half, roots);
+        ntt_forward(a + half, half, roots);
+        return;
+    }
+    for (size_t len = n; len >= 2; len /= 2) {
+        size_t half = len / 2;
+        const uint64_t *w = roots + half;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t j = 0; j < half; j++) {
+                uint64_t u = a[i + j], v = a[i + j + half];
+                a[i + j] = ntt_add(u, v);
+                a[i + j + half] = ntt_mul(ntt_sub(u, v), w[j]);
+            }
+        }
+    }
+}
+
+// Cooley-Tukey: entrada en bit-reverso, salida en orden natural (sin escalar)
+static void ntt_inverse(uint64_t *a, size_t n, const uint64_t *roots) {
+    if (n > NTT_LEAF) {
+        size_t half = n / 2;
+        ntt_inverse(a, half, roots);
+        ntt_inverse(a + half, half, roots);
+        const uint64_t *w = roots + half;
+        for (size_t j = 0; j < half; j++) {
+            uint64_t u = a[j], v = ntt_mul(a[j + half], w[j]);
+            a[j] = ntt_add(u, v);
+            a[j + half] = ntt_sub(u, v);
+        }
+        return;
+    }
+    for (size_t len = 2; len <= n; len *= 2) {
+        size_t half = len / 2;
+        const uint64_t *w = roots + half;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t j = 0; j < half; j++) {
+                uint64_t u = a[i + j], v = ntt_mul(a[i + j + half], w[j]);
+                a[i + j] = ntt_add(u, v);
+                a[i + j + half] = ntt_sub(u, v);
+            }
+        }
+    }
+}
+
+static void ntt_load(uint64_t *f, const uint32_t *a, size_t na) {
+    for (size_t i = 0; i < na; i++) {
+        f[2 * i] = a[i] % NTT_DIGIT;
+        f[2 * i + 1] = a[i] / NTT_DIGIT;
+    }
+}
+
+static int mul_ntt(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    size_t digits = 2 * (na + nb);
+    size_t n = 1;
+    while (n < digits) n <<= 1;
+    int square = a == b && na == nb;
+
+    uint64_t *fa = calloc(n, sizeof(uint64_t));
+    uint64_t *fb = square ? fa : calloc(n, sizeof(uint64_t));
+    uint64_t *roots = malloc(n * sizeof(uint64_t));
+    if (!fa || !fb || !roots) {
+        free(fa);
+        if (!square) free(fb);
+        free(roots);
+        return -1;
+    }
+
+    // El orden bit-reverso de la salida no importa para el producto punto a
+    // punto, y la inversa lo deshace: no hace falta permutar
+    ntt_roots(roots, n, 0);
+    ntt_load(fa, a, na);
+    ntt_forward(fa, n, roots);
+    if (!square) {
+        ntt_load(fb, b, nb);
+        ntt_forward(fb, n, roots);
+    }
+    uint64_t n_inv = ntt_pow(n, NTT_P - 2);
+    for (size_t i = 0; i < n; i++) fa[i] = ntt_mul(ntt_mul(fa[i], fb[i]), n_inv);
+    ntt_roots(roots, n, 1);
+    ntt_inverse(fa, n, roots);
+
+    // Coeficientes < digits * 10^8: el acarreo entra en 64 bits
+    uint64_t carry = 0;
+    for (size_t i = 0; i < digits; i++) {
+        uint64_t cur = fa[i] + carry;
+        fa[i] = cur % NTT_DIGIT;
+        carry = cur / NTT_DIGIT;
+    }
+    for (size_t i = 0; i < na + nb; i++) {
+        out[i] = (uint32_t)(fa[2 * i] + fa[2 * i + 1] * NTT_DIGIT);
+    }
+
+    free(fa);
+    if (!square) free(fb);
+    free(roots);
+    return 0;
+}
+
+// ============================================================================
+// MULTIPLICACIÓN
+// ============================================================================
+
+// out[0..na+nb) = a * b
+static int mul_mag(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out) {
+    if (na < nb) {
+        const uint32_t *t = a; a = b; b = t;
+        size_t tn = na; na = nb; nb = tn;
+    }
+    if (nb < BIGINT_KARATSUBA_LIMBS) {
+        mul_school(a, na, b, nb, out);
+        return 0;
+    }
+    if (nb >= BIGINT_NTT_LIMBS) return mul_ntt(a, na, b, nb, out);
+
+    // Karatsuba balanceado sobre bloques de nb limbs de a
+    uint32_t *scratch = malloc((kara_scratch(nb) + 2 * nb) * sizeof(uint32_t));
+    if (!scratch) return -1;
+    uint32_t *piece = scratch + kara_scratch(nb);
+    int rc = 0;
+
+    memset(out, 0, (na + nb) * sizeof(uint32_t));
+    for (size_t off = 0; off < na && rc == 0; off += nb) {
+        size_t len = na - off < nb ? na - off : nb;
+        if (len == nb) {
+            kara(a + off, b, nb, piece, scratch);
+        } else {
+            rc = mul_mag(b, nb, a + off, len, piece);
+        }
+        add_into(out + off, na + nb - off, piece, len + nb);
+    }
+    free(scratch);
+    return rc;
+}
+
+int bigint_mul(bigint_t *r, const bigint_t *a, const bigint_t *b) {
+    if (a->len == 0 || b->len == 0) {
+        r->len = 0;
+        r->sign = 1;
+        return 0;
+    }
+    bigint_t tmp;
+    bigint_init(&tmp);
+    if (reserve(&tmp, a->len + b->len) != 0) return -1;
+    if (mul_mag(a->limbs, a->len, b->limbs, b->len, tmp.limbs) != 0) {
+        bigint_free(&tmp);
+        return -1;
+    }
+    tmp.len = a->len + b->len;
+    tmp.sign = a->sign * b->sign;
+    take(r, &tmp);
+    return 0;
+}
+
+int bigint_mul_small(bigint_t *r, const bigint_t *a, uint32_t m) {
+    if (a->len == 0 || m == 0) {
+        r->len = 0;
+        r->sign = 1;
+        return 0;
+    }
+    if (reserve(r, a->len + 2) != 0) return -1;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < a->len; i++) {
+        uint64_t cur = (uint64_t)a->limbs[i] * m + carry;
+        r->limbs[i] = (uint32_t)(cur % BASE);
+        carry = cur / BASE;
+    }
+    size_t len = a->len;
+    while (carry) {
+        r->limbs[len++] = (uint32_t)(carry % BASE);
+        carry /= BASE;
+    }
+    r->len = len;
+    r->sign = a->sign;
+    return 0;
+}
+
+// ============================================================================
+// SUMA Y RESTA
+// ============================================================================
+
+// r = a + sign_b * b
+static int add_signed(bigint_t *r, const bigint_t *a, const bigint_t *b, int sign_b) {
+    if (b->len == 0) return bigint_copy(r, a);
+
+    bigint_t tmp;
+    bigint_init(&tmp);
+    size_t n = (a->len > b->len ? a->len : b->len) + 1;
+    if (reserve(&tmp, n) != 0) return -1;
+
+    if (a->sign == sign_b) {
+        memcpy(tmp.limbs, a->limbs, a->len * sizeof(uint32_t));
+        memset(tmp.limbs + a->len, 0, (n - a->len) * sizeof(uint32_t));
+        add_into(tmp.limbs, n, b->limbs, b->len);
+        tmp.sign = a->sign;
+    } else {
+        // Al mayor en valor absoluto se le resta el menor
+        int c = cmp_mag(a->limbs, a->len, b->limbs, b->len);
+        const bigint_t *big = c >= 0 ? a : b;
+        const bigint_t *small = c >= 0 ? b : a;
+        memcpy(tmp.limbs, big->limbs, big->len * sizeof(uint32_t));
+        memset(tmp.limbs + big->len, 0, (n - big->len) * sizeof(uint32_t));
+        sub_into(tmp.limbs, n, small->limbs, small->len);
+        tmp.sign = c >= 0 ? a->sign : sign_b;
+    }
+    tmp.len = n;
+    take(r, &tmp);
+    return 0;
+}
+
+int bigint_add(bigint_t *r, const bigint_t *a, const bigint_t *b) {
+    return add_signed(r, a, b, b->sign);
+}
+
+int bigint_sub(bigint_t *r, const bigint_t *a, const bigint_t *b) {
+    return add_signed(r, a, b, -b->sign);
+}
+
+// ============================================================================
+// VARIOS
+// ============================================================================
+
+int bigint_shift_limbs(bigint_t *x, long k) {
+    if (x->len == 0 || k == 0) return 0;
+    if (k < 0) {
+        size_t drop = (size_t)-k;
+        if (drop >= x->len) {
+            x->len = 0;
+            x->sign = 1;
+            return 0;
+        }
+        memmove(x->limbs, x->limbs + drop, (x->len - drop) * sizeof(uint32_t));
+        x->len -= drop;
+        return 0;
+    }
+    if (reserve(x, x->len + (size_t)k) != 0) return -1;
+    memmove(x->limbs + k, x->limbs, x->len * sizeof(uint32_t));
+    memset(x->limbs, 0, (size_t)k * sizeof(uint32_t));
+    x->len += (size_t)k;
+    return 0;
+}
+
+int bigint_cmp_abs(const bigint_t *a, const bigint_t *b) {
+    return cmp_mag(a->limbs, a->len, b->limbs, b->len);
+}
+
+static int limb_digits(uint32_t v) {
+    int d = 1;
+    while (v >= 10) {
+        v /= 10;
+        d++;
+    }
+    return d;
+}
+
+size_t bigint_digits(const bigint_t *x) {
+    if (x->len == 0) return 1;
+    return (x->len - 1) * BIGINT_BASE_DIGITS + (size_t)limb_digits(x->limbs[x->len - 1]);
+}
+
+size_t bigint_write_decimal(const bigint_t *x, char *out) {
+    if (x->len == 0) {
+        out[0] = '0';
+        return 1;
+    }
+    // Limb alto sin ceros a la izquierda, el resto con 8 dígitos exactos
+    uint32_t top = x->limbs[x->len - 1];
+    int top_digits = limb_digits(top);
+    for (int i = top_digits - 1; i >= 0; i--) {
+        out[i] = (char)('0' + top % 10);
+        top /= 10;
+    }
+    char *p = out + top_digits;
+    for (size_t i = x->len - 1; i-- > 0;) {
+        uint32_t v = x->limbs[i];
+        for (int d = BIGINT_BASE_DIGITS - 1; d >= 0; d--) {
+            p[d] = (char)('0' + v % 10);
+            v /= 10;
+        }
+        p += BIGINT_BASE_DIGITS;
+    }
+    return (size_t)(p - out);
+}
@@ -0,0 +1,70 @@
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// BIGINT - Enteros de precisión arbitraria
+// ============================================================================
+//
+// Limbs de 32 bits en base 10^8 (little-endian): pasar a decimal es copiar
+// dígitos, que es lo que necesitan /pi y /fibonacci. La multiplicación elige
+// algoritmo por tamaño:
+//
+//   schoolbook   operandos chicos
+//   Karatsuba    desde BIGINT_KARATSUBA_LIMBS
+//   NTT          desde BIGINT_NTT_LIMBS: convolución módulo 2^64 - 2^32 + 1
+//                sobre dígitos base 10^4 (exacta hasta ~10^11 limbs)
+//
+// Las funciones que pueden reservar memoria retornan 0 si éxito y -1 si no
+// hubo memoria. El resultado puede ser el mismo objeto que un operando.
+
+#define BIGINT_BASE             100000000u
+#define BIGINT_BASE_DIGITS      8
+#define BIGINT_KARATSUBA_LIMBS  40
+#define BIGINT_NTT_LIMBS        1024
+
+typedef struct {
+    uint32_t *limbs;        // Base 10^8, limb 0 = el menos significativo
+    size_t len;             // Sin ceros altos; 0 = el número cero
+    size_t cap;
+    int sign;               // 1 o -1 (el cero es positivo)
+} bigint_t;
+
+// Inicializar en cero / liberar
+void bigint_init(bigint_t *x);
+void bigint_free(bigint_t *x);
+
+// Asignar un valor
+int bigint_set_u64(bigint_t *x, uint64_t value);
+int bigint_set_u128(bigint_t *x, unsigned __int128 value);
+int bigint_copy(bigint_t *dst, const bigint_t *src);
+
+// r = a + b, r = a - b, r = a * b (con signo)
+int bigint_add(bigint_t *r, const bigint_t *a, const bigint_t *b);
+int bigint_sub(bigint_t *r, const bigint_t *a, const bigint_t *b);
+int bigint_mul(bigint_t *r, const bigint_t *a, const bigint_t *b);
+
+// r = a * m
+int bigint_mul_small(bigint_t *r, const bigint_t *a, uint32_t m);
+
+// x *= BASE^k (k > 0) o x /= BASE^-k truncando hacia cero (k < 0)
+int bigint_shift_limbs(bigint_t *x, long k);
+
+// Comparar valores absolutos: <0, 0, >0
+int bigint_cmp_abs(const bigint_t *a, const bigint_t *b);
+
+// Cantidad de dígitos decimales de |x| (1 para el cero)
+size_t bigint_digits(const bigint_t *x);
+
+/**
+ * Escribir |x| en decimal (sin signo ni terminador)
+ *
+ * @param x Número
+ * @param out Buffer de al menos bigint_digits(x) bytes
+ * @return Dígitos escritos
+ */
+size_t bigint_write_decimal(const bigint_t *x, char *out);
+
+#endif // BIGINT_H
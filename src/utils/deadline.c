@@ -0,0 +1,77 @@
+// Deadline por request (thread-local)
+#include "utils.h"
+
+// Deadline del thread actual; tv_sec == 0 && tv_usec == 0 significa "sin deadline"
+static __thread struct timeval tl_deadline = {0, 0};
+
+// Microsegundos de CLOCK_MONOTONIC: inmune a saltos del reloj de pared
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static bool deadline_is_set(const struct timeval *deadline) {
+    return deadline && (deadline->tv_sec != 0 || deadline->tv_usec != 0);
+}
+
+static long long deadline_us(const struct timeval *deadline) {
+    return (long long)deadline->tv_sec * 1000000LL + deadline->tv_usec;
+}
+
+void deadline_set(const struct timeval *deadline) {
+    if (!deadline) {
+        deadline_clear();
+        return;
+    }
+    tl_deadline = *deadline;
+}
+
+void deadline_clear(void) {
+    tl_deadline.tv_sec = 0;
+    tl_deadline.tv_usec = 0;
+}
+
+bool deadline_get(struct timeval *out) {
+    if (!deadline_is_set(&tl_deadline)) {
+        return false;
+    }
+    if (out) *out = tl_deadline;
+    return true;
+}
+
+long deadline_remaining_ms_of(const struct timeval *deadline) {
+    if (!deadline_is_set(deadline)) {
+        return -1;
+    }
+    
+    long long remaining = (deadline_us(deadline) - monotonic_us()) / 1000;
+    return remaining > 0 ? (long)remaining : 0;
+}
+
+bool deadline_expired_at(const struct timeval *deadline) {
+    if (!deadline_is_set(deadline)) {
+        return false;
+    }
+    return monotonic_us() >= deadline_us(deadline);
+}
+
+long deadline_remaining_ms(void) {
+    return deadline_remaining_ms_of(&tl_deadline);
+}
+
+bool deadline_expired(void) {
+    return deadline_expired_at(&tl_deadline);
+}
+
+void deadline_from_timeout_ms(struct timeval *out, long timeout_ms) {
+    if (!out) return;
+    
+    // Saturar: timeout_ms * 1000 no debe desbordar (un año alcanza de sobra)
+    const long max_ms = 365L * 24 * 3600 * 1000;
+    if (timeout_ms > max_ms) timeout_ms = max_ms;
+    if (timeout_ms < -max_ms) timeout_ms = -max_ms;
+    long long at = monotonic_us() + (long long)timeout_ms * 1000LL;
+    out->tv_sec = (time_t)(at / 1000000LL);
+    out->tv_usec = (suseconds_t)(at % 1000000LL);
+}
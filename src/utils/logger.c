@@ -8,103 +8,480 @@
 // - Producción: detectar errores sin detener el servidor
 // - Pruebas: verificar el flujo de ejecución
 
+// ¿Cómo funciona?
+// - Cada thread tiene su propio ring buffer (un productor, un consumidor):
+//   loggear es formatear el mensaje en el slot libre y publicar el head,
+//   sin locks ni syscalls
+// - Un thread flusher recorre los rings, arma los headers con un timestamp
+//   cacheado por segundo y escribe lotes enteros con un solo writev()
+// - Cuando un thread termina, su ring queda libre para el próximo thread
+//   (el servidor crea un thread por conexión)
+
 #include "utils.h"
 #include <stdarg.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/uio.h>
+
+#define LOG_RING_ENTRIES   512                 // Potencia de 2
+#define LOG_RING_MASK      (LOG_RING_ENTRIES - 1)
+#define LOG_BATCH_MAX      512                 // Entradas por writev (2 iovecs c/u)
+#define LOG_HEADER_MAX     80
+#define LOG_IDLE_SLEEP_US  50000               // Espera máxima del flusher sin actividad
+#define LOG_BUSY_SLEEP_US  1000
+
+typedef struct {
+    time_t sec;
+    const char *file;           // __FILE__: literal estático, se puede guardar el puntero
+    int line;
+    uint16_t level;
+    uint16_t len;               // Bytes de msg, incluido el '\n' final
+    char msg[LOG_MAX_MESSAGE];
+} log_entry_t;
+
+typedef struct log_ring {
+    uint32_t head __attribute__((aligned(64)));    // Solo lo escribe el productor
+    uint32_t tail __attribute__((aligned(64)));    // Solo lo escribe el flusher
+    int in_use __attribute__((aligned(64)));       // 1 mientras un thread es dueño
+    unsigned long dropped;
+    struct log_ring *next;
+    log_entry_t entries[LOG_RING_ENTRIES];
+} log_ring_t;
+
+typedef enum {
+    LOGGER_UNINITIALIZED,
+    LOGGER_RUNNING,
+    LOGGER_STOPPED              // Después de logger_shutdown: escritura directa
+} logger_state_t;
 
 // Estado global del logger
 static struct {
-    log_level_t level;
-    FILE *file;
-    pthread_mutex_t mutex;
-    bool initialized;
+    int state;
+    int level;
+    int overflow;
+    int fd;
+    log_ring_t *rings;          // Lista (solo crece), push con CAS
+    unsigned long dropped;
+
+    pthread_t flusher;
+    int stop;
+    pthread_mutex_t wake_mutex;
+    pthread_cond_t wake_cond;
+
+    pthread_mutex_t init_mutex; // Solo init/shutdown
+    pthread_key_t ring_key;
 } g_logger = {
+    .state = LOGGER_UNINITIALIZED,
     .level = LOG_INFO,
-    .file = NULL,
-    .initialized = false
+    .overflow = LOG_OVERFLOW_DROP,
+    .fd = STDERR_FILENO,
+    .wake_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake_cond = PTHREAD_COND_INITIALIZER,
+    .init_mutex = PTHREAD_MUTEX_INITIALIZER
 };
 
+static __thread log_ring_t *tl_ring = NULL;
+
+static const char* level_to_string(log_level_t level) {
+    switch (level) {
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_INFO:  return "INFO ";
+        case LOG_WARN:  return "WARN ";
+        case LOG_ERROR: return "ERROR";
+        default:        return "?????";
+    }
+}
+
+static const char* base_name(const char *file) {
+    const char *filename = strrchr(file, '/');
+    return filename ? filename + 1 : file;
+}
+
+static time_t coarse_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return ts.tv_sec;
+}
+
+// Timestamp formateado, recalculado solo cuando cambia el segundo.
+// Cada caller tiene su propio cache (el flusher, o la escritura directa).
+typedef struct {
+    time_t sec;
+    char text[32];
+} ts_cache_t;
+
+static const char* format_timestamp(ts_cache_t *cache, time_t sec) {
+    if (cache->sec != sec || cache->text[0] == '\0') {
+        struct tm tm_info;
+        localtime_r(&sec, &tm_info);
+        strftime(cache->text, sizeof(cache->text), "%Y-%m-%d %H:%M:%S", &tm_info);
+        cache->sec = sec;
+    }
+    return cache->text;
+}
+
+// Escribir todos los iovecs, reintentando escrituras parciales
+static void writev_all(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return; // Nada razonable que hacer si el log falla
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+// ============================================================================
+// FLUSHER
+// ============================================================================
+
+// Vaciar todos los rings una vez. Retorna cuántas entradas escribió.
+static size_t flush_rings(ts_cache_t *ts) {
+    static struct iovec iov[LOG_BATCH_MAX * 2];
+    static char headers[LOG_BATCH_MAX][LOG_HEADER_MAX];
+    size_t written = 0;
+
+    log_ring_t *ring = __atomic_load_n(&g_logger.rings, __ATOMIC_ACQUIRE);
+    for (; ring; ring = ring->next) {
+        // Mensajes descartados desde la última pasada
+        unsigned long dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+        if (dropped > 0) {
+            char line[128];
+            int len = snprintf(line, sizeof(line),
+                               "[%s] [%s] [logger.c:%d] %lu log messages dropped (ring full)\n",
+                               format_timestamp(ts, coarse_now()), level_to_string(LOG_WARN),
+                               __LINE__, dropped);
+            if (len > 0 && (size_t)len < sizeof(line)) {
+                iov[0].iov_base = line;
+                iov[0].iov_len = (size_t)len;
+                writev_all(g_logger.fd, iov, 1);
+            }
+        }
+
+        uint32_t tail = ring->tail;
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        while (tail != head) {
+            uint32_t batch = head - tail;
+            if (batch > LOG_BATCH_MAX) batch = LOG_BATCH_MAX;
+
+            for (uint32_t i = 0; i < batch; i++) {
+                const log_entry_t *e = &ring->entries[(tail + i) & LOG_RING_MASK];
+                int hlen = snprintf(headers[i], LOG_HEADER_MAX, "[%s] [%s] [%s:%d] ",
+                                    format_timestamp(ts, e->sec),
+                                    level_to_string((log_level_t)e->level),
+                                    base_name(e->file), e->line);
+                if (hlen < 0) hlen = 0;
+                if (hlen >= LOG_HEADER_MAX) hlen = LOG_HEADER_MAX - 1;
+                iov[2 * i].iov_base = headers[i];
+                iov[2 * i].iov_len = (size_t)hlen;
+                iov[2 * i + 1].iov_base = (void*)e->msg;
+                iov[2 * i + 1].iov_len = e->len;
+            }
+            writev_all(g_logger.fd, iov, (int)(batch * 2));
+
+            // Recién ahora el productor puede reutilizar esas entradas
+            tail += batch;
+            __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+            written += batch;
+        }
+    }
+    return written;
+}
+
+static void flusher_sleep(long usec) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += usec * 1000;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    pthread_mutex_lock(&g_logger.wake_mutex);
+    if (!__atomic_load_n(&g_logger.stop, __ATOMIC_ACQUIRE)) {
+        pthread_cond_timedwait(&g_logger.wake_cond, &g_logger.wake_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&g_logger.wake_mutex);
+}
+
+static void* flusher_thread(void *arg) {
+    (void)arg;
+    ts_cache_t ts = {0};
+    long sleep_us = LOG_BUSY_SLEEP_US;
+
+    while (!__atomic_load_n(&g_logger.stop, __ATOMIC_ACQUIRE)) {
+        if (flush_rings(&ts) > 0) {
+            sleep_us = LOG_BUSY_SLEEP_US;
+        } else if (sleep_us < LOG_IDLE_SLEEP_US) {
+            sleep_us *= 2; // Sin actividad: despertar cada vez menos
+        }
+        flusher_sleep(sleep_us);
+    }
+
+    flush_rings(&ts); // Lo que quedó antes del stop
+    return NULL;
+}
+
+static void wake_flusher(void) {
+    pthread_mutex_lock(&g_logger.wake_mutex);
+    pthread_cond_signal(&g_logger.wake_cond);
+    pthread_mutex_unlock(&g_logger.wake_mutex);
+}
+
+// ============================================================================
+// RINGS POR THREAD
+// ============================================================================
+
+// Destructor del pthread_key: el ring queda libre para otro thread.
+// Las entradas pendientes las sigue vaciando el flusher.
+static void ring_release(void *arg) {
+    log_ring_t *ring = (log_ring_t*)arg;
+    __atomic_store_n(&ring->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static log_ring_t* ring_acquire(void) {
+    log_ring_t *ring = __atomic_load_n(&g_logger.rings, __ATOMIC_ACQUIRE);
+    for (; ring; ring = ring->next) {
+        int expected = 0;
+        if (__atomic_load_n(&ring->in_use, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&ring->in_use, &expected, 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (!ring) {
+        ring = aligned_alloc(64, sizeof(log_ring_t));
+        if (!ring) return NULL;
+        memset(ring, 0, sizeof(*ring));
+        ring->in_use = 1;
+
+        log_ring_t *first = __atomic_load_n(&g_logger.rings, __ATOMIC_RELAXED);
+        do {
+            ring->next = first;
+        } while (!__atomic_compare_exchange_n(&g_logger.rings, &first, ring, 0,
+                                              __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+
+    pthread_setspecific(g_logger.ring_key, ring);
+    tl_ring = ring;
+    return ring;
+}
+
+// ============================================================================
+// INIT / SHUTDOWN
+// ============================================================================
+
+static void logger_atexit(void) {
+    logger_shutdown();
+}
+
 void logger_init(log_level_t level, const char *log_file) {
-    if (g_logger.initialized) {
+    pthread_mutex_lock(&g_logger.init_mutex);
+    if (g_logger.state == LOGGER_RUNNING) {
+        pthread_mutex_unlock(&g_logger.init_mutex);
         return;
     }
-    
+
     g_logger.level = level;
-    
+    g_logger.fd = STDERR_FILENO;
+
     if (log_file) {
-        g_logger.file = fopen(log_file, "a");
-        if (!g_logger.file) {
+        int fd = open(log_file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
             fprintf(stderr, "Failed to open log file: %s\n", log_file);
-            g_logger.file = stderr;
+        } else {
+            g_logger.fd = fd;
         }
+    }
+
+    static bool key_created = false;
+    if (!key_created) {
+        pthread_key_create(&g_logger.ring_key, ring_release);
+        atexit(logger_atexit); // Vaciar los rings aunque nadie llame a shutdown
+        key_created = true;
+    }
+
+    __atomic_store_n(&g_logger.stop, 0, __ATOMIC_RELEASE);
+    if (pthread_create(&g_logger.flusher, NULL, flusher_thread, NULL) != 0) {
+        // Sin flusher: quedarse con la escritura directa
+        fprintf(stderr, "Failed to start log flusher thread\n");
+        __atomic_store_n(&g_logger.state, LOGGER_STOPPED, __ATOMIC_RELEASE);
     } else {
-        g_logger.file = stderr;
+        __atomic_store_n(&g_logger.state, LOGGER_RUNNING, __ATOMIC_RELEASE);
     }
-    
-    pthread_mutex_init(&g_logger.mutex, NULL);
-    g_logger.initialized = true;
+
+    pthread_mutex_unlock(&g_logger.init_mutex);
 }
 
 void logger_shutdown() {
-    if (!g_logger.initialized) {
+    pthread_mutex_lock(&g_logger.init_mutex);
+    if (g_logger.state != LOGGER_RUNNING) {
+        pthread_mutex_unlock(&g_logger.init_mutex);
         return;
     }
-    
-    pthread_mutex_lock(&g_logger.mutex);
-    
-    if (g_logger.file && g_logger.file != stderr) {
-        fclose(g_logger.file);
+
+    // Los mensajes posteriores se escriben directo (ver log_message)
+    __atomic_store_n(&g_logger.state, LOGGER_STOPPED, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&g_logger.stop, 1, __ATOMIC_RELEASE);
+    wake_flusher();
+    pthread_join(g_logger.flusher, NULL);
+
+    if (g_logger.fd != STDERR_FILENO) {
+        close(g_logger.fd);
+        g_logger.fd = STDERR_FILENO;
     }
-    
-    g_logger.initialized = false;
-    pthread_mutex_unlock(&g_logger.mutex);
-    pthread_mutex_destroy(&g_logger.mutex);
+
+    // Los rings no se liberan: threads detached todavía pueden tener uno
+    // asignado y su destructor de pthread_key lo toca al terminar.
+    pthread_mutex_unlock(&g_logger.init_mutex);
 }
 
-static const char* level_to_string(log_level_t level) {
-    switch (level) {
-        case LOG_DEBUG: return "DEBUG";
-        case LOG_INFO:  return "INFO ";
-        case LOG_WARN:  return "WARN ";
-        case LOG_ERROR: return "ERROR";
-        default:        return "?????";
+void logger_after_fork(void) {
+    // Solo sobrevive el thread que llamó a fork(): los mutex pueden haber
+    // quedado tomados y el flusher no existe en el hijo
+    pthread_mutex_init(&g_logger.init_mutex, NULL);
+    pthread_mutex_init(&g_logger.wake_mutex, NULL);
+    pthread_cond_init(&g_logger.wake_cond, NULL);
+
+    // Lo pendiente lo escribe el padre. Los rings de threads que ya no
+    // existen quedan libres (el del thread actual sigue siendo suyo).
+    log_ring_t *ring = __atomic_load_n(&g_logger.rings, __ATOMIC_ACQUIRE);
+    for (; ring; ring = ring->next) {
+        ring->tail = ring->head;
+        ring->dropped = 0;
+        if (ring != tl_ring) {
+            ring->in_use = 0;
+        }
+    }
+
+    if (g_logger.state != LOGGER_RUNNING) {
+        return;
+    }
+    __atomic_store_n(&g_logger.stop, 0, __ATOMIC_RELEASE);
+    if (pthread_create(&g_logger.flusher, NULL, flusher_thread, NULL) != 0) {
+        __atomic_store_n(&g_logger.state, LOGGER_STOPPED, __ATOMIC_RELEASE);
     }
 }
 
+void logger_set_overflow(log_overflow_t policy) {
+    __atomic_store_n(&g_logger.overflow, (int)policy, __ATOMIC_RELAXED);
+}
+
+unsigned long logger_dropped(void) {
+    return __atomic_load_n(&g_logger.dropped, __ATOMIC_RELAXED);
+}
+
+void logger_flush(void) {
+    if (__atomic_load_n(&g_logger.state, __ATOMIC_ACQUIRE) != LOGGER_RUNNING) {
+        return;
+    }
+
+    for (int attempt = 0; attempt < 10000; attempt++) {
+        bool pending = false;
+        log_ring_t *ring = __atomic_load_n(&g_logger.rings, __ATOMIC_ACQUIRE);
+        for (; ring; ring = ring->next) {
+            if (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) !=
+                __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+                pending = true;
+                break;
+            }
+        }
+        if (!pending) return;
+
+        wake_flusher();
+        usleep(100);
+    }
+}
+
+// ============================================================================
+// LOG
+// ============================================================================
+
+// Escritura directa con un solo write (antes de tener flusher o después del shutdown)
+static void log_direct(log_level_t level, const char *file, int line,
+                       const char *fmt, va_list args) {
+    ts_cache_t ts = {0};
+    char buf[LOG_HEADER_MAX + LOG_MAX_MESSAGE];
+
+    int len = snprintf(buf, sizeof(buf), "[%s] [%s] [%s:%d] ",
+                       format_timestamp(&ts, coarse_now()), level_to_string(level),
+                       base_name(file), line);
+    if (len < 0) return;
+    if ((size_t)len >= sizeof(buf) - 1) len = (int)sizeof(buf) - 2;
+
+    int msg = vsnprintf(buf + len, sizeof(buf) - len - 1, fmt, args);
+    if (msg > 0) {
+        len += ((size_t)msg < sizeof(buf) - len - 1) ? msg : (int)(sizeof(buf) - len - 2);
+    }
+    buf[len++] = '\n';
+
+    ssize_t ignored = write(g_logger.fd, buf, (size_t)len);
+    (void)ignored;
+}
+
 void log_message(log_level_t level, const char *file, int line, const char *fmt, ...) {
+    int state = __atomic_load_n(&g_logger.state, __ATOMIC_ACQUIRE);
+
     // Auto-inicializar si no se ha hecho
-    if (!g_logger.initialized) {
+    if (state == LOGGER_UNINITIALIZED) {
         logger_init(LOG_INFO, NULL);
+        state = __atomic_load_n(&g_logger.state, __ATOMIC_ACQUIRE);
     }
-    
+
     // Filtrar por nivel
-    if (level < g_logger.level) {
+    if ((int)level < __atomic_load_n(&g_logger.level, __ATOMIC_RELAXED)) {
         return;
     }
-    
-    pthread_mutex_lock(&g_logger.mutex);
-    
-    // Timestamp
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    char timestamp[32];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
-    
-    // Extraer solo el nombre del archivo (sin path)
-    const char *filename = strrchr(file, '/');
-    filename = filename ? filename + 1 : file;
-    
-    // Imprimir header
-    fprintf(g_logger.file, "[%s] [%s] [%s:%d] ", 
-            timestamp, level_to_string(level), filename, line);
-    
-    // Imprimir mensaje
+
     va_list args;
     va_start(args, fmt);
-    vfprintf(g_logger.file, fmt, args);
+
+    log_ring_t *ring = tl_ring;
+    if (state != LOGGER_RUNNING || (!ring && !(ring = ring_acquire()))) {
+        log_direct(level, file, line, fmt, args);
+        va_end(args);
+        return;
+    }
+
+    uint32_t head = ring->head;
+    while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_ENTRIES) {
+        if (__atomic_load_n(&g_logger.overflow, __ATOMIC_RELAXED) == LOG_OVERFLOW_DROP ||
+            __atomic_load_n(&g_logger.state, __ATOMIC_ACQUIRE) != LOGGER_RUNNING) {
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&g_logger.dropped, 1, __ATOMIC_RELAXED);
+            va_end(args);
+            return;
+        }
+        wake_flusher();
+        sched_yield();
+    }
+
+    log_entry_t *e = &ring->entries[head & LOG_RING_MASK];
+    e->sec = coarse_now();
+    e->file = file;
+    e->line = line;
+    e->level = (uint16_t)level;
+
+    // Reservar un byte para el '\n'
+    int len = vsnprintf(e->msg, sizeof(e->msg) - 1, fmt, args);
     va_end(args);
-    
-    fprintf(g_logger.file, "\n");
-    fflush(g_logger.file);
-    
-    pthread_mutex_unlock(&g_logger.mutex);
-}
\ No newline at end of file
+    if (len < 0) len = 0;
+    if ((size_t)len > sizeof(e->msg) - 2) len = (int)sizeof(e->msg) - 2;
+    e->msg[len++] = '\n';
+    e->len = (uint16_t)len;
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
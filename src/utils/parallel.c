@@ -0,0 +1,59 @@
+// Parallel for con contador atómico (el thread que llama participa)
+#include "utils.h"
+#include <unistd.h>
+
+typedef struct {
+    int next;                   // Próximo índice a tomar (atómico)
+    int count;
+    parallel_fn fn;
+    void *ctx;
+    bool has_deadline;
+    struct timeval deadline;
+} parallel_job_t;
+
+static void run_indices(parallel_job_t *job) {
+    for (;;) {
+        int i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->count) return;
+        job->fn(i, job->ctx);
+    }
+}
+
+static void* helper_thread(void *arg) {
+    parallel_job_t *job = arg;
+    // El deadline es thread-local: el helper trabaja con el de la request
+    if (job->has_deadline) deadline_set(&job->deadline);
+    run_indices(job);
+    return NULL;
+}
+
+int parallel_for(int count, int max_threads, parallel_fn fn, void *ctx) {
+    if (count <= 0 || !fn) return 0;
+
+    int threads = max_threads < 1 ? 1 : max_threads;
+    if (threads > PARALLEL_MAX_THREADS) threads = PARALLEL_MAX_THREADS;
+    if (threads > count) threads = count;
+
+    parallel_job_t job = { .next = 0, .count = count, .fn = fn, .ctx = ctx };
+    job.has_deadline = deadline_get(&job.deadline);
+
+    pthread_t helpers[PARALLEL_MAX_THREADS];
+    int started = 0;
+    for (int t = 1; t < threads; t++) {
+        // Sin thread no se pierde trabajo: los índices los toma el resto
+        if (pthread_create(&helpers[started], NULL, helper_thread, &job) != 0) break;
+        started++;
+    }
+
+    run_indices(&job);
+    for (int t = 0; t < started; t++) {
+        pthread_join(helpers[t], NULL);
+    }
+    return started + 1;
+}
+
+int parallel_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) return 1;
+    return cpus > PARALLEL_MAX_THREADS ? PARALLEL_MAX_THREADS : (int)cpus;
+}
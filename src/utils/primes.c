@@ -0,0 +1,794 @@
+// Primalidad y factorización con aritmética de Montgomery (64 y 128 bits)
+#include "primes.h"
+#include "utils.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef prime_u128_t u128;
+
+#define RHO_BATCH 128           // Productos |x - y| acumulados por cada gcd
+
+// ============================================================================
+// PRIMOS CHICOS (trial division)
+// ============================================================================
+
+static uint16_t small_primes[PRIME_TRIAL_LIMIT / 4];
+static int small_prime_count = 0;
+static pthread_once_t small_primes_once = PTHREAD_ONCE_INIT;
+
+static void small_primes_init(void) {
+    bool composite[PRIME_TRIAL_LIMIT] = { false };
+    for (int i = 2; i < PRIME_TRIAL_LIMIT; i++) {
+        if (composite[i]) continue;
+        small_primes[small_prime_count++] = (uint16_t)i;
+        for (int j = i * i; j < PRIME_TRIAL_LIMIT; j += i) composite[j] = true;
+    }
+}
+
+// ============================================================================
+// GCD
+// ============================================================================
+
+static uint64_t gcd64(uint64_t a, uint64_t b) {
+    if (a == 0) return b;
+    if (b == 0) return a;
+    int shift = __builtin_ctzll(a | b);
+    a >>= __builtin_ctzll(a);
+    while (b) {
+        b >>= __builtin_ctzll(b);
+        if (a > b) {
+            uint64_t t = a; a = b; b = t;
+        }
+        b -= a;
+    }
+    return a << shift;
+}
+
+static int ctz128(u128 x) {
+    uint64_t lo = (uint64_t)x;
+    return lo ? __builtin_ctzll(lo) : 64 + __builtin_ctzll((uint64_t)(x >> 64));
+}
+
+static u128 gcd128(u128 a, u128 b) {
+    if (a == 0) return b;
+    if (b == 0) return a;
+    int shift = ctz128(a | b);
+    a >>= ctz128(a);
+    while (b) {
+        b >>= ctz128(b);
+        if (a > b) {
+            u128 t = a; a = b; b = t;
+        }
+        b -= a;
+    }
+    return a << shift;
+}
+
+// ============================================================================
+// MONTGOMERY 64 BITS (R = 2^64, n impar)
+// ============================================================================
+
+typedef struct {
+    uint64_t n;
+    uint64_t inv;               // n^-1 mod 2^64
+    uint64_t one;               // R mod n
+    uint64_t r2;                // R^2 mod n
+} mont64_t;
+
+static void mont64_init(mont64_t *m, uint64_t n) {
+    uint64_t inv = n;           // Correcto en 3 bits; Newton duplica cada vez
+    for (int i = 0; i < 5; i++) inv *= 2 - n * inv;
+    m->n = n;
+    m->inv = inv;
+    m->one = (0 - n) % n;       // 2^64 mod n, con división de 64 bits
+    m->r2 = (uint64_t)((u128)m->one * m->one % n);
+}
+
+// t / R mod n, para t < n * R. Los 64 bits bajos de t y q*n coinciden
+static inline uint64_t mont64_reduce(const mont64_t *m, u128 t) {
+    uint64_t hi = (uint64_t)(t >> 64);
+    uint64_t q = (uint64_t)t * m->inv;
+    uint64_t h = (uint64_t)(((u128)q * m->n) >> 64);
+    // Sin branch: el signo de hi - h es aleatorio y el mispredict cuesta más
+    // que la suma
+    return hi - h + (m->n & (0 - (uint64_t)(hi < h)));
+}
+
+static inline uint64_t mont64_mul(const mont64_t *m, uint64_t a, uint64_t b) {
+    return mont64_reduce(m, (u128)a * b);
+}
+
+static inline uint64_t mont64_add(const mont64_t *m, uint64_t a, uint64_t b) {
+    uint64_t s = a + b;
+    return (s < a || s >= m->n) ? s - m->n : s;
+}
+
+static inline uint64_t mont64_to(const mont64_t *m, uint64_t a) {
+    return mont64_mul(m, a % m->n, m->r2);
+}
+
+static uint64_t mont64_pow(const mont64_t *m, uint64_t base, uint64_t exp) {
+    uint64_t result = m->one;
+    while (exp) {
+        if (exp & 1) result = mont64_mul(m, result, base);
+        base = mont64_mul(m, base, base);
+        exp >>= 1;
+    }
+    return result;
+}
+
+// ============================================================================
+// MONTGOMERY 128 BITS (R = 2^128, n impar)
+// ============================================================================
+
+typedef struct {
+    u128 n;
+    u128 inv;
+    u128 one;
+    u128 r2;
+} mont128_t;
+
+// a * b = hi * 2^128 + lo
+static inline void mul_wide(u128 a, u128 b, u128 *hi, u128 *lo) {
+    uint64_t a0 = (uint64_t)a, a1 = (uint64_t)(a >> 64);
+    uint64_t b0 = (uint64_t)b, b1 = (uint64_t)(b >> 64);
+    u128 p00 = (u128)a0 * b0;
+    u128 p01 = (u128)a0 * b1;
+    u128 p10 = (u128)a1 * b0;
+    u128 p11 = (u128)a1 * b1;
+    u128 mid = (p00 >> 64) + (uint64_t)p01 + (uint64_t)p10;
+    *lo = (mid << 64) | (uint64_t)p00;
+    *hi = p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+}
+
+static inline u128 mont128_add(const mont128_t *m, u128 a, u128 b) {
+    u128 s = a + b;
+    return (s < a || s >= m->n) ? s - m->n : s;
+}
+
+static void mont128_init(mont128_t *m, u128 n) {
+    u128 inv = n;
+    for (int i = 0; i < 7; i++) inv *= 2 - n * inv;
+    m->n = n;
+    m->inv = inv;
+    m->one = (0 - n) % n;       // 2^128 mod n
+    // R^2 mod n = R * 2^128: 128 duplicaciones modulares de R
+    m->r2 = m->one;
+    for (int i = 0; i < 128; i++) m->r2 = mont128_add(m, m->r2, m->r2);
+}
+
+static inline u128 mont128_mul(const mont128_t *m, u128 a, u128 b) {
+    u128 hi, lo, qhi, qlo;
+    mul_wide(a, b, &hi, &lo);
+    mul_wide(lo * m->inv, m->n, &qhi, &qlo);
+    return hi >= qhi ? hi - qhi : hi - qhi + m->n;
+}
+
+static inline u128 mont128_to(const mont128_t *m, u128 a) {
+    return mont128_mul(m, a % m->n, m->r2);
+}
+
+static u128 mont128_pow(const mont128_t *m, u128 base, u128 exp) {
+    u128 result = m->one;
+    while (exp) {
+        if (exp & 1) result = mont128_mul(m, result, base);
+        base = mont128_mul(m, base, base);
+        exp >>= 1;
+    }
+    return result;
+}
+
+// ============================================================================
+// MILLER-RABIN
+// ============================================================================
+
+// Divisible por un primo chico: 1 si n es ese primo, 0 si es compuesto,
+// -1 si no tiene factores chicos
+static int small_prime_verdict(u128 n) {
+    static const uint32_t first[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+    for (size_t i = 0; i < sizeof(first) / sizeof(first[0]); i++) {
+        if (n % first[i] == 0) return n == first[i];
+    }
+    return n < 41 * 41 ? 1 : -1;
+}
+
+bool prime_is_prime_u64(uint64_t n) {
+    if (n < 2) return false;
+    int verdict = small_prime_verdict(n);
+    if (verdict >= 0) return verdict == 1;
+
+    // Bases de Sinclair: deterministas para todo n < 2^64
+    static const uint64_t bases[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+    mont64_t m;
+    mont64_init(&m, n);
+    uint64_t d = n - 1;
+    int s = __builtin_ctzll(d);
+    d >>= s;
+    uint64_t minus_one = n - m.one;
+
+    for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++) {
+        uint64_t a = bases[i] % n;
+        if (a == 0) continue;
+        uint64_t x = mont64_pow(&m, mont64_to(&m, a), d);
+        if (x == m.one || x == minus_one) continue;
+        bool witness = true;
+        for (int r = 1; r < s && witness; r++) {
+            x = mont64_mul(&m, x, x);
+            if (x == minus_one) witness = false;
+        }
+        if (witness) return false;
+    }
+    return true;
+}
+
+bool prime_is_prime_u128(u128 n) {
+    if (n <= UINT64_MAX) return prime_is_prime_u64((uint64_t)n);
+    if (small_prime_verdict(n) == 0) return false;
+
+    pthread_once(&small_primes_once, small_primes_init);
+    mont128_t m;
+    mont128_init(&m, n);
+    u128 d = n - 1;
+    int s = ctz128(d);
+    d >>= s;
+    u128 minus_one = n - m.one;
+
+    for (int i = 0; i < PRIME_MR128_BASES; i++) {
+        u128 x = mont128_pow(&m, mont128_to(&m, small_primes[i]), d);
+        if (x == m.one || x == minus_one) continue;
+        bool witness = true;
+        for (int r = 1; r < s && witness; r++) {
+            x = mont128_mul(&m, x, x);
+            if (x == minus_one) witness = false;
+        }
+        if (witness) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// MILLER-RABIN POR LOTES
+// ============================================================================
+//
+// Cada multiplicación de Montgomery es una cadena de tres productos
+// dependientes: con un solo número la CPU espera la latencia del
+// multiplicador. Corriendo MR_LANES números a la vez (mismas bases, mismo
+// loop) las cadenas son independientes y se solapan. Las ramas por lane se
+// resuelven con selects, así que un lote cuesta lo que el número más largo.
+
+#define MR_LANES 4
+
+static const uint64_t mr_bases_u32[] = { 2, 7, 61 };    // n < 4759123141
+static const uint64_t mr_bases_u64[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+
+typedef struct {
+    mont64_t m;
+    uint64_t d;                 // n - 1 = d * 2^s
+    uint64_t minus_one;
+    int s;
+    size_t index;               // Posición en la entrada
+} mr64_state_t;
+
+// Una ronda (una base por lane) sobre hasta MR_LANES números; pass[l] =
+// sobrevivió. Los lanes sobrantes repiten el primero y se descartan
+static void mr64_round(mr64_state_t *const *st, const uint64_t *bases, int lanes, bool *pass) {
+    mont64_t m[MR_LANES];
+    uint64_t d[MR_LANES], minus_one[MR_LANES], x[MR_LANES], base[MR_LANES];
+    int s[MR_LANES];
+    bool done[MR_LANES];
+    int max_bits = 0, max_s = 0;
+
+    for (int l = 0; l < MR_LANES; l++) {
+        const mr64_state_t *lane = st[l < lanes ? l : 0];
+        m[l] = lane->m;
+        d[l] = lane->d;
+        s[l] = lane->s;
+        minus_one[l] = lane->minus_one;
+        base[l] = mont64_to(&m[l], bases[l < lanes ? l : 0]);
+        x[l] = m[l].one;
+        int bits = 64 - __builtin_clzll(d[l]);
+        if (bits > max_bits) max_bits = bits;
+        if (s[l] > max_s) max_s = s[l];
+    }
+
+    // base^d, bit a bit desde el menos significativo. El bit elige con una
+    // máscara: con un branch cada bit aleatorio sería un mispredict
+    for (int k = 0; k < max_bits; k++) {
+        #pragma GCC unroll 4
+        for (int l = 0; l < MR_LANES; l++) {
+            uint64_t t = mont64_mul(&m[l], x[l], base[l]);
+            uint64_t mask = 0 - ((d[l] >> k) & 1);
+            x[l] = (t & mask) | (x[l] & ~mask);
+            base[l] = mont64_mul(&m[l], base[l], base[l]);
+        }
+    }
+    for (int l = 0; l < MR_LANES; l++) {
+        done[l] = x[l] == m[l].one || x[l] == minus_one[l];
+    }
+    for (int r = 1; r < max_s; r++) {
+        #pragma GCC unroll 4
+        for (int l = 0; l < MR_LANES; l++) {
+            x[l] = mont64_mul(&m[l], x[l], x[l]);
+            done[l] |= r < s[l] && x[l] == minus_one[l];
+        }
+    }
+    for (int l = 0; l < lanes; l++) pass[l] = done[l];
+}
+
+void prime_is_prime_u64_batch(const uint64_t *n, size_t count, bool *out) {
+    mr64_state_t *states = malloc(count * sizeof(mr64_state_t));
+    mr64_state_t **alive = malloc(count * sizeof(mr64_state_t*));
+    if (!states || !alive) {
+        free(states);
+        free(alive);
+        for (size_t i = 0; i < count; i++) out[i] = prime_is_prime_u64(n[i]);
+        return;
+    }
+
+    // Los que resuelven los primos chicos no llegan a Miller-Rabin
+    size_t pending = 0;
+    for (size_t i = 0; i < count; i++) {
+        int verdict = n[i] < 2 ? 0 : small_prime_verdict(n[i]);
+        out[i] = verdict == 1;
+        if (verdict >= 0) continue;
+        mr64_state_t *st = &states[pending];
+        mont64_init(&st->m, n[i]);
+        st->s = __builtin_ctzll(n[i] - 1);
+        st->d = (n[i] - 1) >> st->s;
+        st->minus_one = n[i] - st->m.one;
+        st->index = i;
+        alive[pending++] = st;
+    }
+
+    // Base por base, compactando los sobrevivientes: los lanes siempre van
+    // llenos aunque la mayoría de los compuestos caiga con la primera base
+    for (int b = 0; b < 7 && pending > 0; b++) {
+        size_t kept = 0;
+        for (size_t i = 0; i < pending;) {
+            mr64_state_t *group[MR_LANES];
+            uint64_t bases[MR_LANES];
+            bool pass[MR_LANES];
+            int lanes = 0;
+            for (; i < pending && lanes < MR_LANES; i++) {
+                mr64_state_t *st = alive[i];
+                bool small = st->m.n < 4759123141ULL;
+                if (small && b >= 3) {
+                    out[st->index] = true;          // Pasó {2, 7, 61}
+                    continue;
+                }
+                uint64_t a = small ? mr_bases_u32[b] : mr_bases_u64[b] % st->m.n;
+                if (a == 0) {
+                    alive[kept++] = st;             // Base múltiplo de n: no dice nada
+                    continue;
+                }
+                group[lanes] = st;
+                bases[lanes++] = a;
+            }
+            if (lanes == 0) continue;
+            mr64_round(group, bases, lanes, pass);
+            for (int l = 0; l < lanes; l++) {
+                if (pass[l]) alive[kept++] = group[l];
+            }
+        }
+        pending = kept;
+    }
+    for (size_t i = 0; i < pending; i++) out[alive[i]->index] = true;
+
+    free(states);
+    free(alive);
+}
+
+// ============================================================================
+// POLLARD RHO (BRENT)
+// ============================================================================
+//
+// f(y) = y^2 + c. En cada tramo de longitud r se acumula el producto de
+// |x - y| y se hace un gcd cada RHO_BATCH pasos; si el gcd da n (se pasó de
+// largo en el lote), se rehace el último lote de a un paso.
+
+// Divisor propio de n (compuesto, impar, sin factores chicos); 0 si venció
+// el deadline
+static uint64_t rho64(uint64_t n) {
+    mont64_t m;
+    mont64_init(&m, n);
+    for (uint64_t c0 = 1; ; c0++) {
+        uint64_t c = mont64_to(&m, c0);
+        uint64_t y = mont64_to(&m, 2), x = y, ys = y;
+        uint64_t q = m.one, g = 1;
+
+        for (uint64_t r = 1; g == 1; r *= 2) {
+            x = y;
+            for (uint64_t i = 0; i < r; i++) y = mont64_add(&m, mont64_mul(&m, y, y), c);
+            for (uint64_t k = 0; k < r && g == 1; k += RHO_BATCH) {
+                if (deadline_expired()) return 0;
+                ys = y;
+                uint64_t steps = r - k < RHO_BATCH ? r - k : RHO_BATCH;
+                for (uint64_t i = 0; i < steps; i++) {
+                    y = mont64_add(&m, mont64_mul(&m, y, y), c);
+                    q = mont64_mul(&m, q, x > y ? x - y : y - x);
+                }
+                // q está multiplicado por R, que es coprimo con n
+                g = gcd64(q, n);
+            }
+        }
+        if (g == n) {
+            do {
+                ys = mont64_add(&m, mont64_mul(&m, ys, ys), c);
+                g = gcd64(x > ys ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+        if (g != n) return g;
+    }
+}
+
+static u128 rho128(u128 n) {
+    mont128_t m;
+    mont128_init(&m, n);
+    for (uint64_t c0 = 1; ; c0++) {
+        u128 c = mont128_to(&m, c0);
+        u128 y = mont128_to(&m, 2), x = y, ys = y;
+        u128 q = m.one, g = 1;
+
+        for (u128 r = 1; g == 1; r *= 2) {
+            x = y;
+            for (u128 i = 0; i < r; i++) y = mont128_add(&m, mont128_mul(&m, y, y), c);
+            for (u128 k = 0; k < r && g == 1; k += RHO_BATCH) {
+                if (deadline_expired()) return 0;
+                ys = y;
+                u128 steps = r - k < RHO_BATCH ? r - k : RHO_BATCH;
+                for (u128 i = 0; i < steps; i++) {
+                    y = mont128_add(&m, mont128_mul(&m, y, y), c);
+                    q = mont128_mul(&m, q, x > y ? x - y : y - x);
+                }
+                g = gcd128(q, n);
+            }
+        }
+        if (g == n) {
+            do {
+                ys = mont128_add(&m, mont128_mul(&m, ys, ys), c);
+                g = gcd128(x > ys ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+        if (g != n) return g;
+    }
+}
+
+// ============================================================================
+// FACTORIZACIÓN
+// ============================================================================
+
+// Agrega los factores primos de n (impar, sin factores chicos) a out
+static int factor_rec(u128 n, u128 *out, int count) {
+    if (n == 1 || count < 0) return count;
+    if (prime_is_prime_u128(n)) {
+        if (count >= PRIME_MAX_FACTORS) return -1;
+        out[count] = n;
+        return count + 1;
+    }
+    u128 d = n <= UINT64_MAX ? rho64((uint64_t)n) : rho128(n);
+    if (d == 0) return -1;
+    count = factor_rec(d, out, count);
+    return factor_rec(n / d, out, count);
+}
+
+int prime_factorize(u128 n, u128 *factors) {
+    if (n < 2) return 0;
+    pthread_once(&small_primes_once, small_primes_init);
+
+    // La división de 128 bits es una llamada a libgcc: si n entra en 64
+    // bits se divide con la instrucción nativa
+    int count = 0;
+    int i = 0;
+    for (; i < small_prime_count && n > UINT64_MAX; i++) {
+        uint32_t p = small_primes[i];
+        while (n % p == 0) {
+            factors[count++] = p;
+            n /= p;
+        }
+    }
+    uint64_t n64 = (uint64_t)n;
+    for (; i < small_prime_count && n <= UINT64_MAX; i++) {
+        uint64_t p = small_primes[i];
+        if (p * p > n64) break;
+        while (n64 % p == 0) {
+            factors[count++] = p;
+            n64 /= p;
+        }
+        n = n64;
+    }
+    // Sin divisores menores que PRIME_TRIAL_LIMIT: si n < LIMIT^2 es primo
+    if (n > 1 && n < (u128)PRIME_TRIAL_LIMIT * PRIME_TRIAL_LIMIT) {
+        factors[count++] = n;
+        n = 1;
+    }
+    int first_big = count;
+    count = factor_rec(n, factors, count);
+    if (count < 0) return -1;
+
+    // rho los devuelve en cualquier orden (los chicos ya están ordenados)
+    for (i = first_big + 1; i < count; i++) {
+        u128 v = factors[i];
+        int j = i - 1;
+        while (j >= first_big && factors[j] > v) {
+            factors[j + 1] = factors[j];
+            j--;
+        }
+        factors[j + 1] = v;
+    }
+    return count;
+}
+
+// ============================================================================
+// CRIBA SEGMENTADA
+// ============================================================================
+//
+// Solo impares: el bit i de un segmento representa base + 2i (1 = compuesto).
+// Un segmento de SIEVE_SEGMENT_BYTES entra en L1. El rango se reparte en
+// tramos de segmentos consecutivos entre threads; cada tramo calcula una vez
+// el primer múltiplo de cada primo base y después lo arrastra de un segmento
+// al siguiente, sin divisiones.
+
+#define SIEVE_SEGMENT_BYTES   32768
+#define SIEVE_SEGMENT_BITS    ((uint64_t)SIEVE_SEGMENT_BYTES * 8)
+#define SIEVE_MAX_CHUNK_SEGS  64
+
+// Patrón de 3*5*7*11*13 bits (bit j = 2j + 1 múltiplo de alguno) repetido
+// hasta cubrir un segmento desde cualquier fase: se copia en vez de marcar
+// esos cinco primos, que son casi la mitad del trabajo de la criba
+#define PRESIEVE_PERIOD     15015
+#define PRESIEVE_PRIMES     5
+#define PRESIEVE_WORDS      ((PRESIEVE_PERIOD + SIEVE_SEGMENT_BITS) / 64 + 2)
+
+static uint64_t presieve[PRESIEVE_WORDS];
+static pthread_once_t presieve_once = PTHREAD_ONCE_INIT;
+
+static void presieve_init(void) {
+    static const uint32_t p[PRESIEVE_PRIMES] = { 3, 5, 7, 11, 13 };
+    for (int k = 0; k < PRESIEVE_PRIMES; k++) {
+        for (uint64_t j = p[k] / 2; j < (uint64_t)PRESIEVE_WORDS * 64; j += p[k]) {
+            presieve[j >> 6] |= 1ULL << (j & 63);
+        }
+    }
+}
+
+// bits[0..words) = patrón desde el bit phase
+static void presieve_copy(uint64_t *bits, size_t words, uint64_t phase) {
+    const uint64_t *src = presieve + phase / 64;
+    unsigned shift = (unsigned)(phase & 63);
+    if (shift == 0) {
+        memcpy(bits, src, words * sizeof(uint64_t));
+        return;
+    }
+    for (size_t w = 0; w < words; w++) {
+        bits[w] = (src[w] >> shift) | (src[w + 1] << (64 - shift));
+    }
+}
+
+typedef struct {
+    uint64_t first;             // Primer impar del rango
+    uint64_t total;             // Cantidad de impares en el rango
+    uint64_t chunk_segs;        // Segmentos por tramo
+    const uint32_t *base;       // Primos impares <= sqrt(to)
+    size_t base_count;
+    uint64_t *counts;           // Por tramo
+    uint64_t **lists;           // Por tramo (NULL = solo contar)
+    bool failed;                // Atómico
+} sieve_job_t;
+
+// Primos impares <= limit (criba simple de impares)
+static uint32_t* sieve_base_primes(uint32_t limit, size_t *count) {
+    size_t odds = limit / 2 + 1;                // i -> 2i + 1
+    uint8_t *composite = calloc(odds, 1);
+    // pi(x) < 1.26 x / ln x
+    size_t cap = limit < 100 ? 32 : (size_t)(1.3 * limit / log(limit)) + 16;
+    uint32_t *primes = malloc(cap * sizeof(uint32_t));
+    if (!composite || !primes) {
+        free(composite);
+        free(primes);
+        return NULL;
+    }
+    size_t n = 0;
+    for (size_t i = 1; i < odds; i++) {
+        if (composite[i]) continue;
+        uint64_t p = 2 * i + 1;
+        if (p > limit) break;
+        primes[n++] = (uint32_t)p;
+        for (uint64_t j = p * p / 2; j < odds; j += p) composite[j] = 1;
+    }
+    free(composite);
+    *count = n;
+    return primes;
+}
+
+static void sieve_chunk(int index, void *ctx) {
+    sieve_job_t *job = ctx;
+    // Con el deadline vencido los tramos que quedan se descartan enteros
+    if (__atomic_load_n(&job->failed, __ATOMIC_RELAXED) || deadline_expired()) {
+        __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+        return;
+    }
+    uint64_t seg_first = (uint64_t)index * job->chunk_segs * SIEVE_SEGMENT_BITS;
+    uint64_t seg_end = seg_first + job->chunk_segs * SIEVE_SEGMENT_BITS;
+    if (seg_end > job->total) seg_end = job->total;
+    uint64_t start_value = job->first + 2 * seg_first;
+    uint64_t end_value = job->first + 2 * (seg_end - 1);
+
+    uint64_t *bits = malloc(SIEVE_SEGMENT_BYTES);
+    uint64_t *next = malloc((job->base_count + 1) * sizeof(uint64_t));
+    uint64_t *list = NULL;
+    size_t list_len = 0, list_cap = 0;
+    if (!bits || !next) goto fail;
+
+    // Offset (en bits desde el inicio del tramo) del primer múltiplo impar de
+    // cada primo base, empezando en p^2
+    size_t active = PRESIEVE_PRIMES;         // 3..13 vienen del patrón
+    if (active > job->base_count) active = job->base_count;
+    for (; active < job->base_count; active++) {
+        uint64_t p = job->base[active];
+        if (p * p > end_value) break;
+        uint64_t m = p * p;
+        if (m < start_value) {
+            m = (start_value + p - 1) / p * p;
+            if ((m & 1) == 0) m += p;
+        }
+        next[active] = (m - start_value) / 2;
+    }
+
+    uint64_t count = 0;
+    for (uint64_t seg = seg_first; seg < seg_end; seg += SIEVE_SEGMENT_BITS) {
+        if (deadline_expired()) goto fail;
+        uint64_t len = seg_end - seg < SIEVE_SEGMENT_BITS ? seg_end - seg : SIEVE_SEGMENT_BITS;
+        uint64_t value0 = job->first + 2 * seg;
+        size_t words = (size_t)((len + 63) / 64);
+        presieve_copy(bits, words, (value0 / 2) % PRESIEVE_PERIOD);
+        // El patrón marca a 3..13 como múltiplos de sí mismos
+        for (uint64_t v = value0; v <= 13 && v < value0 + 2 * len; v += 2) {
+            if (v != 9) bits[(v - value0) / 2 / 64] &= ~(1ULL << ((v - value0) / 2 % 64));
+        }
+        for (size_t k = PRESIEVE_PRIMES; k < active; k++) {
+            uint64_t p = job->base[k];
+            uint64_t j = next[k];
+            for (; j < len; j += p) bits[j >> 6] |= 1ULL << (j & 63);
+            next[k] = j - SIEVE_SEGMENT_BITS;   // Siempre >= 0: j >= len
+        }
+
+        // Bits fuera del rango (último segmento) cuentan como compuestos
+        if (len & 63) bits[words - 1] |= ~0ULL << (len & 63);
+        for (size_t w = 0; w < words; w++) {
+            uint64_t primes = ~bits[w];
+            count += (uint64_t)__builtin_popcountll(primes);
+            if (!job->lists) continue;
+            while (primes) {
+                if (list_len == list_cap) {
+                    list_cap = list_cap ? list_cap * 2 : 1024;
+                    uint64_t *grown = realloc(list, list_cap * sizeof(uint64_t));
+                    if (!grown) goto fail;
+                    list = grown;
+                }
+                list[list_len++] = value0 + 2 * (64 * w + (uint64_t)__builtin_ctzll(primes));
+                primes &= primes - 1;
+            }
+        }
+    }
+
+    job->counts[index] = count;
+    if (job->lists) job->lists[index] = list;
+    free(bits);
+    free(next);
+    return;
+
+fail:
+    __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+    free(bits);
+    free(next);
+    free(list);
+    if (job->lists) job->lists[index] = NULL;
+}
+
+int prime_sieve_range(uint64_t from, uint64_t to, int threads,
+                      uint64_t *count, uint64_t **list) {
+    *count = 0;
+    if (list) *list = NULL;
+    if (to > PRIME_SIEVE_MAX || from > to) return -1;
+
+    bool has_two = from <= 2 && to >= 2;
+    uint64_t first = from < 3 ? 3 : from | 1;
+    uint64_t last = (to & 1) ? to : to - 1;
+    uint64_t total = last >= first && last >= 3 ? (last - first) / 2 + 1 : 0;
+
+    if (total == 0) {
+        *count = has_two;
+        if (list) {
+            *list = malloc(sizeof(uint64_t));
+            if (!*list) return -1;
+            **list = 2;             // Solo se lee si count == 1
+        }
+        return 0;
+    }
+
+    uint32_t root = (uint32_t)sqrt((double)last);
+    while ((uint64_t)root * root > last) root--;
+    while ((uint64_t)(root + 1) * (root + 1) <= last) root++;
+
+    pthread_once(&presieve_once, presieve_init);
+    sieve_job_t job = { .first = first, .total = total };
+    job.base = sieve_base_primes(root, &job.base_count);
+    uint64_t segments = (total + SIEVE_SEGMENT_BITS - 1) / SIEVE_SEGMENT_BITS;
+    if (threads < 1) threads = 1;
+    // Tramos chicos reparten mejor; grandes amortizan el cálculo de offsets
+    job.chunk_segs = segments / ((uint64_t)threads * 4);
+    if (job.chunk_segs < 1) job.chunk_segs = 1;
+    if (job.chunk_segs > SIEVE_MAX_CHUNK_SEGS) job.chunk_segs = SIEVE_MAX_CHUNK_SEGS;
+    int chunks = (int)((segments + job.chunk_segs - 1) / job.chunk_segs);
+    job.counts = calloc((size_t)chunks, sizeof(uint64_t));
+    job.lists = list ? calloc((size_t)chunks, sizeof(uint64_t*)) : NULL;
+
+    int rc = -1;
+    if (job.base && job.counts && (!list || job.lists)) {
+        parallel_for(chunks, threads, sieve_chunk, &job);
+        if (!job.failed) rc = 0;
+    }
+
+    uint64_t total_primes = has_two;
+    for (int c = 0; c < chunks && rc == 0; c++) total_primes += job.counts[c];
+
+    // Concatenar las listas de los tramos, que ya vienen en orden
+    uint64_t *all = NULL;
+    if (list && rc == 0) {
+        all = malloc((total_primes + 1) * sizeof(uint64_t));
+        if (all) {
+            size_t pos = 0;
+            if (has_two) all[pos++] = 2;
+            for (int c = 0; c < chunks; c++) {
+                if (job.counts[c]) memcpy(all + pos, job.lists[c], job.counts[c] * sizeof(uint64_t));
+                pos += job.counts[c];
+            }
+        } else {
+            rc = -1;
+        }
+    }
+    for (int c = 0; job.lists && c < chunks; c++) free(job.lists[c]);
+    free(job.lists);
+    free(job.counts);
+    free((void*)job.base);
+
+    if (rc != 0) {
+        free(all);
+        return -1;
+    }
+    *count = total_primes;
+    if (list) *list = all;
+    return 0;
+}
+
+// ============================================================================
+// DECIMAL
+// ============================================================================
+
+bool prime_parse_u128(const char *s, u128 *out) {
+    if (!s || !*s) return false;
+    u128 v = 0;
+    const u128 max_div_10 = ~(u128)0 / 10;
+    for (; *s; s++) {
+        if (*s < '0' || *s > '9') return false;
+        unsigned digit = (unsigned)(*s - '0');
+        if (v > max_div_10 || (v == max_div_10 && digit > (unsigned)(~(u128)0 % 10))) return false;
+        v = v * 10 + digit;
+    }
+    *out = v;
+    return true;
+}
+
+int prime_format_u128(u128 v, char *buf) {
+    char tmp[40];
+    int len = 0;
+    do {
+        tmp[len++] = (char)('0' + (int)(v % 10));
+        v /= 10;
+    } while (v);
+    for (int i = 0; i < len; i++) buf[i] = tmp[len - 1 - i];
+    buf[len] = '\0';
+    return len;
+}
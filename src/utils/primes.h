@@ -0,0 +1,70 @@
+#ifndef PRIMES_H
+#define PRIMES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// PRIMOS - Primalidad y factorización de enteros de 64 y 128 bits
+// ============================================================================
+//
+// Aritmética modular en forma de Montgomery (sin divisiones en los loops).
+// Primalidad: Miller-Rabin determinista hasta 2^64 (7 bases de Sinclair);
+// arriba de 2^64 con las primeras PRIME_MR128_BASES bases primas (no hay
+// contraejemplos conocidos, pero formalmente es "probable primo").
+// Factorización: trial division por los primos < PRIME_TRIAL_LIMIT y después
+// Pollard rho con el ciclo de Brent y gcd por lotes, recursivo sobre cada
+// factor compuesto.
+// Rangos: criba segmentada de impares en bitsets del tamaño de L1.
+
+typedef unsigned __int128 prime_u128_t;
+
+#define PRIME_TRIAL_LIMIT   1024
+#define PRIME_MR128_BASES   20
+#define PRIME_MAX_FACTORS   128         // Más que log2(2^128)
+
+bool prime_is_prime_u64(uint64_t n);
+bool prime_is_prime_u128(prime_u128_t n);
+
+/**
+ * Primalidad de count números de 64 bits (mismo resultado que
+ * prime_is_prime_u64), intercalando varios Miller-Rabin a la vez
+ *
+ * @param n Números a testear
+ * @param count Cantidad
+ * @param out Salida, count elementos
+ */
+void prime_is_prime_u64_batch(const uint64_t *n, size_t count, bool *out);
+
+/**
+ * Factores primos de n, con repetición y en orden creciente
+ *
+ * @param n Número a factorizar (n >= 2)
+ * @param factors Salida, al menos PRIME_MAX_FACTORS elementos
+ * @return Cantidad de factores, o -1 si venció el deadline del thread
+ */
+int prime_factorize(prime_u128_t n, prime_u128_t *factors);
+
+#define PRIME_SIEVE_MAX     100000000000000ULL      // 10^14: primos base < 10^7
+
+/**
+ * Primos en [from, to] con la criba de Eratóstenes segmentada, repartida
+ * entre threads
+ *
+ * @param from Inicio del rango (inclusive)
+ * @param to Fin del rango (inclusive, <= PRIME_SIEVE_MAX)
+ * @param threads Threads a usar
+ * @param count Salida: cantidad de primos
+ * @param list Si no es NULL, salida con los primos en orden (liberar con free)
+ * @return 0 si éxito, -1 si el rango es inválido, venció el deadline o faltó memoria
+ */
+int prime_sieve_range(uint64_t from, uint64_t to, int threads,
+                      uint64_t *count, uint64_t **list);
+
+// Decimal <-> 128 bits. parse: solo dígitos, sin overflow
+bool prime_parse_u128(const char *s, prime_u128_t *out);
+// Escribe el número con terminador; buf de al menos 40 bytes. Retorna la longitud
+int prime_format_u128(prime_u128_t v, char *buf);
+
+#endif // PRIMES_H
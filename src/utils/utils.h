@@ -22,6 +22,12 @@
 // ============================================================================
 // LOGGER - Sistema de logging thread-safe
 // ============================================================================
+//
+// Asíncrono: cada thread escribe en su propio ring buffer (sin locks) y un
+// thread de fondo los vacía al archivo con writev() en lotes. Los mensajes de
+// más de LOG_MAX_MESSAGE bytes se truncan.
+
+#define LOG_MAX_MESSAGE 224
 
 typedef enum {
     LOG_DEBUG,
@@ -30,9 +36,28 @@ typedef enum {
     LOG_ERROR
 } log_level_t;
 
+// Qué hacer cuando el ring del thread está lleno
+typedef enum {
+    LOG_OVERFLOW_DROP,      // Descartar el mensaje (y contarlo) - default
+    LOG_OVERFLOW_BLOCK      // Esperar a que el flusher libere espacio
+} log_overflow_t;
+
 void logger_init(log_level_t level, const char *log_file);
 void logger_shutdown();
-void log_message(log_level_t level, const char *file, int line, const char *fmt, ...);
+
+// En el hijo después de fork(): reinicia los locks y arranca un flusher propio
+void logger_after_fork(void);
+void log_message(log_level_t level, const char *file, int line, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+// Política cuando un ring se llena
+void logger_set_overflow(log_overflow_t policy);
+
+// Esperar a que todo lo registrado hasta ahora esté escrito
+void logger_flush(void);
+
+// Total de mensajes descartados por rings llenos
+unsigned long logger_dropped(void);
 
 // Macros para logging conveniente
 #define LOG_DEBUG(...) log_message(LOG_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
@@ -126,7 +151,82 @@ long timer_elapsed_us(http_timer_t *timer);
 // ============================================================================
 // UUID - Generación de IDs únicos
 // ============================================================================
+//
+// Sin locks en el camino por request. Dos formatos:
+//   compact - "pppppppppp-tttttttt-cccccccc": prefijo aleatorio del proceso,
+//             número de thread y contador del thread (28 caracteres)
+//   uuid7   - UUIDv7 (RFC 9562): timestamp en ms al principio, así que los
+//             IDs ordenan por tiempo; dentro de un thread son crecientes
+
+#define REQUEST_ID_COMPACT_LEN 28
+#define REQUEST_ID_UUID_LEN    36
 
+typedef enum {
+    REQUEST_ID_COMPACT,
+    REQUEST_ID_UUID7
+} request_id_format_t;
+
+// ID en el formato configurado (default compact). buffer >= 37 bytes
 void generate_request_id(char *buffer, size_t size);
 
+void generate_compact_id(char *buffer, size_t size);
+void generate_uuid_v7(char *buffer, size_t size);
+
+// Formato de generate_request_id (para requests y jobs)
+void request_id_set_format(request_id_format_t format);
+
+// "compact" o "uuid7" -> formato. Retorna 0 si éxito, -1 si no es válido
+int request_id_parse_format(const char *name, request_id_format_t *format);
+
+// ============================================================================
+// DEADLINE - Presupuesto de tiempo de la request actual (por thread)
+// ============================================================================
+
+// El router (o el worker que ejecuta un job) fija el deadline antes de llamar
+// al handler; los comandos largos consultan deadline_expired() en sus loops
+// y abortan temprano. Un deadline en cero significa "sin límite".
+// Los deadlines son instantes de CLOCK_MONOTONIC guardados en un timeval: un
+// salto del reloj de pared (NTP, date) no los adelanta ni los atrasa.
+
+// Fijar deadline absoluto para el thread actual (NULL = sin deadline)
+void deadline_set(const struct timeval *deadline);
+
+// Quitar el deadline del thread actual
+void deadline_clear(void);
+
+// Copiar el deadline actual; retorna false si no hay deadline
+bool deadline_get(struct timeval *out);
+
+// Milisegundos restantes (0 si ya venció, -1 si no hay deadline)
+long deadline_remaining_ms(void);
+
+// true si hay deadline y ya pasó
+bool deadline_expired(void);
+
+// Calcular deadline absoluto = ahora + timeout_ms
+void deadline_from_timeout_ms(struct timeval *out, long timeout_ms);
+
+// Lo mismo sobre un deadline explícito (p. ej. el de una tarea en cola)
+long deadline_remaining_ms_of(const struct timeval *deadline);
+bool deadline_expired_at(const struct timeval *deadline);
+
+// ============================================================================
+// PARALLEL FOR - Repartir un cálculo entre varios threads
+// ============================================================================
+
+// El thread que llama participa; los helpers toman índices de un contador
+// atómico, heredan el deadline de quien llama (y su afinidad, al crearse) y
+// terminan antes de que parallel_for retorne.
+
+#define PARALLEL_MAX_THREADS 64
+
+// Cuerpo del loop: se llama una vez por índice en [0, count)
+typedef void (*parallel_fn)(int index, void *ctx);
+
+// Ejecutar fn(0..count-1) con hasta max_threads threads; retorna los usados
+int parallel_for(int count, int max_threads, parallel_fn fn, void *ctx);
+
+// CPUs en línea (tope PARALLEL_MAX_THREADS)
+int parallel_default_threads(void);
+
 #endif // UTILS_H
\ No newline at end of file
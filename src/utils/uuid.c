@@ -1,22 +1,172 @@
 // Generación de request IDs
+//
+// Sin locks: cada thread arma una vez su prefijo (prefijo aleatorio del
+// proceso + número de thread) y después solo incrementa un contador propio y
+// lo codifica en hex. El único atómico es el fetch_add que numera al thread
+// la primera vez que genera un ID.
 #include "utils.h"
+#include <stdint.h>
 #include <unistd.h>
+#include <sys/random.h>
+
+static const char HEX[] = "0123456789abcdef";
+
+// Prefijo del proceso (40 bits aleatorios); se regenera en el hijo tras fork()
+static struct {
+    uint64_t prefix;
+    uint64_t seed;              // Semilla de los PRNG por thread
+    unsigned int generation;    // Cambia con cada fork: invalida los prefijos por thread
+    unsigned int next_thread;
+    int format;
+} g_ids = { .format = REQUEST_ID_COMPACT };
+
+static pthread_once_t g_ids_once = PTHREAD_ONCE_INIT;
+
+static __thread struct {
+    unsigned int generation;    // 0 = prefijo sin armar
+    uint32_t counter;
+    uint64_t rng;               // splitmix64
+    uint64_t last_ms;           // UUIDv7: último timestamp usado
+    uint16_t seq;               // UUIDv7: contador dentro del mismo ms
+    char prefix[20];            // "pppppppppp-tttttttt-"
+} tl_ids;
+
+// ============================================================================
+// ESTADO DEL PROCESO
+// ============================================================================
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void seed_process(void) {
+    uint64_t bytes[2];
+    if (getrandom(bytes, sizeof(bytes), GRND_NONBLOCK) != (ssize_t)sizeof(bytes)) {
+        // Sin entropía del kernel: mezclar hora y pid
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t state = ((uint64_t)ts.tv_sec << 32) ^ (uint64_t)ts.tv_nsec ^
+                         ((uint64_t)getpid() << 16);
+        bytes[0] = splitmix64(&state);
+        bytes[1] = splitmix64(&state);
+    }
+    g_ids.prefix = bytes[0] & 0xffffffffffULL;
+    g_ids.seed = bytes[1];
+    __atomic_store_n(&g_ids.next_thread, 0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&g_ids.generation, 1, __ATOMIC_RELEASE);
+}
+
+// En el hijo los threads (y sus prefijos) se copian: hay que cambiar de prefijo
+static void after_fork_child(void) {
+    seed_process();
+}
+
+static void init_process(void) {
+    seed_process();
+    pthread_atfork(NULL, NULL, after_fork_child);
+}
+
+static void hex_encode(char *out, uint64_t value, int digits) {
+    for (int i = digits - 1; i >= 0; i--) {
+        out[i] = HEX[value & 0xf];
+        value >>= 4;
+    }
+}
+
+// Armar el estado del thread si todavía no lo tiene (o si hubo un fork)
+static void ensure_thread_state(void) {
+    unsigned int generation = __atomic_load_n(&g_ids.generation, __ATOMIC_ACQUIRE);
+    if (__builtin_expect(tl_ids.generation == generation && generation != 0, 1)) {
+        return;
+    }
+
+    pthread_once(&g_ids_once, init_process);
+    generation = __atomic_load_n(&g_ids.generation, __ATOMIC_ACQUIRE);
+
+    uint32_t thread_no = __atomic_fetch_add(&g_ids.next_thread, 1, __ATOMIC_RELAXED);
+    hex_encode(tl_ids.prefix, g_ids.prefix, 10);
+    tl_ids.prefix[10] = '-';
+    hex_encode(tl_ids.prefix + 11, thread_no, 8);
+    tl_ids.prefix[19] = '-';
+
+    tl_ids.counter = 0;
+    tl_ids.rng = g_ids.seed ^ ((uint64_t)thread_no * 0xd1b54a32d192ed03ULL);
+    tl_ids.last_ms = 0;
+    tl_ids.seq = 0;
+    tl_ids.generation = generation;
+}
+
+// ============================================================================
+// FORMATOS
+// ============================================================================
+
+void generate_compact_id(char *buffer, size_t size) {
+    if (!buffer || size < REQUEST_ID_COMPACT_LEN + 1) return;
+
+    ensure_thread_state();
+    memcpy(buffer, tl_ids.prefix, sizeof(tl_ids.prefix));
+    hex_encode(buffer + sizeof(tl_ids.prefix), tl_ids.counter++, 8);
+    buffer[REQUEST_ID_COMPACT_LEN] = '\0';
+}
+
+void generate_uuid_v7(char *buffer, size_t size) {
+    if (!buffer || size < REQUEST_ID_UUID_LEN + 1) return;
+
+    ensure_thread_state();
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t ms = (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+
+    // rand_a (12 bits) como contador dentro del mismo ms: los IDs de un thread
+    // quedan ordenados aunque se generen varios por milisegundo
+    if (ms > tl_ids.last_ms) {
+        tl_ids.last_ms = ms;
+        tl_ids.seq = (uint16_t)(splitmix64(&tl_ids.rng) & 0x3ff); // Deja margen antes de desbordar
+    } else if (++tl_ids.seq > 0xfff) {
+        tl_ids.last_ms++;       // Desborde: tomar prestado el ms siguiente
+        tl_ids.seq = 0;
+    }
+    ms = tl_ids.last_ms;
+
+    uint64_t rand_b = splitmix64(&tl_ids.rng);
+
+    // xxxxxxxx-xxxx-7xxx-yxxx-xxxxxxxxxxxx
+    hex_encode(buffer, ms >> 16, 8);
+    buffer[8] = '-';
+    hex_encode(buffer + 9, ms & 0xffff, 4);
+    buffer[13] = '-';
+    hex_encode(buffer + 14, 0x7000 | tl_ids.seq, 4);
+    buffer[18] = '-';
+    hex_encode(buffer + 19, 0x8000 | ((rand_b >> 48) & 0x3fff), 4);
+    buffer[23] = '-';
+    hex_encode(buffer + 24, rand_b & 0xffffffffffffULL, 12);
+    buffer[REQUEST_ID_UUID_LEN] = '\0';
+}
+
+void request_id_set_format(request_id_format_t format) {
+    __atomic_store_n(&g_ids.format, (int)format, __ATOMIC_RELAXED);
+}
+
+int request_id_parse_format(const char *name, request_id_format_t *format) {
+    if (!name || !format) return -1;
+    if (strcmp(name, "compact") == 0) {
+        *format = REQUEST_ID_COMPACT;
+    } else if (strcmp(name, "uuid7") == 0) {
+        *format = REQUEST_ID_UUID7;
+    } else {
+        return -1;
+    }
+    return 0;
+}
 
-// Generador simple de IDs únicos (no es UUID RFC4122, pero es suficiente)
 void generate_request_id(char *buffer, size_t size) {
-    if (!buffer || size < 32) return;
-    
-    static unsigned long counter = 0;
-    static pthread_mutex_t counter_mutex = PTHREAD_MUTEX_INITIALIZER;
-    
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    
-    pthread_mutex_lock(&counter_mutex);
-    unsigned long id = counter++;
-    pthread_mutex_unlock(&counter_mutex);
-    
-    // Formato: timestamp-pid-counter
-    snprintf(buffer, size, "%ld%06ld-%d-%lu", 
-             tv.tv_sec, tv.tv_usec, getpid(), id);
-}
\ No newline at end of file
+    if (__atomic_load_n(&g_ids.format, __ATOMIC_RELAXED) == REQUEST_ID_UUID7) {
+        generate_uuid_v7(buffer, size);
+    } else {
+        generate_compact_id(buffer, size);
+    }
+}
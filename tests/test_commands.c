@@ -0,0 +1,1159 @@
+#include "test_utils.h"
+#include "../src/commands/basic/basic_commands.h"
+#include "../src/commands/cpu_bound/cpu_bound_commands.h"
+#include "../src/commands/io_bound/io_bound_commands.h"
+#include "../src/utils/utils.h"
+#include "../src/utils/bigint.h"
+#include "../src/utils/primes.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// TESTS DE MATRIXMUL
+// ============================================================================
+
+// Matriz determinista sin relación con el PRNG del comando
+static double* test_matrix(int n, unsigned int salt) {
+    double *m = malloc(sizeof(double) * n * n);
+    uint64_t x = 0x243F6A8885A308D3ULL ^ salt;
+    for (int i = 0; i < n * n; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        m[i] = (double)(x >> 11) * 0x1.0p-53 - 0.5;
+    }
+    return m;
+}
+
+// Referencia: una cadena de fma() por elemento, en k creciente
+static void reference_multiply(int n, const double *A, const double *B, double *C) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double acc = 0.0;
+            for (int k = 0; k < n; k++) acc = fma(A[i * n + k], B[k * n + j], acc);
+            C[i * n + j] = acc;
+        }
+    }
+}
+
+TEST(test_matrixmul_matches_reference) {
+    // Tamaños con bordes en todas las dimensiones y más de un bloque de k
+    const int sizes[] = { 1, 7, 37, 131, 300 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        double *A = test_matrix(n, 1);
+        double *B = test_matrix(n, 2);
+        double *expected = malloc(sizeof(double) * n * n);
+        double *C = malloc(sizeof(double) * n * n);
+        reference_multiply(n, A, B, expected);
+
+        // Mismo resultado bit a bit con SIMD o escalar y con 1 o varios threads
+        for (int simd = 0; simd <= 1; simd++) {
+            for (int threads = 1; threads <= 3; threads += 2) {
+                memset(C, 0xff, sizeof(double) * n * n);
+                ASSERT_EQ(matrixmul_multiply(n, A, B, C, threads, simd), 0);
+                ASSERT_EQ(memcmp(C, expected, sizeof(double) * n * n), 0);
+            }
+        }
+        free(A);
+        free(B);
+        free(expected);
+        free(C);
+    }
+}
+
+TEST(test_matrixmul_hash_deterministic) {
+    char *first = handle_matrixmul("200", "42");
+    char *second = handle_matrixmul("200", "42");
+    char *other = handle_matrixmul("200", "43");
+    ASSERT_NOT_NULL(first);
+    ASSERT_NOT_NULL(second);
+    ASSERT_NOT_NULL(other);
+
+    const char *h1 = strstr(first, "\"result_hash\":\"");
+    const char *h2 = strstr(second, "\"result_hash\":\"");
+    const char *h3 = strstr(other, "\"result_hash\":\"");
+    ASSERT_NOT_NULL(h1);
+    ASSERT_NOT_NULL(h2);
+    ASSERT_NOT_NULL(h3);
+    if (h1 && h2 && h3) {
+        ASSERT_EQ(strncmp(h1, h2, 32), 0);
+        ASSERT_NEQ(strncmp(h1, h3, 32), 0);
+    }
+    free(first);
+    free(second);
+    free(other);
+}
+
+TEST(test_matrixmul_size_limits) {
+    char *json = handle_matrixmul("0", "1");
+    ASSERT_NOT_NULL(json);
+    ASSERT_NOT_NULL(json ? strstr(json, "Invalid size") : NULL);
+    free(json);
+
+    json = handle_matrixmul("4097", "1");
+    ASSERT_NOT_NULL(json ? strstr(json, "Invalid size (1..4096)") : NULL);
+    free(json);
+
+    // Por encima del viejo límite de 400
+    json = handle_matrixmul("512", "1");
+    ASSERT_NOT_NULL(json ? strstr(json, "\"result_hash\"") : NULL);
+    free(json);
+}
+
+TEST(test_matrixmul_deadline_aborts) {
+    struct timeval past;
+    deadline_from_timeout_ms(&past, -1000);
+    deadline_set(&past);
+    char *json = handle_matrixmul("300", "1");
+    deadline_clear();
+    ASSERT_NULL(json);
+    free(json);
+}
+
+// ============================================================================
+// TESTS DE MANDELBROT
+// ============================================================================
+
+// Referencia: el loop escalar original, pixel por pixel
+static void reference_mandelbrot(const mandelbrot_view_t *v, int *out) {
+    for (int y = 0; y < v->height; y++) {
+        for (int x = 0; x < v->width; x++) {
+            double cx = v->x_min + x * v->dx;
+            double cy = v->y_min + y * v->dy;
+            double zx = 0.0, zy = 0.0;
+            int iter = 0;
+            while (zx*zx + zy*zy <= 4.0 && iter < v->max_iter) {
+                double xt = zx*zx - zy*zy + cx;
+                zy = 2.0*zx*zy + cy;
+                zx = xt;
+                iter++;
+            }
+            out[y * v->width + x] = iter;
+        }
+    }
+}
+
+TEST(test_mandelbrot_kernels_match_reference) {
+    // Vista completa (cardioide y bulbo) y un zoom sobre el borde; tamaños
+    // que no son múltiplo del tile ni de los lanes
+    mandelbrot_view_t views[] = {
+        { 133, 71, 200, -2.0, -1.5, 3.0 / 132, 3.0 / 70 },
+        { 97, 45, 500, -0.7453 - 48 * 1e-5, 0.1127 - 22 * 1e-5, 1e-5, 1e-5 },
+    };
+    for (size_t i = 0; i < sizeof(views) / sizeof(views[0]); i++) {
+        mandelbrot_view_t *v = &views[i];
+        size_t bytes = sizeof(int) * v->width * v->height;
+        int *expected = malloc(bytes);
+        int *got = malloc(bytes);
+        reference_mandelbrot(v, expected);
+
+        const int lanes[] = { 1, 4, 8 };
+        for (int l = 0; l < 3; l++) {
+            for (int threads = 1; threads <= 3; threads += 2) {
+                memset(got, 0xff, bytes);
+                int used = mandelbrot_render(v, got, threads, lanes[l]);
+                ASSERT_TRUE(used >= 1 && used <= lanes[l]);
+                ASSERT_EQ(memcmp(got, expected, bytes), 0);
+            }
+        }
+        free(expected);
+        free(got);
+    }
+}
+
+TEST(test_mandelbrot_view_params) {
+    // Sin vista: encuadre original y sin campos de vista en la respuesta
+    char *json = handle_mandelbrot("8", "6", "50", NULL, NULL, NULL);
+    ASSERT_NOT_NULL(json ? strstr(json, "\"data\":[") : NULL);
+    ASSERT_NULL(json ? strstr(json, "\"zoom\"") : "x");
+    free(json);
+
+    json = handle_mandelbrot("16", "9", "100", "-0.743643887", "0.131825904", "1000");
+    ASSERT_NOT_NULL(json ? strstr(json, "\"zoom\":1000,") : NULL);
+    ASSERT_NOT_NULL(json ? strstr(json, "\"center_x\":-0.743643887") : NULL);
+    free(json);
+
+    json = handle_mandelbrot("16", "9", "100", NULL, NULL, "0");
+    ASSERT_NOT_NULL(json ? strstr(json, "Invalid view parameters") : NULL);
+    free(json);
+
+    json = handle_mandelbrot("16", "9", "100", "abc", NULL, NULL);
+    ASSERT_NOT_NULL(json ? strstr(json, "Invalid view parameters") : NULL);
+    free(json);
+
+    json = handle_mandelbrot("3841", "2160", "10", NULL, NULL, NULL);
+    ASSERT_NOT_NULL(json ? strstr(json, "too large") : NULL);
+    free(json);
+}
+
+TEST(test_mandelbrot_deadline_aborts) {
+    struct timeval past;
+    deadline_from_timeout_ms(&past, -1000);
+    deadline_set(&past);
+    char *json = handle_mandelbrot("640", "480", "1000", NULL, NULL, NULL);
+    deadline_clear();
+    ASSERT_NULL(json);
+    free(json);
+}
+
+// Sink en memoria para la salida binaria
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    int begins;
+    int flushes;
+    char content_type[64];
+} memory_sink_t;
+
+static int memory_begin(void *ctx, const char *content_type, const mandelbrot_view_t *view) {
+    memory_sink_t *m = ctx;
+    (void)view;
+    m->begins++;
+    snprintf(m->content_type, sizeof(m->content_type), "%s", content_type);
+    return 0;
+}
+
+static void memory_write(void *ctx, const void *data, size_t len) {
+    memory_sink_t *m = ctx;
+    m->data = realloc(m->data, m->len + len);
+    memcpy(m->data + m->len, data, len);
+    m->len += len;
+}
+
+static int memory_flush(void *ctx) {
+    ((memory_sink_t*)ctx)->flushes++;
+    return 0;
+}
+
+static int stream_to_memory(const char *w, const char *h, const char *format,
+                            memory_sink_t *m, char **error_json) {
+    memset(m, 0, sizeof(*m));
+    mandelbrot_sink_t sink = { memory_begin, memory_write, memory_flush, m };
+    return handle_mandelbrot_stream(w, h, "300", "-0.75", "0.1", "4", format, &sink, error_json);
+}
+
+TEST(test_mandelbrot_stream_formats) {
+    // 150 filas = 3 bandas
+    mandelbrot_view_t view = { .width = 100, .height = 150, .max_iter = 300 };
+    double scale = 3.0 / 4 / 99;
+    view.x_min = -0.75 - scale * 99 / 2.0;
+    view.y_min = 0.1 - scale * 149 / 2.0;
+    view.dx = view.dy = scale;
+    int *iters = malloc(sizeof(int) * 100 * 150);
+    mandelbrot_render(&view, iters, 1, 0);
+
+    memory_sink_t m;
+    char *error = NULL;
+    ASSERT_EQ(stream_to_memory("100", "150", "u16", &m, &error), MANDELBROT_STREAM_OK);
+    ASSERT_EQ(m.begins, 1);
+    ASSERT_EQ(m.flushes, 3);
+    ASSERT_EQ(m.len, (size_t)100 * 150 * 2);
+    int mismatches = 0;
+    for (int i = 0; i < 100 * 150 && m.len == (size_t)100 * 150 * 2; i++) {
+        mismatches += (m.data[2 * i] | (m.data[2 * i + 1] << 8)) != iters[i];
+    }
+    ASSERT_EQ(mismatches, 0);
+    free(m.data);
+
+    ASSERT_EQ(stream_to_memory("100", "150", "pgm", &m, &error), MANDELBROT_STREAM_OK);
+    ASSERT_EQ(strcmp(m.content_type, "image/x-portable-graymap"), 0);
+    ASSERT_EQ(m.len, strlen("P5\n100 150\n255\n") + 100 * 150);
+    free(m.data);
+
+    ASSERT_EQ(stream_to_memory("100", "150", "png", &m, &error), MANDELBROT_STREAM_OK);
+    ASSERT_EQ(strcmp(m.content_type, "image/png"), 0);
+    ASSERT_TRUE(m.len > 57);
+    if (m.len > 57) {
+        ASSERT_EQ(memcmp(m.data, "\x89PNG\r\n\x1a\n", 8), 0);
+        ASSERT_EQ(memcmp(m.data + 12, "IHDR", 4), 0);
+        ASSERT_EQ(memcmp(m.data + m.len - 8, "IEND", 4), 0);
+    }
+    // Más chico que los pixeles crudos
+    ASSERT_TRUE(m.len < (size_t)100 * 150);
+    free(m.data);
+    free(iters);
+}
+
+TEST(test_mandelbrot_stream_errors) {
+    memory_sink_t m;
+    char *error = NULL;
+    ASSERT_EQ(stream_to_memory("100", "150", "bmp", &m, &error), MANDELBROT_STREAM_ERROR);
+    ASSERT_NOT_NULL(error ? strstr(error, "Invalid format") : NULL);
+    ASSERT_EQ(m.begins, 0);
+    free(error);
+
+    ASSERT_EQ(stream_to_memory("0", "150", "png", &m, &error), MANDELBROT_STREAM_ERROR);
+    ASSERT_NOT_NULL(error ? strstr(error, "Invalid parameters") : NULL);
+    free(error);
+
+    // Deadline vencido antes de la primera banda: sin headers, sin JSON (504)
+    struct timeval past;
+    deadline_from_timeout_ms(&past, -1000);
+    deadline_set(&past);
+    ASSERT_EQ(stream_to_memory("100", "150", "u8", &m, &error), MANDELBROT_STREAM_ERROR);
+    deadline_clear();
+    ASSERT_NULL(error);
+    ASSERT_EQ(m.begins, 0);
+    free(m.data);
+}
+
+// ============================================================================
+// TESTS DE BIGINT Y PI
+// ============================================================================
+
+static void random_bigint(bigint_t *x, size_t limbs, uint64_t *state) {
+    bigint_set_u64(x, 1);
+    bigint_shift_limbs(x, (long)limbs - 1);
+    for (size_t i = 0; i < limbs; i++) {
+        *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+        x->limbs[i] = (uint32_t)((*state >> 33) % BIGINT_BASE);
+    }
+    if (x->limbs[limbs - 1] == 0) x->limbs[limbs - 1] = 1;
+}
+
+// Producto de referencia: schoolbook directo sobre los limbs
+static bool mul_matches_reference(const bigint_t *a, const bigint_t *b, const bigint_t *r) {
+    size_t n = a->len + b->len;
+    uint64_t *acc = calloc(n + 1, sizeof(uint64_t));
+    for (size_t i = 0; i < a->len; i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b->len; j++) {
+            uint64_t cur = acc[i + j] + (uint64_t)a->limbs[i] * b->limbs[j] + carry;
+            acc[i + j] = cur % BIGINT_BASE;
+            carry = cur / BIGINT_BASE;
+        }
+        acc[i + b->len] += carry;
+    }
+    while (n > 0 && acc[n - 1] == 0) n--;
+    bool ok = r->len == n;
+    for (size_t i = 0; ok && i < n; i++) ok = acc[i] == r->limbs[i];
+    free(acc);
+    return ok;
+}
+
+TEST(test_bigint_mul_all_sizes) {
+    // Schoolbook, Karatsuba (balanceado y no), NTT (balanceado, no, cuadrado)
+    size_t sizes[][2] = { {7, 5}, {64, 64}, {300, 45}, {257, 199},
+                          {1500, 1200}, {3000, 1030}, {2048, 0} };
+    uint64_t state = 12345;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bigint_t a, b, r;
+        bigint_init(&a);
+        bigint_init(&b);
+        bigint_init(&r);
+        random_bigint(&a, sizes[i][0], &state);
+        if (sizes[i][1] > 0) random_bigint(&b, sizes[i][1], &state);
+        else bigint_copy(&b, &a);
+        ASSERT_EQ(bigint_mul(&r, &a, sizes[i][1] > 0 ? &b : &a), 0);
+        ASSERT_TRUE(mul_matches_reference(&a, &b, &r));
+        bigint_free(&a);
+        bigint_free(&b);
+        bigint_free(&r);
+    }
+}
+
+TEST(test_bigint_signed_arithmetic) {
+    bigint_t a, b, r;
+    bigint_init(&a);
+    bigint_init(&b);
+    bigint_init(&r);
+    bigint_set_u64(&a, 100000000ULL);      // Un limb justo
+    bigint_set_u64(&b, 100000001ULL);
+    ASSERT_EQ(bigint_sub(&r, &a, &b), 0);
+    ASSERT_EQ(r.sign, -1);
+    ASSERT_EQ(r.len, (size_t)1);
+    ASSERT_EQ(r.limbs[0], 1u);
+    ASSERT_EQ(bigint_add(&r, &r, &b), 0);   // -1 + b = a
+    ASSERT_EQ(bigint_cmp_abs(&r, &a), 0);
+    ASSERT_EQ(r.sign, 1);
+
+    bigint_set_u128(&a, (unsigned __int128)UINT64_MAX * UINT64_MAX);
+    char buf[64];
+    size_t n = bigint_write_decimal(&a, buf);
+    buf[n] = '\0';
+    ASSERT_EQ(strcmp(buf, "340282366920938463426481119284349108225"), 0);
+    ASSERT_EQ(bigint_digits(&a), strlen(buf));
+    bigint_free(&a);
+    bigint_free(&b);
+    bigint_free(&r);
+}
+
+#define PI_100 "3141592653589793238462643383279502884197169399375105820974944592" \
+               "3078164062862089986280348253421170679"
+
+TEST(test_pi_known_digits) {
+    char *digits = pi_compute_digits(1000, 1);
+    ASSERT_NOT_NULL(digits);
+    if (!digits) return;
+    ASSERT_EQ(strlen(digits), (size_t)1001);
+    ASSERT_EQ(strncmp(digits, PI_100, 101), 0);
+    // Punto de Feynman: seis nueves desde el decimal 762
+    ASSERT_EQ(strncmp(digits + 762, "999999", 6), 0);
+    ASSERT_STR_EQ(digits + 990, "92164201989");
+    free(digits);
+}
+
+TEST(test_pi_parallel_matches_serial) {
+    char *serial = pi_compute_digits(30000, 1);
+    char *parallel = pi_compute_digits(30000, 3);
+    ASSERT_NOT_NULL(serial);
+    ASSERT_NOT_NULL(parallel);
+    if (serial && parallel) ASSERT_STR_EQ(serial, parallel);
+    free(serial);
+    free(parallel);
+}
+
+TEST(test_pi_cache_serves_slices) {
+    pi_cache_clear();
+    char *json = handle_pi("2000");
+    ASSERT_NOT_NULL(json ? strstr(json, "\"cached\":false") : NULL);
+    free(json);
+
+    json = handle_pi("100");
+    ASSERT_NOT_NULL(json ? strstr(json, "\"cached\":true") : NULL);
+    ASSERT_NOT_NULL(json ? strstr(json, "\"pi\":\"3.1415926535") : NULL);
+    // Slice exacto: termina en el decimal 100
+    ASSERT_NOT_NULL(json ? strstr(json, "3421170679\"}") : NULL);
+    free(json);
+
+    json = handle_pi("3");
+    ASSERT_NOT_NULL(json ? strstr(json, "\"pi\":\"3.141\"") : NULL);
+    free(json);
+    pi_cache_clear();
+}
+
+TEST(test_pi_invalid_and_deadline) {
+    const char *bad[] = { "0", "-5", "abc", "12x", "5000001" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        char *json = handle_pi(bad[i]);
+        ASSERT_NOT_NULL(json ? strstr(json, "Invalid digits") : NULL);
+        free(json);
+    }
+
+    pi_cache_clear();
+    struct timeval past;
+    deadline_from_timeout_ms(&past, -1000);
+    deadline_set(&past);
+    char *json = handle_pi("50000");
+    deadline_clear();
+    ASSERT_NULL(json);
+    free(json);
+}
+
+// ============================================================================
+// TESTS DE FIBONACCI
+// ============================================================================
+
+TEST(test_fibonacci_small_path) {
+    char *json = handle_fibonacci("10");
+    ASSERT_NOT_NULL(json ? strstr(json, "{\"input\":\"10\",\"output\":\"55\",\"elapsed_ms\":") : NULL);
+    free(json);
+
+    json = handle_fibonacci("93");
+    ASSERT_NOT_NULL(json ? strstr(json, "\"output\":\"12200160415121876738\"") : NULL);
+    free(json);
+
+    json = handle_fibonacci("0");
+    ASSERT_NOT_NULL(json ? strstr(json, "\"output\":\"0\"") : NULL);
+    free(json);
+}
+
+TEST(test_fibonacci_fast_doubling_matches_iteration) {
+    // Referencia: sumas sucesivas con bigint
+    bigint_t a, b, f;
+    bigint_init(&a);
+    bigint_init(&b);
+    bigint_init(&f);
+    bigint_set_u64(&b, 1);
+    int mismatches = 0;
+    for (long n = 0; n <= 3000; n++) {
+        if (n < 200 || n % 97 == 0 || n == 3000) {
+            ASSERT_EQ(fibonacci_compute(n, 1, &f), 0);
+            mismatches += bigint_cmp_abs(&f, &a) != 0;
+        }
+        bigint_add(&a, &a, &b);     // (a, b) = (b, a + b)
+        bigint_t t = a;
+        a = b;
+        b = t;
+    }
+    ASSERT_EQ(mismatches, 0);
+
+    // Paralelo = secuencial en el rango de la NTT
+    bigint_t g;
+    bigint_init(&g);
+    ASSERT_EQ(fibonacci_compute(500001, 1, &f), 0);
+    ASSERT_EQ(fibonacci_compute(500001, 3, &g), 0);
+    ASSERT_EQ(bigint_cmp_abs(&f, &g), 0);
+    ASSERT_EQ(bigint_digits(&f), (size_t)104494);
+    bigint_free(&a);
+    bigint_free(&b);
+    bigint_free(&f);
+    bigint_free(&g);
+}
+
+TEST(test_fibonacci_big_and_cache) {
+    char *json = handle_fibonacci("100");
+    ASSERT_NOT_NULL(json ? strstr(json, "\"output\":\"354224848179261915075\"") : NULL);
+    ASSERT_NOT_NULL(json ? strstr(json, "\"digits\":21") : NULL);
+    free(json);
+
+    fibonacci_cache_clear();
+    char *first = handle_fibonacci("20000");
+    char *second = handle_fibonacci("20000");
+    ASSERT_NOT_NULL(first ? strstr(first, "\"cached\":false") : NULL);
+    ASSERT_NOT_NULL(second ? strstr(second, "\"cached\":true") : NULL);
+    // Mismos dígitos (F(20000) tiene 4180)
+    const char *d1 = first ? strstr(first, "\"output\"") : NULL;
+    const char *d2 = second ? strstr(second, "\"output\"") : NULL;
+    ASSERT_TRUE(d1 && d2 && strcmp(d1, d2) == 0);
+    ASSERT_NOT_NULL(first ? strstr(first, "\"digits\":4180") : NULL);
+    free(first);
+    free(second);
+    fibonacci_cache_clear();
+}
+
+TEST(test_fibonacci_invalid_and_deadline) {
+    const char *bad[] = { "", "-1", "abc", "1e3", "10000001" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        char *json = handle_fibonacci(bad[i]);
+        ASSERT_NOT_NULL(json ? strstr(json, "Invalid num") : NULL);
+        free(json);
+    }
+
+    struct timeval past;
+    deadline_from_timeout_ms(&past, -1000);
+    deadline_set(&past);
+    char *json = handle_fibonacci("1000000");
+    deadline_clear();
+    ASSERT_NULL(json);
+    free(json);
+}
+
+// ============================================================================
+// TESTS DE FACTOR Y PRIMALIDAD
+// ============================================================================
+
+TEST(test_primes_is_prime_matches_sieve) {
+    enum { LIMIT = 200000 };
+    char *composite = calloc(LIMIT, 1);
+    int mismatches = 0;
+    for (int i = 2; i < LIMIT; i++) {
+        if (!composite[i]) {
+            for (long j = (long)i * i; j < LIMIT; j += i) composite[j] = 1;
+        }
+        mismatches += prime_is_prime_u64((uint64_t)i) != !composite[i];
+    }
+    free(composite);
+    ASSERT_EQ(mismatches, 0);
+
+    // Pseudoprimos fuertes para varias bases chicas
+    ASSERT_FALSE(prime_is_prime_u64(3215031751ULL));
+    ASSERT_FALSE(prime_is_prime_u64(3825123056546413051ULL));
+    ASSERT_TRUE(prime_is_prime_u64(18446744073709551557ULL));   // 2^64 - 59
+    ASSERT_TRUE(prime_is_prime_u128(~(prime_u128_t)0 - 158));   // 2^128 - 159
+    ASSERT_FALSE(prime_is_prime_u128((prime_u128_t)18446744073709551557ULL * 18446744073709551557ULL));
+}
+
+TEST(test_primes_sieve_matches_miller_rabin) {
+    // Rangos chicos en los bordes (2, los primos del patrón 3..13, vacíos)
+    static const uint64_t ranges[][2] = {
+        { 0, 1 }, { 0, 2 }, { 2, 2 }, { 3, 3 }, { 9, 9 }, { 1, 13 }, { 13, 17 },
+        { 0, 1000 }, { 524287, 524289 }, { 999999000000ULL, 1000000600000ULL },
+    };
+    int bad = 0;
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+        uint64_t count, *list;
+        ASSERT_EQ(prime_sieve_range(ranges[r][0], ranges[r][1], 3, &count, &list), 0);
+        uint64_t k = 0;
+        for (uint64_t v = ranges[r][0]; v <= ranges[r][1]; v++) {
+            if (!prime_is_prime_u64(v)) continue;
+            bad += k >= count || list[k] != v;
+            k++;
+        }
+        bad += k != count;
+        free(list);
+    }
+    ASSERT_EQ(bad, 0);
+
+    // pi(10^7) con uno y varios threads (varios tramos de segmentos)
+    uint64_t one, many;
+    ASSERT_EQ(prime_sieve_range(0, 10000000, 1, &one, NULL), 0);
+    ASSERT_EQ(prime_sieve_range(0, 10000000, 4, &many, NULL), 0);
+    ASSERT_TRUE(one == 664579 && many == 664579);
+    ASSERT_EQ(prime_sieve_range(10, 5, 1, &one, NULL), -1);
+    ASSERT_EQ(prime_sieve_range(0, PRIME_SIEVE_MAX + 1, 1, &one, NULL), -1);
+}
+
+TEST(test_primes_json) {
+    char *json = handle_primes(NULL, "30", "true");
+    ASSERT_NOT_NULL(json ? strstr(json, "{\"from\":0,\"to\":30,\"count\":10,"
+                                        "\"primes\":[2,3,5,7,11,13,17,19,23,29],\"elapsed_ms\":") : NULL);
+    free(json);
+
+    json = handle_primes("1000000", "2000000", NULL);
+    ASSERT_NOT_NULL(json ? strstr(json, "\"count\":70435,\"elapsed_ms\":") : NULL);
+    ASSERT_NULL(strstr(json, "\"primes\""));
+    free(json);
+
+    const char *bad[][3] = { { "5", "4", NULL }, { "-1", "10", NULL }, { NULL, "1e3", NULL },
+                             { NULL, "100000000000001", NULL }, { "0", "20000000", "true" } };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        json = handle_primes(bad[i][0], bad[i][1], bad[i][2]);
+        ASSERT_NOT_NULL(json ? strstr(json, "\"error\"") : NULL);
+        free(json);
+    }
+
+    // Un rango enorme no termina antes del deadline
+    struct timeval deadline;
+    deadline_from_timeout_ms(&deadline, 20);
+    deadline_set(&deadline);
+    json = handle_primes(NULL, "100000000000000", NULL);
+    deadline_clear();
+    ASSERT_NULL(json);
+}
+
+TEST(test_isprime_batch) {
+    enum { N = 3001 };
+    uint64_t nums[N];
+    bool out[N];
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < N; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        // Mezcla de chicos, de 32 bits (bases {2,7,61}) y de 64 bits
+        nums[i] = i % 3 == 0 ? x % 100000 : i % 3 == 1 ? x >> 32 : x;
+    }
+    nums[0] = 3215031751ULL;                // Pseudoprimo fuerte para 2, 3, 5, 7
+    nums[1] = 18446744073709551557ULL;      // 2^64 - 59
+    prime_is_prime_u64_batch(nums, N, out);
+    int mismatches = 0;
+    for (int i = 0; i < N; i++) mismatches += out[i] != prime_is_prime_u64(nums[i]);
+    ASSERT_EQ(mismatches, 0);
+    ASSERT_FALSE(out[0]);
+    ASSERT_TRUE(out[1]);
+
+    char *json = handle_isprime_batch("0,1,2,97,561,18446744073709551557");
+    ASSERT_NOT_NULL(json ? strstr(json, "{\"count\":6,\"primes\":3,"
+                                        "\"results\":[false,false,true,true,false,true],") : NULL);
+    free(json);
+
+    const char *bad[] = { "1,,2", "3,", "abc", "18446744073709551616" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        json = handle_isprime_batch(bad[i]);
+        ASSERT_NOT_NULL(json ? strstr(json, "\"error\"") : NULL);
+        free(json);
+    }
+}
+
+TEST(test_factor_json) {
+    char *json = handle_factor("360");
+    ASSERT_NOT_NULL(json ? strstr(json, "{\"input\":\"360\",\"factors\":[{\"prime\":\"2\",\"count\":3},"
+                                        "{\"prime\":\"3\",\"count\":2},{\"prime\":\"5\",\"count\":1}],\"elapsed_ms\":") : NULL);
+    free(json);
+
+    // 2^64 - 1 y 2^128 - 1
+    json = handle_factor("18446744073709551615");
+    ASSERT_NOT_NULL(json ? strstr(json, "{\"prime\":\"65537\",\"count\":1},{\"prime\":\"6700417\",\"count\":1}]") : NULL);
+    free(json);
+    json = handle_factor("340282366920938463463374607431768211455");
+    ASSERT_NOT_NULL(json ? strstr(json, "{\"prime\":\"67280421310721\",\"count\":1}]") : NULL);
+    free(json);
+
+    // (2^31 - 1)^2
+    json = handle_factor("4611686014132420609");
+    ASSERT_NOT_NULL(json ? strstr(json, "[{\"prime\":\"2147483647\",\"count\":2}]") : NULL);
+    free(json);
+}
+
+TEST(test_factor_semiprimes) {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    prime_u128_t factors[PRIME_MAX_FACTORS];
+    int bad = 0;
+    for (int k = 0; k < 20; k++) {
+        uint64_t p[2];
+        for (int j = 0; j < 2; j++) {
+            do {
+                state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+                p[j] = (state >> 32) | 0x80000001ULL;
+            } while (!prime_is_prime_u64(p[j]));
+        }
+        prime_u128_t n = (prime_u128_t)p[0] * p[1];
+        int count = prime_factorize(n, factors);
+        uint64_t lo = p[0] < p[1] ? p[0] : p[1];
+        bad += count != 2 || factors[0] != lo || factors[0] * factors[1] != n;
+    }
+    ASSERT_EQ(bad, 0);
+
+    // 128 bits: factores de ~36 bits
+    prime_u128_t n = (prime_u128_t)68719476767ULL * 68719476731ULL * 1000000007ULL;
+    ASSERT_EQ(prime_factorize(n, factors), 3);
+    ASSERT_TRUE(factors[0] == 1000000007ULL && factors[1] == 68719476731ULL &&
+                factors[2] == 68719476767ULL);
+}
+
+TEST(test_factor_invalid_and_deadline) {
+    const char *bad[] = { "0", "1", "-7", "12a", "", "340282366920938463463374607431768211456" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        char *json = handle_factor(bad[i]);
+        ASSERT_NOT_NULL(json ? strstr(json, "Invalid n") : NULL);
+        free(json);
+    }
+
+    // Semiprimo de 128 bits con factores de 61 bits: rho no termina a tiempo
+    struct timeval past;
+    deadline_from_timeout_ms(&past, -1000);
+    deadline_set(&past);
+    char *json = handle_factor("5316911983139663487003542222693990401");
+    deadline_clear();
+    ASSERT_NULL(json);
+    free(json);
+}
+
+// ============================================================================
+// TESTS DE PARALLEL FOR
+// ============================================================================
+
+static void count_index(int index, void *ctx) {
+    int *hits = ctx;
+    __atomic_fetch_add(&hits[index], 1, __ATOMIC_RELAXED);
+}
+
+TEST(test_parallel_for_runs_each_index_once) {
+    int hits[100] = { 0 };
+    int used = parallel_for(100, 4, count_index, hits);
+    ASSERT_EQ(used, 4);
+    int bad = 0;
+    for (int i = 0; i < 100; i++) bad += hits[i] != 1;
+    ASSERT_EQ(bad, 0);
+
+    // Nunca más threads que índices
+    int few[2] = { 0 };
+    ASSERT_EQ(parallel_for(2, 8, count_index, few), 2);
+    ASSERT_EQ(parallel_for(0, 8, count_index, few), 0);
+    ASSERT_TRUE(parallel_default_threads() >= 1);
+}
+
+static void record_deadline(int index, void *ctx) {
+    int *seen = ctx;
+    seen[index] = deadline_get(NULL) ? 1 : 0;
+}
+
+TEST(test_parallel_for_propagates_deadline) {
+    struct timeval deadline;
+    deadline_from_timeout_ms(&deadline, 60000);
+    deadline_set(&deadline);
+    int seen[16] = { 0 };
+    parallel_for(16, 4, record_deadline, seen);
+    deadline_clear();
+
+    int missing = 0;
+    for (int i = 0; i < 16; i++) missing += seen[i] != 1;
+    ASSERT_EQ(missing, 0);
+}
+
+// ============================================================================
+// TESTS DE COMPRESS
+// ============================================================================
+
+// Texto compresible pero no trivial, de más de un buffer de 1 MB
+static char* write_test_file(const char *path, size_t size) {
+    char *data = malloc(size);
+    uint64_t x = 0x2545F4914F6CDD1DULL;
+    for (size_t i = 0; i < size; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        data[i] = (i % 61 == 60) ? '\n' : (char)('a' + (x >> 59) % 8);
+    }
+    FILE *f = fopen(path, "wb");
+    if (f) {
+        fwrite(data, 1, size, f);
+        fclose(f);
+    }
+    return data;
+}
+
+static bool file_equals(const char *path, const char *data, size_t size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    char *buf = malloc(size + 1);
+    size_t got = fread(buf, 1, size + 1, f);
+    fclose(f);
+    bool same = got == size && memcmp(buf, data, size) == 0;
+    free(buf);
+    return same;
+}
+
+TEST(test_compress_roundtrip) {
+    mkdir("files", 0755);
+    const size_t size = 2500000;
+    char *data = write_test_file("files/test_compress_rt.txt", size);
+
+    const char *codecs[] = { "gzip", "xz" };
+    const char *names[] = { "test_compress_rt.txt.gz", "test_compress_rt.txt.xz" };
+    for (int c = 0; c < 2; c++) {
+        char *json = handle_compress("test_compress_rt.txt", codecs[c], "1");
+        ASSERT_NOT_NULL(json ? strstr(json, "\"input_bytes\":2500000,") : NULL);
+        ASSERT_NOT_NULL(strstr(json, "\"ratio\":"));
+        free(json);
+
+        // Descomprimir sobre el original borrado
+        unlink("files/test_compress_rt.txt");
+        json = handle_decompress(names[c], NULL);
+        ASSERT_NOT_NULL(json ? strstr(json, "\"size_bytes\":2500000,") : NULL);
+        free(json);
+        ASSERT_TRUE(file_equals("files/test_compress_rt.txt", data, size));
+    }
+
+    // Dos miembros gzip concatenados (como cat a.gz b.gz) = los dos textos
+    compress_stats_t stats;
+    ASSERT_EQ(compress_file("files/test_compress_rt.txt", "files/test_compress_a.gz",
+                            COMPRESS_CODEC_GZIP, false, 1, true, &stats), COMPRESS_OK);
+    FILE *in = fopen("files/test_compress_a.gz", "rb");
+    FILE *out = fopen("files/test_compress_cat.gz", "wb");
+    char *packed = malloc(stats.output_bytes);
+    ASSERT_EQ(fread(packed, 1, stats.output_bytes, in), stats.output_bytes);
+    fwrite(packed, 1, stats.output_bytes, out);
+    fwrite(packed, 1, stats.output_bytes, out);
+    fclose(in);
+    fclose(out);
+    ASSERT_EQ(compress_file("files/test_compress_cat.gz", "files/test_compress_cat.txt",
+                            COMPRESS_CODEC_GZIP, true, 1, true, &stats), COMPRESS_OK);
+    ASSERT_EQ(stats.output_bytes, 2 * size);
+
+    // Truncado: error y sin archivo de salida
+    out = fopen("files/test_compress_trunc.gz", "wb");
+    fwrite(packed, 1, 1000, out);
+    fclose(out);
+    free(packed);
+    ASSERT_EQ(compress_file("files/test_compress_trunc.gz", "files/test_compress_trunc.txt",
+                            COMPRESS_CODEC_GZIP, true, 1, true, &stats), COMPRESS_ERR_CORRUPT);
+    ASSERT_NEQ(access("files/test_compress_trunc.txt", F_OK), 0);
+
+    const char *tmp[] = { "files/test_compress_rt.txt", "files/test_compress_rt.txt.gz",
+                          "files/test_compress_rt.txt.xz", "files/test_compress_a.gz",
+                          "files/test_compress_cat.gz", "files/test_compress_cat.txt",
+                          "files/test_compress_trunc.gz" };
+    for (size_t i = 0; i < sizeof(tmp) / sizeof(tmp[0]); i++) unlink(tmp[i]);
+    free(data);
+}
+
+// Sin overwrite /decompress no pisa un archivo existente; con overwrite=true sí
+TEST(test_decompress_overwrite) {
+    const size_t size = 300000;
+    char *data = write_test_file("files/test_compress_ow.txt", size);
+    char *json = handle_compress("test_compress_ow.txt", "gzip", "1");
+    ASSERT_NOT_NULL(json ? strstr(json, "\"size_bytes\"") : NULL);
+    free(json);
+
+    FILE *f = fopen("files/test_compress_ow.txt", "wb");
+    fputs("keep me", f);
+    fclose(f);
+    const char *no[] = { NULL, "false", "0" };
+    for (int i = 0; i < 3; i++) {
+        json = handle_decompress("test_compress_ow.txt.gz", no[i]);
+        ASSERT_NOT_NULL(json ? strstr(json, "\"error\":\"Output exists\"") : NULL);
+        free(json);
+        ASSERT_TRUE(file_equals("files/test_compress_ow.txt", "keep me", 7));
+    }
+
+    // El link() final también respeta un dst creado durante el proceso
+    compress_stats_t stats;
+    ASSERT_EQ(compress_file("files/test_compress_ow.txt.gz", "files/test_compress_ow.out",
+                            COMPRESS_CODEC_GZIP, true, 1, false, &stats), COMPRESS_OK);
+    ASSERT_TRUE(file_equals("files/test_compress_ow.out", data, size));
+    ASSERT_EQ(compress_file("files/test_compress_ow.txt.gz", "files/test_compress_ow.out",
+                            COMPRESS_CODEC_GZIP, true, 1, false, &stats), COMPRESS_ERR_EXISTS);
+
+    json = handle_decompress("test_compress_ow.txt.gz", "true");
+    ASSERT_NOT_NULL(json ? strstr(json, "\"size_bytes\":300000,") : NULL);
+    free(json);
+    ASSERT_TRUE(file_equals("files/test_compress_ow.txt", data, size));
+
+    // Ni el temporal de mkstemp ni el del link quedan en files/
+    int leftovers = 0;
+    DIR *dir = opendir("files");
+    struct dirent *e;
+    while (dir && (e = readdir(dir)) != NULL) {
+        leftovers += strncmp(e->d_name, "test_compress_ow.", 17) == 0 &&
+                     strcmp(e->d_name, "test_compress_ow.txt") != 0 &&
+                     strcmp(e->d_name, "test_compress_ow.txt.gz") != 0 &&
+                     strcmp(e->d_name, "test_compress_ow.out") != 0;
+    }
+    if (dir) closedir(dir);
+    ASSERT_EQ(leftovers, 0);
+
+    unlink("files/test_compress_ow.txt");
+    unlink("files/test_compress_ow.txt.gz");
+    unlink("files/test_compress_ow.out");
+    free(data);
+}
+
+TEST(test_compress_parallel_blocks) {
+    // Vacío, un bloque, bloque + 1, ronda exacta (3 threads * 4 bloques) y más
+    const size_t sizes[] = { 0, 1, COMPRESS_BLOCK_SIZE, COMPRESS_BLOCK_SIZE + 1,
+                             12 * COMPRESS_BLOCK_SIZE, 12 * COMPRESS_BLOCK_SIZE + 4321 };
+    int bad = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char *data = write_test_file("files/test_compress_par.txt", sizes[i]);
+        compress_stats_t packed, unpacked;
+        bad += compress_file("files/test_compress_par.txt", "files/test_compress_par.gz",
+                             COMPRESS_CODEC_GZIP, false, 3, true, &packed) != COMPRESS_OK;
+        bad += packed.threads != 3;
+        // Un solo miembro gzip: el CRC y el tamaño del trailer cubren todo
+        FILE *f = fopen("files/test_compress_par.gz", "rb");
+        unsigned char trailer[4] = { 0 };
+        if (f && fseek(f, -4, SEEK_END) == 0 && fread(trailer, 1, 4, f) == 4) {
+            uint32_t isize = trailer[0] | trailer[1] << 8 | trailer[2] << 16 | (uint32_t)trailer[3] << 24;
+            bad += isize != sizes[i];
+        } else {
+            bad++;
+        }
+        if (f) fclose(f);
+        bad += compress_file("files/test_compress_par.gz", "files/test_compress_par.out",
+                             COMPRESS_CODEC_GZIP, true, 1, true, &unpacked) != COMPRESS_OK;
+        bad += !file_equals("files/test_compress_par.out", data, sizes[i]);
+        free(data);
+    }
+    ASSERT_EQ(bad, 0);
+
+    // Con diccionario del bloque anterior el ratio queda cerca del secuencial
+    char *data = write_test_file("files/test_compress_par.txt", 3000000);
+    compress_stats_t seq, par, xz;
+    ASSERT_EQ(compress_file("files/test_compress_par.txt", "files/test_compress_par.gz",
+                            COMPRESS_CODEC_GZIP, false, 1, true, &seq), COMPRESS_OK);
+    ASSERT_EQ(compress_file("files/test_compress_par.txt", "files/test_compress_par.gz",
+                            COMPRESS_CODEC_GZIP, false, 4, true, &par), COMPRESS_OK);
+    ASSERT_TRUE(par.output_bytes < seq.output_bytes + seq.output_bytes / 100);
+
+    // xz multithread: varios bloques de liblzma, mismo contenido
+    ASSERT_EQ(compress_file("files/test_compress_par.txt", "files/test_compress_par.xz",
+                            COMPRESS_CODEC_XZ, false, 2, true, &xz), COMPRESS_OK);
+    ASSERT_EQ(compress_file("files/test_compress_par.xz", "files/test_compress_par.out",
+                            COMPRESS_CODEC_XZ, true, 1, true, &xz), COMPRESS_OK);
+    ASSERT_TRUE(file_equals("files/test_compress_par.out", data, 3000000));
+    free(data);
+
+    const char *tmp[] = { "files/test_compress_par.txt", "files/test_compress_par.gz",
+                          "files/test_compress_par.xz", "files/test_compress_par.out" };
+    for (size_t i = 0; i < sizeof(tmp) / sizeof(tmp[0]); i++) unlink(tmp[i]);
+}
+
+TEST(test_compress_errors_and_deadline) {
+    const char *bad[][3] = { { "../etc/passwd", "gzip" }, { "/etc/passwd", "gzip" },
+                             { "a/../../b", "gzip" }, { "test.txt", "lz4" },
+                             { "test.txt", "gzip", "0" }, { "test.txt", "gzip", "4x" },
+                             { "no_such_file.txt", "gzip" } };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        char *json = handle_compress(bad[i][0], bad[i][1], bad[i][2]);
+        ASSERT_NOT_NULL(json ? strstr(json, "\"error\"") : NULL);
+        free(json);
+    }
+    const char *bad_decompress[][2] = { { "test.txt" }, { "../x.gz" },
+                                        { "test_compress_ow.txt.gz", "yes" } };
+    for (size_t i = 0; i < sizeof(bad_decompress) / sizeof(bad_decompress[0]); i++) {
+        char *json = handle_decompress(bad_decompress[i][0], bad_decompress[i][1]);
+        ASSERT_NOT_NULL(json ? strstr(json, "\"error\"") : NULL);
+        free(json);
+    }
+    char *json;
+
+    // Deadline vencido: NULL (504) y sin archivos a medias
+    char *data = write_test_file("files/test_compress_dl.txt", 3000000);
+    struct timeval deadline;
+    deadline_from_timeout_ms(&deadline, 1);
+    deadline_set(&deadline);
+    usleep(2000);
+    json = handle_compress("test_compress_dl.txt", "xz", NULL);
+    deadline_clear();
+    ASSERT_NULL(json);
+    ASSERT_NEQ(access("files/test_compress_dl.txt.xz", F_OK), 0);
+    unlink("files/test_compress_dl.txt");
+    free(data);
+}
+
+// Conteo byte a byte de referencia (wc con isspace() y chars UTF-8)
+static void naive_wordcount(const unsigned char *p, size_t n, unsigned long *lines,
+                            unsigned long *words, unsigned long *chars) {
+    *lines = *words = *chars = 0;
+    bool prev_space = true;
+    for (size_t i = 0; i < n; i++) {
+        bool sp = isspace(p[i]) != 0;
+        *words += prev_space && !sp;
+        *lines += p[i] == '\n';
+        *chars += (p[i] & 0xC0) != 0x80;
+        prev_space = sp;
+    }
+    if (n > 0 && p[n - 1] != '\n') (*lines)++;
+}
+
+TEST(test_wordcount_chunks_utf8) {
+    mkdir("files", 0755);
+    // Tokens ASCII, UTF-8 de 2, 3 y 4 bytes y todos los espacios de isspace()
+    static const char *tokens[] = { "a", "xyz", "\xc3\xb1", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+                                    " ", "\t", "\n", "\r", "\v", "\f", "  " };
+    const size_t size = 2 * WORDCOUNT_CHUNK_SIZE + 777;
+    unsigned char *data = malloc(size);
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    size_t n = 0;
+    while (n < size) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        const char *t = tokens[(x >> 40) % (sizeof(tokens) / sizeof(tokens[0]))];
+        for (size_t k = 0; t[k] && n < size; k++) data[n++] = (unsigned char)t[k];
+    }
+    // Una palabra que cruza el borde entre chunks y el archivo sin '\n' final
+    memset(data + WORDCOUNT_CHUNK_SIZE - 3, 'w', 6);
+    data[size - 1] = 'z';
+
+    unsigned long lines, words, chars;
+    naive_wordcount(data, size, &lines, &words, &chars);
+    FILE *f = fopen("files/test_wordcount.txt", "wb");
+    ASSERT_NOT_NULL(f);
+    fwrite(data, 1, size, f);
+    fclose(f);
+
+    char expected[160];
+    snprintf(expected, sizeof(expected), "\"lines\":%lu,\"words\":%lu,\"bytes\":%zu,\"chars\":%lu,",
+             lines, words, size, chars);
+    const char *threads[] = { "1", "3", NULL };
+    for (int i = 0; i < 3; i++) {
+        char *json = handle_wordcount("test_wordcount.txt", threads[i]);
+        ASSERT_NOT_NULL(json ? strstr(json, expected) : NULL);
+        free(json);
+    }
+
+    // Archivo chico (solo el resto escalar) y vacío
+    f = fopen("files/test_wordcount.txt", "wb");
+    fwrite(" \xc3\xb1" "and\xc3\xba\t\n", 1, 10, f);
+    fclose(f);
+    char *json = handle_wordcount("test_wordcount.txt", NULL);
+    ASSERT_NOT_NULL(json ? strstr(json, "\"lines\":1,\"words\":1,\"bytes\":10,\"chars\":8,") : NULL);
+    free(json);
+    f = fopen("files/test_wordcount.txt", "wb");
+    fclose(f);
+    json = handle_wordcount("test_wordcount.txt", NULL);
+    ASSERT_NOT_NULL(json ? strstr(json, "\"lines\":0,\"words\":0,\"bytes\":0,\"chars\":0,") : NULL);
+    free(json);
+
+    json = handle_wordcount("test_wordcount.txt", "0");
+    ASSERT_NOT_NULL(json ? strstr(json, "Invalid threads") : NULL);
+    free(json);
+    json = handle_wordcount("test_wordcount_missing.txt", NULL);
+    ASSERT_NOT_NULL(json ? strstr(json, "File not found") : NULL);
+    free(json);
+
+    unlink("files/test_wordcount.txt");
+    free(data);
+}
+
+// Trunca como /createfile o /sortfile (fopen "w") después de arg microsegundos
+static void* truncate_after(void *arg) {
+    usleep((useconds_t)(uintptr_t)arg);
+    FILE *f = fopen("files/test_wordcount_trunc.txt", "w");
+    if (f) fclose(f);
+    return NULL;
+}
+
+TEST(test_wordcount_truncated_while_counting) {
+    mkdir("files", 0755);
+    const size_t size = 8 * WORDCOUNT_CHUNK_SIZE;
+    char *data = malloc(size);
+    for (size_t i = 0; i < size; i++) data[i] = (i % 7 == 6) ? ' ' : 'a';
+
+    // Sin mmap no hay SIGBUS: cada vuelta termina con el conteo completo
+    // (si la truncada llegó tarde) o con un error, nunca con el proceso muerto
+    int answered = 0;
+    for (int round = 0; round < 12; round++) {
+        FILE *f = fopen("files/test_wordcount_trunc.txt", "wb");
+        ASSERT_NOT_NULL(f);
+        fwrite(data, 1, size, f);
+        fclose(f);
+
+        pthread_t truncator;
+        pthread_create(&truncator, NULL, truncate_after, (void *)(uintptr_t)(round * 500));
+        char *json = handle_wordcount("test_wordcount_trunc.txt", round % 2 ? "2" : "1");
+        pthread_join(truncator, NULL);
+
+        answered += json && (strstr(json, "\"success\":true") ||
+                             strstr(json, "Failed to read file"));
+        free(json);
+    }
+    ASSERT_EQ(answered, 12);
+
+    unlink("files/test_wordcount_trunc.txt");
+    free(data);
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+void test_commands_all() {
+    printf("\n📦 Test Suite: Commands\n");
+    printf("==========================================\n");
+
+    // Matrixmul
+    RUN_TEST(test_matrixmul_matches_reference);
+    RUN_TEST(test_matrixmul_hash_deterministic);
+    RUN_TEST(test_matrixmul_size_limits);
+    RUN_TEST(test_matrixmul_deadline_aborts);
+
+    // Mandelbrot
+    RUN_TEST(test_mandelbrot_kernels_match_reference);
+    RUN_TEST(test_mandelbrot_view_params);
+    RUN_TEST(test_mandelbrot_deadline_aborts);
+    RUN_TEST(test_mandelbrot_stream_formats);
+    RUN_TEST(test_mandelbrot_stream_errors);
+
+    // Bigint y pi
+    RUN_TEST(test_bigint_mul_all_sizes);
+    RUN_TEST(test_bigint_signed_arithmetic);
+    RUN_TEST(test_pi_known_digits);
+    RUN_TEST(test_pi_parallel_matches_serial);
+    RUN_TEST(test_pi_cache_serves_slices);
+    RUN_TEST(test_pi_invalid_and_deadline);
+
+    // Fibonacci
+    RUN_TEST(test_fibonacci_small_path);
+    RUN_TEST(test_fibonacci_fast_doubling_matches_iteration);
+    RUN_TEST(test_fibonacci_big_and_cache);
+    RUN_TEST(test_fibonacci_invalid_and_deadline);
+
+    // Factor
+    RUN_TEST(test_primes_is_prime_matches_sieve);
+    RUN_TEST(test_primes_sieve_matches_miller_rabin);
+    RUN_TEST(test_primes_json);
+    RUN_TEST(test_isprime_batch);
+    RUN_TEST(test_factor_json);
+    RUN_TEST(test_factor_semiprimes);
+    RUN_TEST(test_factor_invalid_and_deadline);
+
+    // Compress
+    RUN_TEST(test_compress_roundtrip);
+    RUN_TEST(test_decompress_overwrite);
+    RUN_TEST(test_compress_parallel_blocks);
+    RUN_TEST(test_compress_errors_and_deadline);
+    RUN_TEST(test_wordcount_chunks_utf8);
+    RUN_TEST(test_wordcount_truncated_while_counting);
+
+    // Parallel for
+    RUN_TEST(test_parallel_for_runs_each_index_once);
+    RUN_TEST(test_parallel_for_propagates_deadline);
+
+    printf("\n");
+}
+
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║         HTTP Server - Test Suite: Commands                 ║\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("\n");
+
+    test_commands_all();
+
+    print_test_summary();
+    return get_test_failures() > 0 ? 1 : 0;
+}
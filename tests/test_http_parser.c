@@ -1,7 +1,12 @@
 #include "test_utils.h"
 #include "../src/server/http.h"
+#include "../src/server/server.h"
+#include <pthread.h>
+#include <arpa/inet.h>
 #include <string.h>
 #include <stdbool.h>
+#include <unistd.h>
+#include <signal.h>
 
 
 // ============================================================================
@@ -54,6 +59,47 @@ TEST(test_parse_with_headers) {
     ASSERT_FALSE(req.connection_close); // keep-alive
 }
 
+TEST(test_parse_request_timeout_header) {
+    const char *request = 
+        "GET /matrixmul?size=100&seed=1 HTTP/1.1\r\n"
+        "X-Request-Timeout-Ms: 250\r\n"
+        "\r\n";
+    
+    http_request_t req;
+    int result = http_parse_request(request, &req);
+    
+    ASSERT_EQ(result, 0);
+    ASSERT_EQ(req.timeout_ms, 250);
+}
+
+TEST(test_parse_request_timeout_invalid) {
+    const char *request = 
+        "GET /status HTTP/1.0\r\n"
+        "X-Request-Timeout-Ms: abc\r\n"
+        "\r\n";
+    
+    http_request_t req;
+    int result = http_parse_request(request, &req);
+    
+    ASSERT_EQ(result, 0);
+    ASSERT_EQ(req.timeout_ms, 0); // Sin deadline
+}
+
+TEST(test_parse_request_timeout_clamped) {
+    // Más allá del tope (y del rango de long): se recorta, no desborda
+    const char *values[] = { "99999999999999999", "999999999999999999999999" };
+    for (int i = 0; i < 2; i++) {
+        char request[256];
+        snprintf(request, sizeof(request),
+                 "GET /primes?to=100000000000000 HTTP/1.0\r\n"
+                 "X-Request-Timeout-Ms: %s\r\n"
+                 "\r\n", values[i]);
+        http_request_t req;
+        ASSERT_EQ(http_parse_request(request, &req), 0);
+        ASSERT_EQ(req.timeout_ms, HTTP_MAX_REQUEST_TIMEOUT_MS);
+    }
+}
+
 TEST(test_parse_complex_query) {
     const char *request = 
         "GET /random?count=10&min=1&max=100 HTTP/1.0\r\n"
@@ -167,6 +213,10 @@ TEST(test_status_text_500) {
     ASSERT_STR_EQ(http_status_text(500), "Internal Server Error");
 }
 
+TEST(test_status_text_504) {
+    ASSERT_STR_EQ(http_status_text(504), "Gateway Timeout");
+}
+
 TEST(test_status_text_503) {
     ASSERT_STR_EQ(http_status_text(503), "Service Unavailable");
 }
@@ -215,6 +265,131 @@ TEST(test_content_type_no_extension) {
     ASSERT_STR_EQ(http_content_type_from_file("README"), "application/octet-stream");
 }
 
+// ============================================================================
+// TESTS DE STREAMING
+// ============================================================================
+
+TEST(test_stream_response) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    
+    http_stream_t stream;
+    ASSERT_EQ(http_stream_begin(&stream, fds[1], 200, "text/plain", "req-1"), 0);
+    
+    // Más que el buffer interno: obliga a varios flush intermedios
+    for (int i = 0; i < 2000; i++) {
+        http_stream_printf(&stream, "line %04d\n", i);
+    }
+    http_stream_write(&stream, "end\n", 4);
+    ssize_t total = http_stream_end(&stream);
+    close(fds[1]);
+    
+    static char out[65536];
+    ssize_t n = 0, r;
+    while ((r = read(fds[0], out + n, sizeof(out) - 1 - n)) > 0) n += r;
+    out[n] = '\0';
+    close(fds[0]);
+    
+    ASSERT_EQ(total, n);
+    ASSERT_TRUE(strncmp(out, "HTTP/1.0 200 OK\r\n", 17) == 0);
+    ASSERT_TRUE(strstr(out, "Content-Length") == NULL);
+    ASSERT_TRUE(strstr(out, "X-Request-Id: req-1\r\n") != NULL);
+    
+    char *body = strstr(out, "\r\n\r\n");
+    ASSERT_NOT_NULL(body);
+    body += 4;
+    ASSERT_TRUE(strncmp(body, "line 0000\n", 10) == 0);
+    ASSERT_TRUE(strstr(body, "line 1999\nend\n") != NULL);
+    ASSERT_EQ((long)strlen(body), 2000L * 10 + 4);
+}
+
+TEST(test_stream_write_error) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    close(fds[0]);
+    signal(SIGPIPE, SIG_IGN);
+    
+    http_stream_t stream;
+    http_stream_begin(&stream, fds[1], 200, "text/plain", NULL);
+    http_stream_printf(&stream, "hello\n");
+    ASSERT_EQ(http_stream_end(&stream), -1);
+    close(fds[1]);
+}
+
+// ============================================================================
+// TESTS DE DRAIN
+// ============================================================================
+
+static void* run_server(void *arg) {
+    server_start((server_state_t*)arg);
+    return NULL;
+}
+
+static int connect_local(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Envía la request por fd y lee la respuesta completa en out
+static ssize_t send_and_read(int fd, const char *req, char *out, size_t cap) {
+    ssize_t w = write(fd, req, strlen(req));
+    (void)w;
+    ssize_t n = 0, r;
+    while (n < (ssize_t)cap - 1 && (r = read(fd, out + n, cap - 1 - n)) > 0) n += r;
+    out[n > 0 ? n : 0] = '\0';
+    close(fd);
+    return n;
+}
+
+TEST(test_server_drain_rejects_new_connections) {
+    server_config_t config = {
+        .port = 18093,
+        .max_connections = 16,
+        .request_timeout_sec = 2,
+        .max_request_size = 8192,
+        .drain_timeout_ms = 2000
+    };
+    server_state_t *server = server_init(&config);
+    ASSERT_NOT_NULL(server);
+    
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, run_server, server), 0);
+    
+    // Conexión aceptada antes del drain (todavía sin request)
+    int before = connect_local(config.port);
+    ASSERT_TRUE(before >= 0);
+    for (int i = 0; i < 200 && __atomic_load_n(&server->inflight_connections, __ATOMIC_ACQUIRE) == 0; i++) {
+        usleep(5000);
+    }
+    ASSERT_EQ(__atomic_load_n(&server->inflight_connections, __ATOMIC_ACQUIRE), 1);
+    
+    server_begin_drain(server);
+    ASSERT_TRUE(server_is_draining(server));
+    
+    // Lo nuevo recibe 503; el drain sigue esperando a la primera conexión
+    char out[1024];
+    int after = connect_local(config.port);
+    ASSERT_TRUE(after >= 0);
+    ASSERT_TRUE(send_and_read(after, "GET /status HTTP/1.0\r\n\r\n", out, sizeof(out)) > 0);
+    ASSERT_TRUE(strncmp(out, "HTTP/1.0 503", 12) == 0);
+    ASSERT_TRUE(strstr(out, "Retry-After: 1\r\n") != NULL);
+    
+    // La conexión previa se atiende normalmente (400: request inválida, sin router)
+    ASSERT_TRUE(send_and_read(before, "garbage\r\n\r\n", out, sizeof(out)) > 0);
+    ASSERT_TRUE(strncmp(out, "HTTP/1.0 400", 12) == 0);
+    
+    // Sin nada en curso server_start() retorna antes del plazo
+    pthread_join(thread, NULL);
+    ASSERT_EQ(server_drain(server, 1000), 0);
+    server_destroy(server);
+}
+
 // ============================================================================
 // TEST SUITE
 // ============================================================================
@@ -227,6 +402,9 @@ void test_http_parser_all() {
     RUN_TEST(test_parse_simple_get);
     RUN_TEST(test_parse_get_with_query);
     RUN_TEST(test_parse_with_headers);
+    RUN_TEST(test_parse_request_timeout_header);
+    RUN_TEST(test_parse_request_timeout_invalid);
+    RUN_TEST(test_parse_request_timeout_clamped);
     RUN_TEST(test_parse_complex_query);
     RUN_TEST(test_parse_malformed_no_version);
     RUN_TEST(test_parse_malformed_no_crlf);
@@ -248,6 +426,7 @@ void test_http_parser_all() {
     RUN_TEST(test_status_text_404);
     RUN_TEST(test_status_text_500);
     RUN_TEST(test_status_text_503);
+    RUN_TEST(test_status_text_504);
     
     // Tests de path safety
     RUN_TEST(test_path_safe_normal);
@@ -261,6 +440,13 @@ void test_http_parser_all() {
     RUN_TEST(test_content_type_unknown);
     RUN_TEST(test_content_type_no_extension);
     
+    // Tests de streaming
+    RUN_TEST(test_stream_response);
+    RUN_TEST(test_stream_write_error);
+    
+    // Tests de drain
+    RUN_TEST(test_server_drain_rejects_new_connections);
+    
     printf("\n");
 }
 
@@ -1,8 +1,11 @@
 // Tests de job manager
 #include "test_utils.h"
 #include "../src/core/job_manager.h"
+#include "../src/core/job_executor.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
+#include <unistd.h>
 
 TEST(test_job_submit_and_status) {
 	job_manager_init("data/jobs");
@@ -72,11 +75,114 @@ TEST(test_job_cancel) {
 	free(job_id);
 }
 
+// ============================================================================
+// HOT RESTART: recuperar jobs de otro proceso
+// ============================================================================
+
+#define FAKE_OWNER 999999999L
+
+static int requeued = 0;
+static char requeued_task[64];
+static char requeued_query[128];
+
+static int stub_requeue(const char *job_id, const char *task_name, const char *query) {
+	(void)job_id;
+	requeued++;
+	snprintf(requeued_task, sizeof(requeued_task), "%s", task_name);
+	snprintf(requeued_query, sizeof(requeued_query), "%s", query);
+	return 0;
+}
+
+// Archivo como el que deja job_manager de otro proceso
+static void write_job_file(const char *job_id, int status, long owner) {
+	char path[256];
+	snprintf(path, sizeof(path), "data/jobs/%s.json", job_id);
+	FILE *f = fopen(path, "w");
+	if (!f) return;
+	fprintf(f, "{\n  \"job_id\": \"%s\",\n  \"task_name\": \"isprime\",\n"
+	           "  \"status\": %d,\n  \"progress\": 0,\n  \"eta_ms\": -1,\n"
+	           "  \"payload\": {\"n\":\"97\",\"algo\":\"mr\"},\n"
+	           "  \"owner\": %ld,\n  \"created_at\": 0\n}\n",
+	        job_id, status, owner);
+	fclose(f);
+}
+
+TEST(test_job_recover_from_previous_owner) {
+	char queued[64], other[64], done[64], path[256];
+	snprintf(queued, sizeof(queued), "recover-queued-%d", (int)getpid());
+	snprintf(other, sizeof(other), "recover-other-%d", (int)getpid());
+	snprintf(done, sizeof(done), "recover-done-%d", (int)getpid());
+	write_job_file(queued, JOB_STATUS_QUEUED, FAKE_OWNER);
+	write_job_file(other, JOB_STATUS_QUEUED, FAKE_OWNER + 1);
+	write_job_file(done, JOB_STATUS_DONE, FAKE_OWNER);
+
+	requeued = 0;
+	int n = job_manager_recover(FAKE_OWNER, stub_requeue);
+	ASSERT_EQ(n, 1);
+	ASSERT_EQ(requeued, 1);
+	ASSERT_TRUE(strcmp(requeued_task, "isprime") == 0);
+	ASSERT_TRUE(strcmp(requeued_query, "n=97&algo=mr") == 0);
+
+	job_status_info_t info;
+	ASSERT_EQ(job_get_status(queued, &info), 0);
+	ASSERT_EQ(info.status, JOB_STATUS_QUEUED);
+
+	// Ya es de este proceso: no se vuelve a recuperar
+	ASSERT_EQ(job_manager_recover(FAKE_OWNER, stub_requeue), 0);
+
+	const char *ids[] = { queued, other, done };
+	for (int i = 0; i < 3; i++) {
+		snprintf(path, sizeof(path), "data/jobs/%s.json", ids[i]);
+		unlink(path);
+	}
+}
+
+// ============================================================================
+// DRAIN: jobs que no llegaron a empezar
+// ============================================================================
+
+TEST(test_job_executor_release_marks_error) {
+	ASSERT_EQ(job_executor_init(1, 10), 0);
+
+	char *ids[3];
+	for (int i = 0; i < 3; i++) {
+		ids[i] = job_submit("sleep", "{\"seconds\":\"1\"}", 0);
+		ASSERT_NOT_NULL(ids[i]);
+		ASSERT_EQ(job_executor_requeue(ids[i], "sleep", "seconds=1"), 0);
+	}
+
+	// Esperar a que el único worker tome el primero
+	job_status_info_t info = { 0 };
+	for (int i = 0; i < 200; i++) {
+		job_get_status(ids[0], &info);
+		if (info.status == JOB_STATUS_RUNNING) break;
+		usleep(10000);
+	}
+	ASSERT_EQ(info.status, JOB_STATUS_RUNNING);
+	ASSERT_EQ(job_executor_pending(), 3);
+
+	ASSERT_EQ(job_executor_release("Server shut down before the job started"), 2);
+	for (int i = 1; i < 3; i++) {
+		job_get_status(ids[i], &info);
+		ASSERT_EQ(info.status, JOB_STATUS_ERROR);
+	}
+
+	// El que estaba corriendo termina en el shutdown
+	job_executor_shutdown();
+	job_get_status(ids[0], &info);
+	ASSERT_EQ(info.status, JOB_STATUS_DONE);
+	ASSERT_EQ(job_executor_pending(), 0);
+
+	for (int i = 0; i < 3; i++) free(ids[i]);
+}
+
 void run_all_tests() {
     RUN_TEST(test_job_submit_and_status);
     RUN_TEST(test_job_mark_running_and_done);
     RUN_TEST(test_job_mark_error_and_get_result);
     RUN_TEST(test_job_cancel);
+    RUN_TEST(test_job_recover_from_previous_owner);
+    RUN_TEST(test_job_executor_release_marks_error);
 }
 
 int main() {
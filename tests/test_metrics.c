@@ -1,6 +1,16 @@
 #include "test_utils.h"
 #include "../src/core/metrics.h"
+#include "../src/core/access_log.h"
+#include "../src/core/trace.h"
+#include "../src/core/shm.h"
+#include "../src/core/affinity.h"
+#include "../src/core/queue.h"
+#include "../src/core/worker_pool.h"
 #include <math.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 // ============================================================================
 // TESTS DE INICIALIZACIÓN
@@ -32,6 +42,7 @@ TEST(test_metrics_register_duplicate) {
     
     // Debe retornar el mismo índice
     ASSERT_EQ(idx1, idx2);
+    ASSERT_EQ(metrics_command_count(), 1);
     
     metrics_destroy();
 }
@@ -102,6 +113,89 @@ TEST(test_metrics_update_workers) {
     metrics_destroy();
 }
 
+// Handler que se queda ocupado hasta que el test lo suelta
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int started;
+    bool release;
+} gauge_ctx_t;
+
+static int gauge_blocking_handler(task_t *task, void *user_ctx) {
+    (void)task;
+    gauge_ctx_t *ctx = user_ctx;
+    pthread_mutex_lock(&ctx->mutex);
+    ctx->started++;
+    pthread_cond_broadcast(&ctx->cond);
+    while (!ctx->release) pthread_cond_wait(&ctx->cond, &ctx->mutex);
+    pthread_mutex_unlock(&ctx->mutex);
+    return 0;
+}
+
+static void gauges_of(const char *command, int *queued, int *busy) {
+    command_metrics_t m;
+    metrics_get_command(command, &m);
+    *queued = m.current_queue_size;
+    *busy = m.busy_workers;
+}
+
+TEST(test_metrics_gauges_per_command) {
+    metrics_init();
+    metrics_register_command("gauge_a", 2, 64, 100);
+    metrics_register_command("gauge_b", 2, 64, 100);
+
+    gauge_ctx_t ctx = { .started = 0, .release = false };
+    pthread_mutex_init(&ctx.mutex, NULL);
+    pthread_cond_init(&ctx.cond, NULL);
+
+    // 2 workers: toman A y B; quedan dos A en cola
+    queue_t *q = queue_create(0);
+    worker_pool_t *pool = worker_pool_create(2, q, gauge_blocking_handler, &ctx);
+    ASSERT_NOT_NULL(pool);
+    const char *paths[] = { "/gauge_a", "/gauge_b", "/gauge_a", "/gauge_a" };
+    for (int i = 0; i < 2; i++) queue_enqueue(q, task_create(-1, paths[i], NULL, "gauge"), -1);
+    worker_pool_start(pool);
+
+    pthread_mutex_lock(&ctx.mutex);
+    while (ctx.started < 2) pthread_cond_wait(&ctx.cond, &ctx.mutex);
+    pthread_mutex_unlock(&ctx.mutex);
+    for (int i = 2; i < 4; i++) queue_enqueue(q, task_create(-1, paths[i], NULL, "gauge"), -1);
+
+    int queued, busy;
+    gauges_of("gauge_a", &queued, &busy);
+    ASSERT_EQ(busy, 1);
+    ASSERT_EQ(queued, 2);
+    gauges_of("gauge_b", &queued, &busy);
+    ASSERT_EQ(busy, 1);
+    ASSERT_EQ(queued, 0);
+
+    // Terminado todo, ningún comando conserva el último total
+    pthread_mutex_lock(&ctx.mutex);
+    ctx.release = true;
+    pthread_cond_broadcast(&ctx.cond);
+    pthread_mutex_unlock(&ctx.mutex);
+    for (int waited = 0; waited < 2000; waited += 5) {
+        int busy_b, queued_b;
+        gauges_of("gauge_a", &queued, &busy);
+        gauges_of("gauge_b", &queued_b, &busy_b);
+        if (queued + busy + queued_b + busy_b == 0) break;
+        usleep(5000);
+    }
+    gauges_of("gauge_a", &queued, &busy);
+    ASSERT_EQ(busy, 0);
+    ASSERT_EQ(queued, 0);
+    gauges_of("gauge_b", &queued, &busy);
+    ASSERT_EQ(busy, 0);
+    ASSERT_EQ(queued, 0);
+
+    worker_pool_stop(pool);
+    worker_pool_destroy(pool);
+    queue_destroy(q);
+    pthread_cond_destroy(&ctx.cond);
+    pthread_mutex_destroy(&ctx.mutex);
+    metrics_destroy();
+}
+
 // ============================================================================
 // TESTS DE DESVIACIÓN ESTÁNDAR
 // ============================================================================
@@ -230,6 +324,595 @@ TEST(test_metrics_buffer_overflow) {
     metrics_destroy();
 }
 
+// ============================================================================
+// TESTS DE HISTOGRAMA Y FASES
+// ============================================================================
+
+TEST(test_histogram_buckets) {
+    // Valores chicos se guardan exactos
+    for (uint64_t v = 0; v < 64; v++) {
+        ASSERT_EQ(histogram_bucket_lower(histogram_bucket_index(v)), v);
+    }
+    
+    // Cada valor cae dentro de su bucket y el error relativo es <= 1/32
+    uint64_t samples[] = {64, 100, 1000, 12345, 999999, 60000000ULL};
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        int idx = histogram_bucket_index(samples[i]);
+        uint64_t lo = histogram_bucket_lower(idx);
+        uint64_t hi = histogram_bucket_upper(idx);
+        ASSERT_TRUE(lo <= samples[i] && samples[i] <= hi);
+        ASSERT_TRUE((double)(hi - lo) <= (double)lo / 32.0);
+    }
+    
+    // Saturación en el último bucket
+    ASSERT_EQ(histogram_bucket_index(HIST_MAX_VALUE), HIST_BUCKETS - 1);
+    ASSERT_EQ(histogram_bucket_index(~0ULL), HIST_BUCKETS - 1);
+}
+
+TEST(test_histogram_percentiles) {
+    histogram_t *h = histogram_create();
+    ASSERT_NOT_NULL(h);
+    
+    // 1..1000 us
+    for (uint64_t v = 1; v <= 1000; v++) {
+        histogram_record(h, v);
+    }
+    
+    histogram_summary_t s;
+    histogram_summarize(h, &s);
+    
+    ASSERT_EQ(s.count, 1000);
+    ASSERT_EQ(s.max, 1000);
+    ASSERT_FLOAT_EQ(s.mean, 500.5, 0.01);
+    ASSERT_FLOAT_EQ((double)s.p50, 500.0, 500.0 / 32.0);
+    ASSERT_FLOAT_EQ((double)s.p90, 900.0, 900.0 / 32.0);
+    ASSERT_FLOAT_EQ((double)s.p99, 990.0, 990.0 / 32.0);
+    ASSERT_TRUE(s.p999 <= s.max);
+    
+    histogram_destroy(h);
+}
+
+TEST(test_metrics_record_phase) {
+    metrics_init();
+    metrics_register_command("test_cmd", 1, 10, 100);
+    
+    metrics_record_phase("test_cmd", METRICS_PHASE_PARSE, 10);
+    metrics_record_phase("test_cmd", METRICS_PHASE_WRITE, 20);
+    metrics_record_phase("test_cmd", METRICS_PHASE_WRITE, 40);
+    
+    histogram_summary_t s;
+    ASSERT_EQ(metrics_get_phase_summary("test_cmd", METRICS_PHASE_PARSE, &s), 0);
+    ASSERT_EQ(s.count, 1);
+    ASSERT_EQ(s.max, 10);
+    
+    ASSERT_EQ(metrics_get_phase_summary("test_cmd", METRICS_PHASE_WRITE, &s), 0);
+    ASSERT_EQ(s.count, 2);
+    ASSERT_EQ(s.max, 40);
+    
+    // PARSE/WRITE no cuentan como ejecuciones
+    command_metrics_t metrics;
+    metrics_get_command("test_cmd", &metrics);
+    ASSERT_EQ(metrics.count, 0);
+    
+    ASSERT_EQ(metrics_get_phase_summary("nonexistent", METRICS_PHASE_EXEC, &s), -1);
+    ASSERT_STR_EQ(metrics_command_from_path("/isprime"), "isprime");
+    
+    metrics_destroy();
+}
+
+TEST(test_metrics_get_json_grows) {
+    metrics_init();
+    
+    char name[32];
+    for (int i = 0; i < 20; i++) {
+        snprintf(name, sizeof(name), "cmd_%d", i);
+        metrics_register_command(name, 1, 10, 100);
+        metrics_record_phase(name, METRICS_PHASE_EXEC, 1000);
+    }
+    
+    // Buffer chico: retorna el largo necesario sin escribir fuera del buffer
+    char small[256];
+    int needed = metrics_get_json(small, sizeof(small));
+    ASSERT_TRUE(needed > (int)sizeof(small));
+    
+    char *big = malloc((size_t)needed + 1);
+    int written = metrics_get_json(big, (size_t)needed + 1);
+    ASSERT_EQ(written, needed);
+    ASSERT_TRUE(strstr(big, "\"cmd_19\"") != NULL);
+    ASSERT_TRUE(strstr(big, "\"p999\"") != NULL);
+    free(big);
+    
+    metrics_destroy();
+}
+
+// ============================================================================
+// TESTS DE CONTADORES POR THREAD
+// ============================================================================
+
+#define COUNTER_TEST_THREADS 8
+#define COUNTER_TEST_ITERS   100000
+
+static void* counter_worker(void *arg) {
+    counter_set_t *set = (counter_set_t*)arg;
+    for (int i = 0; i < COUNTER_TEST_ITERS; i++) {
+        counter_set_add(set, 0, 1);
+        counter_set_add(set, 1, 3);
+    }
+    return NULL;
+}
+
+TEST(test_counter_set_concurrent) {
+    counter_set_t *set = counter_set_create(2);
+    ASSERT_NOT_NULL(set);
+    
+    pthread_t threads[COUNTER_TEST_THREADS];
+    for (int i = 0; i < COUNTER_TEST_THREADS; i++) {
+        pthread_create(&threads[i], NULL, counter_worker, set);
+    }
+    for (int i = 0; i < COUNTER_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    // Ningún incremento se pierde al sumar los slots
+    ASSERT_EQ(counter_set_read(set, 0), (uint64_t)COUNTER_TEST_THREADS * COUNTER_TEST_ITERS);
+    ASSERT_EQ(counter_set_read(set, 1), (uint64_t)COUNTER_TEST_THREADS * COUNTER_TEST_ITERS * 3);
+    
+    // Campos fuera de rango se ignoran
+    counter_set_add(set, 5, 1);
+    ASSERT_EQ(counter_set_read(set, 5), 0);
+    ASSERT_NULL(counter_set_create(COUNTER_MAX_FIELDS + 1));
+    
+    counter_set_destroy(set);
+}
+
+TEST(test_metrics_request_counters) {
+    metrics_init();
+    
+    metrics_increment_requests();
+    metrics_increment_requests();
+    metrics_increment_errors();
+    
+    char buffer[4096];
+    metrics_get_json(buffer, sizeof(buffer));
+    ASSERT_TRUE(strstr(buffer, "\"total_requests\": 2") != NULL);
+    ASSERT_TRUE(strstr(buffer, "\"total_errors\": 1") != NULL);
+    
+    metrics_destroy();
+}
+
+// ============================================================================
+// TESTS DE EXPOSICIÓN PROMETHEUS
+// ============================================================================
+
+typedef struct {
+    char data[65536];
+    size_t len;
+} prom_buffer_t;
+
+static void prom_collect(void *ctx, const char *data, size_t len) {
+    prom_buffer_t *buf = (prom_buffer_t*)ctx;
+    if (buf->len + len >= sizeof(buf->data)) return;
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+}
+
+TEST(test_metrics_prometheus) {
+    metrics_init();
+    metrics_register_command("isprime", 4, 64, 100);
+    
+    metrics_record_phase("isprime", METRICS_PHASE_EXEC, 40);       // 40 us
+    metrics_record_phase("isprime", METRICS_PHASE_EXEC, 3000);     // 3 ms
+    metrics_record_phase("isprime", METRICS_PHASE_EXEC, 2000000);  // 2 s
+    metrics_update_workers("isprime", 1);
+    
+    static prom_buffer_t buf;
+    buf.len = 0;
+    ASSERT_EQ(metrics_write_prometheus(prom_collect, &buf), 0);
+    
+    ASSERT_TRUE(strstr(buf.data, "# TYPE http_server_command_phase_seconds histogram\n") != NULL);
+    ASSERT_TRUE(strstr(buf.data, "http_server_command_executions_total{command=\"isprime\"} 3\n") != NULL);
+    ASSERT_TRUE(strstr(buf.data, "http_server_command_workers{command=\"isprime\",state=\"busy\"} 1\n") != NULL);
+    
+    // Buckets acumulados
+    ASSERT_TRUE(strstr(buf.data, "phase=\"exec\",le=\"0.00005\"} 1\n") != NULL);
+    ASSERT_TRUE(strstr(buf.data, "phase=\"exec\",le=\"0.005\"} 2\n") != NULL);
+    ASSERT_TRUE(strstr(buf.data, "phase=\"exec\",le=\"1\"} 2\n") != NULL);
+    ASSERT_TRUE(strstr(buf.data, "phase=\"exec\",le=\"2.5\"} 3\n") != NULL);
+    ASSERT_TRUE(strstr(buf.data, "phase=\"exec\",le=\"+Inf\"} 3\n") != NULL);
+    ASSERT_TRUE(strstr(buf.data, "http_server_command_phase_seconds_count{command=\"isprime\",phase=\"exec\"} 3\n") != NULL);
+    
+    metrics_destroy();
+}
+
+// ============================================================================
+// TESTS: VENTANAS DESLIZANTES
+// ============================================================================
+
+TEST(test_window_rates) {
+    rolling_window_t *w = window_create();
+    ASSERT_NOT_NULL(w);
+    
+    // 10 requests por segundo en los segundos 1000..1009, 1 error por segundo
+    for (uint64_t sec = 1000; sec < 1010; sec++) {
+        for (int i = 0; i < 10; i++) {
+            window_record_at(w, sec, 100, i == 0);
+        }
+    }
+    
+    window_summary_t s;
+    window_summarize_at(w, 1010, 10, &s);
+    ASSERT_EQ(s.seconds, 10);
+    ASSERT_EQ(s.requests, 100);
+    ASSERT_EQ(s.errors, 10);
+    ASSERT_FLOAT_EQ(s.requests_per_sec, 10.0, 0.001);
+    ASSERT_FLOAT_EQ(s.error_rate, 0.1, 0.001);
+    ASSERT_FLOAT_EQ(s.mean_us, 100.0, 0.001);
+    ASSERT_TRUE(s.p50 >= 100 && s.p50 <= 112);
+    
+    // Ventana de 1 s: solo el último segundo completo
+    window_summarize_at(w, 1010, 1, &s);
+    ASSERT_EQ(s.requests, 10);
+    
+    // El segundo en curso no se cuenta
+    window_record_at(w, 1010, 100, false);
+    window_summarize_at(w, 1010, 10, &s);
+    ASSERT_EQ(s.requests, 100);
+    
+    window_destroy(w);
+}
+
+TEST(test_window_expires_old_slots) {
+    rolling_window_t *w = window_create();
+    
+    window_record_at(w, 5000, 50, false);
+    window_record_at(w, 5000 + WINDOW_SLOTS, 70000, false);  // Recicla el mismo slot
+    
+    window_summary_t s;
+    window_summarize_at(w, 5001 + WINDOW_SLOTS, WINDOW_MAX_SECONDS, &s);
+    ASSERT_EQ(s.requests, 1);
+    ASSERT_TRUE(s.p99 >= 70000);
+    
+    // Mucho después, la ventana está vacía
+    window_summarize_at(w, 9000, 60, &s);
+    ASSERT_EQ(s.requests, 0);
+    ASSERT_EQ(s.p50, 0);
+    
+    // Los límites se recortan a [1, WINDOW_MAX_SECONDS]
+    window_summarize_at(w, 9000, 600, &s);
+    ASSERT_EQ(s.seconds, WINDOW_MAX_SECONDS);
+    
+    window_destroy(w);
+}
+
+TEST(test_metrics_window_json) {
+    metrics_init();
+    metrics_register_command("hash", 2, 16, 100);
+    metrics_record_request("hash", 250, false);
+    metrics_record_request("hash", 250, true);
+    
+    char buffer[4096];
+    int len = metrics_get_window_json(buffer, sizeof(buffer), 10);
+    ASSERT_TRUE(len > 0 && len < (int)sizeof(buffer));
+    ASSERT_TRUE(strstr(buffer, "\"window_seconds\": 10") != NULL);
+    ASSERT_TRUE(strstr(buffer, "\"hash\"") != NULL);
+    ASSERT_TRUE(strstr(buffer, "\"requests_per_sec\"") != NULL);
+    ASSERT_TRUE(strstr(buffer, "\"error_rate\"") != NULL);
+    ASSERT_TRUE(strstr(buffer, "\"p99\"") != NULL);
+    
+    metrics_destroy();
+}
+
+// ============================================================================
+// TESTS: ACCESS LOG
+// ============================================================================
+
+#define ACCESS_TEST_FILE "/tmp/test_access_log.bin"
+
+static void fill_record(access_record_t *r, int i) {
+    memset(r, 0, sizeof(*r));
+    r->timestamp_us = 1700000000123456ULL + (uint64_t)i;
+    r->status = (i % 10 == 0) ? 503 : 200;
+    r->bytes_in = 90;
+    r->bytes_out = 219;
+    r->exec_us = (uint32_t)i;
+    snprintf(r->request_id, sizeof(r->request_id), "req-%d", i);
+    strcpy(r->method, "GET");
+    snprintf(r->target, sizeof(r->target), "/isprime?n=%d", i);
+}
+
+TEST(test_access_log_format_line) {
+    access_record_t r;
+    fill_record(&r, 7);
+    
+    char line[512];
+    access_log_format_line(&r, line, sizeof(line));
+    ASSERT_TRUE(strcmp(line, "2023-11-14T22:13:20.123463Z\treq-7\tGET\t/isprime?n=7\t"
+                             "200\t90\t219\t0\t0\t7\t0") == 0);
+    
+    access_log_format_t fmt;
+    ASSERT_EQ(access_log_parse_format("binary", &fmt), 0);
+    ASSERT_EQ(fmt, ACCESS_LOG_BINARY);
+    ASSERT_EQ(access_log_parse_format("json", &fmt), -1);
+}
+
+TEST(test_access_log_binary_roundtrip) {
+    unlink(ACCESS_TEST_FILE);
+    ASSERT_EQ(access_log_init(ACCESS_TEST_FILE, ACCESS_LOG_BINARY, 50), 0);
+    ASSERT_TRUE(access_log_enabled());
+    
+    // Más de un buffer de shard: fuerza flushes por tamaño además del final
+    const int n = (ACCESS_LOG_BUFFER_SIZE / (int)sizeof(access_record_t)) * 2 + 5;
+    for (int i = 0; i < n; i++) {
+        access_record_t r;
+        fill_record(&r, i);
+        access_log_record(&r);
+    }
+    access_log_shutdown();
+    ASSERT_FALSE(access_log_enabled());
+    
+    FILE *f = fopen(ACCESS_TEST_FILE, "rb");
+    ASSERT_NOT_NULL(f);
+    access_log_header_t hdr;
+    ASSERT_EQ(fread(&hdr, sizeof(hdr), 1, f), 1);
+    ASSERT_TRUE(memcmp(hdr.magic, ACCESS_LOG_MAGIC, 4) == 0);
+    ASSERT_EQ(hdr.record_size, sizeof(access_record_t));
+    
+    // Un solo thread: todos los registros caen en el mismo shard, en orden
+    access_record_t r;
+    int count = 0, errors = 0;
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        ASSERT_EQ(r.exec_us, (uint32_t)count);
+        if (r.status >= 500) errors++;
+        count++;
+    }
+    fclose(f);
+    ASSERT_EQ(count, n);
+    ASSERT_EQ(errors, (n + 9) / 10);
+    
+    // Un archivo binario existente se reabre; uno de texto se rechaza
+    ASSERT_EQ(access_log_init(ACCESS_TEST_FILE, ACCESS_LOG_BINARY, 50), 0);
+    access_log_shutdown();
+    FILE *t = fopen(ACCESS_TEST_FILE, "w");
+    fputs("texto\n", t);
+    fclose(t);
+    ASSERT_EQ(access_log_init(ACCESS_TEST_FILE, ACCESS_LOG_BINARY, 50), -1);
+    
+    unlink(ACCESS_TEST_FILE);
+}
+
+// ============================================================================
+// TESTS: TRAZAS
+// ============================================================================
+
+typedef struct {
+    char data[65536];
+    size_t len;
+} trace_buffer_t;
+
+static void trace_collect(void *ctx, const char *data, size_t len) {
+    trace_buffer_t *buf = (trace_buffer_t*)ctx;
+    if (buf->len + len >= sizeof(buf->data)) return;
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+}
+
+TEST(test_trace_sampling) {
+    ASSERT_EQ(trace_init(0), 0);
+    ASSERT_FALSE(trace_request_begin("req-1"));
+    ASSERT_EQ(trace_tl_active, 0);
+    
+    // Misma decisión para el mismo id; ~10% muestreado
+    trace_init(10);
+    int sampled = 0;
+    for (int i = 0; i < 10000; i++) {
+        char id[32];
+        snprintf(id, sizeof(id), "req-%d", i);
+        bool first = trace_request_begin(id);
+        ASSERT_EQ(trace_request_begin(id), first);
+        if (first) sampled++;
+    }
+    trace_request_end();
+    ASSERT_TRUE(sampled > 800 && sampled < 1200);
+    
+    trace_init(0);
+}
+
+TEST(test_trace_chrome_export) {
+    trace_init(100);
+    ASSERT_TRUE(trace_request_begin("trace-test-1"));
+    
+    TRACE_BEGIN(outer);
+    TRACE_BEGIN(inner);
+    TRACE_END("inner-span", inner);
+    TRACE_END("outer-span", outer);
+    
+    struct timeval start;
+    gettimeofday(&start, NULL);
+    start.tv_usec -= 1000;  // Hace 1 ms (tv_usec puede quedar negativo: la resta lo tolera)
+    trace_span_timeval("since-span", &start, NULL);
+    trace_request_end();
+    
+    // Sin request activa no se registra nada
+    TRACE_BEGIN(ignored);
+    ASSERT_EQ(ignored, 0);
+    
+    static trace_buffer_t buf;
+    buf.len = 0;
+    int n = trace_write_chrome_json(5, trace_collect, &buf);
+    ASSERT_TRUE(n >= 3);
+    const char *prefix = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    ASSERT_TRUE(strncmp(buf.data, prefix, strlen(prefix)) == 0);
+    ASSERT_TRUE(strstr(buf.data, "\"name\":\"inner-span\",\"cat\":\"http\",\"ph\":\"X\"") != NULL);
+    ASSERT_TRUE(strstr(buf.data, "\"name\":\"outer-span\"") != NULL);
+    ASSERT_TRUE(strstr(buf.data, "\"request_id\":\"trace-test-1\"") != NULL);
+    ASSERT_TRUE(strstr(buf.data, "\n]}\n") != NULL);
+    
+    // La duración del span con timeval es ~1 ms
+    char *since = strstr(buf.data, "\"name\":\"since-span\"");
+    ASSERT_NOT_NULL(since);
+    double dur = atof(strstr(since, "\"dur\":") + 6);
+    ASSERT_TRUE(dur >= 900.0 && dur < 50000.0);
+    
+    trace_init(0);
+}
+
+// ============================================================================
+// TESTS DE MEMORIA COMPARTIDA (PREFORK)
+// ============================================================================
+
+// El arena queda activo hasta que termina el proceso: cada caso corre en un
+// hijo y reporta por exit code (0 = ok, otro valor = qué chequeo falló)
+static int run_in_child(int (*fn)(void)) {
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(fn());
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 100 + WTERMSIG(status);
+}
+
+static void wait_children(int n) {
+    for (int i = 0; i < n; i++) {
+        wait(NULL);
+    }
+}
+
+static int shm_counters_case(void) {
+    if (shm_arena_init(SHM_ARENA_DEFAULT_SIZE) != 0) return 1;
+
+    counter_set_t *set = counter_set_create(1);
+    histogram_t *h = histogram_create();
+    if (!set || !h || !shm_contains(set) || !shm_contains(h)) return 2;
+
+    // Dos procesos escriben (desde el mismo slot de thread heredado)
+    for (int p = 0; p < 2; p++) {
+        if (fork() == 0) {
+            for (int i = 0; i < 1000; i++) {
+                counter_set_add(set, 0, 1);
+                histogram_record(h, 100 + i);
+            }
+            _exit(0);
+        }
+    }
+    wait_children(2);
+
+    if (counter_set_read(set, 0) != 2000) return 3;
+    histogram_summary_t summary;
+    histogram_summarize(h, &summary);
+    if (summary.count != 2000 || summary.max < 1099) return 4;
+
+    // shm_free sobre memoria del arena no hace nada
+    counter_set_destroy(set);
+    histogram_destroy(h);
+    return shm_used() > 0 ? 0 : 5;
+}
+
+static int shm_metrics_case(void) {
+    metrics_destroy();
+    if (shm_arena_init(SHM_ARENA_DEFAULT_SIZE) != 0) return 1;
+    metrics_init();
+    if (metrics_register_command("isprime", 4, 100, 100) < 0) return 2;
+
+    for (int p = 0; p < 2; p++) {
+        if (fork() == 0) {
+            metrics_set_process(p, 2);
+            metrics_update_workers("isprime", p + 1);
+            metrics_update_queue_size("isprime", 5);
+            metrics_record_exec_time("isprime", 1000);
+            metrics_increment_requests();
+            metrics_destroy();      // Worker: no toca lo compartido
+            _exit(0);
+        }
+    }
+    wait_children(2);
+
+    command_metrics_t m;
+    if (metrics_get_command("isprime", &m) != 0) return 3;
+    if (m.exec_count != 2) return 4;
+    if (m.busy_workers != 3 || m.current_queue_size != 10) return 5;
+    if (m.total_workers != 8) return 6;     // 4 por proceso
+
+    // Un worker nuevo en el slot 1 arranca con sus gauges en cero
+    if (fork() == 0) {
+        metrics_set_process(1, 2);
+        _exit(0);
+    }
+    wait_children(1);
+    metrics_get_command("isprime", &m);
+    if (m.busy_workers != 1 || m.current_queue_size != 5) return 7;
+
+    static char json[16384];
+    if (metrics_get_json(json, sizeof(json)) <= 0 ||
+        !strstr(json, "\"total_requests\": 2,")) return 8;
+
+    metrics_destroy();
+    return 0;
+}
+
+TEST(test_shm_counters_across_processes) {
+    ASSERT_EQ(run_in_child(shm_counters_case), 0);
+}
+
+TEST(test_shm_metrics_across_processes) {
+    ASSERT_EQ(run_in_child(shm_metrics_case), 0);
+}
+
+// ============================================================================
+// TESTS DE AFINIDAD
+// ============================================================================
+
+TEST(test_affinity_parse_cpu_list) {
+    int cpus[16];
+    ASSERT_EQ(affinity_parse_cpu_list("0-3,8", cpus, 16), 5);
+    ASSERT_EQ(cpus[3], 3);
+    ASSERT_EQ(cpus[4], 8);
+    ASSERT_EQ(affinity_parse_cpu_list("2,0-1\n", cpus, 16), 3);    // Formato de sysfs
+    ASSERT_EQ(cpus[0], 0);
+    
+    ASSERT_EQ(affinity_parse_cpu_list("", cpus, 16), -1);
+    ASSERT_EQ(affinity_parse_cpu_list("3-1", cpus, 16), -1);
+    ASSERT_EQ(affinity_parse_cpu_list("1,", cpus, 16), -1);
+    ASSERT_EQ(affinity_parse_cpu_list("a", cpus, 16), -1);
+    ASSERT_EQ(affinity_parse_cpu_list("0-15", cpus, 4), -1);
+}
+
+static void* pin_worker_thread(void *arg) {
+    *(int*)arg = affinity_pin_worker();
+    return NULL;
+}
+
+TEST(test_affinity_pin_and_report) {
+    char json[1024];
+    ASSERT_EQ(affinity_init(NULL), 0);
+    ASSERT_TRUE(!affinity_enabled());
+    ASSERT_EQ(affinity_enter_compute(), 0);
+    affinity_write_json(json, sizeof(json));
+    ASSERT_TRUE(strstr(json, "\"enabled\":false") != NULL);
+    
+    ASSERT_EQ(affinity_init("0:"), -1);
+    ASSERT_EQ(affinity_init("x:0"), -1);
+    
+    // La CPU 0 siempre existe; en un thread aparte para no fijar al del test
+    ASSERT_EQ(affinity_init("0:0"), 0);
+    ASSERT_TRUE(affinity_enabled());
+    int cpu = -2;
+    pthread_t t;
+    pthread_create(&t, NULL, pin_worker_thread, &cpu);
+    pthread_join(t, NULL);
+    ASSERT_EQ(cpu, 0);
+    
+    affinity_write_json(json, sizeof(json));
+    ASSERT_TRUE(strstr(json, "\"mode\":\"manual\"") != NULL);
+    ASSERT_TRUE(strstr(json, "\"io_cpus\":\"0\"") != NULL);
+    ASSERT_TRUE(strstr(json, "\"cpu\":0,\"node\":0}") != NULL);
+    
+    ASSERT_EQ(affinity_init("off"), 0);
+}
+
 // ============================================================================
 // TEST SUITE
 // ============================================================================
@@ -248,6 +931,7 @@ void test_metrics_all() {
     RUN_TEST(test_metrics_record_exec_time);
     RUN_TEST(test_metrics_update_queue_size);
     RUN_TEST(test_metrics_update_workers);
+    RUN_TEST(test_metrics_gauges_per_command);
     
     // Desviación estándar
     RUN_TEST(test_metrics_stddev_calculation);
@@ -262,6 +946,40 @@ void test_metrics_all() {
     RUN_TEST(test_metrics_no_data);
     RUN_TEST(test_metrics_buffer_overflow);
     
+    // Histogramas y fases
+    RUN_TEST(test_histogram_buckets);
+    RUN_TEST(test_histogram_percentiles);
+    RUN_TEST(test_metrics_record_phase);
+    RUN_TEST(test_metrics_get_json_grows);
+    
+    // Contadores por thread
+    RUN_TEST(test_counter_set_concurrent);
+    RUN_TEST(test_metrics_request_counters);
+    
+    // Prometheus
+    RUN_TEST(test_metrics_prometheus);
+    
+    // Ventanas deslizantes
+    RUN_TEST(test_window_rates);
+    RUN_TEST(test_window_expires_old_slots);
+    RUN_TEST(test_metrics_window_json);
+    
+    // Access log
+    RUN_TEST(test_access_log_format_line);
+    RUN_TEST(test_access_log_binary_roundtrip);
+    
+    // Trazas
+    RUN_TEST(test_trace_sampling);
+    RUN_TEST(test_trace_chrome_export);
+    
+    // Afinidad
+    RUN_TEST(test_affinity_parse_cpu_list);
+    RUN_TEST(test_affinity_pin_and_report);
+    
+    // Memoria compartida (prefork)
+    RUN_TEST(test_shm_counters_across_processes);
+    RUN_TEST(test_shm_metrics_across_processes);
+    
     printf("\n");
 }
 
@@ -242,6 +242,56 @@ TEST(test_queue_stats) {
     queue_destroy(queue);
 }
 
+// ============================================================================
+// TESTS DE DEADLINE
+// ============================================================================
+
+static int g_expired_calls = 0;
+
+static void count_expired(task_t *task, void *ctx) {
+    (void)task;
+    (void)ctx;
+    g_expired_calls++;
+}
+
+TEST(test_task_deadline) {
+    task_t *task = task_create(1, "/test", NULL, "req");
+    
+    // Sin deadline por defecto
+    ASSERT_FALSE(task_is_expired(task));
+    ASSERT_EQ(task_remaining_ms(task), -1);
+    
+    task_set_deadline_ms(task, 10000);
+    ASSERT_FALSE(task_is_expired(task));
+    ASSERT_TRUE(task_remaining_ms(task) > 9000);
+    
+    task_free(task);
+}
+
+TEST(test_dequeue_skips_expired) {
+    queue_t *queue = queue_create(10);
+    g_expired_calls = 0;
+    queue_set_expired_handler(queue, count_expired, NULL);
+    
+    task_t *stale = task_create(1, "/test", NULL, "stale");
+    task_set_deadline_ms(stale, 1);
+    task_t *fresh = task_create(2, "/test", NULL, "fresh");
+    task_set_deadline_ms(fresh, 10000);
+    
+    queue_enqueue(queue, stale, 0);
+    queue_enqueue(queue, fresh, 0);
+    usleep(5000); // Dejar vencer la primera
+    
+    task_t *task = queue_dequeue_timeout(queue, 100);
+    ASSERT_NOT_NULL(task);
+    ASSERT_STR_EQ(task->request_id, "fresh");
+    ASSERT_EQ(g_expired_calls, 1);
+    ASSERT_EQ(queue_get_expired(queue), 1);
+    task_free(task);
+    
+    queue_destroy(queue);
+}
+
 // ============================================================================
 // TESTS DE CONCURRENCIA
 // ============================================================================
@@ -518,6 +568,10 @@ void test_queue_all() {
     // Tests de métricas
     RUN_TEST(test_queue_stats);
     
+    // Tests de deadline
+    RUN_TEST(test_task_deadline);
+    RUN_TEST(test_dequeue_skips_expired);
+    
     // Tests de concurrencia
     RUN_TEST(test_concurrent_multiple_producers);
     RUN_TEST(test_concurrent_producer_consumer);
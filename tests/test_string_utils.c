@@ -9,6 +9,7 @@
 // - Documentación viva: los tests muestran cómo usar las funciones
 #include "test_utils.h"
 #include "../src/utils/utils.h"
+#include <unistd.h>
 
 // ============================================================================
 // TESTS DE URL_DECODE
@@ -261,6 +262,181 @@ TEST(test_get_query_param_long_not_exists) {
     free_query_params(params);
 }
 
+// ============================================================================
+// TESTS DE REQUEST IDS
+// ============================================================================
+
+#define ID_THREADS 4
+#define ID_PER_THREAD 5000
+
+static char g_ids[ID_THREADS * ID_PER_THREAD][40];
+
+static void* id_thread(void *arg) {
+    long t = (long)arg;
+    for (int i = 0; i < ID_PER_THREAD; i++) {
+        generate_request_id(g_ids[t * ID_PER_THREAD + i], sizeof(g_ids[0]));
+    }
+    return NULL;
+}
+
+static int cmp_ids(const void *a, const void *b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+static bool ids_unique_across_threads(request_id_format_t format) {
+    request_id_set_format(format);
+    pthread_t threads[ID_THREADS];
+    for (long i = 0; i < ID_THREADS; i++) {
+        pthread_create(&threads[i], NULL, id_thread, (void*)i);
+    }
+    for (int i = 0; i < ID_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    request_id_set_format(REQUEST_ID_COMPACT);
+    
+    qsort(g_ids, ID_THREADS * ID_PER_THREAD, sizeof(g_ids[0]), cmp_ids);
+    for (int i = 1; i < ID_THREADS * ID_PER_THREAD; i++) {
+        if (strcmp(g_ids[i - 1], g_ids[i]) == 0) return false;
+    }
+    return true;
+}
+
+TEST(test_request_id_compact_format) {
+    char a[64], b[64];
+    generate_compact_id(a, sizeof(a));
+    generate_compact_id(b, sizeof(b));
+    
+    ASSERT_EQ(strlen(a), REQUEST_ID_COMPACT_LEN);
+    ASSERT_EQ(a[10], '-');
+    ASSERT_EQ(a[19], '-');
+    ASSERT_TRUE(strspn(a, "0123456789abcdef-") == REQUEST_ID_COMPACT_LEN);
+    
+    // Mismo thread: mismo prefijo, contador +1
+    ASSERT_TRUE(strncmp(a, b, 20) == 0);
+    ASSERT_EQ(strtoul(b + 20, NULL, 16), strtoul(a + 20, NULL, 16) + 1);
+    
+    // Buffer chico: no escribe
+    char small[8] = "intacto";
+    generate_compact_id(small, sizeof(small));
+    ASSERT_TRUE(strcmp(small, "intacto") == 0);
+}
+
+TEST(test_request_id_uuid_v7_format) {
+    char prev[64] = "";
+    for (int i = 0; i < 5000; i++) {
+        char id[64];
+        generate_uuid_v7(id, sizeof(id));
+        ASSERT_EQ(strlen(id), REQUEST_ID_UUID_LEN);
+        ASSERT_TRUE(id[8] == '-' && id[13] == '-' && id[18] == '-' && id[23] == '-');
+        ASSERT_EQ(id[14], '7');                         // Versión
+        ASSERT_TRUE(strchr("89ab", id[19]) != NULL);    // Variante RFC 9562
+        ASSERT_TRUE(strcmp(prev, id) < 0);              // Crecientes en el thread
+        strcpy(prev, id);
+    }
+    
+    // Los primeros 48 bits son el timestamp en ms
+    char id[64];
+    generate_uuid_v7(id, sizeof(id));
+    char hex[13];
+    memcpy(hex, id, 8);
+    memcpy(hex + 8, id + 9, 4);
+    hex[12] = '\0';
+    unsigned long long ms = strtoull(hex, NULL, 16);
+    unsigned long long now = (unsigned long long)time(NULL) * 1000ULL;
+    ASSERT_TRUE(ms + 5000 > now && ms < now + 5000);
+}
+
+TEST(test_request_id_unique_across_threads) {
+    ASSERT_TRUE(ids_unique_across_threads(REQUEST_ID_COMPACT));
+    ASSERT_TRUE(ids_unique_across_threads(REQUEST_ID_UUID7));
+    
+    request_id_format_t fmt;
+    ASSERT_EQ(request_id_parse_format("uuid7", &fmt), 0);
+    ASSERT_EQ(fmt, REQUEST_ID_UUID7);
+    ASSERT_EQ(request_id_parse_format("uuid4", &fmt), -1);
+}
+
+// ============================================================================
+// TESTS DEL LOGGER
+// ============================================================================
+
+#define LOG_TEST_FILE "/tmp/test_logger.log"
+#define LOG_TEST_THREADS 4
+#define LOG_TEST_LINES 2000
+
+static int count_lines(const char *path, const char *needle) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char line[512];
+    int count = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (!needle || strstr(line, needle)) count++;
+    }
+    fclose(f);
+    return count;
+}
+
+static void* log_thread(void *arg) {
+    long id = (long)arg;
+    for (int i = 0; i < LOG_TEST_LINES; i++) {
+        LOG_INFO("thread %ld line %d", id, i);
+    }
+    return NULL;
+}
+
+TEST(test_logger_concurrent_block) {
+    unlink(LOG_TEST_FILE);
+    logger_init(LOG_INFO, LOG_TEST_FILE);
+    logger_set_overflow(LOG_OVERFLOW_BLOCK);
+    
+    // Más líneas que entradas tiene un ring: con BLOCK no se pierde ninguna
+    pthread_t threads[LOG_TEST_THREADS];
+    for (long i = 0; i < LOG_TEST_THREADS; i++) {
+        pthread_create(&threads[i], NULL, log_thread, (void*)i);
+    }
+    for (int i = 0; i < LOG_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    LOG_DEBUG("filtrado por nivel");
+    logger_flush();
+    
+    ASSERT_EQ(count_lines(LOG_TEST_FILE, NULL), LOG_TEST_THREADS * LOG_TEST_LINES);
+    ASSERT_EQ(count_lines(LOG_TEST_FILE, "] [INFO ] [test_string_utils.c:"), 
+              LOG_TEST_THREADS * LOG_TEST_LINES);
+    ASSERT_EQ(count_lines(LOG_TEST_FILE, "thread 3 line 1999\n"), 1);
+    ASSERT_EQ(logger_dropped(), 0);
+    
+    logger_set_overflow(LOG_OVERFLOW_DROP);
+    logger_shutdown();
+    unlink(LOG_TEST_FILE);
+}
+
+TEST(test_logger_truncates_and_writes_after_shutdown) {
+    unlink(LOG_TEST_FILE);
+    logger_init(LOG_INFO, LOG_TEST_FILE);
+    
+    char big[1024];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    LOG_WARN("%s", big);
+    logger_flush();
+    
+    FILE *f = fopen(LOG_TEST_FILE, "r");
+    ASSERT_NOT_NULL(f);
+    char line[2048];
+    ASSERT_NOT_NULL(fgets(line, sizeof(line), f));
+    fclose(f);
+    ASSERT_TRUE(strstr(line, "[WARN ]") != NULL);
+    ASSERT_TRUE(strlen(strchr(line, 'x')) == LOG_MAX_MESSAGE - 1); // x...x\n
+    
+    logger_shutdown();
+    
+    // Después del shutdown los mensajes se escriben directo (a stderr)
+    LOG_INFO("despues del shutdown");
+    ASSERT_EQ(count_lines(LOG_TEST_FILE, NULL), 1);
+    unlink(LOG_TEST_FILE);
+}
+
 // ============================================================================
 // TEST SUITE PRINCIPAL
 // ============================================================================
@@ -311,6 +487,15 @@ void test_string_utils_all() {
     RUN_TEST(test_get_query_param_long_valid);
     RUN_TEST(test_get_query_param_long_not_exists);
     
+    // Tests de request IDs
+    RUN_TEST(test_request_id_compact_format);
+    RUN_TEST(test_request_id_uuid_v7_format);
+    RUN_TEST(test_request_id_unique_across_threads);
+    
+    // Tests del logger
+    RUN_TEST(test_logger_concurrent_block);
+    RUN_TEST(test_logger_truncates_and_writes_after_shutdown);
+    
     printf("\n");
 }
 